@@ -0,0 +1,56 @@
+import glob
+import json
+import os
+import unittest
+import numpy as np
+import ivcmp
+
+json_folder = "test_data"
+max_score_deviation = 0.005
+iv_curve = ivcmp.IvCurve()
+ivc_curve = ivcmp.IvCurve()
+
+
+def _set_curve(curve, ivc):
+    n_points = len(ivc["voltage"])
+    curve.length = n_points
+    curve.voltages[:n_points] = ivc["voltage"]
+    curve.currents[:n_points] = ivc["current"]
+
+
+class TestPrecision(unittest.TestCase):
+
+    def tearDown(self):
+        ivcmp.SetPrecision(ivcmp.PRECISION_DOUBLE)
+
+    def test_float_deviation(self):
+        max_deviation = 0.
+        common_count = 0
+        for filename in sorted(glob.glob(os.path.join(json_folder, "elements (*).json"))):
+            with open(filename) as f:
+                ivc_data = json.load(f)
+            for pin in ivc_data["elements"][0]["pins"]:
+                common_count += 1
+                _set_curve(iv_curve, pin["ivc"])
+                _set_curve(ivc_curve, pin["reference_ivc"])
+                ivcmp.SetMinVarVC(0.03 * np.max(np.abs(pin["ivc"]["voltage"])),
+                                  0.03 * np.max(np.abs(pin["ivc"]["current"])))
+                ivcmp.SetPrecision(ivcmp.PRECISION_DOUBLE)
+                score_double = ivcmp.CompareIvc(iv_curve, ivc_curve)
+                ivcmp.SetPrecision(ivcmp.PRECISION_FLOAT)
+                score_float = ivcmp.CompareIvc(iv_curve, ivc_curve)
+                deviation = abs(score_float - score_double)
+                if deviation > max_deviation:
+                    max_deviation = deviation
+                self.assertLess(deviation, max_score_deviation,
+                                "{}, pin {}".format(filename, ivc_data["elements"][0]["pins"].index(pin)))
+        print("Max deviation of float scores is {} for {} comparing".format(max_deviation, common_count))
+
+    def test_unsupported_precision(self):
+        with self.assertRaises(ValueError):
+            ivcmp.SetPrecision(2)
+        self.assertEqual(ivcmp.GetPrecision(), ivcmp.PRECISION_DOUBLE)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,66 @@
+import glob
+import json
+import os
+import unittest
+import numpy as np
+import ivcmp
+
+json_folder = "test_data"
+resampling_step = 0.1
+max_score_deviation = 0.005
+long_curve_factor = 20
+iv_curve = ivcmp.IvCurve()
+ivc_curve = ivcmp.IvCurve()
+
+
+def _curve_arrays(ivc, factor):
+    n_points = len(ivc["voltage"])
+    points = np.linspace(0, n_points - 1, (n_points - 1) * factor + 1)
+    return (np.interp(points, np.arange(n_points), ivc["voltage"]),
+            np.interp(points, np.arange(n_points), ivc["current"]))
+
+
+class TestResampling(unittest.TestCase):
+
+    def tearDown(self):
+        ivcmp.SetResampling(0)
+
+    def _check_deviation(self, factor):
+        max_deviation = 0.
+        common_count = 0
+        for filename in sorted(glob.glob(os.path.join(json_folder, "elements (*).json"))):
+            with open(filename) as f:
+                ivc_data = json.load(f)
+            for pin in ivc_data["elements"][0]["pins"]:
+                common_count += 1
+                voltages_a, currents_a = _curve_arrays(pin["ivc"], factor)
+                voltages_b, currents_b = _curve_arrays(pin["reference_ivc"], factor)
+                ivcmp.SetMinVarVC(0.03 * np.max(np.abs(pin["ivc"]["voltage"])),
+                                  0.03 * np.max(np.abs(pin["ivc"]["current"])))
+                ivcmp.SetResampling(0)
+                score, _ = ivcmp.CompareIvcBatch(voltages_a[None], currents_a[None],
+                                                 voltages_b[None], currents_b[None])
+                ivcmp.SetResampling(resampling_step)
+                resampled_score, _ = ivcmp.CompareIvcBatch(voltages_a[None], currents_a[None],
+                                                           voltages_b[None], currents_b[None])
+                deviation = abs(resampled_score[0] - score[0])
+                if deviation > max_deviation:
+                    max_deviation = deviation
+                self.assertLess(deviation, max_score_deviation,
+                                "{}, pin {}".format(filename, ivc_data["elements"][0]["pins"].index(pin)))
+        print("Max deviation of resampled scores is {} for {} comparing".format(max_deviation, common_count))
+
+    def test_resampling_deviation(self):
+        self._check_deviation(1)
+
+    def test_long_curves_deviation(self):
+        self._check_deviation(long_curve_factor)
+
+    def test_invalid_step(self):
+        with self.assertRaises(ValueError):
+            ivcmp.SetResampling(-1)
+        self.assertEqual(ivcmp.GetResampling(), 0)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -1,4 +1,5 @@
-from ctypes import CDLL, Structure, Array, c_ubyte, c_double, c_size_t, POINTER, pointer
+from ctypes import (CDLL, Structure, Array, c_ubyte, c_char_p, c_double, c_int, c_uint32, c_uint64, c_size_t,
+                    c_void_p, POINTER, pointer)
 from platform import system
 import numpy as np
 import logging
@@ -111,9 +112,9 @@ class IvCurve(_IterableStructure):
                 len(new_voltages_array), MAX_NUM_POINTS
             ))
 
-        for i in range(len(new_voltages_array)):
-            # Elementwise assignment for correct ctypes conversion
-            self._voltages[i] = c_double(new_voltages_array[i])
+        # One vectorized copy into the ctypes array
+        values = np.asarray(new_voltages_array, dtype=np.float64)
+        np.ctypeslib.as_array(self._voltages)[:len(values)] = values
 
     @property
     def currents(self):
@@ -126,9 +127,9 @@ class IvCurve(_IterableStructure):
                 len(new_currents_array), MAX_NUM_POINTS
             ))
 
-        for i in range(len(new_currents_array)):
-            # Elementwise assignment for correct ctypes conversion
-            self._currents[i] = c_double(new_currents_array[i])
+        # One vectorized copy into the ctypes array
+        values = np.asarray(new_currents_array, dtype=np.float64)
+        np.ctypeslib.as_array(self._currents)[:len(values)] = values
 
 
 def SetMinVarVC(min_var_v, min_var_c):
@@ -162,7 +163,8 @@ def SetMinVarVC(min_var_v, min_var_c):
     @param min_var_c Характерный масштаб по току. Единицы измерения: мА.
     """
     lib_func = lib.SetMinVarVC
-    lib_func.argtype = c_double, c_double
+    lib_func.argtypes = c_double, c_double
+    lib_func.restype = None
     lib_func(c_double(min_var_v),  c_double(min_var_c))
 
 
@@ -185,12 +187,10 @@ def SetMinVarVCFromCurves(open_circuit_iv_curve, short_circuit_iv_curve):
     @param short_circuit_iv_curve сигнатура, снятая при разомкнутых щупах (объект типа IvCurve)
     """
     lib_func = lib.SetMinVarVCFromCurves
-    lib_func.argtype = POINTER(c_double), POINTER(c_double), c_size_t, POINTER(c_double), POINTER(c_double), c_size_t
-    lib_func.restype = c_double
-    res = lib_func(open_circuit_iv_curve.voltages, open_circuit_iv_curve.currents, open_circuit_iv_curve.length,
-                   short_circuit_iv_curve.voltages, short_circuit_iv_curve.currents, short_circuit_iv_curve.length)
-    res = _normalize_arg(res, c_double)
-    return res
+    lib_func.argtypes = POINTER(c_double), POINTER(c_double), c_uint32, POINTER(c_double), POINTER(c_double), c_uint32
+    lib_func.restype = None
+    lib_func(open_circuit_iv_curve.voltages, open_circuit_iv_curve.currents, open_circuit_iv_curve.length,
+             short_circuit_iv_curve.voltages, short_circuit_iv_curve.currents, short_circuit_iv_curve.length)
 
 
 def GetMinVarVC():
@@ -202,12 +202,194 @@ def GetMinVarVC():
     min_var_c = c_double()
 
     lib_func = lib.GetMinVarVC
-    lib_func.argtype = POINTER(c_double), POINTER(c_double)
+    lib_func.argtypes = POINTER(c_double), POINTER(c_double)
+    lib_func.restype = None
 
     lib_func(pointer(min_var_v), pointer(min_var_c))
     return min_var_v.value, min_var_c.value
 
 
+PRECISION_DOUBLE = 0
+PRECISION_FLOAT = 1
+
+
+def SetPrecision(precision):
+    """
+    Функция установки точности вычисления расстояний между кривыми.
+    Одинарная точность (PRECISION_FLOAT) ускоряет сравнение длинных кривых,
+    степень различия при этом отличается от вычисленной с двойной точностью (PRECISION_DOUBLE)
+    не более чем на 0.005.
+    @param precision точность вычислений (PRECISION_DOUBLE или PRECISION_FLOAT)
+    """
+    lib_func = lib.SetIVCPrecision
+    lib_func.argtypes = c_int,
+    lib_func.restype = c_int
+    if lib_func(c_int(precision)) != 0:
+        raise ValueError("Unsupported precision {}".format(precision))
+
+
+def GetPrecision():
+    """
+    Функция для получения текущей точности вычисления расстояний между кривыми.
+    Подробнее см. описание функции SetPrecision.
+    """
+    lib_func = lib.GetIVCPrecision
+    lib_func.restype = c_int
+    return lib_func()
+
+
+def SetResampling(step):
+    """
+    Функция установки шага передискретизации кривых.
+    При ненулевом шаге кривые пересчитываются B-сплайном в количество точек, зависящее от их длины
+    в нормированных координатах, а не от количества измеренных точек: соседние точки отстоят вдоль кривой
+    не более чем на step. Длинные записи простых кривых при этом сравниваются значительно быстрее.
+    При шаге 0.1 степень различия отличается от вычисленной без передискретизации не более чем на 0.005.
+    Подробнее см. описание SetIVCResampling() в ivcmp.h.
+    @param step наибольший шаг вдоль кривых в единицах масштабов (0 - без передискретизации)
+    """
+    lib_func = lib.SetIVCResampling
+    lib_func.argtypes = c_double,
+    lib_func.restype = c_int
+    if lib_func(step) != 0:
+        raise ValueError("Invalid resampling step {}".format(step))
+
+
+def GetResampling():
+    """
+    Функция для получения текущего шага передискретизации кривых (0 - без передискретизации).
+    Подробнее см. описание функции SetResampling.
+    """
+    lib_func = lib.GetIVCResampling
+    lib_func.restype = c_double
+    return lib_func()
+
+
+STAGE_NORMALIZE = 0
+STAGE_REMOVE_REPEATS = 1
+STAGE_BSPLINE = 2
+STAGE_DISTANCE = 3
+NUM_STAGES = 4
+
+
+class Stats(_IterableStructure):
+    """
+    Статистика работы библиотеки во всех потоках процесса.
+    stage_calls и stage_time - количество измерений и суммарное время [нс] этапов сравнения
+    (STAGE_NORMALIZE, STAGE_REMOVE_REPEATS, STAGE_BSPLINE, STAGE_DISTANCE), см. SetStatsTimers.
+    """
+    _fields_ = (
+        ("comparisons", c_uint64),
+        ("prepared_curves", c_uint64),
+        ("short_curves", c_uint64),
+        ("identical_curves", c_uint64),
+        ("curves_with_repeats", c_uint64),
+        ("repeats_removed", c_uint64),
+        ("min_var_v_clamped", c_uint64),
+        ("min_var_c_clamped", c_uint64),
+        ("threshold_cutoffs", c_uint64),
+        ("stage_calls", c_uint64*NUM_STAGES),
+        ("stage_time", c_uint64*NUM_STAGES)
+    )
+
+    def as_dict(self):
+        """
+        Статистика в виде словаря для передачи в системы мониторинга.
+        """
+        return {name: list(getattr(self, name)) if name.startswith("stage_") else getattr(self, name)
+                for name, _ in self._fields_}
+
+
+def GetStats():
+    """
+    Функция получения статистики работы библиотеки: количества сравнений, вырожденных кривых,
+    удалённых повторяющихся точек, ограничений разброса порогами масштабирования и времени этапов сравнения.
+    Счётчики суммируются по всем потокам с последнего вызова ResetStats.
+    """
+    stats = Stats()
+    lib.GetIVCStats.argtypes = POINTER(Stats),
+    lib.GetIVCStats.restype = c_int
+    status = lib.GetIVCStats(pointer(stats))
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.GetIVCStats() call, status {}".format(status))
+    return stats
+
+
+def ResetStats():
+    """
+    Функция обнуления статистики работы библиотеки во всех потоках.
+    """
+    lib.ResetIVCStats.restype = None
+    lib.ResetIVCStats()
+
+
+def SetStatsTimers(enable):
+    """
+    Функция включения и выключения измерения времени этапов сравнения (по умолчанию выключено).
+    @param enable True - включить измерение, False - выключить
+    """
+    lib.SetIVCStatsTimers.argtypes = c_int,
+    lib.SetIVCStatsTimers.restype = c_int
+    status = lib.SetIVCStatsTimers(1 if enable else 0)
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.SetIVCStatsTimers() call, status {}".format(status))
+
+
+class CacheStats(_IterableStructure):
+    """
+    Счётчики кэша результатов сравнения, см. SetCacheCapacity.
+    """
+    _fields_ = (
+        ("hits", c_uint64),
+        ("misses", c_uint64),
+        ("evictions", c_uint64),
+        ("entries", c_uint32),
+        ("capacity", c_uint32)
+    )
+
+    def as_dict(self):
+        """
+        Счётчики в виде словаря для передачи в системы мониторинга.
+        """
+        return {name: getattr(self, name) for name, _ in self._fields_}
+
+
+def SetCacheCapacity(capacity):
+    """
+    Функция включения кэша результатов сравнения, общего для всех потоков. Если пара кривых с теми же
+    значениями и настройками сравнения уже сравнивалась, степень различия берётся из кэша.
+    Изменение размера очищает кэш и его счётчики.
+    @param capacity наибольшее количество степеней различия в кэше, 0 - выключить кэш
+    """
+    lib.SetIVCCacheCapacity.argtypes = c_uint32,
+    lib.SetIVCCacheCapacity.restype = c_int
+    status = lib.SetIVCCacheCapacity(capacity)
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.SetIVCCacheCapacity() call, status {}".format(status))
+
+
+def GetCacheStats():
+    """
+    Функция получения счётчиков кэша результатов сравнения: попаданий, промахов, вытеснений
+    и заполненности кэша.
+    """
+    stats = CacheStats()
+    lib.GetIVCCacheStats.argtypes = POINTER(CacheStats),
+    lib.GetIVCCacheStats.restype = c_int
+    status = lib.GetIVCCacheStats(pointer(stats))
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.GetIVCCacheStats() call, status {}".format(status))
+    return stats
+
+
+def ClearCache():
+    """
+    Функция очистки кэша результатов сравнения и обнуления его счётчиков.
+    """
+    lib.ClearIVCCache.restype = None
+    lib.ClearIVCCache()
+
+
 def CompareIvc(first_iv_curve, second_iv_curve):
     """
     Функция для сравнения двух сигнатур (ВАХ).
@@ -230,7 +412,7 @@ def CompareIvc(first_iv_curve, second_iv_curve):
         raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
 
     lib_func = lib.CompareIVC
-    lib_func.argtype = POINTER(c_double), POINTER(c_double), c_size_t, POINTER(c_double), POINTER(c_double), c_size_t
+    lib_func.argtypes = POINTER(c_double), POINTER(c_double), c_uint32, POINTER(c_double), POINTER(c_double), c_uint32
     lib_func.restype = c_double
     res = lib_func(first_iv_curve.voltages, first_iv_curve.currents, first_iv_curve.length,
                    second_iv_curve.voltages, second_iv_curve.currents, second_iv_curve.length)
@@ -242,6 +424,558 @@ def CompareIvc(first_iv_curve, second_iv_curve):
     return res
 
 
+def _create_context():
+    """
+    Создаёт контекст сравнения с текущими порогами масштабирования, точностью и шагом передискретизации.
+    Контекст необходимо удалить функцией lib.DestroyIVCContext().
+    """
+    lib.CreateIVCContext.restype = c_void_p
+    lib.DestroyIVCContext.argtypes = c_void_p,
+    lib.SetContextMinVarVC.argtypes = c_void_p, c_double, c_double
+    lib.SetContextPrecision.argtypes = c_void_p, c_int
+    lib.SetContextResampling.argtypes = c_void_p, c_double
+    ctx = lib.CreateIVCContext()
+    if not ctx:
+        raise MemoryError("Unable to create comparison context")
+    lib.SetContextMinVarVC(ctx, *GetMinVarVC())
+    lib.SetContextPrecision(ctx, GetPrecision())
+    lib.SetContextResampling(ctx, GetResampling())
+    return ctx
+
+
+def CompareIvcThreshold(first_iv_curve, second_iv_curve, threshold):
+    """
+    Функция проверки того, что степень различия двух сигнатур не превышает порог
+    (например, при отбраковке выводов платы).
+    Сравнение прекращается, как только становится ясно, что порог превышен,
+    поэтому сильно различающиеся сигнатуры проверяются быстрее, чем функцией CompareIvc().
+    @param first_iv_curve первая кривая для сравнения (объект типа IvCurve)
+    @param second_iv_curve вторая кривая для сравнения (объект типа IvCurve)
+    @param threshold порог степени различия от 0 до 1
+    @return пара (passed, score): passed - True, если порог не превышен;
+    score - степень различия, если порог не превышен, иначе её нижняя оценка, превышающая порог
+    """
+    if first_iv_curve.length == 0 or second_iv_curve.length == 0:
+        raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
+    if not 0 <= threshold <= 1:
+        raise ValueError("Threshold should be in range [0, 1]")
+
+    lib_func = lib.CompareIVCThreshold
+    lib_func.argtypes = (c_void_p, POINTER(c_double), POINTER(c_double), c_uint32,
+                         POINTER(c_double), POINTER(c_double), c_uint32, c_double, POINTER(c_int), POINTER(c_double))
+    lib_func.restype = c_int
+    verdict = c_int()
+    score = c_double()
+
+    ctx = _create_context()
+    try:
+        status = lib_func(ctx, first_iv_curve.voltages, first_iv_curve.currents, first_iv_curve.length,
+                          second_iv_curve.voltages, second_iv_curve.currents, second_iv_curve.length,
+                          threshold, pointer(verdict), pointer(score))
+    finally:
+        lib.DestroyIVCContext(ctx)
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.CompareIVCThreshold() call, status {}".format(status))
+    return verdict.value == 0, score.value
+
+
+def CaptureIvc(first_iv_curve, second_iv_curve, file_name=None):
+    """
+    Функция сравнения двух сигнатур с захватом промежуточных данных всех этапов сравнения
+    (для отладки отдельных выводов без пересборки библиотеки).
+    Графики этапов строит скрипт utils/plot_debug_data.py по сохранённому дампу.
+    @param first_iv_curve первая кривая для сравнения (объект типа IvCurve)
+    @param second_iv_curve вторая кривая для сравнения (объект типа IvCurve)
+    @param file_name имя файла для сохранения дампа (допускается None)
+    @return пара (score, dump): score - степень различия, dump - двоичный дамп этапов сравнения (bytes)
+    """
+    if first_iv_curve.length == 0 or second_iv_curve.length == 0:
+        raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
+
+    lib.SetContextCaptureBuffer.argtypes = c_void_p, c_void_p, c_size_t
+    lib.SetContextCaptureBuffer.restype = c_int
+    lib.GetContextCaptureSize.argtypes = c_void_p,
+    lib.GetContextCaptureSize.restype = c_size_t
+    lib.CompareIVCWithContext.argtypes = (c_void_p, POINTER(c_double), POINTER(c_double), c_uint32,
+                                          POINTER(c_double), POINTER(c_double), c_uint32, POINTER(c_double))
+    lib.CompareIVCWithContext.restype = c_int
+    # Header, 12 records and their arrays: 4 stages of both curves before and 1 after B-spline, 5 values
+    points = first_iv_curve.length + second_iv_curve.length
+    buffer = (c_ubyte * (24 + 12 * 16 + 8 * (8 * points + 4 * max(first_iv_curve.length,
+                                                                  second_iv_curve.length) + 5)))()
+    score = c_double()
+
+    ctx = _create_context()
+    try:
+        status = lib.SetContextCaptureBuffer(ctx, buffer, len(buffer))
+        if status == 0:
+            status = lib.CompareIVCWithContext(ctx, first_iv_curve.voltages, first_iv_curve.currents,
+                                               first_iv_curve.length, second_iv_curve.voltages,
+                                               second_iv_curve.currents, second_iv_curve.length, pointer(score))
+        dump = bytes(buffer[:lib.GetContextCaptureSize(ctx)])
+    finally:
+        lib.DestroyIVCContext(ctx)
+    if file_name is not None:
+        with open(file_name, "wb") as f:
+            f.write(dump)
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.CompareIVCWithContext() call, status {}".format(status))
+    return score.value, dump
+
+
+def CompareIvcMatrix(iv_curves, packed=False, num_threads=0):
+    """
+    Функция сравнения каждой сигнатуры из списка с каждой (например, для группировки выводов платы).
+    Каждая сигнатура обрабатывается один раз, каждая пара сравнивается один раз в нескольких потоках.
+    Используются текущие пороги масштабирования (см. SetMinVarVC) и точность (см. SetPrecision).
+    Степень различия каждой пары совпадает с результатом CompareIvc().
+    @param iv_curves список сигнатур (объектов типа IvCurve)
+    @param packed False - вернуть полную матрицу K x K,
+    True - вернуть элементы над главной диагональью по строкам (K * (K - 1) / 2 элементов)
+    @param num_threads количество потоков (0 - по количеству процессоров)
+    @return массив numpy со степенями различия
+    """
+    k = len(iv_curves)
+    for curve in iv_curves:
+        if curve.length == 0:
+            raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
+    voltages = (POINTER(c_double) * k)(*[curve.voltages for curve in iv_curves])
+    currents = (POINTER(c_double) * k)(*[curve.currents for curve in iv_curves])
+    lengths = (c_uint32 * k)(*[curve.length for curve in iv_curves])
+    scores = np.empty(k * (k - 1) // 2 if packed else k * k, dtype=np.float64)
+
+    lib_func = lib.CompareIVCMatrix
+    lib_func.argtypes = (c_void_p, POINTER(POINTER(c_double)), POINTER(POINTER(c_double)), POINTER(c_uint32),
+                         c_uint32, c_int, c_uint32, POINTER(c_double))
+    lib_func.restype = c_int
+
+    ctx = _create_context()
+    try:
+        status = lib_func(ctx, voltages, currents, lengths, k, 1 if packed else 0, num_threads,
+                          scores.ctypes.data_as(POINTER(c_double)))
+    finally:
+        lib.DestroyIVCContext(ctx)
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.CompareIVCMatrix() call, status {}".format(status))
+    return scores if packed else scores.reshape(k, k)
+
+
+def _as_doubles(array):
+    """
+    Возвращает массив numpy типа float64 с последовательным расположением элементов.
+    Такой массив (например, строки двумерного массива numpy) передаётся библиотеке без копирования.
+    """
+    return np.ascontiguousarray(array, dtype=np.float64)
+
+
+def _batch_offsets(offsets, array, name):
+    """
+    Возвращает смещения кривых в массиве для CompareIVCBatch():
+    заданные смещения или смещения строк двумерного массива.
+    """
+    if offsets is None:
+        if array.ndim != 2:
+            raise ValueError("{} should be 2-D array (pairs x points) or offsets should be given".format(name))
+        return np.arange(array.shape[0] + 1, dtype=np.uintp) * array.shape[1]
+    offsets = np.ascontiguousarray(offsets, dtype=np.uintp)
+    if offsets.ndim != 1 or offsets[-1] > array.size or np.any(offsets[1:] < offsets[:-1]):
+        raise ValueError("Invalid offsets of {}".format(name))
+    return offsets
+
+
+def CompareIvcBatch(voltages_a, currents_a, voltages_b, currents_b, offsets_a=None, offsets_b=None,
+                    min_var_v=None, min_var_c=None, num_threads=0):
+    """
+    Функция сравнения пар сигнатур в нескольких потоках (например, измерений платы с эталонами).
+    Сигнатуры передаются массивами numpy без копирования: двумерными массивами (пары x точки)
+    или одномерными массивами с сигнатурами подряд и смещениями их начал (для сигнатур разной длины).
+    Массивы типа float64 с последовательным расположением элементов не копируются, остальные преобразуются.
+    Во время сравнения GIL освобождён, поэтому другие потоки Python продолжают работу.
+    Степень различия каждой пары совпадает с результатом CompareIvc().
+    @param voltages_a напряжения первых сигнатур пар
+    @param currents_a токи первых сигнатур пар
+    @param voltages_b напряжения вторых сигнатур пар
+    @param currents_b токи вторых сигнатур пар
+    @param offsets_a для одномерных массивов: K + 1 смещений, первая сигнатура пары i занимает
+    элементы с offsets_a[i] по offsets_a[i + 1] - 1
+    @param offsets_b для одномерных массивов: K + 1 смещений вторых сигнатур
+    @param min_var_v пороги масштабирования напряжения для каждой пары (None - текущий порог, см. SetMinVarVC)
+    @param min_var_c пороги масштабирования тока для каждой пары (None - текущий порог)
+    @param num_threads количество потоков (0 - по количеству процессоров)
+    @return пара (scores, statuses): массивы numpy со степенями различия и кодами результата пар;
+    для пар, которые не удалось сравнить, степень различия равна -1, а код результата не равен 0
+    """
+    voltages_a, currents_a = _as_doubles(voltages_a), _as_doubles(currents_a)
+    voltages_b, currents_b = _as_doubles(voltages_b), _as_doubles(currents_b)
+    if voltages_a.shape != currents_a.shape or voltages_b.shape != currents_b.shape:
+        raise ValueError("Voltages and currents arrays should have the same shape")
+    offsets_a = _batch_offsets(offsets_a, voltages_a, "voltages_a")
+    offsets_b = _batch_offsets(offsets_b, voltages_b, "voltages_b")
+    k = len(offsets_a) - 1
+    if len(offsets_b) - 1 != k:
+        raise ValueError("Numbers of the first and the second curves differ")
+    min_vars = []
+    for min_var in (min_var_v, min_var_c):
+        if min_var is not None:
+            min_var = _as_doubles(np.broadcast_to(min_var, (k,)))
+        min_vars.append(min_var)
+    scores = np.empty(k, dtype=np.float64)
+    statuses = np.empty(k, dtype=np.intc)
+
+    double_p = POINTER(c_double)
+    size_p = POINTER(c_size_t)
+    lib_func = lib.CompareIVCBatch
+    lib_func.argtypes = (c_void_p, double_p, double_p, size_p, double_p, double_p, size_p, double_p, double_p,
+                         c_uint32, c_uint32, double_p, POINTER(c_int))
+    lib_func.restype = c_int
+    ctx = _create_context()
+    try:
+        # Pointers to the data of the arrays, the arrays themselves are not copied
+        status = lib_func(ctx, voltages_a.ctypes.data_as(double_p), currents_a.ctypes.data_as(double_p),
+                          offsets_a.ctypes.data_as(size_p), voltages_b.ctypes.data_as(double_p),
+                          currents_b.ctypes.data_as(double_p), offsets_b.ctypes.data_as(size_p),
+                          None if min_vars[0] is None else min_vars[0].ctypes.data_as(double_p),
+                          None if min_vars[1] is None else min_vars[1].ctypes.data_as(double_p),
+                          k, num_threads, scores.ctypes.data_as(double_p), statuses.ctypes.data_as(POINTER(c_int)))
+    finally:
+        lib.DestroyIVCContext(ctx)
+    # Pairs failed separately are reported by their statuses
+    if status != 0 and not np.any(statuses == status):
+        raise RuntimeError("Something went wrong during ivcmp.CompareIVCBatch() call, status {}".format(status))
+    return scores, statuses
+
+
+def CompareIvcMatrixArrays(voltages, currents, lengths=None, packed=False, num_threads=0):
+    """
+    Функция сравнения каждой сигнатуры с каждой, аналог CompareIvcMatrix() для сигнатур в двумерных массивах numpy
+    (сигнатуры x точки). Массивы типа float64 с последовательным расположением элементов не копируются,
+    во время сравнения GIL освобождён.
+    @param voltages напряжения сигнатур
+    @param currents токи сигнатур
+    @param lengths количество точек каждой сигнатуры, если сигнатуры короче строк массивов (None - длина строк)
+    @param packed False - вернуть полную матрицу K x K,
+    True - вернуть элементы над главной диагональью по строкам (K * (K - 1) / 2 элементов)
+    @param num_threads количество потоков (0 - по количеству процессоров)
+    @return массив numpy со степенями различия
+    """
+    voltages, currents = _as_doubles(voltages), _as_doubles(currents)
+    if voltages.ndim != 2 or voltages.shape != currents.shape:
+        raise ValueError("Voltages and currents should be 2-D arrays of the same shape (curves x points)")
+    k, n = voltages.shape
+    if lengths is None:
+        lengths = np.full(k, n, dtype=np.uint32)
+    else:
+        lengths = np.ascontiguousarray(lengths, dtype=np.uint32)
+        if lengths.shape != (k,) or np.any(lengths > n):
+            raise ValueError("Invalid lengths of the curves")
+    # Pointers to the rows of the arrays
+    row_offsets = np.arange(k, dtype=np.uintp) * (n * voltages.itemsize)
+    voltage_rows = voltages.ctypes.data + row_offsets
+    current_rows = currents.ctypes.data + row_offsets
+    scores = np.empty(k * (k - 1) // 2 if packed else k * k, dtype=np.float64)
+
+    double_p = POINTER(c_double)
+    lib_func = lib.CompareIVCMatrix
+    lib_func.argtypes = (c_void_p, POINTER(double_p), POINTER(double_p), POINTER(c_uint32),
+                         c_uint32, c_int, c_uint32, double_p)
+    lib_func.restype = c_int
+    ctx = _create_context()
+    try:
+        status = lib_func(ctx, voltage_rows.ctypes.data_as(POINTER(double_p)),
+                          current_rows.ctypes.data_as(POINTER(double_p)), lengths.ctypes.data_as(POINTER(c_uint32)),
+                          k, 1 if packed else 0, num_threads, scores.ctypes.data_as(double_p))
+    finally:
+        lib.DestroyIVCContext(ctx)
+    if status != 0:
+        raise RuntimeError("Something went wrong during ivcmp.CompareIVCMatrix() call, status {}".format(status))
+    return scores if packed else scores.reshape(k, k)
+
+
+class IvcIndex:
+    """
+    Индекс для поиска наиболее похожих сигнатур в библиотеке эталонных сигнатур компонентов.
+    Сигнатуры библиотеки обрабатываются один раз при построении индекса,
+    поиск отбрасывает группы заведомо непохожих сигнатур без сравнения.
+    Результат поиска совпадает с результатом сравнения со всеми сигнатурами библиотеки функцией CompareIvc().
+    Индекс можно сохранить в файл (save) и загрузить из файла (load).
+    """
+
+    def __init__(self, iv_curves=None):
+        """
+        Строит индекс по списку сигнатур с текущими порогами масштабирования (см. SetMinVarVC).
+        @param iv_curves список сигнатур (объектов типа IvCurve)
+        """
+        lib.BuildIVCIndex.argtypes = (c_void_p, POINTER(POINTER(c_double)), POINTER(POINTER(c_double)),
+                                      POINTER(c_uint32), c_uint32, POINTER(c_void_p))
+        lib.BuildIVCIndex.restype = c_int
+        lib.DestroyIVCIndex.argtypes = c_void_p,
+        self._index = None
+        if iv_curves is None:
+            return
+        k = len(iv_curves)
+        for curve in iv_curves:
+            if curve.length == 0:
+                raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
+        voltages = (POINTER(c_double) * k)(*[curve.voltages for curve in iv_curves])
+        currents = (POINTER(c_double) * k)(*[curve.currents for curve in iv_curves])
+        lengths = (c_uint32 * k)(*[curve.length for curve in iv_curves])
+        index = c_void_p()
+        ctx = _create_context()
+        try:
+            status = lib.BuildIVCIndex(ctx, voltages, currents, lengths, k, pointer(index))
+        finally:
+            lib.DestroyIVCContext(ctx)
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.BuildIVCIndex() call, status {}".format(status))
+        self._index = index.value
+
+    def __del__(self):
+        if self._index:
+            lib.DestroyIVCIndex(self._index)
+            self._index = None
+
+    def __len__(self):
+        lib.GetIVCIndexSize.argtypes = c_void_p,
+        lib.GetIVCIndexSize.restype = c_uint32
+        return lib.GetIVCIndexSize(self._index) if self._index else 0
+
+    def search(self, iv_curve, k=1):
+        """
+        Функция поиска k наиболее похожих сигнатур библиотеки.
+        @param iv_curve сигнатура, для которой ищутся наиболее похожие (объект типа IvCurve)
+        @param k количество сигнатур для поиска
+        @return список пар (номер сигнатуры в библиотеке, степень различия) по возрастанию степени различия
+        """
+        if not self._index:
+            raise ValueError("Index is empty")
+        if iv_curve.length == 0:
+            raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
+        if k < 1:
+            raise ValueError("Number of curves to find should be positive")
+        lib.PrepareIVC.argtypes = c_void_p, POINTER(c_double), POINTER(c_double), c_uint32, POINTER(c_void_p)
+        lib.PrepareIVC.restype = c_int
+        lib.DestroyPreparedIVC.argtypes = c_void_p,
+        lib.SearchIVCIndex.argtypes = (c_void_p, c_void_p, c_void_p, c_uint32, POINTER(c_uint32), POINTER(c_double),
+                                       POINTER(c_uint32))
+        lib.SearchIVCIndex.restype = c_int
+        indices = (c_uint32 * k)()
+        scores = (c_double * k)()
+        num_found = c_uint32()
+        prepared = c_void_p()
+
+        ctx = _create_context()
+        try:
+            status = lib.PrepareIVC(ctx, iv_curve.voltages, iv_curve.currents, iv_curve.length, pointer(prepared))
+            if status == 0:
+                status = lib.SearchIVCIndex(ctx, self._index, prepared, k, indices, scores, pointer(num_found))
+        finally:
+            lib.DestroyPreparedIVC(prepared)
+            lib.DestroyIVCContext(ctx)
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.SearchIVCIndex() call, status {}".format(status))
+        return [(indices[i], scores[i]) for i in range(num_found.value)]
+
+    def save(self, file_name):
+        """
+        Функция сохранения индекса в файл.
+        @param file_name имя файла
+        """
+        if not self._index:
+            raise ValueError("Index is empty")
+        lib.SaveIVCIndex.argtypes = c_void_p, c_char_p
+        lib.SaveIVCIndex.restype = c_int
+        status = lib.SaveIVCIndex(self._index, os.fsencode(file_name))
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.SaveIVCIndex() call, status {}".format(status))
+
+    @classmethod
+    def load(cls, file_name):
+        """
+        Функция загрузки индекса, сохранённого функцией save.
+        @param file_name имя файла
+        @return индекс (объект типа IvcIndex)
+        """
+        lib.LoadIVCIndex.argtypes = c_void_p, c_char_p, POINTER(c_void_p)
+        lib.LoadIVCIndex.restype = c_int
+        index = cls()
+        loaded = c_void_p()
+        ctx = _create_context()
+        try:
+            status = lib.LoadIVCIndex(ctx, os.fsencode(file_name), pointer(loaded))
+        finally:
+            lib.DestroyIVCContext(ctx)
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.LoadIVCIndex() call, status {}".format(status))
+        index._index = loaded.value
+        return index
+
+
+class MeasureSettings(_IterableStructure):
+    """
+    Параметры измерения сигнатуры (measure_settings файлов плат EyePoint).
+    """
+    _fields_ = (
+        ("probe_signal_frequency", c_double),
+        ("max_voltage", c_double),
+        ("max_current", c_double),
+        ("desc_frequency", c_double),
+        ("n_points", c_uint32),
+        ("n_charge_points", c_uint32),
+        ("flags", c_uint32),
+        ("reserved", c_uint32)
+    )
+
+
+class IvcStore:
+    """
+    Хранилище сигнатур: файл с сигнатурами, параметрами их измерения и обработанными сигнатурами
+    (например, библиотека эталонных сигнатур компонентов).
+    Файл отображается в память, поэтому открывается без чтения и используется совместно несколькими процессами.
+    Файл записывается функцией write или утилитой ivcmp_store из файлов плат.
+    """
+
+    def __init__(self, file_name):
+        """
+        Открывает хранилище.
+        @param file_name имя файла
+        """
+        lib.OpenIVCStore.argtypes = c_char_p, POINTER(c_void_p)
+        lib.OpenIVCStore.restype = c_int
+        lib.CloseIVCStore.argtypes = c_void_p,
+        self._store = None
+        store = c_void_p()
+        status = lib.OpenIVCStore(os.fsencode(file_name), pointer(store))
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.OpenIVCStore() call, status {}".format(status))
+        self._store = store.value
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        """
+        Закрывает хранилище.
+        """
+        if self._store:
+            lib.CloseIVCStore(self._store)
+            self._store = None
+
+    def __len__(self):
+        lib.GetIVCStoreSize.argtypes = c_void_p,
+        lib.GetIVCStoreSize.restype = c_uint32
+        return lib.GetIVCStoreSize(self._store) if self._store else 0
+
+    def get(self, index):
+        """
+        Функция получения сигнатуры из хранилища.
+        @param index номер сигнатуры
+        @return пара (сигнатура (объект типа IvCurve), параметры измерения (объект типа MeasureSettings))
+        """
+        if not self._store:
+            raise ValueError("Store is closed")
+        lib.GetIVCStoreCurve.argtypes = (c_void_p, c_uint32, POINTER(POINTER(c_double)), POINTER(POINTER(c_double)),
+                                         POINTER(c_uint32), POINTER(MeasureSettings))
+        lib.GetIVCStoreCurve.restype = c_int
+        voltages = POINTER(c_double)()
+        currents = POINTER(c_double)()
+        length = c_uint32()
+        settings = MeasureSettings()
+        status = lib.GetIVCStoreCurve(self._store, index, pointer(voltages), pointer(currents), pointer(length),
+                                      pointer(settings))
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.GetIVCStoreCurve() call, status {}".format(status))
+        curve = IvCurve()
+        curve.length = length.value
+        curve.voltages = np.ctypeslib.as_array(voltages, (length.value,))
+        curve.currents = np.ctypeslib.as_array(currents, (length.value,))
+        return curve, settings
+
+    def compare(self, iv_curve):
+        """
+        Функция сравнения сигнатуры со всеми сигнатурами хранилища.
+        Обработанные сигнатуры хранилища используются прямо из файла.
+        Используются текущие пороги масштабирования (см. SetMinVarVC) и точность (см. SetPrecision),
+        степень различия совпадает с результатом сравнения обработанных сигнатур.
+        @param iv_curve сигнатура (объект типа IvCurve)
+        @return массив numpy со степенями различия (-1 для сигнатур, которые не удалось сравнить)
+        """
+        if not self._store:
+            raise ValueError("Store is closed")
+        if iv_curve.length == 0:
+            raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
+        lib.PrepareIVC.argtypes = c_void_p, POINTER(c_double), POINTER(c_double), c_uint32, POINTER(c_void_p)
+        lib.PrepareIVC.restype = c_int
+        lib.DestroyPreparedIVC.argtypes = c_void_p,
+        lib.GetIVCStorePrepared.argtypes = c_void_p, c_uint32, POINTER(c_void_p)
+        lib.GetIVCStorePrepared.restype = c_int
+        lib.CompareIVCPrepared.argtypes = c_void_p, c_void_p, c_void_p, POINTER(c_double)
+        lib.CompareIVCPrepared.restype = c_int
+        scores = np.full(len(self), -1.)
+        prepared = c_void_p()
+        stored = c_void_p()
+        score = c_double()
+
+        ctx = _create_context()
+        try:
+            status = lib.PrepareIVC(ctx, iv_curve.voltages, iv_curve.currents, iv_curve.length, pointer(prepared))
+            if status != 0:
+                raise RuntimeError("Something went wrong during ivcmp.PrepareIVC() call, status {}".format(status))
+            for i in range(len(scores)):
+                status = lib.GetIVCStorePrepared(self._store, i, pointer(stored))
+                if status != 0:
+                    raise RuntimeError("Something went wrong during ivcmp.GetIVCStorePrepared() call, "
+                                       "status {}".format(status))
+                if lib.CompareIVCPrepared(ctx, prepared, stored, pointer(score)) == 0:
+                    scores[i] = score.value
+        finally:
+            lib.DestroyPreparedIVC(prepared)
+            lib.DestroyIVCContext(ctx)
+        return scores
+
+    @staticmethod
+    def write(file_name, iv_curves, settings=None, prepared=True):
+        """
+        Функция записи файла хранилища.
+        Сигнатуры обрабатываются с текущими порогами масштабирования (см. SetMinVarVC).
+        @param file_name имя файла
+        @param iv_curves список сигнатур (объектов типа IvCurve)
+        @param settings список параметров измерения сигнатур (объектов типа MeasureSettings) или None
+        @param prepared True - сохранять обработанные сигнатуры для сравнения функцией compare
+        """
+        if settings is not None and len(settings) != len(iv_curves):
+            raise ValueError("Number of measure settings should be equal to the number of curves")
+        for curve in iv_curves:
+            if curve.length == 0:
+                raise ValueError("IVCurve length attribute should be explicitly set. And it should not be zero")
+        lib.CreateIVCStoreWriter.argtypes = c_char_p, c_int, POINTER(c_void_p)
+        lib.CreateIVCStoreWriter.restype = c_int
+        lib.AddIVCStoreCurve.argtypes = (c_void_p, c_void_p, POINTER(c_double), POINTER(c_double), c_uint32,
+                                         POINTER(MeasureSettings))
+        lib.AddIVCStoreCurve.restype = c_int
+        lib.CloseIVCStoreWriter.argtypes = c_void_p,
+        lib.CloseIVCStoreWriter.restype = c_int
+        writer = c_void_p()
+        status = lib.CreateIVCStoreWriter(os.fsencode(file_name), 1 if prepared else 0, pointer(writer))
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.CreateIVCStoreWriter() call, "
+                               "status {}".format(status))
+        ctx = _create_context()
+        try:
+            status = 0
+            for i, curve in enumerate(iv_curves):
+                curve_settings = pointer(settings[i]) if settings is not None else None
+                status = lib.AddIVCStoreCurve(ctx, writer, curve.voltages, curve.currents, curve.length,
+                                              curve_settings)
+                if status != 0:
+                    break
+        finally:
+            close_status = lib.CloseIVCStoreWriter(writer)
+            lib.DestroyIVCContext(ctx)
+        status = status or close_status
+        if status != 0:
+            raise RuntimeError("Something went wrong during ivcmp.AddIVCStoreCurve() call, status {}".format(status))
+
+
 if __name__ == "__main__":
     iv_curve_1 = IvCurve()
     iv_curve_1.length = MAX_NUM_POINTS
@@ -2,9 +2,15 @@
 from __future__ import print_function
 import unittest
 from pyivcmp.ivcmp import IvCurve, CompareIvc, MAX_NUM_POINTS, SetMinVarVC, GetMinVarVC, SetMinVarVCFromCurves, \
-                          VOLTAGE_AMPL, CURRENT_AMPL
+                          CompareIvcMatrix, CompareIvcThreshold, IvcIndex, IvcStore, MeasureSettings, \
+                          GetStats, ResetStats, SetStatsTimers, STAGE_DISTANCE, CaptureIvc, VOLTAGE_AMPL, \
+                          CURRENT_AMPL, CompareIvcBatch, CompareIvcMatrixArrays, SetResampling, GetResampling, \
+                          SetCacheCapacity, GetCacheStats, ClearCache
 from ctypes import c_double
 import numpy as np
+import os
+import struct
+import tempfile
 
 
 class TestIVCMPMethods(unittest.TestCase):
@@ -214,6 +220,285 @@ class TestIVCMPMethods(unittest.TestCase):
         res = CompareIvc(curve_sc, curve_sc)
         self.assertTrue((res - 0) < 0.05)
 
+    def test_compare_matrix(self):
+        curves = []
+        for k in range(5):
+            curve = IvCurve()
+            curve.length = 100 + 10 * k
+            i = np.arange(curve.length)
+            curve.voltages = (0.3 + 0.1 * k) * VOLTAGE_AMPL * np.sin(2 * np.pi * i / curve.length)
+            curve.currents = (0.7 - 0.1 * k) * CURRENT_AMPL * np.cos(k * np.pi / 8 + 2 * np.pi * i / curve.length)
+            curves.append(curve)
+
+        # Set Voltage and Current scale
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+
+        scores = CompareIvcMatrix(curves, num_threads=2)
+        packed_scores = CompareIvcMatrix(curves, packed=True)
+        self.assertEqual(scores.shape, (5, 5))
+        self.assertEqual(len(packed_scores), 10)
+        k = 0
+        for i in range(5):
+            self.assertEqual(scores[i, i], 0)
+            for j in range(i + 1, 5):
+                res = CompareIvc(curves[i], curves[j])
+                self.assertAlmostEqual(scores[i, j], res, places=6)
+                self.assertEqual(scores[j, i], scores[i, j])
+                self.assertEqual(packed_scores[k], scores[i, j])
+                k += 1
+
+    def test_compare_batch(self):
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+        i = np.arange(100)
+        k = np.arange(6)[:, None]
+        voltages_a = (0.3 + 0.1 * k) * VOLTAGE_AMPL * np.sin(2 * np.pi * i / 100)
+        currents_a = (0.7 - 0.1 * k) * CURRENT_AMPL * np.cos(2 * np.pi * i / 100)
+        voltages_b = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / 100) + 0 * k
+        currents_b = 0.5 * CURRENT_AMPL * np.cos(k * np.pi / 8 + 2 * np.pi * i / 100)
+
+        scores, statuses = CompareIvcBatch(voltages_a, currents_a, voltages_b, currents_b, num_threads=2)
+        self.assertEqual(len(scores), 6)
+        self.assertTrue(np.all(statuses == 0))
+        for p in range(6):
+            curve_a = IvCurve()
+            curve_a.length = 100
+            curve_a.voltages = voltages_a[p]
+            curve_a.currents = currents_a[p]
+            curve_b = IvCurve()
+            curve_b.length = 100
+            curve_b.voltages = voltages_b[p]
+            curve_b.currents = currents_b[p]
+            self.assertAlmostEqual(scores[p], CompareIvc(curve_a, curve_b), places=6)
+
+        # Curves of different lengths follow each other in flat arrays
+        offsets = np.array([0, 100, 150, 250])
+        flat_v = np.concatenate([voltages_a[0], voltages_a[1, :50], voltages_a[2]])
+        flat_c = np.concatenate([currents_a[0], currents_a[1, :50], currents_a[2]])
+        ragged_scores, _ = CompareIvcBatch(flat_v, flat_c, flat_v, flat_c, offsets, offsets)
+        self.assertTrue(np.all(ragged_scores == 0))
+        ragged_scores, _ = CompareIvcBatch(flat_v, flat_c, voltages_b[:3].ravel(), currents_b[:3].ravel(),
+                                           offsets_a=offsets, offsets_b=[0, 100, 200, 300])
+        self.assertEqual(ragged_scores[0], scores[0])
+        self.assertEqual(ragged_scores[2], scores[2])
+
+        # Per-pair scales and a pair that can not be compared
+        scaled_scores, statuses = CompareIvcBatch(voltages_a, currents_a, voltages_b, currents_b,
+                                                  offsets_a=np.arange(7) * 100, offsets_b=[0, 100, 200, 300, 400, 500, 500],
+                                                  min_var_v=VOLTAGE_AMPL * 0.03, min_var_c=CURRENT_AMPL * 0.03)
+        self.assertTrue(np.array_equal(scaled_scores[:5], scores[:5]))
+        self.assertEqual(scaled_scores[5], -1)
+        self.assertNotEqual(statuses[5], 0)
+
+    def test_compare_matrix_arrays(self):
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+        curves = []
+        voltages = np.zeros((4, 120))
+        currents = np.zeros((4, 120))
+        for k in range(4):
+            curve = IvCurve()
+            curve.length = 90 + 10 * k
+            i = np.arange(curve.length)
+            voltages[k, :curve.length] = (0.3 + 0.1 * k) * VOLTAGE_AMPL * np.sin(2 * np.pi * i / curve.length)
+            currents[k, :curve.length] = (0.7 - 0.1 * k) * CURRENT_AMPL * np.cos(2 * np.pi * i / curve.length)
+            curve.voltages = voltages[k, :curve.length]
+            curve.currents = currents[k, :curve.length]
+            curves.append(curve)
+
+        lengths = [curve.length for curve in curves]
+        scores = CompareIvcMatrixArrays(voltages, currents, lengths, num_threads=2)
+        self.assertTrue(np.array_equal(scores, CompareIvcMatrix(curves)))
+        packed_scores = CompareIvcMatrixArrays(voltages, currents, lengths, packed=True)
+        self.assertTrue(np.array_equal(packed_scores, CompareIvcMatrix(curves, packed=True)))
+
+    def test_resampling(self):
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+        i = np.arange(2000)
+        voltages = VOLTAGE_AMPL * np.sin(2 * np.pi * i / 2000)
+        currents_a = CURRENT_AMPL * np.cos(2 * np.pi * i / 2000)
+        currents_b = 0.8 * CURRENT_AMPL * np.cos(np.pi / 8 + 2 * np.pi * i / 2000)
+        score, _ = CompareIvcBatch(voltages[None], currents_a[None], voltages[None], currents_b[None])
+        try:
+            SetResampling(0.1)
+            self.assertEqual(GetResampling(), 0.1)
+            resampled_score, _ = CompareIvcBatch(voltages[None], currents_a[None], voltages[None], currents_b[None])
+            with self.assertRaises(ValueError):
+                SetResampling(-1)
+        finally:
+            SetResampling(0)
+        self.assertLess(abs(resampled_score[0] - score[0]), 0.005)
+
+    def test_compare_threshold(self):
+        ivc_resistor_1 = IvCurve()
+        ivc_resistor_1.length = MAX_NUM_POINTS
+        ivc_resistor_2 = IvCurve()
+        ivc_resistor_2.length = MAX_NUM_POINTS
+        i = np.arange(MAX_NUM_POINTS)
+        ivc_resistor_1.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+        ivc_resistor_1.currents = 0.5 * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+        ivc_resistor_2.voltages = 0.47 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+        ivc_resistor_2.currents = 0.63 * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+
+        # Set Voltage and Current scale
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+
+        res = CompareIvc(ivc_resistor_1, ivc_resistor_2)
+        passed, score = CompareIvcThreshold(ivc_resistor_1, ivc_resistor_2, 0.5)
+        self.assertTrue(passed)
+        self.assertEqual(score, res)
+        passed, score = CompareIvcThreshold(ivc_resistor_1, ivc_resistor_2, res / 2)
+        self.assertFalse(passed)
+        self.assertTrue(res / 2 < score <= res)
+        with self.assertRaises(ValueError):
+            CompareIvcThreshold(ivc_resistor_1, ivc_resistor_2, 1.5)
+
+    def test_index_search(self):
+        i = np.arange(MAX_NUM_POINTS)
+        library = []
+        for ratio in (0.2, 0.5, 1., 2., 5.):
+            curve = IvCurve()
+            curve.length = MAX_NUM_POINTS
+            curve.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            curve.currents = 0.1 * ratio * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            library.append(curve)
+        probe = IvCurve()
+        probe.length = MAX_NUM_POINTS
+        probe.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+        probe.currents = 0.11 * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+
+        # Set Voltage and Current scale
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+
+        index = IvcIndex(library)
+        self.assertEqual(len(index), len(library))
+        matches = index.search(probe, 3)
+        scores = sorted((CompareIvc(probe, curve), n) for n, curve in enumerate(library))
+        self.assertEqual([n for n, _ in matches], [n for _, n in scores[:3]])
+        for (_, score), (res, _) in zip(matches, scores):
+            self.assertAlmostEqual(score, res, places=12)
+
+        with tempfile.TemporaryDirectory() as directory:
+            file_name = os.path.join(directory, "library.idx")
+            index.save(file_name)
+            loaded = IvcIndex.load(file_name)
+        self.assertEqual(loaded.search(probe, 3), matches)
+
+    def test_store_compare(self):
+        i = np.arange(MAX_NUM_POINTS)
+        library = []
+        settings = []
+        for ratio in (0.2, 0.5, 1., 2., 5.):
+            curve = IvCurve()
+            curve.length = MAX_NUM_POINTS
+            curve.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            curve.currents = 0.1 * ratio * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            library.append(curve)
+            settings.append(MeasureSettings(max_voltage=VOLTAGE_AMPL, max_current=ratio * CURRENT_AMPL,
+                                            n_points=MAX_NUM_POINTS))
+        probe = IvCurve()
+        probe.length = MAX_NUM_POINTS
+        probe.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+        probe.currents = 0.11 * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+
+        # Set Voltage and Current scale
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+
+        with tempfile.TemporaryDirectory() as directory:
+            file_name = os.path.join(directory, "library.ivcs")
+            IvcStore.write(file_name, library, settings)
+            store = IvcStore(file_name)
+            self.assertEqual(len(store), len(library))
+            curve, curve_settings = store.get(3)
+            self.assertEqual(list(curve.currents[:MAX_NUM_POINTS]), list(library[3].currents))
+            self.assertEqual(curve_settings.max_current, 2. * CURRENT_AMPL)
+            scores = store.compare(probe)
+            store.close()
+        for score, curve in zip(scores, library):
+            self.assertAlmostEqual(score, CompareIvc(probe, curve), places=12)
+
+    def test_stats(self):
+        i = np.arange(MAX_NUM_POINTS)
+        curves = []
+        for ratio in (0.5, 0.6, 0.7):
+            curve = IvCurve()
+            curve.length = MAX_NUM_POINTS
+            curve.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            curve.currents = ratio * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            curves.append(curve)
+        # Curve with two equal points
+        curves[0].voltages[1] = curves[0].voltages[0]
+        curves[0].currents[1] = curves[0].currents[0]
+
+        # Set Voltage and Current scale
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+
+        ResetStats()
+        SetStatsTimers(True)
+        CompareIvcMatrix(curves, packed=True, num_threads=2)
+        SetStatsTimers(False)
+        stats = GetStats()
+        self.assertEqual(stats.comparisons, 3)
+        self.assertGreaterEqual(stats.repeats_removed, 1)
+        self.assertEqual(stats.stage_calls[STAGE_DISTANCE], 3)
+        self.assertEqual(stats.as_dict()["comparisons"], 3)
+        ResetStats()
+        self.assertEqual(GetStats().comparisons, 0)
+
+    def test_cache(self):
+        i = np.arange(MAX_NUM_POINTS)
+        curves = []
+        for ratio in (0.5, 0.6, 0.7):
+            curve = IvCurve()
+            curve.length = MAX_NUM_POINTS
+            curve.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            curve.currents = ratio * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+            curves.append(curve)
+
+        # Set Voltage and Current scale
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+
+        pairs = [(0, 1), (0, 2), (1, 2), (0, 1)]
+        scores = [CompareIvc(curves[a], curves[b]) for a, b in pairs]
+        SetCacheCapacity(16)
+        try:
+            self.assertEqual([CompareIvc(curves[a], curves[b]) for a, b in pairs], scores)
+            stats = GetCacheStats()
+            self.assertEqual((stats.hits, stats.misses, stats.entries), (1, 3, 3))
+            # Other scaling thresholds give other scores
+            SetMinVarVC(VOLTAGE_AMPL * 0.5, CURRENT_AMPL * 0.5)
+            self.assertNotEqual(CompareIvc(curves[0], curves[1]), scores[0])
+            self.assertEqual(GetCacheStats().misses, 4)
+            ClearCache()
+            self.assertEqual(GetCacheStats().as_dict(),
+                             {"hits": 0, "misses": 0, "evictions": 0, "entries": 0, "capacity": 16})
+        finally:
+            SetCacheCapacity(0)
+
+    def test_capture(self):
+        i = np.arange(MAX_NUM_POINTS)
+        curve_1 = IvCurve()
+        curve_1.length = MAX_NUM_POINTS
+        curve_1.voltages = 0.5 * VOLTAGE_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+        curve_1.currents = 0.5 * CURRENT_AMPL * np.sin(2 * np.pi * i / MAX_NUM_POINTS)
+        curve_2 = IvCurve()
+        curve_2.length = MAX_NUM_POINTS // 2
+        curve_2.voltages = 0.47 * VOLTAGE_AMPL * np.sin(4 * np.pi * i[:MAX_NUM_POINTS // 2] / MAX_NUM_POINTS)
+        curve_2.currents = 0.63 * CURRENT_AMPL * np.sin(4 * np.pi * i[:MAX_NUM_POINTS // 2] / MAX_NUM_POINTS)
+
+        # Set Voltage and Current scale
+        SetMinVarVC(VOLTAGE_AMPL * 0.03, CURRENT_AMPL * 0.03)
+
+        with tempfile.TemporaryDirectory() as directory:
+            file_name = os.path.join(directory, "capture.bin")
+            score, dump = CaptureIvc(curve_1, curve_2, file_name)
+            with open(file_name, "rb") as f:
+                self.assertEqual(f.read(), dump)
+        self.assertEqual(score, CompareIvc(curve_1, curve_2))
+        self.assertEqual(dump[:8], b"IVCMPCAP")
+        # 12 records, no records lost
+        self.assertEqual(struct.unpack_from("=II", dump, 12), (12, 0))
+        # The last value is the score
+        self.assertEqual(struct.unpack_from("=d", dump, len(dump) - 8)[0], score)
+
 
 if __name__ == "__main__":
     unittest.main()
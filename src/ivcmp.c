@@ -6,14 +6,19 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include "ivcmp.h"
-
-/* ******************************* */
-/*    Settings                     */
-/* ******************************* */
-/* Uncomment this to save temporary results 
- * to files on intermediate steps
- */
-//#define DEBUG_FILE_OUTPUT
+#include "ivcmp_kernels.h"
+#include "ivcmp_pool.h"
+#include "ivcmp_map.h"
+#include "ivcmp_stats.h"
+#include "ivcmp_cache.h"
+#if defined(IVCMP_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 /* ******************************* */
 /*    Definitions                  */
@@ -21,10 +26,33 @@
 #define IV_CURVE_NUM_COMPONENTS 2
 #define MIN_VAR_V_DEFAULT 0.6
 #define MIN_VAR_C_DEFAULT 0.0002
-static double MinVarV, MinVarC;
 #define SCORE_ERROR -1    /**< Algorithm return Error */
 #define ORDER 3     /**< Order of B-spline */
 #define MIN_LEN_CURVE 2
+#define RESAMPLE_MIN_LENGTH 32 /**< Curves are not resampled to fewer points, see SetContextResampling() */
+#define WORKSPACE_ALIGNMENT 64 /**< Alignment of the arrays in the workspace, bytes */
+#define BASIS_TABLES 2 /**< Number of B-spline basis tables cached in the workspace */
+#define DIST_BLOCK 32 /**< Number of points processed between the checks of the distance bound */
+#define FUSED_TILE 256 /**< Number of points of each curve in a tile of NearestNodesFused() */
+#define WINDOW_BLOCK 8 /**< Number of curve nodes in a block of NearestNodeWindow() */
+#define WINDOW_RADIUS 1 /**< Number of blocks on each side of the previous nearest node checked first */
+#define MAX_BOX_LEVELS 32 /**< Enough levels of NearestNodeWindow() boxes for any curve length */
+#define MATRIX_TILE 16 /**< Number of curves in a side of the pairs block compared by one task */
+#define DESCRIPTOR_BLOCKS 8 /**< Number of parts of the curve with own bounding boxes in the descriptor */
+#define BOUND_TOLERANCE 1e-5 /**< Allowance for rounding errors of the distances in the score lower bound */
+#define INDEX_LEAF_SIZE 8 /**< Largest number of curves in a leaf node of the search index */
+#define INDEX_FILE_VERSION 1 /**< Version of the format of the search index file */
+#define STORE_FILE_VERSION 1 /**< Version of the format of the signature store file */
+#define STORE_ALIGNMENT 64 /**< Alignment of the arrays in the signature store file, bytes */
+#define STORE_BYTE_ORDER 0x01020304 /**< Number giving the byte order of the signature store file */
+#define CAPTURE_FILE_VERSION 1 /**< Version of the format of the capture dump */
+#define CAPTURE_TRUNCATED 1 /**< Flag of the capture dump: records not fitting the buffer are lost */
+#ifndef WINDOW_MIN_LEN_CURVE
+#define WINDOW_MIN_LEN_CURVE 64 /**< Curves with fewer points use brute force nearest node search */
+#endif
+#ifndef FUSED_MAX_LEN_CURVE
+#define FUSED_MAX_LEN_CURVE 2048 /**< Shorter curves use brute force nearest node search for both directions at once */
+#endif
 
 #if defined(linux)
 #define min(a, b) (((a<b))?(a):(b))
@@ -32,7 +60,7 @@ static double MinVarV, MinVarC;
 #endif
 
 #if defined(linux)
-#define OPEN_FILE(FilePtr, FileName, Mode) file_ptr = fopen(FileName, Mode)
+#define OPEN_FILE(FilePtr, FileName, Mode) FilePtr = fopen(FileName, Mode)
 #else
 #define OPEN_FILE(FilePtr, FileName, Mode) fopen_s(&FilePtr, FileName, Mode)
 #endif
@@ -42,23 +70,6 @@ static double MinVarV, MinVarC;
 /*       Internal functions        */
 /* ******************************* */
 
-/**
- * Returns the difference vector of two vectors
- * 
- * @param[in] a first vector
- * @param[in] b vector to subtract
- * @param[out] v resulting vector
- * @param[in] SizeArr vector length
- */
-static void SubtractVec(double *a, double *b, double *v, uint32_t SizeArr)
-{
-  uint32_t i;
-  for (i = 0; i < SizeArr; i++)
-  {
-    v[i] = a[i] - b[i];
-  }
-}
-
 /**
  * Returns the vector mean
  *
@@ -79,244 +90,238 @@ static double Mean(double *mas, uint32_t SizeArr)
 }
 
 /**
- * Returns the scalar product of two vectors
+ * Returns the dispersion of the vector
  *
- * @param[in] a first vector
- * @param[in] b second vector
+ * @param[im] mas vector
  * @param[in] SizeArr vector length
  *
- * @return scalar product of 'a' and 'b'
+ * @return ('mas' - mean of the 'mas') ^ 2
  */
-static double Dot(double *a, double *b, uint32_t SizeArr)
+static double Disp(double *mas, uint32_t SizeArr)
 {
-  double s;
-  double sum = 0;
+  double avg = 0;
+  double Disp = 0;
   uint32_t i;
+  avg = Mean(mas, SizeArr);
+
   for (i = 0; i < SizeArr; i++)
   {
-    s = a[i] * b[i];
-    sum += s;
+    Disp += (mas[i] - avg) * (mas[i] - avg);
   }
-  return sum;
+
+  return Disp / SizeArr;
 }
 
 /**
- * Returns the vector product of two vectors
+ * Updates Score value
  *
- * @param[in] a first vector
- * @param[in] b second vector
- * @param[in] SizeArr vector length
+ * @param[in] x average sum of distances between two curves
  *
- * @return vector product of 'a' and 'b'
+ * @return score 
  */
-static double Cross(double *a, double *b)
+static double RescaleScore(double x)
 {
-  return a[0] * b[1] - a[1] * b[0];
+  return 1 - exp(-8 * x);
 }
 
-/*
- * Clean two double matrixes and two or less dynamic massives
- *
- * @param[in] Matrix1 first double matrix
- * @param[in] Matrix2 second double matrix
- * @param[in] Massive1 first double array
- * @param[in] Massive2 second double array
+/**
+ * Hierarchy of the bounding boxes of consecutive curve nodes for the windowed nearest node search.
+ * Level 0 has a box for each block of WINDOW_BLOCK nodes, each box of the next level bounds two boxes
+ * of the previous one, the last level has one box. Boxes are stored in a separate array of the precision
+ * of the curve.
  */
-static void CleanUp(double **Matrix1, double **Matrix2, double *Massive1, double *Massive2)
+typedef struct
 {
-  uint32_t i;
-  for (i = 0; i < IV_CURVE_NUM_COMPONENTS; i++)
-  {
-    free(Matrix1[i]);
-    free(Matrix2[i]);
-  }
-  free(Matrix1);
-  free(Matrix2);
-  if (Massive1 != NULL)
-  {
-    free(Massive1);
-  }
-  if (Massive2 != NULL)
-  {
-    free(Massive2);
-  }
-}
+  uint32_t NumLevels;
+  uint32_t First[MAX_BOX_LEVELS]; /**< First box of each level */
+  uint32_t Count[MAX_BOX_LEVELS]; /**< Number of boxes of each level */
+} box_tree_t;
+
+/** Number of boxes in the hierarchy for the curve of n points */
+#define BOX_TREE_SIZE(n) (2 * ((n) / WINDOW_BLOCK + 1) + MAX_BOX_LEVELS)
 
 /**
- * Returns the dispersion of the vector
- *
- * @param[im] mas vector
- * @param[in] SizeArr vector length
- *
- * @return ('mas' - mean of the 'mas') ^ 2
+ * Set of distance stage kernels for one instruction set
  */
-static double Disp(double *mas, uint32_t SizeArr)
+typedef struct
 {
-  double avg = 0;
-  uint32_t i;
-  double *Disp = (double *)malloc(SizeArr * sizeof(double));
-  avg = Mean(mas, SizeArr);
+  ivcmp_kernel_t Kernel;                 /**< Instruction set */
+  uint32_t MinLength;                    /**< Shorter curves are processed by the scalar kernels */
+  nearest_node_kernel_t NearestNode;     /**< Brute force nearest node search */
+  seg_dist_kernel_t SegDist;             /**< Distances to the segments near the nearest nodes */
+  nearest_tile_kernel_t NearestTile;     /**< Brute force nearest nodes of both curves for a tile */
+  uint32_t MinLengthF;                   /**< Same for single precision */
+  nearest_node_f_kernel_t NearestNodeF;
+  seg_dist_f_kernel_t SegDistF;
+  nearest_tile_f_kernel_t NearestTileF;
+} kernel_table_t;
 
-  for (i = 0; i < SizeArr; i++)
-  {
-    Disp[i] = (mas[i] - avg) * (mas[i] - avg);
-  }
+static const kernel_table_t *GetKernels(void);
+static const kernel_table_t *GetScalarKernels(void);
 
-  avg = Mean(Disp, SizeArr);
-  free(Disp);
-  return avg;
-}
+/* Distance stage in double precision */
+#define real_t double
+#define REAL_FN(Name) Name
+#define REAL_KERNEL(Kernels, Name) ((Kernels)->Name)
+#define REAL_WINDOW_SAFETY 1e-9
+#include "ivcmp_dist.inc"
+#undef real_t
+#undef REAL_FN
+#undef REAL_KERNEL
+#undef REAL_WINDOW_SAFETY
+
+/* Distance stage in single precision */
+#define real_t float
+#define REAL_FN(Name) Name##F
+#define REAL_KERNEL(Kernels, Name) ((Kernels)->Name##F)
+#define REAL_WINDOW_SAFETY 1e-5
+#include "ivcmp_dist.inc"
+#undef real_t
+#undef REAL_FN
+#undef REAL_KERNEL
+#undef REAL_WINDOW_SAFETY
 
 /**
- * Returns the transposed matrix
- *
- * @param[in] m matrix
- * @param[out] m_t transposed matrix
- * @param[in] Size_I number of lines in 'm'
- * @param[in] SIze_J number of columns in 'm'
+ * Kernels for each instruction set, the index is ivcmp_kernel_t
  */
-static void Transpose(double **m, double **m_t, uint32_t SizeI, uint32_t SizeJ)
+static const kernel_table_t KernelTables[] =
 {
-  uint32_t i;
-  uint32_t j;
-  for (i = 0; i < SizeI; i++)
-  {
-    for (j = 0; j < SizeJ; j++)
-    {
-      m_t[j][i] = m[i][j];
-    }
-  }
-}
+  {IVCMP_KERNEL_SCALAR, 1, NearestNodeBrute, SegDistScalar, NearestTileScalar,
+   1, NearestNodeBruteF, SegDistScalarF, NearestTileScalarF},
+#if defined(IVCMP_SIMD_X86)
+  {IVCMP_KERNEL_AVX2, 4, IvcNearestNodeAvx2, IvcSegDistAvx2, IvcNearestTileAvx2,
+   8, IvcNearestNodeAvx2F, IvcSegDistAvx2F, IvcNearestTileAvx2F},
+  {IVCMP_KERNEL_AVX512, 8, IvcNearestNodeAvx512, IvcSegDistAvx512, IvcNearestTileAvx512,
+   16, IvcNearestNodeAvx512F, IvcSegDistAvx512F, IvcNearestTileAvx512F},
+#endif
+};
 
 /**
- * Returns the distance between a point and a segment
- *
- * @param[in] p point
- * @param[in] a first end of a segment
- * @param[in] b second end of a segment
- * @param[in] SizeArr dimension
- *
- * @return distance
+ * Kernels selected by SetIVCKernel(), NULL until the first call.
+ * The pointer is read by comparisons of any thread, so it is accessed atomically.
  */
-static double Dist2PtSeg(double *p, double *a, double *b, uint32_t SizeArr)
-{
-  double *v1 = (double *)malloc(SizeArr * sizeof(double));
-  double *v2 = (double *)malloc(SizeArr * sizeof(double));
-  double Result;
-  SubtractVec(b, a, v1, SizeArr);
-  SubtractVec(p, a, v2, SizeArr);
-  double SegLen2 = Dot(v1, v1, SizeArr);
-  double Proj = Dot(v1, v2, SizeArr) / SegLen2;
-  if (Proj > 1)
-  {
-    SubtractVec(p, b, v1, SizeArr);
-    Result = Dot(v1, v1, SizeArr);
-  }
-  else if (Proj < 0)
-  {
-    Result = Dot(v2, v2, SizeArr);
-  }
-  else Result = pow(Cross(v1, v2), 2) / SegLen2;
-  free(v1); 
-  free(v2);
+static const kernel_table_t *SelectedKernels = NULL;
 
-  return Result;
-}
+/** Best kernels supported by the processor, set once by DetectKernels() */
+static const kernel_table_t *DetectedKernels = NULL;
+
+#if defined(_MSC_VER)
+#define LOAD_KERNELS(Pointer) ((const kernel_table_t *)InterlockedCompareExchangePointer((PVOID volatile *)&(Pointer), NULL, NULL))
+#define STORE_KERNELS(Pointer, Value) InterlockedExchangePointer((PVOID volatile *)&(Pointer), (PVOID)(Value))
+#else
+#define LOAD_KERNELS(Pointer) __atomic_load_n(&(Pointer), __ATOMIC_ACQUIRE)
+#define STORE_KERNELS(Pointer, Value) __atomic_store_n(&(Pointer), (Value), __ATOMIC_RELEASE)
+#endif
 
 /**
- * Updates Score value
+ * Checks whether the processor and the operating system support the instruction set
  *
- * @param[in] x average sum of distances between two curves
+ * @param[in] Kernel instruction set
  *
- * @return score 
+ * @return non-zero if the kernels can be used
  */
-static double RescaleScore(double x)
+static int IsKernelSupported(ivcmp_kernel_t Kernel)
 {
-  return 1 - exp(-8 * x);
+#if defined(IVCMP_SIMD_X86) && defined(_MSC_VER)
+  int Regs[4];
+  unsigned long long Xcr0;
+  __cpuid(Regs, 1);
+  /* OSXSAVE and AVX */
+  if ((Regs[2] & (1 << 27)) == 0 || (Regs[2] & (1 << 28)) == 0)
+  {
+    return Kernel == IVCMP_KERNEL_SCALAR;
+  }
+  Xcr0 = _xgetbv(0);
+  __cpuidex(Regs, 7, 0);
+  switch (Kernel)
+  {
+  case IVCMP_KERNEL_SCALAR:
+    return 1;
+  case IVCMP_KERNEL_AVX2:
+    /* YMM state and AVX2 */
+    return (Xcr0 & 0x6) == 0x6 && (Regs[1] & (1 << 5)) != 0;
+  case IVCMP_KERNEL_AVX512:
+    /* ZMM state and AVX-512F */
+    return (Xcr0 & 0xe6) == 0xe6 && (Regs[1] & (1 << 16)) != 0;
+  }
+  return 0;
+#elif defined(IVCMP_SIMD_X86)
+  /* GCC and Clang check the operating system support too */
+  __builtin_cpu_init();
+  switch (Kernel)
+  {
+  case IVCMP_KERNEL_SCALAR:
+    return 1;
+  case IVCMP_KERNEL_AVX2:
+    return __builtin_cpu_supports("avx2");
+  case IVCMP_KERNEL_AVX512:
+    return __builtin_cpu_supports("avx512f");
+  }
+  return 0;
+#else
+  return Kernel == IVCMP_KERNEL_SCALAR;
+#endif
 }
 
 /**
- * Returns all distances of two iv_curves
- *
- * @param[in] Curve first curve
- * @param[in] pts second curve
- * @param[in] SizeJ number of points in the curves
- *
- * @return normalized sum of distances
+ * Finds the best kernels supported by the processor
  */
-static double DistCurvePts(double **Curve, double **pts, uint32_t SizeJ)
+static void DetectKernels(void)
 {
-  double res = 0.0;
-  uint32_t LocMinItem = 0; double LocMin;
-  double *v = (double *)malloc(SizeJ * sizeof(double));
-  double *PrevNode = NULL;
-  double *CurNode = NULL;
-  double *NextNode = NULL;
-  double *pt = NULL;
-  double Dist1, Dist2;
-  uint32_t j;
   uint32_t i;
-  double **CurveT = (double **)malloc(SizeJ * sizeof(double *));
-  double **PtsT = (double **)malloc(SizeJ * sizeof(double *));
-  for (i = 0; i < SizeJ; i++)
-  {
-    CurveT[i] = (double*)malloc(IV_CURVE_NUM_COMPONENTS * sizeof(double));
-    PtsT[i] = (double*)malloc(IV_CURVE_NUM_COMPONENTS * sizeof(double));
-  }
-  
-  Transpose(pts, PtsT, IV_CURVE_NUM_COMPONENTS, SizeJ);
-
-  for (j = 0; j < SizeJ; j++)
+  DetectedKernels = &KernelTables[0];
+  for (i = 1; i < sizeof(KernelTables) / sizeof(KernelTables[0]); i++)
   {
-    LocMin = 100000;
-    pt = PtsT[j];
-    for (i = 0; i < SizeJ; i++)
-    {
-      v[i] = (Curve[0][i] - pt[0]) * (Curve[0][i] - pt[0]) + (Curve[1][i] - pt[1]) * (Curve[1][i] - pt[1]);
-      if (v[i] < LocMin)
-      {
-        LocMinItem = i;
-        LocMin = v[i];
-      }
-    }
-
-    Transpose(Curve, CurveT, IV_CURVE_NUM_COMPONENTS, SizeJ);
-    CurNode = CurveT[LocMinItem];
-    
-    if (LocMinItem > 0)
-    {
-      PrevNode = CurveT[LocMinItem - 1];
-      Dist1 = Dist2PtSeg(pt, PrevNode, CurNode, IV_CURVE_NUM_COMPONENTS);
-    }
-    else
-    {
-      Dist1 = 10000;
-    }
-   
-    if (LocMinItem < SizeJ - 1)
-    {
-      NextNode = CurveT[LocMinItem + 1];
-      Dist2 = Dist2PtSeg(pt, CurNode, NextNode, IV_CURVE_NUM_COMPONENTS);
-    }
-    else
+    if (IsKernelSupported(KernelTables[i].Kernel))
     {
-      Dist2 = 10000;
+      DetectedKernels = &KernelTables[i];
     }
-    res += min(Dist1, Dist2);
   }
-  res /= SizeJ;
+}
 
-  for (i = 0; i < SizeJ; i++)
+#if defined(_WIN32)
+static INIT_ONCE KernelsOnce = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK DetectKernelsOnce(PINIT_ONCE Once, PVOID Parameter, PVOID *Context)
+{
+  (void)Once;
+  (void)Parameter;
+  (void)Context;
+  DetectKernels();
+  return TRUE;
+}
+#else
+static pthread_once_t KernelsOnce = PTHREAD_ONCE_INIT;
+#endif
+
+/**
+ * Returns the kernels selected by SetIVCKernel() or the best kernels supported by the processor
+ *
+ * @return kernels
+ */
+static const kernel_table_t *GetKernels(void)
+{
+  const kernel_table_t *Kernels = LOAD_KERNELS(SelectedKernels);
+  if (Kernels)
   {
-    free(CurveT[i]);
-    free(PtsT[i]);
+    return Kernels;
   }
+#if defined(_WIN32)
+  InitOnceExecuteOnce(&KernelsOnce, DetectKernelsOnce, NULL, NULL);
+#else
+  pthread_once(&KernelsOnce, DetectKernels);
+#endif
+  return DetectedKernels;
+}
 
-  free(CurveT);
-  free(PtsT);
-  free(v);
-
-  return res;
+/**
+ * Returns the kernels without vector instructions
+ *
+ * @return kernels
+ */
+static const kernel_table_t *GetScalarKernels(void)
+{
+  return &KernelTables[IVCMP_KERNEL_SCALAR];
 }
 
 static double Abs(double x)
@@ -336,6 +341,7 @@ static uint32_t RemoveRepeatsIvc(double **a, uint32_t SizeJ)
 {
   uint32_t i;
   uint32_t n;
+  IVC_STATS_TIMER(Timer);
   n = 0;
   for (i = 0; i < SizeJ - 1; i++)
   {
@@ -348,503 +354,4385 @@ static uint32_t RemoveRepeatsIvc(double **a, uint32_t SizeJ)
   a[0][n] = a[0][SizeJ - 1];
   a[1][n++] = a[1][SizeJ - 1];
 
+  IVC_STATS_STAGE(IVCMP_STAGE_REMOVE_REPEATS, Timer);
   return n;
 }
 
 /**
- * Subroutine to generate a B-spline knot vector
- * 
- * @param[in] n number of defining polygon vertices
- * @param[in] c order of the basis function
- * @param[out] x knot vector
- * 
- * @note NplusC is the maximum value of the knot vector 'x'
+ * Sparse table of B-spline basis functions for resampling of Npts defining points to p1 curve points.
+ * Only ORDER basis functions are non-zero for each parameter value.
  */
-static void Knot(uint32_t n, uint32_t c, double *x)
+typedef struct
 {
-  uint32_t NplusC, i;
-  NplusC = n + c;
-  x[1] = 0;
-
-  for (i = 2; i <= NplusC; i++)
-  {
-    x[i] = i - 1;
-  }
-}
+  uint32_t *First; /**< Number of the first vertex with non-zero basis function for each curve point */
+  double *Weights; /**< ORDER basis functions for each curve point starting from the First vertex */
+} basis_table_t;
 
 /**
- * Subroutine to generate B-spline basis functions for knot vectors. Uses Cox-de Boor recursive relation.
- *
- * @param[in] c order of the B-spline basis function
- * @param[in] t parameter in the Cox-de Boor formula
- * @param[in] Npts number of defining polygon vertices
- * @param[in] x knot vector
- * @param[out] n array containing the basis functions
- *
- * @note d is the first part of the basis function recursive relation
- * @note e is the second part of the basis function recursive relation
- * @note NplusC the maximum number of knot values 'Npts' + 'c'
+ * Keys of the basis tables cached in the workspace
  */
-static void Basis(uint32_t c, double t, uint32_t Npts, double *x, double *n)
+typedef struct
 {
-  uint32_t NplusC;
-  uint32_t k; uint32_t i;
-  double d, e;
-  double *Temp = (double *)malloc(4 * Npts * sizeof(double));
-  NplusC = Npts + c;
-
-  for (i = 1; i <= NplusC - 1; i++)
-  {
-    if ((t >= x[i]) && (t < x[i + 1]))
-    {
-      Temp[i] = 1.000;
-    }
-    else Temp[i] = 0;
-  }
-  for (k = 2; k <= c; k++)
-  {
-    for (i = 1; i <= NplusC - k; i++)
-    {
-      if (Temp[i] != 0)
-      {
-        d = ((t - x[i]) * Temp[i]) / (x[i + k - 1] - x[i]);
-      }
-      else d = 0;
-
-      if (Temp[i + 1] != 0)
-      {
-        e = ((x[i + k] - t) * Temp[i + 1]) / (x[i + k] - x[i + 1]);
-      }
-      else e = 0;
-
-      Temp[i] = d + e;
-    }
-  }
-
-  if (t == x[NplusC])
-  {
-    Temp[Npts] = 1;
-  }
-
-  for (i = 0; i <= Npts; i++)
-  {
-    n[i] = Temp[i];
-  }
-  free(Temp);
-}
+  uint32_t CurveLength;        /**< Curve length the workspace is placed for, 0 if the cache is empty */
+  uint32_t NextTable;          /**< Table to be replaced on cache miss */
+  uint32_t Npts[BASIS_TABLES]; /**< Number of defining vertices of each table, 0 for unused table */
+  uint32_t P1[BASIS_TABLES];   /**< Number of curve points of each table */
+} basis_cache_t;
 
 /**
- * Subroutine to generate a B-spline curve using an uniform open knot vector
+ * Fills basis table for the B-spline with uniform periodic knot vector x[i] = i - 1 (i = 1..Npts + ORDER).
+ * Only basis functions of the span x[i] <= t < x[i + 1] are evaluated with Cox-de Boor recursive relation.
+ * The arithmetic operations are the same as in the recursion over the whole knot vector,
+ * so the curve points do not depend on the number of defining vertices via rounding errors.
  *
  * @param[in] Npts number of defining polygon vertices
- * @param[in] k order of the B-spline basis function
  * @param[in] p1 number of points to be calculated on the curve
- * @param[in] b array containing the defining polygon vertices
- * @param[out] p array containing the curve points
- *
- * @note b[1], b[3]... contain the x-component of the vertex
- * @note b[2], b[4]... contain the y-component of the vertex
- * @note NBasis is the array containing the basis functions for a single value of t
- * @note NplusC is the number of knot values
- * @note p[1], p[3]... contain the x-component of the point
- * @note p[2], p[4]... contain the y-component of the point
+ * @param[out] Table basis table for p1 points
+ *
  * @note t is the parameter value used in Cox-de Boor formula
- * @note x is the array containing the knot vector
+ * @note T1, T2 are the non-zero basis functions of the second order
+ * @note at t = Npts the last basis function belongs to the vertex Npts + 1 (1-based) which does not exist,
+ * its weight is zeroed and the vertex is padded by Bspline() caller
  */
-static void Bspline(uint32_t Npts, uint32_t k, uint32_t p1, double *b, double *p)
+static void BuildBasisTable(uint32_t Npts, uint32_t p1, const basis_table_t *Table)
 {
-  uint32_t i, j, Icount, Jcount;
-  uint32_t i1;
-  uint32_t NplusC;
+  uint32_t i, i1;
   double Step;
   double t;
-  double *NBasis = (double *)malloc(IV_CURVE_NUM_COMPONENTS * Npts * sizeof(double));
-  double Temp;
-  NplusC = Npts + k;
-  double *x = (double *)malloc(IV_CURVE_NUM_COMPONENTS * NplusC * sizeof(double));
-
-  for (i = 1; i <= Npts; i++)
-  {
-    NBasis[i] = 0.;
-  }
-
-  for (i = 1; i <= NplusC; i++)
-  {
-    x[i] = 0.;
-  }
-
-  Knot(Npts, k, x);
-
-  Icount = 0;
+  double xm1, xi, xi1, xi2;
+  double T1, T2;
+  double *w;
 
-  t = k - 1; /* special parameter range for periodic basis functions */
-  Step = ((float)(Npts - (k - 1))) / ((float)(p1 - 1));
+  t = ORDER - 1; /* special parameter range for periodic basis functions */
+  Step = ((float)(Npts - (ORDER - 1))) / ((float)(p1 - 1));
 
-  for (i1 = 1; i1 <= p1; i1++)
+  for (i1 = 0; i1 < p1; i1++)
   {
     if ((float)(Npts) - t < 5e-6)
     {
       t = (float)((Npts));
     }
-    Basis(k, t, Npts, x, NBasis);
-    for (j = 1; j <= 2; j++)
+    /* Knots around the span x[i] <= t < x[i + 1] */
+    i = (uint32_t)floor(t) + 1;
+    xm1 = i - 2;
+    xi = i - 1;
+    xi1 = i;
+    xi2 = i + 1;
+
+    T1 = ((xi1 - t) * 1.000) / (xi1 - xi);
+    T2 = ((t - xi) * 1.000) / (xi1 - xi);
+
+    w = Table->Weights + ORDER * i1;
+    w[0] = 0 + ((xi1 - t) * T1) / (xi1 - xm1);
+    w[1] = ((t - xm1) * T1) / (xi1 - xm1) + ((xi2 - t) * T2) / (xi2 - xi);
+    w[2] = ((t - xi) * T2) / (xi2 - xi) + 0;
+    if (i > Npts)
     {
-      Jcount = j;
-      p[Icount + j] = 0.;
-      for (i = 1; i <= Npts; i++)
-      {
-        Temp = NBasis[i] * b[Jcount];
-        p[Icount + j] = p[Icount + j] + Temp;
-        Jcount = Jcount + 2;
-      }
+      w[2] = 0;
     }
-    Icount = Icount + 2;
+    /* Vertices are numbered from 0 here and from 1 in Cox-de Boor formula */
+    Table->First[i1] = i - ORDER;
+
     t = t + Step;
   }
-  free(x);
-  free(NBasis);
 }
 
-
-/* ******************************* */
-/*    Public functions             */
-/* ******************************* */
+/**
+ * Evaluates one coordinate of a B-spline curve point
+ *
+ * @param[in] w ORDER basis functions of the point
+ * @param[in] b coordinates of the ORDER defining vertices starting from the first one of the point
+ *
+ * @return coordinate
+ */
+static double BsplinePoint(const double *w, const double *b)
+{
+  return w[0] * b[0] + w[1] * b[1] + w[2] * b[2];
+}
 
 /**
- * Sets scaling threshold for voltages and currents
- * 
- * @param NewMinVarV new voltage noise
- * @param NewMinVarC new current noise
+ * Subroutine to generate a B-spline curve using the basis table
+ *
+ * @param[in] Table basis table
+ * @param[in] p1 number of points to be calculated on the curve
+ * @param[in] b defining polygon vertices, one vertex after the last must be readable and zero
+ * @param[out] p curve points
  */
-void SetMinVarVC(double NewMinVarV, double NewMinVarC)
+static void Bspline(const basis_table_t *Table, uint32_t p1, double *const *b, double **p)
 {
-  if (NewMinVarV > 0 && NewMinVarC > 0)
-  {
-    MinVarV = NewMinVarV;
-    MinVarC = NewMinVarC;
-  }
-  else
+  uint32_t i1, j;
+  const double *w;
+  for (j = 0; j < IV_CURVE_NUM_COMPONENTS; j++)
   {
-    printf("IVCMP ERROR: Incorrect MinVarV, MinVarC setup. Got %lf, %lf. Should be > 0.\n"
-		   "CompareIVC() will not work until correct MinVar setup\n",
-		   NewMinVarV, NewMinVarC);
-	/*
-	 * Error maximization. Compare will return -1 until correct MinVar setup.
-	 */
-	MinVarV = 0;
-	MinVarC = 0;
+    w = Table->Weights;
+    for (i1 = 0; i1 < p1; i1++, w += ORDER)
+    {
+      p[j][i1] = BsplinePoint(w, b[j] + Table->First[i1]);
+    }
   }
 }
 
-
 /**
- * Sets scaling threshold for voltages and currents
- * by noise evaluation for short circuit and open circuit curves.
- * 
- * @param VoltagesOpenC Array of voltages for open circuit curve
- * @param CurrentsOpenC Array of currents for open circuit curve
- * @param CurveLengthOpenC Number of points in open circuit curve
- * @param VoltagesShortC Array of voltages for short circuit curve
- * @param CurrentsShortC Array of currents for short circuit curve
- * @param CurveLengthShotC Number of points in short circuit curve
+ * Scratch buffers of one comparison placed in one contiguous memory block
  */
-void SetMinVarVCFromCurves(double *VoltagesOpenC, double *CurrentsOpenC, uint32_t CurveLengthOpenC,
-                           double *VoltagesShortC, double *CurrentsShortC, uint32_t CurveLengthShotC)
+typedef struct
 {
-  /*
-   * Scaling threshold should be n * sigma.
-   * Sigma - standard deviation of noise.
-   * Open circuit - no current, so we can evaluate current noise.
-   * Short circuit - no voltage drop, so we can evaluate voltage noise.
-   */
-  const float SigmaFactor = 3.0;
-  double NewMinVarV = SigmaFactor * sqrt(Disp(VoltagesShortC, CurveLengthShotC));
-  double NewMinVarC = SigmaFactor * sqrt(Disp(CurrentsOpenC, CurveLengthOpenC));
-
-  SetMinVarVC(NewMinVarV, NewMinVarC);
-
-  /* To avoid warnings for unused params, but save standard interface */
-  (void)(VoltagesOpenC);
-  (void)(CurrentsShortC);
-}
-
+  double *a_[IV_CURVE_NUM_COMPONENTS];       /**< First curve */
+  double *b_[IV_CURVE_NUM_COMPONENTS];       /**< Second curve */
+  double *SplineIn[IV_CURVE_NUM_COMPONENTS]; /**< Defining polygon vertices for Bspline() */
+  basis_table_t Tables[BASIS_TABLES];        /**< Basis tables for Bspline() */
+  basis_cache_t *Cache;                      /**< Keys of the basis tables */
+  uint32_t *Nearest;                         /**< Nearest nodes for DistCurvePts() */
+  uint32_t *NearestBA;                       /**< Nearest nodes of the other direction for NearestNodesFused() */
+  double *Dist;                              /**< Distances for DistCurvePts() */
+  double *NodeDist;                          /**< Distances to the nearest nodes for NearestNodesFused() */
+  double *Boxes;                             /**< Bounding boxes of the node blocks for DistCurvePts() */
+  float *aF[IV_CURVE_NUM_COMPONENTS];        /**< First curve in single precision */
+  float *bF[IV_CURVE_NUM_COMPONENTS];        /**< Second curve in single precision */
+  float *DistF;                              /**< Distances for DistCurvePtsF() */
+  float *NodeDistF;                          /**< Distances to the nearest nodes for NearestNodesFusedF() */
+  float *BoxesF;                             /**< Bounding boxes of the node blocks for DistCurvePtsF() */
+} workspace_t;
 
 /**
- * Gets active scaling threshold for voltages and currents
+ * Takes the next aligned array from the memory block
  *
- * @param NewMinVarVPtr - variable pointer to store voltage variation.
- * @param NewMinVarCPtr - variable pointer to store current variation.
+ * @param Base start of the aligned memory block, NULL to evaluate the size only
+ * @param Offset current offset in the block, updated
+ * @param[in] Size array size in bytes
+ *
+ * @return pointer to the array or NULL if Base is NULL
  */
-void GetMinVarVC(double *NewMinVarVPtr, double *NewMinVarCPtr)
+static void *TakeArray(char *Base, size_t *Offset, size_t Size)
 {
-	*NewMinVarVPtr = MinVarV;
-	*NewMinVarCPtr = MinVarC;
+  void *Array = Base ? Base + *Offset : NULL;
+  *Offset += (Size + WORKSPACE_ALIGNMENT - 1) / WORKSPACE_ALIGNMENT * WORKSPACE_ALIGNMENT;
+  return Array;
 }
 
-
 /**
- * Compares two curves
- * 
- * @param[in] VoltagesA voltages of the first curve
- * @param[in] CurrentsA currents of the first curve
- * @param[in] CurveLengthA number of points in the curves
- * @param[in] VoltagesB voltages of the second curve
- * @param[in] CurrentsB currents of the second curve
- * @param[in] CurveLengthB number of points in the curves
- * 
- * @return score of difference between the curves; 1.0 for completely different curves, 0.0 for same curves
+ * Places scratch buffers for curves of the given length in the memory block
+ *
+ * @param Buffer memory block, NULL to evaluate the size only
+ * @param[in] CurveLength maximal number of points in the curves
+ * @param[out] Ws scratch buffers, may be NULL if Buffer is NULL
+ *
+ * @return size of the memory block in bytes
  */
-double CompareIVC(double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
-                  double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB)
+static size_t LayoutWorkspace(void *Buffer, uint32_t CurveLength, workspace_t *Ws)
 {
+  workspace_t Dummy;
+  size_t Offset = 0;
+  const size_t N = CurveLength;
+  char *Base = NULL;
   uint32_t i;
-  double VarV, VarC;
-  double Score;
-
-  /* Check parameters */
-  if (CurveLengthA <= MIN_LEN_CURVE || CurveLengthB <= MIN_LEN_CURVE)
+  if (Buffer)
   {
-	printf("IVCMP ERROR: The signature length is too small. There should be at least %d points.\n", MIN_LEN_CURVE);
-	return SCORE_ERROR;
+    Base = (char *)Buffer + (WORKSPACE_ALIGNMENT - (uintptr_t)Buffer % WORKSPACE_ALIGNMENT) % WORKSPACE_ALIGNMENT;
   }
-
-  if (MinVarC <= 0 || MinVarV <= 0)
+  if (!Ws)
   {
-    /*
-     * Min variance should be at least several times larger than noise dispersion.
-     * Optimal value - possible curve size.
-     */
-	Score = SCORE_ERROR;
-	printf("IVCMP ERROR: Invalid normalization thresholds (MinVarVC). You should explicitly set them.\n");
-	return SCORE_ERROR;
+    Ws = &Dummy;
   }
-
-#ifdef DEBUG_FILE_OUTPUT
-  FILE *DebugOutFile;
-#endif
-
-#ifdef DEBUG_FILE_OUTPUT
-  OPEN_FILE(DebugOutFile, "input_curve_a.txt", "w");
-  for (i = 0; i < CurveLengthA; i++)
+  Ws->a_[0] = (double *)TakeArray(Base, &Offset, N * sizeof(double));
+  Ws->a_[1] = (double *)TakeArray(Base, &Offset, N * sizeof(double));
+  Ws->b_[0] = (double *)TakeArray(Base, &Offset, N * sizeof(double));
+  Ws->b_[1] = (double *)TakeArray(Base, &Offset, N * sizeof(double));
+  Ws->SplineIn[0] = (double *)TakeArray(Base, &Offset, (N + 1) * sizeof(double));
+  Ws->SplineIn[1] = (double *)TakeArray(Base, &Offset, (N + 1) * sizeof(double));
+  for (i = 0; i < BASIS_TABLES; i++)
   {
-      fprintf(DebugOutFile, "%lf\t%lf\n", VoltagesA[i], CurrentsA[i]);
+    Ws->Tables[i].First = (uint32_t *)TakeArray(Base, &Offset, N * sizeof(uint32_t));
+    Ws->Tables[i].Weights = (double *)TakeArray(Base, &Offset, ORDER * N * sizeof(double));
   }
-  fclose(DebugOutFile);
+  Ws->Nearest = (uint32_t *)TakeArray(Base, &Offset, N * sizeof(uint32_t));
+  Ws->NearestBA = (uint32_t *)TakeArray(Base, &Offset, N * sizeof(uint32_t));
+  Ws->Dist = (double *)TakeArray(Base, &Offset, N * sizeof(double));
+  Ws->NodeDist = (double *)TakeArray(Base, &Offset, N * sizeof(double));
+  Ws->Boxes = (double *)TakeArray(Base, &Offset, 4 * BOX_TREE_SIZE(N) * sizeof(double));
+  Ws->aF[0] = (float *)TakeArray(Base, &Offset, N * sizeof(float));
+  Ws->aF[1] = (float *)TakeArray(Base, &Offset, N * sizeof(float));
+  Ws->bF[0] = (float *)TakeArray(Base, &Offset, N * sizeof(float));
+  Ws->bF[1] = (float *)TakeArray(Base, &Offset, N * sizeof(float));
+  Ws->DistF = (float *)TakeArray(Base, &Offset, N * sizeof(float));
+  Ws->NodeDistF = (float *)TakeArray(Base, &Offset, N * sizeof(float));
+  Ws->BoxesF = (float *)TakeArray(Base, &Offset, 4 * BOX_TREE_SIZE(N) * sizeof(float));
+  Ws->Cache = NULL;
+  /* Reserve for alignment of the block start */
+  return Offset + WORKSPACE_ALIGNMENT;
+}
 
-  OPEN_FILE(DebugOutFile, "input_curve_b.txt", "w");
-  for (i = 0; i < CurveLengthB; i++)
+/**
+ * Returns basis table from the workspace, builds the table if it is not cached
+ *
+ * @param[in] Ws scratch buffers
+ * @param[in] Npts number of defining polygon vertices
+ * @param[in] p1 number of points to be calculated on the curve
+ *
+ * @return basis table
+ */
+static const basis_table_t *GetBasisTable(const workspace_t *Ws, uint32_t Npts, uint32_t p1)
+{
+  uint32_t i;
+  basis_cache_t *Cache = Ws->Cache;
+  for (i = 0; i < BASIS_TABLES; i++)
   {
-      fprintf(DebugOutFile, "%lf\t%lf\n", VoltagesB[i], CurrentsB[i]);
+    if ((Cache->Npts[i] == Npts) && (Cache->P1[i] == p1))
+    {
+      return &Ws->Tables[i];
+    }
   }
-  fclose(DebugOutFile);
-#endif
-
-  double **a_ = (double**)malloc(IV_CURVE_NUM_COMPONENTS * sizeof(double*));
-  double **b_ = (double**)malloc(IV_CURVE_NUM_COMPONENTS * sizeof(double*));
+  i = Cache->NextTable;
+  Cache->NextTable = (i + 1) % BASIS_TABLES;
+  BuildBasisTable(Npts, p1, &Ws->Tables[i]);
+  Cache->Npts[i] = Npts;
+  Cache->P1[i] = p1;
+  return &Ws->Tables[i];
+}
 
-  const uint32_t CurveLength = max(CurveLengthA, CurveLengthB);
-  for (i = 0; i < IV_CURVE_NUM_COMPONENTS; i++)
+/**
+ * Divides voltages and currents of the curve by scaling factors
+ *
+ * @param a curve
+ * @param[in] SizeJ number of points in the curve
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ */
+static void ScaleCurve(double **a, uint32_t SizeJ, double VarV, double VarC)
+{
+  uint32_t i;
+  for (i = 0; i < SizeJ; i++)
   {
-    a_[i] = (double*)malloc(CurveLength * sizeof(double));
-    b_[i] = (double*)malloc(CurveLength * sizeof(double));
+    a[0][i] = a[0][i] / VarV;
+    a[1][i] = a[1][i] / VarC;
   }
+}
 
-  
-  if (!VoltagesA | !CurrentsA)
+/**
+ * Resamples the curve with B-spline
+ *
+ * @param a curve, on input contains Npts defining points, on output - CurveLength points of B-spline
+ * @param[in] Npts number of defining points
+ * @param[in] CurveLength number of points to be calculated on the curve
+ * @param[in] Ws scratch buffers for curves with CurveLength points
+ */
+static void SplineCurve(double **a, uint32_t Npts, uint32_t CurveLength, const workspace_t *Ws)
+{
+  uint32_t i;
+  IVC_STATS_TIMER(Timer);
+  for (i = 0; i < IV_CURVE_NUM_COMPONENTS; i++)
   {
-	Score = SCORE_ERROR;
-    CleanUp(a_, b_, NULL, NULL);
-	printf("IVCMP ERROR: Invalid currents or voltages pointers given!\n");
-	return Score;
+    memcpy(Ws->SplineIn[i], a[i], Npts * sizeof(double));
+    Ws->SplineIn[i][Npts] = 0.;
   }
+  Bspline(GetBasisTable(Ws, Npts, CurveLength), CurveLength, Ws->SplineIn, a);
+  IVC_STATS_STAGE(IVCMP_STAGE_BSPLINE, Timer);
+}
 
-  for (i = 0; i < CurveLengthA; i++)
+/**
+ * Returns the upper bound of the length of the B-spline defined by the curve.
+ * On each span the derivative of the uniform B-spline of the second degree is a convex combination of two sides
+ * of the defining polygon, so the speed does not exceed the longest side. The parameter range is Npts - (ORDER - 1).
+ *
+ * @param[in] a defining polygon vertices
+ * @param[in] Npts number of defining polygon vertices
+ *
+ * @return bound of the length
+ */
+static double SplineLengthBound(double **a, uint32_t Npts)
+{
+  uint32_t i;
+  double dV, dC;
+  double MaxSide2 = 0;
+  for (i = 0; i + 1 < Npts; i++)
   {
-    a_[0][i] = VoltagesA[i];
-    a_[1][i] = CurrentsA[i];
+    dV = a[0][i + 1] - a[0][i];
+    dC = a[1][i + 1] - a[1][i];
+    MaxSide2 = max(MaxSide2, dV * dV + dC * dC);
   }
+  return sqrt(MaxSide2) * (Npts - (ORDER - 1));
+}
 
-  if (VoltagesB)
+/**
+ * Returns the number of points to resample two curves to, so that the neighbouring points of each B-spline
+ * are at most Step apart along it
+ *
+ * @param[in] a first curve, defining polygon vertices
+ * @param[in] SizeA number of vertices of the first curve
+ * @param[in] b second curve, defining polygon vertices
+ * @param[in] SizeB number of vertices of the second curve
+ * @param[in] Step largest step along the curves, 0 to keep CurveLength
+ * @param[in] CurveLength number of points without resampling
+ *
+ * @return number of points, not more than CurveLength
+ */
+static uint32_t ResampledLength(double **a, uint32_t SizeA, double **b, uint32_t SizeB, double Step,
+                                uint32_t CurveLength)
+{
+  if (Step <= 0)
   {
-    for (i = 0; i < CurveLengthB; i++)
-    {
-      b_[0][i] = VoltagesB[i];
-      b_[1][i] = CurrentsB[i];
-    }
+    return CurveLength;
   }
-
-#ifdef DEBUG_FILE_OUTPUT
-  OPEN_FILE(DebugOutFile, "copied_curve_a.txt", "w");
-  for (i = 0; i < CurveLengthA; i++)
+  /* p1 points divide the parameter range into p1 - 1 equal parts */
+  const double Length = max(SplineLengthBound(a, SizeA), SplineLengthBound(b, SizeB));
+  const double Need = ceil(Length / Step) + 1;
+  if (!(Need < CurveLength))
   {
-      fprintf(DebugOutFile, "%lf\t%lf\n", a_[0][i], a_[1][i]);
+    return CurveLength;
   }
-  fclose(DebugOutFile);
+  return max((uint32_t)Need, min(RESAMPLE_MIN_LENGTH, CurveLength));
+}
 
-  OPEN_FILE(DebugOutFile, "copied_curve_b.txt", "w");
-  for (i = 0; i < CurveLengthB; i++)
+/**
+ * Marks points which RemoveRepeatsIvc() keeps in the curve scaled by given factors
+ *
+ * @param[in] Voltages voltages of the curve
+ * @param[in] Currents currents of the curve
+ * @param[in] SizeJ number of points in the curve
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ * @param[out] Kept non-zero for the kept points
+ *
+ * @return number of kept points
+ */
+static uint32_t MarkRepeatsIvc(const double *Voltages, const double *Currents, uint32_t SizeJ,
+                               double VarV, double VarC, uint8_t *Kept)
+{
+  uint32_t i;
+  uint32_t n = 0;
+  for (i = 0; i < SizeJ - 1; i++)
   {
-      fprintf(DebugOutFile, "%lf\t%lf\n", b_[0][i], b_[1][i]);
+    Kept[i] = (Abs(Voltages[i + 1] / VarV - Voltages[i] / VarV) > 1.e-6) |
+              (Abs(Currents[i + 1] / VarC - Currents[i] / VarC) > 1.e-6);
+    n += Kept[i];
   }
-  fclose(DebugOutFile);
-#endif
+  Kept[SizeJ - 1] = 1;
+  return n + 1;
+}
 
-  double _v = max(sqrt(Disp(a_[0], CurveLengthA)), sqrt(Disp(b_[0], CurveLengthB)));
-  double _c = max(sqrt(Disp(a_[1], CurveLengthA)), sqrt(Disp(b_[1], CurveLengthB)));
-  VarV = max(_v, MinVarV);
-  VarC = max(_c, MinVarC);
-
-#ifdef DEBUG_FILE_OUTPUT
-  OPEN_FILE(DebugOutFile, "variations.txt", "w");
-  fprintf(DebugOutFile, "VarV = %lf\n", VarV);
-  fprintf(DebugOutFile, "VarC = %lf\n", VarC);
-  fclose(DebugOutFile);
-#endif
 
-  for (i = 0; i < CurveLengthA; i++)
-  { 
-    a_[0][i] = a_[0][i] / VarV;
-    a_[1][i] = a_[1][i] / VarC;
-  }
+/* ******************************* */
+/*    Comparison context           */
+/* ******************************* */
 
-#ifdef DEBUG_FILE_OUTPUT
-  OPEN_FILE(DebugOutFile, "scaled_a.txt", "w");
-  for (i = 0; i < CurveLengthA; i++)
-  {
-      fprintf(DebugOutFile, "%lf\t%lf\n", a_[0][i], a_[1][i]);
-  }
-  fclose(DebugOutFile);
-#endif
+/**
+ * Header of the capture dump, see SetContextCaptureBuffer()
+ */
+typedef struct
+{
+  char Magic[8];       /**< "IVCMPCAP" */
+  uint32_t Version;    /**< CAPTURE_FILE_VERSION */
+  uint32_t NumRecords; /**< Number of records following the header */
+  uint32_t Flags;      /**< CAPTURE_TRUNCATED */
+  uint32_t Reserved;   /**< 0 */
+} capture_header_t;
 
-  double *InCurve = (double *)malloc((CurveLength * IV_CURVE_NUM_COMPONENTS + 1) * sizeof(double));
-  double *OutCurve = (double *)malloc((CurveLength * IV_CURVE_NUM_COMPONENTS + 1) * sizeof(double));
-  uint32_t SizeA = RemoveRepeatsIvc(a_, CurveLengthA);
+/**
+ * Header of a record of the capture dump, followed by NumArrays arrays of Length doubles
+ */
+typedef struct
+{
+  uint32_t Stage;     /**< ivcmp_capture_stage_t */
+  uint32_t Curve;     /**< 0 for the first curve, 1 for the second one */
+  uint32_t Length;    /**< Number of points or values */
+  uint32_t NumArrays; /**< 2 for a curve, 1 for values */
+} capture_record_header_t;
+
+/**
+ * Buffer given by SetContextCaptureBuffer()
+ */
+typedef struct
+{
+  unsigned char *Data; /**< Memory block, the dump of the last comparison */
+  size_t Size;         /**< Size of the memory block in bytes */
+  size_t Used;         /**< Size of the dump in bytes, 0 before the first comparison */
+} capture_buffer_t;
 
-#ifdef DEBUG_FILE_OUTPUT
-  OPEN_FILE(DebugOutFile, "repeats_removed_a.txt", "w");
-  for (i = 0; i < SizeA; i++)
+/**
+ * Comparison context: all the settings and scratch buffers used by one comparison thread
+ */
+struct ivcmp_context_s
+{
+  double MinVarV;       /**< Scaling threshold for voltages */
+  double MinVarC;       /**< Scaling threshold for currents */
+  void *Workspace;      /**< Memory block for scratch buffers */
+  size_t WorkspaceSize; /**< Size of the memory block in bytes */
+  int OwnWorkspace;     /**< Non-zero if the memory block is allocated by the library */
+  basis_cache_t Cache;  /**< Basis tables stored in the memory block */
+  ivcmp_precision_t Precision; /**< Precision of the distance stage */
+  double ResampleStep;         /**< Largest step along the B-splines, 0 to resample to the longer curve */
+  ivcmp_capture_func_t Capture;  /**< Function receiving the stages of the comparisons, NULL if disabled */
+  void *CaptureUser;             /**< Argument of the capture function */
+  capture_buffer_t CaptureBuffer; /**< Buffer of the dump if the stages are captured to memory */
+};
+
+/**
+ * Context used by the functions without explicit context parameter.
+ * Zero initialized thresholds mean that CompareIVC() will not work until correct MinVar setup.
+ */
+static ivcmp_context_t DefaultContext;
+
+/**
+ * Allocator functions set by SetIVCAllocator(), NULL for standard malloc() and free()
+ */
+static ivcmp_malloc_t MallocFunc;
+static ivcmp_free_t FreeFunc;
+
+/**
+ * Passes the curve of the stage to the capture function of the context
+ *
+ * @param Ctx comparison context with the capture function
+ * @param[in] Stage stage
+ * @param[in] Curve 0 for the first curve, 1 for the second one
+ * @param[in] Voltages voltages
+ * @param[in] Currents currents
+ * @param[in] Length number of points
+ */
+static void CaptureCurve(ivcmp_context_t *Ctx, ivcmp_capture_stage_t Stage, uint32_t Curve,
+                         const double *Voltages, const double *Currents, uint32_t Length)
+{
+  ivcmp_capture_record_t Record;
+  Record.Stage = (uint32_t)Stage;
+  Record.Curve = Curve;
+  Record.Length = Length;
+  Record.Voltages = Voltages;
+  Record.Currents = Currents;
+  Ctx->Capture(Ctx->CaptureUser, &Record);
+}
+
+/**
+ * Passes the values of the stage to the capture function of the context
+ *
+ * @param Ctx comparison context with the capture function
+ * @param[in] Stage stage
+ * @param[in] Values values
+ * @param[in] Length number of values
+ */
+static void CaptureValues(ivcmp_context_t *Ctx, ivcmp_capture_stage_t Stage, const double *Values, uint32_t Length)
+{
+  CaptureCurve(Ctx, Stage, 0, Values, NULL, Length);
+}
+
+/**
+ * Capture function writing the records to the buffer. The dump is restarted by the input of the first curve,
+ * so the buffer keeps the stages of the last comparison.
+ *
+ * @param User buffer of the context
+ * @param[in] Record record
+ */
+static void CCONV CaptureToBuffer(void *User, const ivcmp_capture_record_t *Record)
+{
+  capture_buffer_t *Buffer = (capture_buffer_t *)User;
+  capture_header_t *Header = (capture_header_t *)Buffer->Data;
+  capture_record_header_t RecordHeader;
+  const uint32_t NumArrays = Record->Currents ? 2 : 1;
+  const size_t ArraySize = (size_t)Record->Length * sizeof(double);
+
+  if (Record->Stage == IVCMP_CAPTURE_INPUT && Record->Curve == 0)
   {
-      fprintf(DebugOutFile, "%lf\t%lf\n", a_[0][i], a_[1][i]);
+    memset(Header, 0, sizeof(capture_header_t));
+    memcpy(Header->Magic, "IVCMPCAP", sizeof(Header->Magic));
+    Header->Version = CAPTURE_FILE_VERSION;
+    Buffer->Used = sizeof(capture_header_t);
   }
-  fclose(DebugOutFile);
-#endif
-
-  if (SizeA < MIN_LEN_CURVE)
+  if (Buffer->Used == 0)
   {
-    Score = SCORE_ERROR;
-    printf("IVCMP ERROR:  all elements of curve identical. Algorithm doesn't match such curves!\n");
-    CleanUp(a_, b_, InCurve, OutCurve);
-    return Score;
+    return;
   }
-
-  for (i = 0; i < SizeA; i++)
+  if (Buffer->Size - Buffer->Used < sizeof(capture_record_header_t) + NumArrays * ArraySize)
   {
-    InCurve[i * IV_CURVE_NUM_COMPONENTS + 1] = a_[0][i];
-    InCurve[i * IV_CURVE_NUM_COMPONENTS + 2] = a_[1][i];
+    Header->Flags |= CAPTURE_TRUNCATED;
+    return;
   }
-  for (i = 1; i <= IV_CURVE_NUM_COMPONENTS * CurveLength; i++)
+  RecordHeader.Stage = Record->Stage;
+  RecordHeader.Curve = Record->Curve;
+  RecordHeader.Length = Record->Length;
+  RecordHeader.NumArrays = NumArrays;
+  memcpy(Buffer->Data + Buffer->Used, &RecordHeader, sizeof(RecordHeader));
+  Buffer->Used += sizeof(RecordHeader);
+  memcpy(Buffer->Data + Buffer->Used, Record->Voltages, ArraySize);
+  Buffer->Used += ArraySize;
+  if (Record->Currents)
   {
-    OutCurve[i] = 0.;
+    memcpy(Buffer->Data + Buffer->Used, Record->Currents, ArraySize);
+    Buffer->Used += ArraySize;
   }
+  Header->NumRecords++;
+}
 
-  Bspline(SizeA, ORDER, CurveLength, InCurve, OutCurve);
+/**
+ * Bounding box of a part of the splined curve, not scaled
+ */
+typedef struct
+{
+  double MinV;    /**< Voltage range */
+  double MaxV;
+  double MinC;    /**< Current range */
+  double MaxC;
+  uint32_t Count; /**< Number of points in the part, the box also covers the first point of the next part */
+} curve_box_t;
 
-  for (i = 0; i < CurveLength; i++)
-  {
-    a_[0][i] = OutCurve[i * IV_CURVE_NUM_COMPONENTS + 1];
-    a_[1][i] = OutCurve[i * IV_CURVE_NUM_COMPONENTS + 2];
-  }
+/* Arrays of the prepared curve follow its structure, Capacity elements each. The structure has no pointers,
+ * so the whole curve is one block that can be written to a file and used in place. */
+#define PREPARED_VOLTAGES(P) ((double *)((P) + 1))                          /**< Copy of voltages */
+#define PREPARED_CURRENTS(P) (PREPARED_VOLTAGES(P) + (P)->Capacity)        /**< Copy of currents */
+#define PREPARED_SPLINED_V(P) (PREPARED_CURRENTS(P) + (P)->Capacity)       /**< Voltages of B-spline, not scaled */
+#define PREPARED_SPLINED_C(P) (PREPARED_SPLINED_V(P) + (P)->Capacity)      /**< Currents of B-spline, not scaled */
+#define PREPARED_KEPT(P) ((uint8_t *)(PREPARED_SPLINED_C(P) + (P)->Capacity)) /**< Points left by repeats removal */
+
+/**
+ * Curve prepared for repeated comparisons: everything that does not depend on the second curve
+ */
+struct ivcmp_prepared_s
+{
+  uint32_t CurveLength; /**< Number of points in the curve */
+  uint32_t Size;        /**< Number of points left after repeats removal */
+  uint32_t Capacity;    /**< Maximum number of points, gives the positions of the arrays */
+  uint32_t Reserved;    /**< Zero */
+  double SigmaV;        /**< Standard deviation of voltages */
+  double SigmaC;        /**< Standard deviation of currents */
+  double OwnVarV;       /**< Voltage scale used for repeats removal */
+  double OwnVarC;       /**< Current scale used for repeats removal */
+  double MaxGrowth;     /**< Scales may grow by a smaller factor without changing the kept points */
+  curve_box_t Boxes[DESCRIPTOR_BLOCKS]; /**< Descriptor: bounding boxes of the parts of the B-spline */
+};
+
+/**
+ * Allocates memory with the allocator set by SetIVCAllocator()
+ *
+ * @param[in] Size size in bytes
+ *
+ * @return pointer to the memory or NULL
+ */
+static void *IvcMalloc(size_t Size)
+{
+  return MallocFunc ? MallocFunc(Size) : malloc(Size);
+}
 
-#ifdef DEBUG_FILE_OUTPUT
-  OPEN_FILE(DebugOutFile, "splined_a.txt", "w");
-  for (i = 0; i < CurveLength; i++)
+/**
+ * Releases memory allocated by IvcMalloc()
+ *
+ * @param Ptr pointer to the memory, may be NULL
+ */
+static void IvcFree(void *Ptr)
+{
+  if (!Ptr)
   {
-      fprintf(DebugOutFile, "%lf\t%lf\n", a_[0][i], a_[1][i]);
+    return;
   }
-  fclose(DebugOutFile);
-#endif
-
-  if (!VoltagesB)
+  if (FreeFunc)
   {
-    double x = Mean(a_[1], CurveLengthB);
-    Score = RescaleScore(x * x);
+    FreeFunc(Ptr);
   }
   else
   {
-    for (i = 0; i < CurveLengthB; i++)
+    free(Ptr);
+  }
+}
+
+/**
+ * Makes sure that the workspace of the context can hold curves of the given length
+ * and places scratch buffers in it.
+ * Memory is allocated only if the own workspace of the context is too small.
+ *
+ * @param Ctx comparison context
+ * @param[in] CurveLength number of points in the curves
+ * @param[out] Ws scratch buffers
+ *
+ * @return IVCMP_OK, IVCMP_ERROR_NO_MEMORY or IVCMP_ERROR_WORKSPACE_TOO_SMALL for the workspace given by user
+ */
+static ivcmp_status_t ReserveWorkspace(ivcmp_context_t *Ctx, uint32_t CurveLength, workspace_t *Ws)
+{
+  void *Workspace;
+  const size_t Size = LayoutWorkspace(NULL, CurveLength, NULL);
+  if (Size > Ctx->WorkspaceSize)
+  {
+    if (Ctx->Workspace && !Ctx->OwnWorkspace)
     {
-      b_[0][i] = b_[0][i] / VarV;
-      b_[1][i] = b_[1][i] / VarC;
+      return IVCMP_ERROR_WORKSPACE_TOO_SMALL;
     }
-
-#ifdef DEBUG_FILE_OUTPUT
-    OPEN_FILE(DebugOutFile, "scaled_b.txt", "w");
-    for (i = 0; i < CurveLengthB; i++)
+    Workspace = IvcMalloc(Size);
+    if (!Workspace)
     {
-        fprintf(DebugOutFile, "%lf\t%lf\n", b_[0][i], b_[1][i]);
+      return IVCMP_ERROR_NO_MEMORY;
     }
-    fclose(DebugOutFile);
-#endif
+    IvcFree(Ctx->Workspace);
+    Ctx->Workspace = Workspace;
+    Ctx->WorkspaceSize = Size;
+    Ctx->OwnWorkspace = 1;
+    memset(&Ctx->Cache, 0, sizeof(Ctx->Cache));
+  }
+  if (Ctx->Cache.CurveLength != CurveLength)
+  {
+    /* The tables are moved by the new layout */
+    memset(&Ctx->Cache, 0, sizeof(Ctx->Cache));
+    Ctx->Cache.CurveLength = CurveLength;
+  }
+  LayoutWorkspace(Ctx->Workspace, CurveLength, Ws);
+  Ws->Cache = &Ctx->Cache;
+  return IVCMP_OK;
+}
 
-    uint32_t SizeB = RemoveRepeatsIvc(b_, CurveLengthB);
 
-#ifdef DEBUG_FILE_OUTPUT
-    OPEN_FILE(DebugOutFile, "repeats_removed_b.txt", "w");
-    for (i = 0; i < SizeB; i++)
-    {
-        fprintf(DebugOutFile, "%lf\t%lf\n", b_[0][i], b_[1][i]);
-    }
-    fclose(DebugOutFile);
-#endif
+/**
+ * Evaluates scaling thresholds for voltages and currents
+ * by noise evaluation for short circuit and open circuit curves.
+ *
+ * @param[in] CurrentsOpenC Array of currents for open circuit curve
+ * @param[in] CurveLengthOpenC Number of points in open circuit curve
+ * @param[in] VoltagesShortC Array of voltages for short circuit curve
+ * @param[in] CurveLengthShotC Number of points in short circuit curve
+ * @param[out] NewMinVarV voltage threshold
+ * @param[out] NewMinVarC current threshold
+ */
+static void EvalMinVarVC(double *CurrentsOpenC, uint32_t CurveLengthOpenC,
+                         double *VoltagesShortC, uint32_t CurveLengthShotC,
+                         double *NewMinVarV, double *NewMinVarC)
+{
+  /*
+   * Scaling threshold should be n * sigma.
+   * Sigma - standard deviation of noise.
+   * Open circuit - no current, so we can evaluate current noise.
+   * Short circuit - no voltage drop, so we can evaluate voltage noise.
+   */
+  const float SigmaFactor = 3.0;
+  *NewMinVarV = SigmaFactor * sqrt(Disp(VoltagesShortC, CurveLengthShotC));
+  *NewMinVarC = SigmaFactor * sqrt(Disp(CurrentsOpenC, CurveLengthOpenC));
+}
 
-    if (SizeB < MIN_LEN_CURVE)
-    {
-      Score = SCORE_ERROR;
-      printf("IVCMP ERROR:  all elements of curve identical. Algorithm doesn't match such curves!\n");
-      CleanUp(a_, b_, InCurve, OutCurve);
-      return Score;
-    }
 
-    for (i = 0; i < SizeB; i++)
-    {
-      InCurve[i * IV_CURVE_NUM_COMPONENTS + 1] = b_[0][i];
-      InCurve[i * IV_CURVE_NUM_COMPONENTS + 2] = b_[1][i];
-    }
 
-    for (i = 1; i <= IV_CURVE_NUM_COMPONENTS * CurveLength; i++)
+/**
+ * Checks that repeats removal with given scales leaves the same points as on curve preparation
+ *
+ * @param[in] Prepared prepared curve
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ *
+ * @return 1 if the same points are left, 0 otherwise
+ */
+static int HasSameRepeats(const ivcmp_prepared_t *Prepared, double VarV, double VarC)
+{
+  uint32_t i;
+  uint8_t Kept;
+  const double *Voltages = PREPARED_VOLTAGES(Prepared);
+  const double *Currents = PREPARED_CURRENTS(Prepared);
+  const uint8_t *PreparedKept = PREPARED_KEPT(Prepared);
+  for (i = 0; i < Prepared->CurveLength - 1; i++)
+  {
+    Kept = (Abs(Voltages[i + 1] / VarV - Voltages[i] / VarV) > 1.e-6) |
+           (Abs(Currents[i + 1] / VarC - Currents[i] / VarC) > 1.e-6);
+    if (Kept != PreparedKept[i])
     {
-      OutCurve[i] = 0.;
+      return 0;
     }
+  }
+  return 1;
+}
+
+/**
+ * Counts the repeats removed from the curve in the statistics
+ *
+ * @param[in] CurveLength number of points in the curve
+ * @param[in] Size number of points left
+ */
+static void CountRepeats(uint32_t CurveLength, uint32_t Size)
+{
+  if (Size < CurveLength)
+  {
+    IVC_STATS_ADD(CurvesWithRepeats, 1);
+    IVC_STATS_ADD(RepeatsRemoved, CurveLength - Size);
+  }
+}
+
+/**
+ * Counts the scaling thresholds exceeding the standard deviations of the curves in the statistics
+ *
+ * @param[in] Ctx comparison context
+ * @param[in] SigmaV larger standard deviation of the voltages of the curves
+ * @param[in] SigmaC larger standard deviation of the currents of the curves
+ */
+static void CountClamping(const ivcmp_context_t *Ctx, double SigmaV, double SigmaC)
+{
+  if (SigmaV < Ctx->MinVarV)
+  {
+    IVC_STATS_ADD(MinVarVClamped, 1);
+  }
+  if (SigmaC < Ctx->MinVarC)
+  {
+    IVC_STATS_ADD(MinVarCClamped, 1);
+  }
+}
 
-    Bspline(SizeB, ORDER, CurveLength, InCurve, OutCurve);
+/**
+ * Gets scaled B-spline of the prepared curve. B-spline is affine invariant,
+ * so cached B-spline is only rescaled if repeats removal gives the same points
+ * and number of points matches. Otherwise the full pipeline is repeated.
+ *
+ * @param[in] Prepared prepared curve
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ * @param[in] CurveLength number of points to be calculated on the curve
+ * @param[out] a resulting curve with CurveLength points
+ * @param[in] Ws scratch buffers for SplineCurve()
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_IDENTICAL_POINTS
+ */
+static ivcmp_status_t GetScaledSpline(const ivcmp_prepared_t *Prepared, double VarV, double VarC,
+                                      uint32_t CurveLength, double **a, const workspace_t *Ws)
+{
+  uint32_t i;
+  uint32_t Size;
+  IVC_STATS_TIMER(Timer);
+  if (Prepared->CurveLength == CurveLength && HasSameRepeats(Prepared, VarV, VarC))
+  {
     for (i = 0; i < CurveLength; i++)
     {
-      b_[0][i] = OutCurve[i * IV_CURVE_NUM_COMPONENTS + 1];
-      b_[1][i] = OutCurve[i * IV_CURVE_NUM_COMPONENTS + 2];
+      a[0][i] = PREPARED_SPLINED_V(Prepared)[i] / VarV;
+      a[1][i] = PREPARED_SPLINED_C(Prepared)[i] / VarC;
     }
+    IVC_STATS_STAGE(IVCMP_STAGE_NORMALIZE, Timer);
+    return IVCMP_OK;
+  }
 
-#ifdef DEBUG_FILE_OUTPUT
-    OPEN_FILE(DebugOutFile, "splined_b.txt", "w");
-    for (i = 0; i < CurveLength; i++)
+  for (i = 0; i < Prepared->CurveLength; i++)
+  {
+    a[0][i] = PREPARED_VOLTAGES(Prepared)[i];
+    a[1][i] = PREPARED_CURRENTS(Prepared)[i];
+  }
+  ScaleCurve(a, Prepared->CurveLength, VarV, VarC);
+  IVC_STATS_STAGE(IVCMP_STAGE_NORMALIZE, Timer);
+  Size = RemoveRepeatsIvc(a, Prepared->CurveLength);
+  CountRepeats(Prepared->CurveLength, Size);
+  if (Size < MIN_LEN_CURVE)
+  {
+    IVC_STATS_ADD(IdenticalCurves, 1);
+    return IVCMP_ERROR_IDENTICAL_POINTS;
+  }
+  SplineCurve(a, Size, CurveLength, Ws);
+  return IVCMP_OK;
+}
+
+/**
+ * Evaluates the descriptor of the prepared curve: bounding boxes of the parts of its B-spline
+ * and the factor by which the scales may grow without changing the points left by repeats removal.
+ *
+ * @param Prepared prepared curve with B-spline and kept points
+ */
+static void DescribeCurve(ivcmp_prepared_t *Prepared)
+{
+  uint32_t i, k, First, Last;
+  double Growth;
+  const uint32_t N = Prepared->CurveLength;
+  const double *Voltages = PREPARED_VOLTAGES(Prepared);
+  const double *Currents = PREPARED_CURRENTS(Prepared);
+  const double *SplinedV = PREPARED_SPLINED_V(Prepared);
+  const double *SplinedC = PREPARED_SPLINED_C(Prepared);
+
+  for (k = 0; k < DESCRIPTOR_BLOCKS; k++)
+  {
+    curve_box_t *Box = &Prepared->Boxes[k];
+    First = (uint32_t)((uint64_t)k * N / DESCRIPTOR_BLOCKS);
+    Last = (uint32_t)((uint64_t)(k + 1) * N / DESCRIPTOR_BLOCKS);
+    Box->Count = Last - First;
+    /* Segment from the last point of the part to the next one lies in the box too */
+    Last = min(Last, N - 1);
+    Box->MinV = Box->MaxV = SplinedV[First];
+    Box->MinC = Box->MaxC = SplinedC[First];
+    for (i = First + 1; i <= Last; i++)
     {
-        fprintf(DebugOutFile, "%lf\t%lf\n", b_[0][i], b_[1][i]);
+      Box->MinV = min(Box->MinV, SplinedV[i]);
+      Box->MaxV = max(Box->MaxV, SplinedV[i]);
+      Box->MinC = min(Box->MinC, SplinedC[i]);
+      Box->MaxC = max(Box->MaxC, SplinedC[i]);
     }
-    fclose(DebugOutFile);
-#endif
+  }
 
-    double DistAB = DistCurvePts(a_, b_, CurveLength);
-    double DistBA = DistCurvePts(b_, a_, CurveLength);
-    Score = RescaleScore((DistAB + DistBA) / 2.);
+  /* Kept point stays kept while one of its steps exceeds the repeats threshold */
+  Prepared->MaxGrowth = HUGE_VAL;
+  for (i = 0; i < N - 1; i++)
+  {
+    if (PREPARED_KEPT(Prepared)[i])
+    {
+      Growth = max(Abs(Voltages[i + 1] - Voltages[i]) / Prepared->OwnVarV,
+                   Abs(Currents[i + 1] - Currents[i]) / Prepared->OwnVarC) / 1.e-6;
+      Prepared->MaxGrowth = min(Prepared->MaxGrowth, Growth);
+    }
+  }
+}
 
-#ifdef DEBUG_FILE_OUTPUT
-    OPEN_FILE(DebugOutFile, "dist_and_scores.txt", "w");
-    fprintf(DebugOutFile, "dist_a_b = %lf\n", DistAB);
-    fprintf(DebugOutFile, "dist_b_a = %lf\n", DistBA);
-    fprintf(DebugOutFile, "score = %lf\n", Score);
-    fclose(DebugOutFile);
-#endif
+/**
+ * Checks that the descriptor of the prepared curve describes its B-spline used in the comparison:
+ * the number of points is the same and repeats removal leaves the same points, see GetScaledSpline()
+ *
+ * @param[in] Prepared prepared curve
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ * @param[in] CurveLength number of points in the compared curves
+ *
+ * @return 1 if the descriptor may be used
+ */
+static int IsDescriptorValid(const ivcmp_prepared_t *Prepared, double VarV, double VarC, uint32_t CurveLength)
+{
+  const double Growth = max(VarV / Prepared->OwnVarV, VarC / Prepared->OwnVarC);
+  /* Removed repeats may be kept again with a smaller scale */
+  if (Prepared->Size < Prepared->CurveLength && (VarV < Prepared->OwnVarV || VarC < Prepared->OwnVarC))
+  {
+    return 0;
   }
-  CleanUp(a_, b_, InCurve, OutCurve);
-  return Score;
+  /* Margin covers rounding in the repeats check */
+  return Prepared->CurveLength == CurveLength && Growth * (1 + 1.e-6) < Prepared->MaxGrowth;
 }
 
+/**
+ * Evaluates the lower bound of the distance from the points of one curve to the other curve.
+ * Every point lies in the box of its part and every segment of the other curve lies in one of its boxes,
+ * so the distance from the point is not less than the least distance between the boxes.
+ *
+ * @param[in] PtsBoxes boxes of the curve with the points
+ * @param[in] CurveBoxes boxes of the other curve
+ * @param[in] CurveLength number of points in the curves
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ *
+ * @return lower bound of DistCurvePts() for the scaled curves
+ */
+static double BoxesDistance(const curve_box_t *PtsBoxes, const curve_box_t *CurveBoxes, uint32_t CurveLength,
+                            double VarV, double VarC)
+{
+  uint32_t k, m;
+  double dV, dC, Dist, MinDist;
+  double Sum = 0;
+  for (k = 0; k < DESCRIPTOR_BLOCKS; k++)
+  {
+    const curve_box_t *a = &PtsBoxes[k];
+    MinDist = HUGE_VAL;
+    for (m = 0; m < DESCRIPTOR_BLOCKS && MinDist > 0; m++)
+    {
+      const curve_box_t *b = &CurveBoxes[m];
+      dV = max(max(a->MinV - b->MaxV, b->MinV - a->MaxV), 0) / VarV;
+      dC = max(max(a->MinC - b->MaxC, b->MinC - a->MaxC), 0) / VarC;
+      Dist = dV * dV + dC * dC;
+      MinDist = min(MinDist, Dist);
+    }
+    Sum += a->Count * MinDist;
+  }
+  return Sum / CurveLength;
+}
+
+/**
+ * Returns the largest absolute coordinate of the scaled boxes
+ *
+ * @param[in] Boxes boxes of the curve
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ *
+ * @return largest coordinate
+ */
+static double BoxesRange(const curve_box_t *Boxes, double VarV, double VarC)
+{
+  uint32_t k;
+  double Range = 0;
+  for (k = 0; k < DESCRIPTOR_BLOCKS; k++)
+  {
+    const curve_box_t *Box = &Boxes[k];
+    Range = max(Range, max(max(Abs(Box->MinV), Abs(Box->MaxV)) / VarV, max(Abs(Box->MinC), Abs(Box->MaxC)) / VarC));
+  }
+  return Range;
+}
+
+/**
+ * Evaluates the lower bound of the score from the boxes of two curves
+ *
+ * @param[in] BoxesA boxes of the first curve
+ * @param[in] BoxesB boxes of the second curve
+ * @param[in] CurveLength number of points in the curves
+ * @param[in] VarV voltage scale
+ * @param[in] VarC current scale
+ * @param[in] LeastVarV least voltage scale of the curves described by the boxes, not greater than VarV
+ * @param[in] LeastVarC least current scale of the curves described by the boxes, not greater than VarC
+ *
+ * @return lower bound of the score
+ */
+static double BoxesBound(const curve_box_t *BoxesA, const curve_box_t *BoxesB, uint32_t CurveLength,
+                         double VarV, double VarC, double LeastVarV, double LeastVarC)
+{
+  double Dist, Range;
+  Dist = (BoxesDistance(BoxesA, BoxesB, CurveLength, VarV, VarC) +
+          BoxesDistance(BoxesB, BoxesA, CurveLength, VarV, VarC)) / 2.;
+  /* Distances between the points are evaluated with rounding errors, single precision included */
+  Range = max(BoxesRange(BoxesA, LeastVarV, LeastVarC), BoxesRange(BoxesB, LeastVarV, LeastVarC));
+  Dist -= BOUND_TOLERANCE * (1 + Range * Range);
+  return Dist > 0 ? RescaleScore(Dist) : 0;
+}
+
+/**
+ * Evaluates the lower bound of the score of two prepared curves from their descriptors
+ *
+ * @param Ctx comparison context
+ * @param[in] PreparedA first curve
+ * @param[in] PreparedB second curve
+ *
+ * @return lower bound of the score, 0 if the descriptors do not describe the compared curves
+ */
+static double DescriptorsBound(const ivcmp_context_t *Ctx, const ivcmp_prepared_t *PreparedA,
+                               const ivcmp_prepared_t *PreparedB)
+{
+  const uint32_t CurveLength = max(PreparedA->CurveLength, PreparedB->CurveLength);
+  const double VarV = max(max(PreparedA->SigmaV, PreparedB->SigmaV), Ctx->MinVarV);
+  const double VarC = max(max(PreparedA->SigmaC, PreparedB->SigmaC), Ctx->MinVarC);
+
+  if (!IsDescriptorValid(PreparedA, VarV, VarC, CurveLength) ||
+      !IsDescriptorValid(PreparedB, VarV, VarC, CurveLength))
+  {
+    return 0;
+  }
+  return BoxesBound(PreparedA->Boxes, PreparedB->Boxes, CurveLength, VarV, VarC, VarV, VarC);
+}
+
+/**
+ * Evaluates distances between two splined curves in both directions.
+ * The evaluation stops as soon as the sum of the distances proves to exceed MaxSum.
+ *
+ * @param Ws scratch buffers with the curves in a_ and b_
+ * @param[in] CurveLength number of points in the curves
+ * @param[in] Precision precision of the distance stage
+ * @param[in] MaxSum bound of the sum of the distances, HUGE_VAL to evaluate the distances completely
+ * @param[out] DistAB distance from the first curve to the second one
+ * @param[out] DistBA distance from the second curve to the first one
+ *
+ * @return 1 if the distances are exact, 0 if they may be lower bounds
+ */
+static int CurvesDistance(workspace_t *Ws, uint32_t CurveLength, ivcmp_precision_t Precision, double MaxSum,
+                          double *DistAB, double *DistBA)
+{
+  uint32_t i, j;
+  /* Both directions share the squared distances, unless the second direction is likely to be skipped */
+  const int Fused = CurveLength < FUSED_MAX_LEN_CURVE && MaxSum == HUGE_VAL;
+  if (Precision == IVCMP_PRECISION_FLOAT)
+  {
+    for (j = 0; j < IV_CURVE_NUM_COMPONENTS; j++)
+    {
+      for (i = 0; i < CurveLength; i++)
+      {
+        Ws->aF[j][i] = (float)Ws->a_[j][i];
+        Ws->bF[j][i] = (float)Ws->b_[j][i];
+      }
+    }
+    if (Fused)
+    {
+      NearestNodesFusedF(Ws->aF, Ws->bF, CurveLength, Ws->DistF, Ws->NearestBA, Ws->NodeDistF, Ws->Nearest);
+    }
+    *DistAB = DistCurvePtsF(Ws->aF, Ws->bF, CurveLength, Ws->BoxesF, Ws->Nearest, Fused, Ws->DistF, MaxSum);
+    *DistBA = *DistAB > MaxSum ? 0 :
+              DistCurvePtsF(Ws->bF, Ws->aF, CurveLength, Ws->BoxesF, Fused ? Ws->NearestBA : Ws->Nearest, Fused,
+                            Ws->DistF, MaxSum - *DistAB);
+  }
+  else
+  {
+    if (Fused)
+    {
+      NearestNodesFused(Ws->a_, Ws->b_, CurveLength, Ws->Dist, Ws->NearestBA, Ws->NodeDist, Ws->Nearest);
+    }
+    *DistAB = DistCurvePts(Ws->a_, Ws->b_, CurveLength, Ws->Boxes, Ws->Nearest, Fused, Ws->Dist, MaxSum);
+    *DistBA = *DistAB > MaxSum ? 0 :
+              DistCurvePts(Ws->b_, Ws->a_, CurveLength, Ws->Boxes, Fused ? Ws->NearestBA : Ws->Nearest, Fused,
+                           Ws->Dist, MaxSum - *DistAB);
+  }
+  return *DistAB <= MaxSum && *DistBA <= MaxSum - *DistAB;
+}
+
+/**
+ * Evaluates the score of two splined curves.
+ * The evaluation stops as soon as the score proves to exceed Threshold.
+ *
+ * @param Ws scratch buffers with the curves in a_ and b_
+ * @param[in] CurveLength number of points in the curves
+ * @param[in] Precision precision of the distance stage
+ * @param[in] Threshold score threshold, 1 to evaluate the score completely
+ * @param[out] DistAB distance from the first curve to the second one
+ * @param[out] DistBA distance from the second curve to the first one
+ *
+ * @return exact score if it does not exceed Threshold, otherwise a lower bound of the score exceeding Threshold
+ */
+static double CurvesScore(workspace_t *Ws, uint32_t CurveLength, ivcmp_precision_t Precision, double Threshold,
+                          double *DistAB, double *DistBA)
+{
+  /* Score > Threshold if and only if DistAB + DistBA > MaxSum, see RescaleScore() */
+  const double MaxSum = Threshold < 1 ? -log(1 - Threshold) / 4 : HUGE_VAL;
+  IVC_STATS_TIMER(Timer);
+  const int Exact = CurvesDistance(Ws, CurveLength, Precision, MaxSum, DistAB, DistBA);
+  double Score = RescaleScore((*DistAB + *DistBA) / 2.);
+  if (!Exact && Score <= Threshold)
+  {
+    /* Lower bounds are rounded to the threshold, so the outcome is not decided yet */
+    CurvesDistance(Ws, CurveLength, Precision, HUGE_VAL, DistAB, DistBA);
+    Score = RescaleScore((*DistAB + *DistBA) / 2.);
+  }
+  IVC_STATS_STAGE(IVCMP_STAGE_DISTANCE, Timer);
+  if (!Exact && Score > Threshold)
+  {
+    IVC_STATS_ADD(ThresholdCutoffs, 1);
+  }
+  return Score;
+}
+
+/* ******************************* */
+/*    Public functions             */
+/* ******************************* */
+
+/**
+ * Creates comparison context with unset scaling thresholds
+ *
+ * @return new context or NULL if there is not enough memory
+ */
+ivcmp_context_t *CreateIVCContext(void)
+{
+  ivcmp_context_t *Ctx = (ivcmp_context_t *)IvcMalloc(sizeof(ivcmp_context_t));
+  if (Ctx)
+  {
+    memset(Ctx, 0, sizeof(ivcmp_context_t));
+  }
+  return Ctx;
+}
+
+
+/**
+ * Destroys comparison context created by CreateIVCContext()
+ *
+ * @param Ctx context to destroy, may be NULL
+ */
+void DestroyIVCContext(ivcmp_context_t *Ctx)
+{
+  if (Ctx == NULL || Ctx == &DefaultContext)
+  {
+    return;
+  }
+  if (Ctx->OwnWorkspace)
+  {
+    IvcFree(Ctx->Workspace);
+  }
+  IvcFree(Ctx);
+}
+
+
+/**
+ * Sets functions used by the library to allocate and release memory
+ *
+ * @param NewMallocFunc allocation function, NULL for malloc()
+ * @param NewFreeFunc release function, NULL for free()
+ */
+void SetIVCAllocator(ivcmp_malloc_t NewMallocFunc, ivcmp_free_t NewFreeFunc)
+{
+  MallocFunc = NewMallocFunc;
+  FreeFunc = NewFreeFunc;
+}
+
+
+/**
+ * Returns size of the workspace for comparison of curves with given maximal length
+ *
+ * @param[in] MaxCurveLength maximal number of points in the curves
+ *
+ * @return size in bytes
+ */
+size_t GetIVCWorkspaceSize(uint32_t MaxCurveLength)
+{
+  return LayoutWorkspace(NULL, MaxCurveLength, NULL);
+}
+
+
+/**
+ * Sets memory block given by user as workspace of the context.
+ * The context will never allocate memory for comparisons, and the block should live
+ * until the context is destroyed or another workspace is set.
+ *
+ * @param Ctx comparison context
+ * @param Buffer memory block, NULL to let the context allocate the workspace itself
+ * @param[in] BufferSize size of the memory block in bytes
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NULL_POINTER
+ */
+ivcmp_status_t SetContextWorkspace(ivcmp_context_t *Ctx, void *Buffer, size_t BufferSize)
+{
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Ctx->OwnWorkspace)
+  {
+    IvcFree(Ctx->Workspace);
+  }
+  Ctx->Workspace = Buffer;
+  Ctx->WorkspaceSize = Buffer ? BufferSize : 0;
+  Ctx->OwnWorkspace = 0;
+  memset(&Ctx->Cache, 0, sizeof(Ctx->Cache));
+  return IVCMP_OK;
+}
+
+
+/**
+ * Sets the function receiving the arrays of each stage of the comparisons made with the context.
+ * The function is called on the thread of the comparison, the arrays are valid during the call only.
+ *
+ * @param Ctx comparison context
+ * @param[in] Func capture function, NULL to disable capture
+ * @param User argument of the capture function
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NULL_POINTER
+ */
+ivcmp_status_t SetContextCapture(ivcmp_context_t *Ctx, ivcmp_capture_func_t Func, void *User)
+{
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  Ctx->Capture = Func;
+  Ctx->CaptureUser = User;
+  memset(&Ctx->CaptureBuffer, 0, sizeof(Ctx->CaptureBuffer));
+  return IVCMP_OK;
+}
+
+/**
+ * Makes the comparisons made with the context write the arrays of their stages to the buffer
+ *
+ * @param Ctx comparison context
+ * @param Buffer memory block for the dump of the last comparison, NULL to disable capture
+ * @param[in] BufferSize size of the memory block in bytes
+ *
+ * @return IVCMP_OK, IVCMP_ERROR_NULL_POINTER or IVCMP_ERROR_INVALID_ARGUMENT if the buffer can not hold the header
+ */
+ivcmp_status_t SetContextCaptureBuffer(ivcmp_context_t *Ctx, void *Buffer, size_t BufferSize)
+{
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Buffer && BufferSize < sizeof(capture_header_t))
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  SetContextCapture(Ctx, Buffer ? CaptureToBuffer : NULL, Buffer ? &Ctx->CaptureBuffer : NULL);
+  Ctx->CaptureBuffer.Data = (unsigned char *)Buffer;
+  Ctx->CaptureBuffer.Size = Buffer ? BufferSize : 0;
+  return IVCMP_OK;
+}
+
+/**
+ * Returns the size of the dump written to the buffer set by SetContextCaptureBuffer()
+ *
+ * @param[in] Ctx comparison context
+ *
+ * @return size in bytes, 0 if there was no comparison since the buffer was set
+ */
+size_t GetContextCaptureSize(const ivcmp_context_t *Ctx)
+{
+  return Ctx ? Ctx->CaptureBuffer.Used : 0;
+}
+
+
+/**
+ * Makes sure that the workspace of the context can hold curves of the given length,
+ * so comparisons of such curves will not allocate memory.
+ *
+ * @param Ctx comparison context
+ * @param[in] MaxCurveLength maximal number of points in the curves
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t ReserveContextWorkspace(ivcmp_context_t *Ctx, uint32_t MaxCurveLength)
+{
+  workspace_t Ws;
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  return ReserveWorkspace(Ctx, MaxCurveLength, &Ws);
+}
+
+
+/**
+ * Returns human readable description of the status code
+ *
+ * @param[in] Status status code returned by one of the library functions
+ *
+ * @return static string with description
+ */
+const char *GetIVCStatusMessage(ivcmp_status_t Status)
+{
+  switch (Status)
+  {
+  case IVCMP_OK:
+    return "No error";
+  case IVCMP_ERROR_NULL_POINTER:
+    return "Invalid currents or voltages pointers given!";
+  case IVCMP_ERROR_CURVE_TOO_SHORT:
+    return "The signature length is too small. There should be at least 2 points.";
+  case IVCMP_ERROR_INVALID_MIN_VAR:
+    return "Invalid normalization thresholds (MinVarVC). You should explicitly set them.";
+  case IVCMP_ERROR_IDENTICAL_POINTS:
+    return "All elements of curve identical. Algorithm doesn't match such curves!";
+  case IVCMP_ERROR_NO_MEMORY:
+    return "Not enough memory for comparison.";
+  case IVCMP_ERROR_WORKSPACE_TOO_SMALL:
+    return "Workspace is too small for the curves.";
+  case IVCMP_ERROR_UNSUPPORTED_KERNEL:
+    return "Kernel is not supported by the processor or the library build.";
+  case IVCMP_ERROR_INVALID_ARGUMENT:
+    return "Invalid argument value.";
+  case IVCMP_ERROR_FILE_IO:
+    return "File can not be opened, read or written.";
+  case IVCMP_ERROR_INVALID_FILE:
+    return "File format is not supported or the file is damaged.";
+  case IVCMP_ERROR_NOT_SUPPORTED:
+    return "Feature is disabled in the library build.";
+  default:
+    return "Unknown error";
+  }
+}
+
+
+/**
+ * Returns the kernel used by the distance stage of comparisons
+ *
+ * @return kernel
+ */
+ivcmp_kernel_t GetIVCKernel(void)
+{
+  return GetKernels()->Kernel;
+}
+
+/**
+ * Returns the kernel name
+ *
+ * @param[in] Kernel kernel
+ *
+ * @return static string with the name
+ */
+const char *GetIVCKernelName(ivcmp_kernel_t Kernel)
+{
+  switch (Kernel)
+  {
+  case IVCMP_KERNEL_SCALAR:
+    return "scalar";
+  case IVCMP_KERNEL_AVX2:
+    return "avx2";
+  case IVCMP_KERNEL_AVX512:
+    return "avx512";
+  default:
+    return "unknown";
+  }
+}
+
+/**
+ * Selects the kernel for the distance stage of all the following comparisons
+ *
+ * @param[in] Kernel kernel
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_UNSUPPORTED_KERNEL, in the last case the active kernel is not changed
+ */
+ivcmp_status_t SetIVCKernel(ivcmp_kernel_t Kernel)
+{
+  if ((uint32_t)Kernel >= sizeof(KernelTables) / sizeof(KernelTables[0]) || !IsKernelSupported(Kernel))
+  {
+    return IVCMP_ERROR_UNSUPPORTED_KERNEL;
+  }
+  STORE_KERNELS(SelectedKernels, &KernelTables[Kernel]);
+  return IVCMP_OK;
+}
+
+
+/**
+ * Gives the statistics summed over all the threads since the last ResetIVCStats() call
+ *
+ * @param[out] Stats statistics
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NOT_SUPPORTED if the library is built without IVCMP_STATS
+ */
+ivcmp_status_t GetIVCStats(ivcmp_stats_t *Stats)
+{
+  if (!Stats)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+#ifdef IVCMP_STATS
+  IvcCollectStats(Stats);
+  return IVCMP_OK;
+#else
+  memset(Stats, 0, sizeof(ivcmp_stats_t));
+  return IVCMP_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Makes the statistics of all the threads count from zero
+ */
+void ResetIVCStats(void)
+{
+#ifdef IVCMP_STATS
+  IvcResetStats();
+#endif
+}
+
+/**
+ * Enables or disables timing of the stages of the comparisons
+ *
+ * @param[in] Enable 1 to enable, 0 to disable
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NOT_SUPPORTED if the library is built without IVCMP_STATS
+ */
+ivcmp_status_t SetIVCStatsTimers(int Enable)
+{
+#ifdef IVCMP_STATS
+  IvcStatsTimers = Enable != 0;
+  return IVCMP_OK;
+#else
+  (void)Enable;
+  return IVCMP_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * Enables the cache of the scores and sets its capacity
+ *
+ * @param[in] Capacity largest number of scores in the cache, 0 to disable the cache
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NO_MEMORY, the cache is disabled then
+ */
+ivcmp_status_t SetIVCCacheCapacity(uint32_t Capacity)
+{
+  return IvcSetCacheCapacity(Capacity);
+}
+
+/**
+ * Gives the counters of the cache of the scores
+ *
+ * @param[out] Stats counters
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NULL_POINTER
+ */
+ivcmp_status_t GetIVCCacheStats(ivcmp_cache_stats_t *Stats)
+{
+  if (!Stats)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  IvcGetCacheStats(Stats);
+  return IVCMP_OK;
+}
+
+/**
+ * Drops the scores of the cache and its counters
+ */
+void ClearIVCCache(void)
+{
+  IvcClearCache();
+}
+
+
+/**
+ * Sets scaling threshold for voltages and currents of the context
+ *
+ * @param Ctx comparison context
+ * @param NewMinVarV new voltage noise
+ * @param NewMinVarC new current noise
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_INVALID_MIN_VAR if thresholds are not positive;
+ * in the last case comparisons in the context will fail until correct MinVar setup
+ */
+ivcmp_status_t SetContextMinVarVC(ivcmp_context_t *Ctx, double NewMinVarV, double NewMinVarC)
+{
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (NewMinVarV > 0 && NewMinVarC > 0)
+  {
+    Ctx->MinVarV = NewMinVarV;
+    Ctx->MinVarC = NewMinVarC;
+    return IVCMP_OK;
+  }
+  /*
+   * Error maximization. Compare will return error until correct MinVar setup.
+   */
+  Ctx->MinVarV = 0;
+  Ctx->MinVarC = 0;
+  return IVCMP_ERROR_INVALID_MIN_VAR;
+}
+
+
+/**
+ * Sets scaling threshold for voltages and currents of the context
+ * by noise evaluation for short circuit and open circuit curves.
+ *
+ * @param Ctx comparison context
+ * @param VoltagesOpenC Array of voltages for open circuit curve
+ * @param CurrentsOpenC Array of currents for open circuit curve
+ * @param CurveLengthOpenC Number of points in open circuit curve
+ * @param VoltagesShortC Array of voltages for short circuit curve
+ * @param CurrentsShortC Array of currents for short circuit curve
+ * @param CurveLengthShotC Number of points in short circuit curve
+ *
+ * @return status of SetContextMinVarVC() call
+ */
+ivcmp_status_t SetContextMinVarVCFromCurves(ivcmp_context_t *Ctx,
+                                            double *VoltagesOpenC, double *CurrentsOpenC, uint32_t CurveLengthOpenC,
+                                            double *VoltagesShortC, double *CurrentsShortC, uint32_t CurveLengthShotC)
+{
+  double NewMinVarV, NewMinVarC;
+  if (!CurrentsOpenC || !VoltagesShortC)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  EvalMinVarVC(CurrentsOpenC, CurveLengthOpenC, VoltagesShortC, CurveLengthShotC, &NewMinVarV, &NewMinVarC);
+
+  /* To avoid warnings for unused params, but save standard interface */
+  (void)(VoltagesOpenC);
+  (void)(CurrentsShortC);
+
+  return SetContextMinVarVC(Ctx, NewMinVarV, NewMinVarC);
+}
+
+
+/**
+ * Gets active scaling threshold for voltages and currents of the context
+ *
+ * @param Ctx comparison context
+ * @param NewMinVarVPtr - variable pointer to store voltage variation.
+ * @param NewMinVarCPtr - variable pointer to store current variation.
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NULL_POINTER
+ */
+ivcmp_status_t GetContextMinVarVC(const ivcmp_context_t *Ctx, double *NewMinVarVPtr, double *NewMinVarCPtr)
+{
+  if (!Ctx || !NewMinVarVPtr || !NewMinVarCPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *NewMinVarVPtr = Ctx->MinVarV;
+  *NewMinVarCPtr = Ctx->MinVarC;
+  return IVCMP_OK;
+}
+
+
+/**
+ * Sets scaling threshold for voltages and currents
+ * 
+ * @param NewMinVarV new voltage noise
+ * @param NewMinVarC new current noise
+ */
+void SetMinVarVC(double NewMinVarV, double NewMinVarC)
+{
+  if (SetContextMinVarVC(&DefaultContext, NewMinVarV, NewMinVarC) != IVCMP_OK)
+  {
+    printf("IVCMP ERROR: Incorrect MinVarV, MinVarC setup. Got %lf, %lf. Should be > 0.\n"
+           "CompareIVC() will not work until correct MinVar setup\n",
+           NewMinVarV, NewMinVarC);
+  }
+}
+
+
+/**
+ * Sets scaling threshold for voltages and currents
+ * by noise evaluation for short circuit and open circuit curves.
+ * 
+ * @param VoltagesOpenC Array of voltages for open circuit curve
+ * @param CurrentsOpenC Array of currents for open circuit curve
+ * @param CurveLengthOpenC Number of points in open circuit curve
+ * @param VoltagesShortC Array of voltages for short circuit curve
+ * @param CurrentsShortC Array of currents for short circuit curve
+ * @param CurveLengthShotC Number of points in short circuit curve
+ */
+void SetMinVarVCFromCurves(double *VoltagesOpenC, double *CurrentsOpenC, uint32_t CurveLengthOpenC,
+                           double *VoltagesShortC, double *CurrentsShortC, uint32_t CurveLengthShotC)
+{
+  double NewMinVarV, NewMinVarC;
+  EvalMinVarVC(CurrentsOpenC, CurveLengthOpenC, VoltagesShortC, CurveLengthShotC, &NewMinVarV, &NewMinVarC);
+
+  SetMinVarVC(NewMinVarV, NewMinVarC);
+
+  /* To avoid warnings for unused params, but save standard interface */
+  (void)(VoltagesOpenC);
+  (void)(CurrentsShortC);
+}
+
+
+/**
+ * Gets active scaling threshold for voltages and currents
+ *
+ * @param NewMinVarVPtr - variable pointer to store voltage variation.
+ * @param NewMinVarCPtr - variable pointer to store current variation.
+ */
+void GetMinVarVC(double *NewMinVarVPtr, double *NewMinVarCPtr)
+{
+  GetContextMinVarVC(&DefaultContext, NewMinVarVPtr, NewMinVarCPtr);
+}
+
+
+/**
+ * Sets precision of the distance stage of the context
+ *
+ * @param Ctx comparison context
+ * @param[in] Precision new precision
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_INVALID_ARGUMENT for unknown precision
+ */
+ivcmp_status_t SetContextPrecision(ivcmp_context_t *Ctx, ivcmp_precision_t Precision)
+{
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Precision != IVCMP_PRECISION_DOUBLE && Precision != IVCMP_PRECISION_FLOAT)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  Ctx->Precision = Precision;
+  return IVCMP_OK;
+}
+
+
+/**
+ * Gives precision of the distance stage of the context
+ *
+ * @param[in] Ctx comparison context
+ * @param[out] PrecisionPtr precision
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NULL_POINTER
+ */
+ivcmp_status_t GetContextPrecision(const ivcmp_context_t *Ctx, ivcmp_precision_t *PrecisionPtr)
+{
+  if (!Ctx || !PrecisionPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *PrecisionPtr = Ctx->Precision;
+  return IVCMP_OK;
+}
+
+
+/**
+ * Sets precision of the distance stage
+ *
+ * @param[in] Precision new precision
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_INVALID_ARGUMENT for unknown precision
+ */
+ivcmp_status_t SetIVCPrecision(ivcmp_precision_t Precision)
+{
+  return SetContextPrecision(&DefaultContext, Precision);
+}
+
+
+/**
+ * Returns precision of the distance stage
+ *
+ * @return precision
+ */
+ivcmp_precision_t GetIVCPrecision(void)
+{
+  return DefaultContext.Precision;
+}
+
+
+/**
+ * Sets the largest step along the B-splines of the compared curves
+ *
+ * @param Ctx comparison context
+ * @param[in] Step step in units of the scales, 0 to resample the curves to the number of points of the longer one
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_INVALID_ARGUMENT for negative or infinite step
+ */
+ivcmp_status_t SetContextResampling(ivcmp_context_t *Ctx, double Step)
+{
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (!(Step >= 0 && Step < HUGE_VAL))
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  Ctx->ResampleStep = Step;
+  return IVCMP_OK;
+}
+
+
+/**
+ * Gives the largest step along the B-splines of the context
+ *
+ * @param[in] Ctx comparison context
+ * @param[out] StepPtr step, 0 if the curves are resampled to the number of points of the longer one
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NULL_POINTER
+ */
+ivcmp_status_t GetContextResampling(const ivcmp_context_t *Ctx, double *StepPtr)
+{
+  if (!Ctx || !StepPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *StepPtr = Ctx->ResampleStep;
+  return IVCMP_OK;
+}
+
+
+/**
+ * Sets the largest step along the B-splines of the compared curves
+ *
+ * @param[in] Step step in units of the scales, 0 to resample the curves to the number of points of the longer one
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_INVALID_ARGUMENT for negative or infinite step
+ */
+ivcmp_status_t SetIVCResampling(double Step)
+{
+  return SetContextResampling(&DefaultContext, Step);
+}
+
+
+/**
+ * Returns the largest step along the B-splines
+ *
+ * @return step, 0 if the curves are resampled to the number of points of the longer one
+ */
+double GetIVCResampling(void)
+{
+  return DefaultContext.ResampleStep;
+}
+
+
+/**
+ * Makes the key of the pair of curves in the cache of the scores
+ *
+ * @param[in] Ctx comparison context
+ * @param[in] VoltagesA voltages of the first curve
+ * @param[in] CurrentsA currents of the first curve
+ * @param[in] CurveLengthA number of points in the curves
+ * @param[in] VoltagesB voltages of the second curve, may be NULL
+ * @param[in] CurrentsB currents of the second curve
+ * @param[in] CurveLengthB number of points in the curves
+ * @param[out] Key key
+ */
+static void MakeCacheKey(const ivcmp_context_t *Ctx,
+                         const double *VoltagesA, const double *CurrentsA, uint32_t CurveLengthA,
+                         const double *VoltagesB, const double *CurrentsB, uint32_t CurveLengthB,
+                         ivc_cache_key_t *Key)
+{
+  Key->HashA = IvcHashCurve(VoltagesA, CurrentsA, CurveLengthA);
+  Key->HashB = VoltagesB ? IvcHashCurve(VoltagesB, CurrentsB, CurveLengthB) : 0;
+  Key->LengthA = CurveLengthA;
+  Key->LengthB = CurveLengthB;
+  Key->MinVarV = Ctx->MinVarV;
+  Key->MinVarC = Ctx->MinVarC;
+  Key->ResampleStep = Ctx->ResampleStep;
+  Key->Precision = (uint32_t)Ctx->Precision;
+}
+
+/**
+ * Compares two curves using settings and scratch buffers of the context.
+ * Evaluation of the distances stops as soon as the score proves to exceed Threshold.
+ * Exact scores of the repeated pairs are taken from the cache, see SetIVCCacheCapacity().
+ *
+ * @param Ctx comparison context
+ * @param[in] VoltagesA voltages of the first curve
+ * @param[in] CurrentsA currents of the first curve
+ * @param[in] CurveLengthA number of points in the curves
+ * @param[in] VoltagesB voltages of the second curve
+ * @param[in] CurrentsB currents of the second curve
+ * @param[in] CurveLengthB number of points in the curves
+ * @param[in] Threshold score threshold, 1 to evaluate the score completely
+ * @param[out] ScorePtr score of difference between the curves or its lower bound exceeding Threshold;
+ * 1.0 for completely different curves, 0.0 for same curves. SCORE_ERROR if comparison failed.
+ *
+ * @return IVCMP_OK or error code
+ */
+static ivcmp_status_t CompareCurves(ivcmp_context_t *Ctx,
+                                    double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
+                                    double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB,
+                                    double Threshold, double *ScorePtr)
+{
+  uint32_t i;
+  double VarV, VarC;
+  double Score;
+  ivcmp_status_t Status;
+  workspace_t Ws;
+
+  if (!Ctx || !ScorePtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *ScorePtr = SCORE_ERROR;
+
+  /* Check parameters */
+  if (CurveLengthA <= MIN_LEN_CURVE || CurveLengthB <= MIN_LEN_CURVE)
+  {
+    IVC_STATS_ADD(ShortCurves, 1);
+    return IVCMP_ERROR_CURVE_TOO_SHORT;
+  }
+
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    /*
+     * Min variance should be at least several times larger than noise dispersion.
+     * Optimal value - possible curve size.
+     */
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+
+  if (!VoltagesA || !CurrentsA || (VoltagesB && !CurrentsB))
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+
+  /* Capture needs all the stages, so the cache is not used then */
+  ivc_cache_key_t CacheKey;
+  const int UseCache = IvcCacheCapacity && !Ctx->Capture;
+  if (UseCache)
+  {
+    MakeCacheKey(Ctx, VoltagesA, CurrentsA, CurveLengthA, VoltagesB, CurrentsB, CurveLengthB, &CacheKey);
+    if (IvcCacheLookup(&CacheKey, &Score))
+    {
+      IVC_STATS_ADD(Comparisons, 1);
+      *ScorePtr = Score;
+      return IVCMP_OK;
+    }
+  }
+
+  if (Ctx->Capture)
+  {
+    CaptureCurve(Ctx, IVCMP_CAPTURE_INPUT, 0, VoltagesA, CurrentsA, CurveLengthA);
+    if (VoltagesB)
+    {
+      CaptureCurve(Ctx, IVCMP_CAPTURE_INPUT, 1, VoltagesB, CurrentsB, CurveLengthB);
+    }
+  }
+
+  const uint32_t CurveLength = max(CurveLengthA, CurveLengthB);
+  Status = ReserveWorkspace(Ctx, CurveLength, &Ws);
+  if (Status != IVCMP_OK)
+  {
+    return Status;
+  }
+  double **a_ = Ws.a_;
+  double **b_ = Ws.b_;
+
+  IVC_STATS_TIMER(NormalizeTimer);
+  for (i = 0; i < CurveLengthA; i++)
+  {
+    a_[0][i] = VoltagesA[i];
+    a_[1][i] = CurrentsA[i];
+  }
+
+  if (VoltagesB)
+  {
+    for (i = 0; i < CurveLengthB; i++)
+    {
+      b_[0][i] = VoltagesB[i];
+      b_[1][i] = CurrentsB[i];
+    }
+  }
+
+  if (Ctx->Capture)
+  {
+    CaptureCurve(Ctx, IVCMP_CAPTURE_COPIED, 0, a_[0], a_[1], CurveLengthA);
+    if (VoltagesB)
+    {
+      CaptureCurve(Ctx, IVCMP_CAPTURE_COPIED, 1, b_[0], b_[1], CurveLengthB);
+    }
+  }
+
+  double _v = max(sqrt(Disp(a_[0], CurveLengthA)), sqrt(Disp(b_[0], CurveLengthB)));
+  double _c = max(sqrt(Disp(a_[1], CurveLengthA)), sqrt(Disp(b_[1], CurveLengthB)));
+  VarV = max(_v, Ctx->MinVarV);
+  VarC = max(_c, Ctx->MinVarC);
+  CountClamping(Ctx, _v, _c);
+
+  if (Ctx->Capture)
+  {
+    const double Variations[2] = {VarV, VarC};
+    CaptureValues(Ctx, IVCMP_CAPTURE_VARIATIONS, Variations, 2);
+  }
+
+  ScaleCurve(a_, CurveLengthA, VarV, VarC);
+  IVC_STATS_STAGE(IVCMP_STAGE_NORMALIZE, NormalizeTimer);
+
+  if (Ctx->Capture)
+  {
+    CaptureCurve(Ctx, IVCMP_CAPTURE_SCALED, 0, a_[0], a_[1], CurveLengthA);
+  }
+
+  uint32_t SizeA = RemoveRepeatsIvc(a_, CurveLengthA);
+  CountRepeats(CurveLengthA, SizeA);
+
+  if (Ctx->Capture)
+  {
+    CaptureCurve(Ctx, IVCMP_CAPTURE_REPEATS_REMOVED, 0, a_[0], a_[1], SizeA);
+  }
+
+  if (SizeA < MIN_LEN_CURVE)
+  {
+    IVC_STATS_ADD(IdenticalCurves, 1);
+    return IVCMP_ERROR_IDENTICAL_POINTS;
+  }
+
+  if (!VoltagesB)
+  {
+    SplineCurve(a_, SizeA, CurveLength, &Ws);
+
+    if (Ctx->Capture)
+    {
+      CaptureCurve(Ctx, IVCMP_CAPTURE_SPLINED, 0, a_[0], a_[1], CurveLength);
+    }
+
+    double x = Mean(a_[1], CurveLengthB);
+    Score = RescaleScore(x * x);
+  }
+  else
+  {
+    IVC_STATS_TIMER(ScaleTimer);
+    ScaleCurve(b_, CurveLengthB, VarV, VarC);
+    IVC_STATS_STAGE(IVCMP_STAGE_NORMALIZE, ScaleTimer);
+
+    if (Ctx->Capture)
+    {
+      CaptureCurve(Ctx, IVCMP_CAPTURE_SCALED, 1, b_[0], b_[1], CurveLengthB);
+    }
+
+    uint32_t SizeB = RemoveRepeatsIvc(b_, CurveLengthB);
+    CountRepeats(CurveLengthB, SizeB);
+
+    if (Ctx->Capture)
+    {
+      CaptureCurve(Ctx, IVCMP_CAPTURE_REPEATS_REMOVED, 1, b_[0], b_[1], SizeB);
+    }
+
+    if (SizeB < MIN_LEN_CURVE)
+    {
+      IVC_STATS_ADD(IdenticalCurves, 1);
+      return IVCMP_ERROR_IDENTICAL_POINTS;
+    }
+
+    /* Both defining polygons are known here, so both curves get the same resolution */
+    const uint32_t SplineLength = ResampledLength(a_, SizeA, b_, SizeB, Ctx->ResampleStep, CurveLength);
+    SplineCurve(a_, SizeA, SplineLength, &Ws);
+    SplineCurve(b_, SizeB, SplineLength, &Ws);
+
+    if (Ctx->Capture)
+    {
+      CaptureCurve(Ctx, IVCMP_CAPTURE_SPLINED, 0, a_[0], a_[1], SplineLength);
+      CaptureCurve(Ctx, IVCMP_CAPTURE_SPLINED, 1, b_[0], b_[1], SplineLength);
+    }
+
+    double DistAB, DistBA;
+    Score = CurvesScore(&Ws, SplineLength, Ctx->Precision, Threshold, &DistAB, &DistBA);
+
+    if (Ctx->Capture)
+    {
+      const double Distances[3] = {DistAB, DistBA, Score};
+      CaptureValues(Ctx, IVCMP_CAPTURE_SCORE, Distances, 3);
+    }
+  }
+  /* Above Threshold the score may be only its lower bound */
+  if (UseCache && Score <= Threshold)
+  {
+    IvcCacheStore(&CacheKey, Score);
+  }
+  IVC_STATS_ADD(Comparisons, 1);
+  *ScorePtr = Score;
+  return IVCMP_OK;
+}
+
+
+/**
+ * Compares two curves using settings and scratch buffers of the context
+ * 
+ * @param Ctx comparison context
+ * @param[in] VoltagesA voltages of the first curve
+ * @param[in] CurrentsA currents of the first curve
+ * @param[in] CurveLengthA number of points in the curves
+ * @param[in] VoltagesB voltages of the second curve
+ * @param[in] CurrentsB currents of the second curve
+ * @param[in] CurveLengthB number of points in the curves
+ * @param[out] ScorePtr score of difference between the curves;
+ * 1.0 for completely different curves, 0.0 for same curves. SCORE_ERROR if comparison failed.
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t CompareIVCWithContext(ivcmp_context_t *Ctx,
+                                     double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
+                                     double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB,
+                                     double *ScorePtr)
+{
+  return CompareCurves(Ctx, VoltagesA, CurrentsA, CurveLengthA, VoltagesB, CurrentsB, CurveLengthB, 1., ScorePtr);
+}
+
+
+/**
+ * Checks whether the score of two curves exceeds the threshold.
+ * Evaluation of the distances stops as soon as the outcome is decided.
+ *
+ * @param Ctx comparison context
+ * @param[in] VoltagesA voltages of the first curve
+ * @param[in] CurrentsA currents of the first curve
+ * @param[in] CurveLengthA number of points in the curves
+ * @param[in] VoltagesB voltages of the second curve
+ * @param[in] CurrentsB currents of the second curve
+ * @param[in] CurveLengthB number of points in the curves
+ * @param[in] Threshold score threshold from 0 to 1
+ * @param[out] VerdictPtr IVCMP_VERDICT_FAIL if the score exceeds Threshold, IVCMP_VERDICT_PASS otherwise
+ * @param[out] ScorePtr exact score for passed curves, lower bound of the score for failed ones; may be NULL
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t CompareIVCThreshold(ivcmp_context_t *Ctx,
+                                   double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
+                                   double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB,
+                                   double Threshold, ivcmp_verdict_t *VerdictPtr, double *ScorePtr)
+{
+  double Score = SCORE_ERROR;
+  ivcmp_status_t Status;
+
+  if (!VerdictPtr || !VoltagesB || !CurrentsB)
+  {
+    Status = IVCMP_ERROR_NULL_POINTER;
+  }
+  else if (!(Threshold >= 0 && Threshold <= 1))
+  {
+    Status = IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  else
+  {
+    Status = CompareCurves(Ctx, VoltagesA, CurrentsA, CurveLengthA, VoltagesB, CurrentsB, CurveLengthB,
+                           Threshold, &Score);
+  }
+  if (VerdictPtr)
+  {
+    /* Curves that can not be compared do not pass */
+    *VerdictPtr = (Status != IVCMP_OK || Score > Threshold) ? IVCMP_VERDICT_FAIL : IVCMP_VERDICT_PASS;
+  }
+  if (ScorePtr)
+  {
+    *ScorePtr = Score;
+  }
+  return Status;
+}
+
+
+/**
+ * Compares two curves
+ * 
+ * @param[in] VoltagesA voltages of the first curve
+ * @param[in] CurrentsA currents of the first curve
+ * @param[in] CurveLengthA number of points in the curves
+ * @param[in] VoltagesB voltages of the second curve
+ * @param[in] CurrentsB currents of the second curve
+ * @param[in] CurveLengthB number of points in the curves
+ * 
+ * @return score of difference between the curves; 1.0 for completely different curves, 0.0 for same curves
+ */
+double CompareIVC(double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
+                  double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB)
+{
+  double Score;
+  ivcmp_status_t Status = CompareIVCWithContext(&DefaultContext,
+                                                VoltagesA, CurrentsA, CurveLengthA,
+                                                VoltagesB, CurrentsB, CurveLengthB,
+                                                &Score);
+  if (Status != IVCMP_OK)
+  {
+    printf("IVCMP ERROR: %s\n", GetIVCStatusMessage(Status));
+    return SCORE_ERROR;
+  }
+  return Score;
+}
+
+
+/**
+ * Allocates the prepared curve with the arrays for the given number of points
+ *
+ * @param[in] MaxLength largest number of points in the curve
+ *
+ * @return prepared curve to be filled with FillPrepared() or NULL
+ */
+static ivcmp_prepared_t *AllocPrepared(uint32_t MaxLength)
+{
+  ivcmp_prepared_t *Prepared = (ivcmp_prepared_t *)IvcMalloc(sizeof(ivcmp_prepared_t) +
+                                                             4 * (size_t)MaxLength * sizeof(double) + MaxLength);
+  if (!Prepared)
+  {
+    return NULL;
+  }
+  /* Padding is cleared too, so stored prepared curves do not depend on the memory contents */
+  memset(Prepared, 0, sizeof(ivcmp_prepared_t));
+  Prepared->Capacity = MaxLength;
+  return Prepared;
+}
+
+/**
+ * Prepares the curve for repeated comparisons with the given scaling thresholds
+ *
+ * @param Ctx comparison context
+ * @param Prepared curve allocated by AllocPrepared() for at least CurveLength points
+ * @param[in] Voltages voltages of the curve
+ * @param[in] Currents currents of the curve
+ * @param[in] CurveLength number of points in the curve, more than MIN_LEN_CURVE
+ * @param[in] MinVarV voltage scaling threshold used for repeats removal
+ * @param[in] MinVarC current scaling threshold used for repeats removal
+ *
+ * @return IVCMP_OK or error code
+ */
+static ivcmp_status_t FillPrepared(ivcmp_context_t *Ctx, ivcmp_prepared_t *Prepared,
+                                   const double *Voltages, const double *Currents, uint32_t CurveLength,
+                                   double MinVarV, double MinVarC)
+{
+  uint32_t i;
+  uint32_t n;
+  double VarV, VarC;
+  ivcmp_status_t Status;
+  workspace_t Ws;
+
+  Status = ReserveWorkspace(Ctx, CurveLength, &Ws);
+  if (Status != IVCMP_OK)
+  {
+    return Status;
+  }
+
+  IVC_STATS_TIMER(NormalizeTimer);
+  Prepared->CurveLength = CurveLength;
+  memcpy(PREPARED_VOLTAGES(Prepared), Voltages, CurveLength * sizeof(double));
+  memcpy(PREPARED_CURRENTS(Prepared), Currents, CurveLength * sizeof(double));
+  Prepared->SigmaV = sqrt(Disp(PREPARED_VOLTAGES(Prepared), CurveLength));
+  Prepared->SigmaC = sqrt(Disp(PREPARED_CURRENTS(Prepared), CurveLength));
+
+  /* Pairwise scales are never less than the own ones, so usually the same points are left */
+  VarV = max(Prepared->SigmaV, MinVarV);
+  VarC = max(Prepared->SigmaC, MinVarC);
+  Prepared->OwnVarV = VarV;
+  Prepared->OwnVarC = VarC;
+  IVC_STATS_STAGE(IVCMP_STAGE_NORMALIZE, NormalizeTimer);
+  IVC_STATS_TIMER(RepeatsTimer);
+  Prepared->Size = MarkRepeatsIvc(Voltages, Currents, CurveLength, VarV, VarC, PREPARED_KEPT(Prepared));
+  IVC_STATS_STAGE(IVCMP_STAGE_REMOVE_REPEATS, RepeatsTimer);
+  CountRepeats(CurveLength, Prepared->Size);
+  if (Prepared->Size < MIN_LEN_CURVE)
+  {
+    IVC_STATS_ADD(IdenticalCurves, 1);
+    return IVCMP_ERROR_IDENTICAL_POINTS;
+  }
+
+  double **a_ = Ws.a_;
+  for (i = 0, n = 0; i < CurveLength; i++)
+  {
+    if (PREPARED_KEPT(Prepared)[i])
+    {
+      a_[0][n] = Voltages[i];
+      a_[1][n++] = Currents[i];
+    }
+  }
+  SplineCurve(a_, Prepared->Size, CurveLength, &Ws);
+  memcpy(PREPARED_SPLINED_V(Prepared), a_[0], CurveLength * sizeof(double));
+  memcpy(PREPARED_SPLINED_C(Prepared), a_[1], CurveLength * sizeof(double));
+  DescribeCurve(Prepared);
+  IVC_STATS_ADD(PreparedCurves, 1);
+  return IVCMP_OK;
+}
+
+/**
+ * Prepares the curve for repeated comparisons with the given scaling thresholds
+ *
+ * @param Ctx comparison context
+ * @param[in] Voltages voltages of the curve
+ * @param[in] Currents currents of the curve
+ * @param[in] CurveLength number of points in the curve
+ * @param[in] MinVarV voltage scaling threshold used for repeats removal
+ * @param[in] MinVarC current scaling threshold used for repeats removal
+ * @param[out] PreparedPtr prepared curve, should be destroyed with DestroyPreparedIVC()
+ *
+ * @return IVCMP_OK or error code
+ */
+static ivcmp_status_t PrepareCurve(ivcmp_context_t *Ctx, const double *Voltages, const double *Currents,
+                                   uint32_t CurveLength, double MinVarV, double MinVarC,
+                                   ivcmp_prepared_t **PreparedPtr)
+{
+  ivcmp_prepared_t *Prepared;
+  ivcmp_status_t Status;
+
+  if (!Ctx || !PreparedPtr || !Voltages || !Currents)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *PreparedPtr = NULL;
+  if (CurveLength <= MIN_LEN_CURVE)
+  {
+    IVC_STATS_ADD(ShortCurves, 1);
+    return IVCMP_ERROR_CURVE_TOO_SHORT;
+  }
+  if (MinVarC <= 0 || MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+
+  Prepared = AllocPrepared(CurveLength);
+  if (!Prepared)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  Status = FillPrepared(Ctx, Prepared, Voltages, Currents, CurveLength, MinVarV, MinVarC);
+  if (Status != IVCMP_OK)
+  {
+    IvcFree(Prepared);
+    return Status;
+  }
+  *PreparedPtr = Prepared;
+  return IVCMP_OK;
+}
+
+
+/**
+ * Prepares the curve for repeated comparisons: copies it, evaluates dispersions,
+ * removes repeats and resamples with B-spline once.
+ *
+ * @param Ctx comparison context, its scaling thresholds are used for repeats removal
+ * @param[in] Voltages voltages of the curve
+ * @param[in] Currents currents of the curve
+ * @param[in] CurveLength number of points in the curve
+ * @param[out] PreparedPtr prepared curve, should be destroyed with DestroyPreparedIVC()
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t PrepareIVC(ivcmp_context_t *Ctx, double *Voltages, double *Currents, uint32_t CurveLength,
+                          ivcmp_prepared_t **PreparedPtr)
+{
+  if (!Ctx)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  return PrepareCurve(Ctx, Voltages, Currents, CurveLength, Ctx->MinVarV, Ctx->MinVarC, PreparedPtr);
+}
+
+
+/**
+ * Destroys curve prepared by PrepareIVC()
+ *
+ * @param Prepared prepared curve, may be NULL
+ */
+void DestroyPreparedIVC(ivcmp_prepared_t *Prepared)
+{
+  IvcFree(Prepared);
+}
+
+
+/**
+ * Compares two prepared curves.
+ * Evaluation of the distances stops as soon as the score proves to exceed Threshold.
+ *
+ * @param Ctx comparison context
+ * @param[in] PreparedA first curve
+ * @param[in] PreparedB second curve
+ * @param[in] Threshold score threshold, 1 to evaluate the score completely
+ * @param[out] ScorePtr score of difference between the curves or its lower bound exceeding Threshold;
+ * SCORE_ERROR if comparison failed.
+ *
+ * @return IVCMP_OK or error code
+ */
+static ivcmp_status_t ComparePrepared(ivcmp_context_t *Ctx, const ivcmp_prepared_t *PreparedA,
+                                      const ivcmp_prepared_t *PreparedB, double Threshold, double *ScorePtr)
+{
+  double VarV, VarC;
+  ivcmp_status_t Status;
+  workspace_t Ws;
+
+  if (!Ctx || !PreparedA || !PreparedB || !ScorePtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *ScorePtr = SCORE_ERROR;
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+
+  const uint32_t CurveLength = max(PreparedA->CurveLength, PreparedB->CurveLength);
+  Status = ReserveWorkspace(Ctx, CurveLength, &Ws);
+  if (Status != IVCMP_OK)
+  {
+    return Status;
+  }
+  double **a_ = Ws.a_;
+  double **b_ = Ws.b_;
+
+  VarV = max(max(PreparedA->SigmaV, PreparedB->SigmaV), Ctx->MinVarV);
+  VarC = max(max(PreparedA->SigmaC, PreparedB->SigmaC), Ctx->MinVarC);
+  CountClamping(Ctx, max(PreparedA->SigmaV, PreparedB->SigmaV), max(PreparedA->SigmaC, PreparedB->SigmaC));
+
+  Status = GetScaledSpline(PreparedA, VarV, VarC, CurveLength, a_, &Ws);
+  if (Status == IVCMP_OK)
+  {
+    Status = GetScaledSpline(PreparedB, VarV, VarC, CurveLength, b_, &Ws);
+  }
+  if (Status != IVCMP_OK)
+  {
+    return Status;
+  }
+
+  double DistAB, DistBA;
+  *ScorePtr = CurvesScore(&Ws, CurveLength, Ctx->Precision, Threshold, &DistAB, &DistBA);
+  IVC_STATS_ADD(Comparisons, 1);
+  return IVCMP_OK;
+}
+
+
+/**
+ * Compares two prepared curves. Gives the same score as CompareIVC() for the original curves.
+ *
+ * @param Ctx comparison context
+ * @param[in] PreparedA first curve
+ * @param[in] PreparedB second curve
+ * @param[out] ScorePtr score of difference between the curves; SCORE_ERROR if comparison failed.
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t CompareIVCPrepared(ivcmp_context_t *Ctx, const ivcmp_prepared_t *PreparedA,
+                                  const ivcmp_prepared_t *PreparedB, double *ScorePtr)
+{
+  return ComparePrepared(Ctx, PreparedA, PreparedB, 1., ScorePtr);
+}
+
+
+/**
+ * Evaluates the lower bound of the score of two prepared curves from their descriptors
+ *
+ * @param Ctx comparison context
+ * @param[in] PreparedA first curve
+ * @param[in] PreparedB second curve
+ * @param[out] BoundPtr lower bound of the score given by CompareIVCPrepared()
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t GetIVCScoreLowerBound(ivcmp_context_t *Ctx, const ivcmp_prepared_t *PreparedA,
+                                     const ivcmp_prepared_t *PreparedB, double *BoundPtr)
+{
+  if (!Ctx || !PreparedA || !PreparedB || !BoundPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *BoundPtr = 0;
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+  *BoundPtr = DescriptorsBound(Ctx, PreparedA, PreparedB);
+  return IVCMP_OK;
+}
+
+
+/**
+ * Candidate of FindIVCBestMatch()
+ */
+typedef struct
+{
+  double Bound;   /**< Lower bound of the score */
+  uint32_t Index; /**< Number of the candidate */
+} match_candidate_t;
+
+/**
+ * Orders candidates by the lower bound of the score, then by the number
+ */
+static int CompareCandidates(const void *a, const void *b)
+{
+  const match_candidate_t *ca = (const match_candidate_t *)a;
+  const match_candidate_t *cb = (const match_candidate_t *)b;
+  if (ca->Bound != cb->Bound)
+  {
+    return ca->Bound < cb->Bound ? -1 : 1;
+  }
+  return ca->Index < cb->Index ? -1 : (ca->Index > cb->Index);
+}
+
+/**
+ * Finds the candidate with the least score. Candidates are compared in the order of
+ * the lower bounds of their scores, the ones with the bound exceeding the best score are skipped
+ * and the comparisons stop as soon as the score proves to exceed the best one.
+ *
+ * @param Ctx comparison context
+ * @param[in] Prepared curve to match
+ * @param[in] Candidates candidate curves
+ * @param[in] NumCandidates number of candidates
+ * @param[out] IndexPtr number of the first candidate with the least score
+ * @param[out] ScorePtr the least score, may be NULL
+ *
+ * @return IVCMP_OK or the first error code if no candidate can be compared
+ */
+ivcmp_status_t FindIVCBestMatch(ivcmp_context_t *Ctx, const ivcmp_prepared_t *Prepared,
+                                const ivcmp_prepared_t *const *Candidates, uint32_t NumCandidates,
+                                uint32_t *IndexPtr, double *ScorePtr)
+{
+  uint32_t i;
+  double Score;
+  double BestScore = HUGE_VAL;
+  uint32_t BestIndex = UINT32_MAX;
+  ivcmp_status_t Status = IVCMP_OK;
+  ivcmp_status_t FirstError = IVCMP_OK;
+  match_candidate_t *Order;
+
+  if (!Ctx || !Prepared || !Candidates || !IndexPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *IndexPtr = UINT32_MAX;
+  if (ScorePtr)
+  {
+    *ScorePtr = SCORE_ERROR;
+  }
+  if (NumCandidates == 0)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+  for (i = 0; i < NumCandidates; i++)
+  {
+    if (!Candidates[i])
+    {
+      return IVCMP_ERROR_NULL_POINTER;
+    }
+  }
+  Order = (match_candidate_t *)IvcMalloc(NumCandidates * sizeof(match_candidate_t));
+  if (!Order)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  for (i = 0; i < NumCandidates; i++)
+  {
+    Order[i].Bound = DescriptorsBound(Ctx, Prepared, Candidates[i]);
+    Order[i].Index = i;
+  }
+  qsort(Order, NumCandidates, sizeof(match_candidate_t), CompareCandidates);
+
+  for (i = 0; i < NumCandidates && Order[i].Bound <= BestScore; i++)
+  {
+    /* Exact score is needed only if it does not exceed the best one */
+    Status = ComparePrepared(Ctx, Prepared, Candidates[Order[i].Index], min(BestScore, 1.), &Score);
+    if (Status != IVCMP_OK)
+    {
+      FirstError = FirstError != IVCMP_OK ? FirstError : Status;
+      continue;
+    }
+    if (Score < BestScore || (Score == BestScore && Order[i].Index < BestIndex))
+    {
+      BestScore = Score;
+      BestIndex = Order[i].Index;
+    }
+  }
+  IvcFree(Order);
+
+  if (BestIndex == UINT32_MAX)
+  {
+    return FirstError;
+  }
+  *IndexPtr = BestIndex;
+  if (ScorePtr)
+  {
+    *ScorePtr = BestScore;
+  }
+  return IVCMP_OK;
+}
+
+
+/**
+ * Creates the context of a worker with the settings of the given context and own scratch buffers
+ *
+ * @param[in] Ctx context of the caller
+ *
+ * @return context or NULL if there is not enough memory
+ */
+static ivcmp_context_t *CreateWorkerContext(const ivcmp_context_t *Ctx)
+{
+  ivcmp_context_t *WorkerCtx = CreateIVCContext();
+  if (WorkerCtx)
+  {
+    WorkerCtx->MinVarV = Ctx->MinVarV;
+    WorkerCtx->MinVarC = Ctx->MinVarC;
+    WorkerCtx->Precision = Ctx->Precision;
+    WorkerCtx->ResampleStep = Ctx->ResampleStep;
+  }
+  return WorkerCtx;
+}
+
+/**
+ * State of CompareIVCMatrix() shared by the workers
+ */
+typedef struct
+{
+  ivcmp_context_t **Contexts;   /**< Context of each worker */
+  double **Voltages;            /**< Voltages of the curves */
+  double **Currents;            /**< Currents of the curves */
+  const uint32_t *CurveLengths; /**< Number of points in the curves */
+  uint32_t NumCurves;           /**< Number of curves */
+  uint32_t NumTiles;            /**< Number of blocks in a side of the matrix */
+  ivcmp_matrix_layout_t Layout; /**< Layout of the scores */
+  double *Scores;               /**< Scores */
+  ivcmp_prepared_t **Prepared;  /**< Prepared curves, NULL if preparation failed */
+  ivcmp_status_t *CurveStatus;  /**< Status of the preparation of each curve */
+  ivcmp_status_t *TileStatus;   /**< Status of the first failed comparison in each block */
+} matrix_job_t;
+
+/**
+ * Prepares one curve of the matrix
+ *
+ * @param Arg matrix job
+ * @param[in] Task number of the curve
+ * @param[in] Worker number of the worker
+ */
+static void PrepareMatrixCurve(void *Arg, uint32_t Task, uint32_t Worker)
+{
+  matrix_job_t *Job = (matrix_job_t *)Arg;
+  Job->CurveStatus[Task] = PrepareIVC(Job->Contexts[Worker], Job->Voltages[Task], Job->Currents[Task],
+                                      Job->CurveLengths[Task], &Job->Prepared[Task]);
+}
+
+/**
+ * Stores the score of the pair of curves
+ *
+ * @param Job matrix job
+ * @param[in] i number of the first curve
+ * @param[in] j number of the second curve, j > i
+ * @param[in] Score score
+ */
+static void SetMatrixScore(const matrix_job_t *Job, uint32_t i, uint32_t j, double Score)
+{
+  const size_t K = Job->NumCurves;
+  if (Job->Layout == IVCMP_MATRIX_PACKED)
+  {
+    Job->Scores[i * (2 * K - i - 1) / 2 + (j - i - 1)] = Score;
+  }
+  else
+  {
+    Job->Scores[i * K + j] = Score;
+    Job->Scores[j * K + i] = Score;
+  }
+}
+
+/**
+ * Compares the pairs of curves of one block of the upper triangle of the matrix.
+ * Blocks are numbered by rows.
+ *
+ * @param Arg matrix job
+ * @param[in] Task number of the block
+ * @param[in] Worker number of the worker
+ */
+static void CompareMatrixTile(void *Arg, uint32_t Task, uint32_t Worker)
+{
+  matrix_job_t *Job = (matrix_job_t *)Arg;
+  uint32_t TileI = 0;
+  uint32_t TileJ = Task;
+  uint32_t i, j, iEnd, jEnd;
+  double Score;
+  ivcmp_status_t Status;
+
+  while (TileJ >= Job->NumTiles - TileI)
+  {
+    TileJ -= Job->NumTiles - TileI;
+    TileI++;
+  }
+  TileJ += TileI;
+  iEnd = min((TileI + 1) * MATRIX_TILE, Job->NumCurves);
+  jEnd = min((TileJ + 1) * MATRIX_TILE, Job->NumCurves);
+  Job->TileStatus[Task] = IVCMP_OK;
+  for (i = TileI * MATRIX_TILE; i < iEnd; i++)
+  {
+    for (j = max(TileJ * MATRIX_TILE, i + 1); j < jEnd; j++)
+    {
+      if (!Job->Prepared[i] || !Job->Prepared[j])
+      {
+        Status = Job->Prepared[i] ? Job->CurveStatus[j] : Job->CurveStatus[i];
+        Score = SCORE_ERROR;
+      }
+      else
+      {
+        Status = CompareIVCPrepared(Job->Contexts[Worker], Job->Prepared[i], Job->Prepared[j], &Score);
+      }
+      if (Status != IVCMP_OK && Job->TileStatus[Task] == IVCMP_OK)
+      {
+        Job->TileStatus[Task] = Status;
+      }
+      SetMatrixScore(Job, i, j, Score);
+    }
+  }
+}
+
+/**
+ * Compares each curve with each other one.
+ * Curves are prepared once, then blocks of pairs are compared by the workers.
+ *
+ * @param Ctx comparison context, its settings are used by all the workers
+ * @param[in] Voltages voltages of the curves
+ * @param[in] Currents currents of the curves
+ * @param[in] CurveLengths number of points in the curves
+ * @param[in] NumCurves number of curves
+ * @param[in] Layout layout of the scores
+ * @param[in] NumThreads number of threads, 0 for the number of processors
+ * @param[out] Scores scores, SCORE_ERROR for the pairs that failed
+ *
+ * @return IVCMP_OK or the first error code
+ */
+ivcmp_status_t CompareIVCMatrix(ivcmp_context_t *Ctx, double **Voltages, double **Currents,
+                                const uint32_t *CurveLengths, uint32_t NumCurves,
+                                ivcmp_matrix_layout_t Layout, uint32_t NumThreads, double *Scores)
+{
+  uint32_t i;
+  uint32_t NumTasks;
+  size_t Size;
+  matrix_job_t Job;
+  ivcmp_status_t Status = IVCMP_OK;
+
+  if (!Ctx || !Voltages || !Currents || !CurveLengths || !Scores)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Layout != IVCMP_MATRIX_FULL && Layout != IVCMP_MATRIX_PACKED)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+  for (i = 0; i < NumCurves; i++)
+  {
+    if (!Voltages[i] || !Currents[i])
+    {
+      return IVCMP_ERROR_NULL_POINTER;
+    }
+  }
+  if (NumThreads == 0)
+  {
+    NumThreads = IvcGetNumProcessors();
+  }
+  /* No more workers than curves to prepare */
+  NumThreads = min(min(NumThreads, IVC_MAX_WORKERS), max(NumCurves, 1));
+
+  Job.NumCurves = NumCurves;
+  Job.NumTiles = (NumCurves + MATRIX_TILE - 1) / MATRIX_TILE;
+  NumTasks = Job.NumTiles * (Job.NumTiles + 1) / 2;
+  Job.Voltages = Voltages;
+  Job.Currents = Currents;
+  Job.CurveLengths = CurveLengths;
+  Job.Layout = Layout;
+  Job.Scores = Scores;
+  Size = NumThreads * sizeof(ivcmp_context_t *) + NumCurves * sizeof(ivcmp_prepared_t *) +
+         NumCurves * sizeof(ivcmp_status_t) + NumTasks * sizeof(ivcmp_status_t);
+  Job.Contexts = (ivcmp_context_t **)IvcMalloc(Size);
+  if (!Job.Contexts)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  memset(Job.Contexts, 0, Size);
+  Job.Prepared = (ivcmp_prepared_t **)(Job.Contexts + NumThreads);
+  Job.CurveStatus = (ivcmp_status_t *)(Job.Prepared + NumCurves);
+  Job.TileStatus = Job.CurveStatus + NumCurves;
+
+  /* Workers have own scratch buffers and the settings of the given context */
+  Job.Contexts[0] = Ctx;
+  for (i = 1; i < NumThreads; i++)
+  {
+    Job.Contexts[i] = CreateWorkerContext(Ctx);
+    if (!Job.Contexts[i])
+    {
+      Status = IVCMP_ERROR_NO_MEMORY;
+      break;
+    }
+  }
+
+  if (Status == IVCMP_OK)
+  {
+    IvcParallelFor(NumThreads, NumCurves, PrepareMatrixCurve, &Job);
+    IvcParallelFor(NumThreads, NumTasks, CompareMatrixTile, &Job);
+    for (i = 0; i < NumCurves && Status == IVCMP_OK; i++)
+    {
+      Status = Job.CurveStatus[i];
+    }
+    for (i = 0; i < NumTasks && Status == IVCMP_OK; i++)
+    {
+      Status = Job.TileStatus[i];
+    }
+    if (Layout == IVCMP_MATRIX_FULL)
+    {
+      for (i = 0; i < NumCurves; i++)
+      {
+        Scores[(size_t)i * NumCurves + i] = Job.Prepared[i] ? 0. : SCORE_ERROR;
+      }
+    }
+  }
+
+  for (i = 0; i < NumCurves; i++)
+  {
+    DestroyPreparedIVC(Job.Prepared[i]);
+  }
+  for (i = 1; i < NumThreads; i++)
+  {
+    DestroyIVCContext(Job.Contexts[i]);
+  }
+  IvcFree(Job.Contexts);
+  return Status;
+}
+
+/**
+ * State of CompareIVCBatch() shared by the workers
+ */
+typedef struct
+{
+  ivcmp_context_t **Contexts; /**< Context of each worker */
+  double *VoltagesA;          /**< Voltages of the first curves of the pairs one after another */
+  double *CurrentsA;          /**< Currents of the first curves of the pairs one after another */
+  const size_t *OffsetsA;     /**< Offset of each first curve and the total number of points */
+  double *VoltagesB;          /**< The same for the second curves */
+  double *CurrentsB;
+  const size_t *OffsetsB;
+  const double *MinVarV;      /**< Scaling thresholds of each pair, NULL for the thresholds of the context */
+  const double *MinVarC;
+  double *Scores;             /**< Scores */
+  ivcmp_status_t *Statuses;   /**< Status of each pair */
+} batch_job_t;
+
+/**
+ * Compares one pair of the batch
+ *
+ * @param Arg batch job
+ * @param[in] Task number of the pair
+ * @param[in] Worker number of the worker
+ */
+static void CompareBatchPair(void *Arg, uint32_t Task, uint32_t Worker)
+{
+  batch_job_t *Job = (batch_job_t *)Arg;
+  ivcmp_context_t *Ctx = Job->Contexts[Worker];
+  const size_t *OffsetsA = Job->OffsetsA + Task;
+  const size_t *OffsetsB = Job->OffsetsB + Task;
+
+  Job->Scores[Task] = SCORE_ERROR;
+  if (OffsetsA[1] < OffsetsA[0] || OffsetsB[1] < OffsetsB[0] ||
+      OffsetsA[1] - OffsetsA[0] > UINT32_MAX || OffsetsB[1] - OffsetsB[0] > UINT32_MAX)
+  {
+    Job->Statuses[Task] = IVCMP_ERROR_INVALID_ARGUMENT;
+    return;
+  }
+  if (Job->MinVarV)
+  {
+    Ctx->MinVarV = Job->MinVarV[Task];
+    Ctx->MinVarC = Job->MinVarC[Task];
+  }
+  Job->Statuses[Task] = CompareCurves(Ctx, Job->VoltagesA + OffsetsA[0], Job->CurrentsA + OffsetsA[0],
+                                      (uint32_t)(OffsetsA[1] - OffsetsA[0]),
+                                      Job->VoltagesB + OffsetsB[0], Job->CurrentsB + OffsetsB[0],
+                                      (uint32_t)(OffsetsB[1] - OffsetsB[0]), 1., &Job->Scores[Task]);
+}
+
+/**
+ * Compares the curves of each pair of the batch on several threads.
+ * Pairs are compared independently, so the results do not depend on the number of threads.
+ *
+ * @param Ctx comparison context, its settings are used by all the workers
+ * @param[in] VoltagesA voltages of the first curves of the pairs one after another
+ * @param[in] CurrentsA currents of the first curves of the pairs one after another
+ * @param[in] OffsetsA NumPairs + 1 offsets: the first curve of pair i is from OffsetsA[i] to OffsetsA[i + 1]
+ * @param[in] VoltagesB voltages of the second curves of the pairs one after another
+ * @param[in] CurrentsB currents of the second curves of the pairs one after another
+ * @param[in] OffsetsB NumPairs + 1 offsets of the second curves
+ * @param[in] MinVarV voltage scaling threshold of each pair, NULL for the threshold of the context
+ * @param[in] MinVarC current scaling threshold of each pair, NULL for the threshold of the context
+ * @param[in] NumPairs number of pairs
+ * @param[in] NumThreads number of threads, 0 for the number of processors
+ * @param[out] Scores score of each pair, SCORE_ERROR for the pairs that failed
+ * @param[out] Statuses status of each pair, may be NULL
+ *
+ * @return IVCMP_OK or the status of the first failed pair
+ */
+ivcmp_status_t CompareIVCBatch(ivcmp_context_t *Ctx,
+                               double *VoltagesA, double *CurrentsA, const size_t *OffsetsA,
+                               double *VoltagesB, double *CurrentsB, const size_t *OffsetsB,
+                               const double *MinVarV, const double *MinVarC, uint32_t NumPairs,
+                               uint32_t NumThreads, double *Scores, ivcmp_status_t *Statuses)
+{
+  uint32_t i;
+  batch_job_t Job;
+  ivcmp_status_t Status = IVCMP_OK;
+
+  if (!Ctx || !VoltagesA || !CurrentsA || !OffsetsA || !VoltagesB || !CurrentsB || !OffsetsB || !Scores)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (!MinVarV != !MinVarC)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (NumThreads == 0)
+  {
+    NumThreads = IvcGetNumProcessors();
+  }
+  NumThreads = min(min(NumThreads, IVC_MAX_WORKERS), max(NumPairs, 1));
+
+  Job.VoltagesA = VoltagesA;
+  Job.CurrentsA = CurrentsA;
+  Job.OffsetsA = OffsetsA;
+  Job.VoltagesB = VoltagesB;
+  Job.CurrentsB = CurrentsB;
+  Job.OffsetsB = OffsetsB;
+  Job.MinVarV = MinVarV;
+  Job.MinVarC = MinVarC;
+  Job.Scores = Scores;
+  Job.Contexts = (ivcmp_context_t **)IvcMalloc(NumThreads * sizeof(ivcmp_context_t *) +
+                                               (Statuses ? 0 : NumPairs * sizeof(ivcmp_status_t)));
+  if (!Job.Contexts)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  Job.Statuses = Statuses ? Statuses : (ivcmp_status_t *)(Job.Contexts + NumThreads);
+
+  /* Thresholds of the pairs are set to the contexts of the workers, the given context is not changed */
+  for (i = 0; i < NumThreads; i++)
+  {
+    Job.Contexts[i] = Status == IVCMP_OK ? CreateWorkerContext(Ctx) : NULL;
+    if (!Job.Contexts[i])
+    {
+      Status = IVCMP_ERROR_NO_MEMORY;
+    }
+  }
+
+  if (Status == IVCMP_OK)
+  {
+    IvcParallelFor(NumThreads, NumPairs, CompareBatchPair, &Job);
+    for (i = 0; i < NumPairs && Status == IVCMP_OK; i++)
+    {
+      Status = Job.Statuses[i];
+    }
+  }
+
+  for (i = 0; i < NumThreads; i++)
+  {
+    DestroyIVCContext(Job.Contexts[i]);
+  }
+  IvcFree(Job.Contexts);
+  return Status;
+}
+
+
+/* ******************************* */
+/*    Search index                 */
+/* ******************************* */
+
+/**
+ * Node of the search index: curves of the node and the summary of their descriptors
+ */
+typedef struct
+{
+  curve_box_t Boxes[DESCRIPTOR_BLOCKS]; /**< Boxes covering the boxes of all the curves */
+  double MinSigmaV;     /**< Range of the standard deviations of voltages */
+  double MaxSigmaV;
+  double MinSigmaC;     /**< Range of the standard deviations of currents */
+  double MaxSigmaC;
+  double LimitV;        /**< Descriptors of all the curves are valid for the voltage scales below the limit */
+  double LimitC;        /**< Descriptors of all the curves are valid for the current scales below the limit */
+  uint32_t CurveLength; /**< Number of points in all the curves, 0 if it differs */
+  uint32_t First;       /**< Position of the first curve of the node in the order of the index */
+  uint32_t Count;       /**< Number of curves in the node */
+  uint32_t Children[2]; /**< Child nodes, 0 for a leaf */
+} index_node_t;
+
+/**
+ * Search index: tree of the nodes over the prepared curves
+ */
+struct ivcmp_index_s
+{
+  double MinVarV;            /**< Scaling thresholds used for preparation of the curves */
+  double MinVarC;
+  uint32_t NumCurves;        /**< Number of curves */
+  uint32_t NumNodes;         /**< Number of nodes, the root is the first one */
+  index_node_t *Nodes;       /**< Nodes */
+  ivcmp_prepared_t **Curves; /**< Prepared curves in the order given to BuildIVCIndex() */
+  uint32_t *Order;           /**< Numbers of the curves in the order of the nodes */
+};
+
+/**
+ * Allocates the index with empty curves and nodes
+ *
+ * @param[in] NumCurves number of curves
+ * @param[in] MinVarV voltage scaling threshold for preparation of the curves
+ * @param[in] MinVarC current scaling threshold for preparation of the curves
+ *
+ * @return index or NULL
+ */
+static ivcmp_index_t *CreateIndex(uint32_t NumCurves, double MinVarV, double MinVarC)
+{
+  ivcmp_index_t *Index;
+  /* Every split node has two children, so there are less than two nodes per curve */
+  const size_t MaxNodes = 2 * (size_t)NumCurves;
+  const size_t Size = sizeof(ivcmp_index_t) + MaxNodes * sizeof(index_node_t) +
+                      NumCurves * (sizeof(ivcmp_prepared_t *) + sizeof(uint32_t));
+
+  Index = (ivcmp_index_t *)IvcMalloc(Size);
+  if (!Index)
+  {
+    return NULL;
+  }
+  memset(Index, 0, Size);
+  Index->MinVarV = MinVarV;
+  Index->MinVarC = MinVarC;
+  Index->NumCurves = NumCurves;
+  Index->Nodes = (index_node_t *)(Index + 1);
+  Index->Curves = (ivcmp_prepared_t **)(Index->Nodes + MaxNodes);
+  Index->Order = (uint32_t *)(Index->Curves + NumCurves);
+  return Index;
+}
+
+/**
+ * Evaluates the summary of the descriptors of the curves of the node
+ *
+ * @param[in] Index index with the prepared curves
+ * @param Node node with the curves
+ */
+static void SummarizeNode(const ivcmp_index_t *Index, index_node_t *Node)
+{
+  uint32_t i, k;
+  const ivcmp_prepared_t *Curve = Index->Curves[Index->Order[Node->First]];
+
+  memcpy(Node->Boxes, Curve->Boxes, sizeof(Node->Boxes));
+  Node->CurveLength = Curve->CurveLength;
+  Node->MinSigmaV = Node->MaxSigmaV = Curve->SigmaV;
+  Node->MinSigmaC = Node->MaxSigmaC = Curve->SigmaC;
+  Node->LimitV = Node->LimitC = HUGE_VAL;
+  for (i = 0; i < Node->Count; i++)
+  {
+    Curve = Index->Curves[Index->Order[Node->First + i]];
+    for (k = 0; k < DESCRIPTOR_BLOCKS; k++)
+    {
+      curve_box_t *Box = &Node->Boxes[k];
+      Box->MinV = min(Box->MinV, Curve->Boxes[k].MinV);
+      Box->MaxV = max(Box->MaxV, Curve->Boxes[k].MaxV);
+      Box->MinC = min(Box->MinC, Curve->Boxes[k].MinC);
+      Box->MaxC = max(Box->MaxC, Curve->Boxes[k].MaxC);
+    }
+    if (Curve->CurveLength != Node->CurveLength)
+    {
+      Node->CurveLength = 0;
+    }
+    Node->MinSigmaV = min(Node->MinSigmaV, Curve->SigmaV);
+    Node->MaxSigmaV = max(Node->MaxSigmaV, Curve->SigmaV);
+    Node->MinSigmaC = min(Node->MinSigmaC, Curve->SigmaC);
+    Node->MaxSigmaC = max(Node->MaxSigmaC, Curve->SigmaC);
+    /* See IsDescriptorValid() */
+    Node->LimitV = min(Node->LimitV, Curve->MaxGrowth * Curve->OwnVarV);
+    Node->LimitC = min(Node->LimitC, Curve->MaxGrowth * Curve->OwnVarC);
+  }
+}
+
+/**
+ * Returns the coordinate of the curve used to split the nodes: center of one of the descriptor boxes
+ * scaled by the own scale of the curve
+ *
+ * @param[in] Curve prepared curve
+ * @param[in] Dim number of the coordinate, from 0 to 2 * DESCRIPTOR_BLOCKS - 1
+ *
+ * @return coordinate
+ */
+static double CurveFeature(const ivcmp_prepared_t *Curve, uint32_t Dim)
+{
+  const curve_box_t *Box = &Curve->Boxes[Dim / 2];
+  if (Dim % 2 == 0)
+  {
+    return (Box->MinV + Box->MaxV) / 2. / Curve->OwnVarV;
+  }
+  return (Box->MinC + Box->MaxC) / 2. / Curve->OwnVarC;
+}
+
+/**
+ * Builds the subtree of the node: splits the curves of the node in halves by the coordinate
+ * with the largest spread until the leaves are small enough.
+ * Curves with different number of points are split by the number of points first.
+ *
+ * @param Index index with the prepared curves and the order of the curves
+ * @param[in] NodeNum number of the node with the curves
+ * @param Keys scratch array for the curves of the node
+ */
+static void BuildIndexNode(ivcmp_index_t *Index, uint32_t NodeNum, match_candidate_t *Keys)
+{
+  uint32_t i, Dim, Half;
+  double Value, Low, High, Spread;
+  double BestSpread = -1;
+  uint32_t BestDim = 0;
+  index_node_t *Node = &Index->Nodes[NodeNum];
+  const uint32_t *Order = Index->Order + Node->First;
+
+  SummarizeNode(Index, Node);
+  if (Node->Count <= INDEX_LEAF_SIZE)
+  {
+    return;
+  }
+
+  for (Dim = 0; Dim < 2 * DESCRIPTOR_BLOCKS && Node->CurveLength != 0; Dim++)
+  {
+    Low = HUGE_VAL;
+    High = -HUGE_VAL;
+    for (i = 0; i < Node->Count; i++)
+    {
+      Value = CurveFeature(Index->Curves[Order[i]], Dim);
+      Low = min(Low, Value);
+      High = max(High, Value);
+    }
+    Spread = High - Low;
+    if (Spread > BestSpread)
+    {
+      BestSpread = Spread;
+      BestDim = Dim;
+    }
+  }
+  for (i = 0; i < Node->Count; i++)
+  {
+    const ivcmp_prepared_t *Curve = Index->Curves[Order[i]];
+    Keys[i].Bound = Node->CurveLength != 0 ? CurveFeature(Curve, BestDim) : Curve->CurveLength;
+    Keys[i].Index = Order[i];
+  }
+  qsort(Keys, Node->Count, sizeof(match_candidate_t), CompareCandidates);
+  for (i = 0; i < Node->Count; i++)
+  {
+    Index->Order[Node->First + i] = Keys[i].Index;
+  }
+
+  Half = Node->Count / 2;
+  for (i = 0; i < 2; i++)
+  {
+    index_node_t *Child = &Index->Nodes[Index->NumNodes];
+    Child->First = Node->First + (i == 0 ? 0 : Half);
+    Child->Count = i == 0 ? Half : Node->Count - Half;
+    Node->Children[i] = Index->NumNodes++;
+  }
+  BuildIndexNode(Index, Node->Children[0], Keys);
+  BuildIndexNode(Index, Node->Children[1], Keys);
+}
+
+/**
+ * Evaluates the lower bound of the scores of the curve with all the curves of the node
+ *
+ * @param Ctx comparison context
+ * @param[in] Index index with the node
+ * @param[in] Prepared curve
+ * @param[in] Node node
+ *
+ * @return lower bound of the scores, 0 if the descriptors do not describe the compared curves
+ */
+static double NodeBound(const ivcmp_context_t *Ctx, const ivcmp_index_t *Index, const ivcmp_prepared_t *Prepared,
+                        const index_node_t *Node)
+{
+  /* Scales of the pairs with the curves of the node lie in these ranges */
+  const double VarV = max(max(Prepared->SigmaV, Node->MaxSigmaV), Ctx->MinVarV);
+  const double VarC = max(max(Prepared->SigmaC, Node->MaxSigmaC), Ctx->MinVarC);
+  const double LeastVarV = max(max(Prepared->SigmaV, Node->MinSigmaV), Ctx->MinVarV);
+  const double LeastVarC = max(max(Prepared->SigmaC, Node->MinSigmaC), Ctx->MinVarC);
+
+  /* Own scales of the curves are not less than the thresholds of the index, smaller scales of the pairs
+   * may keep the removed repeats of the curves again, see IsDescriptorValid() */
+  if (LeastVarV < Index->MinVarV || LeastVarC < Index->MinVarC)
+  {
+    return 0;
+  }
+  /* Margin is larger than in IsDescriptorValid() to cover rounding of the limits */
+  if (!IsDescriptorValid(Prepared, VarV, VarC, Node->CurveLength) ||
+      VarV * (1 + 2.e-6) >= Node->LimitV || VarC * (1 + 2.e-6) >= Node->LimitC)
+  {
+    return 0;
+  }
+  /* Scaled distances and coordinates only decrease with the scales */
+  return BoxesBound(Prepared->Boxes, Node->Boxes, Node->CurveLength, VarV, VarC, LeastVarV, LeastVarC);
+}
+
+/**
+ * Adds an entry to the binary heap ordered by CompareCandidates()
+ *
+ * @param Heap heap
+ * @param Size number of entries in the heap
+ * @param[in] Bound key of the entry
+ * @param[in] Index number of the entry
+ */
+static void PushCandidate(match_candidate_t *Heap, uint32_t *Size, double Bound, uint32_t Index)
+{
+  uint32_t i = (*Size)++;
+  match_candidate_t Entry;
+  Entry.Bound = Bound;
+  Entry.Index = Index;
+  while (i > 0 && CompareCandidates(&Entry, &Heap[(i - 1) / 2]) < 0)
+  {
+    Heap[i] = Heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  Heap[i] = Entry;
+}
+
+/**
+ * Removes the least entry from the binary heap ordered by CompareCandidates()
+ *
+ * @param Heap heap, not empty
+ * @param Size number of entries in the heap
+ *
+ * @return removed entry
+ */
+static match_candidate_t PopCandidate(match_candidate_t *Heap, uint32_t *Size)
+{
+  uint32_t i = 0;
+  uint32_t Child;
+  const match_candidate_t Top = Heap[0];
+  const match_candidate_t Last = Heap[--(*Size)];
+  for (;;)
+  {
+    Child = 2 * i + 1;
+    if (Child >= *Size)
+    {
+      break;
+    }
+    if (Child + 1 < *Size && CompareCandidates(&Heap[Child + 1], &Heap[Child]) < 0)
+    {
+      Child++;
+    }
+    if (CompareCandidates(&Last, &Heap[Child]) <= 0)
+    {
+      break;
+    }
+    Heap[i] = Heap[Child];
+    i = Child;
+  }
+  Heap[i] = Last;
+  return Top;
+}
+
+/**
+ * Inserts the match into the list ordered by the score, then by the number.
+ * The last match is dropped if the list is full.
+ *
+ * @param[in] K capacity of the list
+ * @param Indices numbers of the matches
+ * @param Scores scores of the matches
+ * @param NumFound number of matches in the list
+ * @param[in] Index number of the new match
+ * @param[in] Score score of the new match
+ */
+static void InsertMatch(uint32_t K, uint32_t *Indices, double *Scores, uint32_t *NumFound,
+                        uint32_t Index, double Score)
+{
+  uint32_t i = *NumFound < K ? (*NumFound)++ : K - 1;
+  while (i > 0 && (Scores[i - 1] > Score || (Scores[i - 1] == Score && Indices[i - 1] > Index)))
+  {
+    Scores[i] = Scores[i - 1];
+    Indices[i] = Indices[i - 1];
+    i--;
+  }
+  Scores[i] = Score;
+  Indices[i] = Index;
+}
+
+/**
+ * Builds the search index over the curves
+ *
+ * @param Ctx comparison context, its scaling thresholds are used for preparation of the curves
+ * @param[in] Voltages voltages of the curves
+ * @param[in] Currents currents of the curves
+ * @param[in] CurveLengths number of points in the curves
+ * @param[in] NumCurves number of curves
+ * @param[out] IndexPtr index, should be destroyed with DestroyIVCIndex()
+ *
+ * @return IVCMP_OK or the error code of the first curve that can not be prepared
+ */
+ivcmp_status_t BuildIVCIndex(ivcmp_context_t *Ctx, double **Voltages, double **Currents,
+                             const uint32_t *CurveLengths, uint32_t NumCurves, ivcmp_index_t **IndexPtr)
+{
+  uint32_t i;
+  ivcmp_index_t *Index;
+  match_candidate_t *Keys;
+  ivcmp_status_t Status = IVCMP_OK;
+
+  if (!Ctx || !Voltages || !Currents || !CurveLengths || !IndexPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *IndexPtr = NULL;
+  if (NumCurves == 0)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  Index = CreateIndex(NumCurves, Ctx->MinVarV, Ctx->MinVarC);
+  if (!Index)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  for (i = 0; i < NumCurves && Status == IVCMP_OK; i++)
+  {
+    Status = PrepareCurve(Ctx, Voltages[i], Currents[i], CurveLengths[i], Index->MinVarV, Index->MinVarC,
+                          &Index->Curves[i]);
+    Index->Order[i] = i;
+  }
+  Keys = Status == IVCMP_OK ? (match_candidate_t *)IvcMalloc(NumCurves * sizeof(match_candidate_t)) : NULL;
+  if (Status == IVCMP_OK && !Keys)
+  {
+    Status = IVCMP_ERROR_NO_MEMORY;
+  }
+  if (Status != IVCMP_OK)
+  {
+    DestroyIVCIndex(Index);
+    return Status;
+  }
+
+  Index->NumNodes = 1;
+  Index->Nodes[0].First = 0;
+  Index->Nodes[0].Count = NumCurves;
+  BuildIndexNode(Index, 0, Keys);
+  IvcFree(Keys);
+  *IndexPtr = Index;
+  return IVCMP_OK;
+}
+
+/**
+ * Destroys the search index
+ *
+ * @param Index index, may be NULL
+ */
+void DestroyIVCIndex(ivcmp_index_t *Index)
+{
+  uint32_t i;
+  if (!Index)
+  {
+    return;
+  }
+  for (i = 0; i < Index->NumCurves; i++)
+  {
+    DestroyPreparedIVC(Index->Curves[i]);
+  }
+  IvcFree(Index);
+}
+
+/**
+ * Returns the number of curves in the search index
+ *
+ * @param[in] Index index
+ *
+ * @return number of curves, 0 for NULL
+ */
+uint32_t GetIVCIndexSize(const ivcmp_index_t *Index)
+{
+  return Index ? Index->NumCurves : 0;
+}
+
+/**
+ * Finds K curves of the index with the least scores.
+ * Nodes are visited in the order of the lower bounds of the scores of their curves,
+ * the search stops as soon as the bound exceeds the K-th best score.
+ * Curves of the visited leaves are compared like in FindIVCBestMatch().
+ *
+ * @param Ctx comparison context
+ * @param[in] Index index
+ * @param[in] Prepared curve to match
+ * @param[in] K number of curves to find
+ * @param[out] Indices numbers of the found curves, K elements
+ * @param[out] Scores scores of the found curves in increasing order, K elements
+ * @param[out] NumFoundPtr number of the found curves, less than K if the index is smaller
+ * or some curves can not be compared
+ *
+ * @return IVCMP_OK or the first error code if no curve can be compared
+ */
+ivcmp_status_t SearchIVCIndex(ivcmp_context_t *Ctx, const ivcmp_index_t *Index, const ivcmp_prepared_t *Prepared,
+                              uint32_t K, uint32_t *Indices, double *Scores, uint32_t *NumFoundPtr)
+{
+  uint32_t i, HeapSize, CurveNum;
+  double Bound, Score, Worst;
+  match_candidate_t Top;
+  match_candidate_t *Heap;
+  ivcmp_status_t Status;
+  ivcmp_status_t FirstError = IVCMP_OK;
+  uint32_t NumFound = 0;
+
+  if (!Ctx || !Index || !Prepared || !Indices || !Scores || !NumFoundPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *NumFoundPtr = 0;
+  if (K == 0)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+  Heap = (match_candidate_t *)IvcMalloc(Index->NumNodes * sizeof(match_candidate_t));
+  if (!Heap)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+
+  HeapSize = 0;
+  PushCandidate(Heap, &HeapSize, NodeBound(Ctx, Index, Prepared, &Index->Nodes[0]), 0);
+  while (HeapSize > 0)
+  {
+    Worst = NumFound < K ? HUGE_VAL : Scores[K - 1];
+    Top = PopCandidate(Heap, &HeapSize);
+    if (Top.Bound > Worst)
+    {
+      break;
+    }
+    const index_node_t *Node = &Index->Nodes[Top.Index];
+    if (Node->Children[0] != 0)
+    {
+      for (i = 0; i < 2; i++)
+      {
+        Bound = NodeBound(Ctx, Index, Prepared, &Index->Nodes[Node->Children[i]]);
+        if (Bound <= Worst)
+        {
+          PushCandidate(Heap, &HeapSize, Bound, Node->Children[i]);
+        }
+      }
+      continue;
+    }
+    for (i = 0; i < Node->Count; i++)
+    {
+      Worst = NumFound < K ? HUGE_VAL : Scores[K - 1];
+      CurveNum = Index->Order[Node->First + i];
+      if (DescriptorsBound(Ctx, Prepared, Index->Curves[CurveNum]) > Worst)
+      {
+        continue;
+      }
+      /* Exact score is needed only if it does not exceed the K-th best one */
+      Status = ComparePrepared(Ctx, Prepared, Index->Curves[CurveNum], min(Worst, 1.), &Score);
+      if (Status != IVCMP_OK)
+      {
+        FirstError = FirstError != IVCMP_OK ? FirstError : Status;
+        continue;
+      }
+      if (NumFound < K || Score < Worst || (Score == Worst && CurveNum < Indices[K - 1]))
+      {
+        InsertMatch(K, Indices, Scores, &NumFound, CurveNum, Score);
+      }
+    }
+  }
+  IvcFree(Heap);
+
+  *NumFoundPtr = NumFound;
+  return NumFound > 0 ? IVCMP_OK : FirstError;
+}
+
+/**
+ * Writes values to the file
+ *
+ * @param File file
+ * @param[in] Values values
+ * @param[in] Size size of a value in bytes
+ * @param[in] Count number of values
+ *
+ * @return 1 if all the values are written
+ */
+static int WriteValues(FILE *File, const void *Values, size_t Size, size_t Count)
+{
+  return fwrite(Values, Size, Count, File) == Count;
+}
+
+/**
+ * Reads values from the file
+ *
+ * @param File file
+ * @param[out] Values values
+ * @param[in] Size size of a value in bytes
+ * @param[in] Count number of values
+ *
+ * @return 1 if all the values are read
+ */
+static int ReadValues(FILE *File, void *Values, size_t Size, size_t Count)
+{
+  return fread(Values, Size, Count, File) == Count;
+}
+
+static const char IndexFileMagic[8] = {'I', 'V', 'C', 'M', 'P', 'I', 'D', 'X'};
+
+/**
+ * Saves the search index to the file: scaling thresholds, original curves and the tree.
+ * Numbers are stored in the byte order of the machine.
+ *
+ * @param[in] Index index
+ * @param[in] FileName name of the file
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t SaveIVCIndex(const ivcmp_index_t *Index, const char *FileName)
+{
+  uint32_t i;
+  int Ok;
+  FILE *File = NULL;
+  const uint32_t Version = INDEX_FILE_VERSION;
+
+  if (!Index || !FileName)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  OPEN_FILE(File, FileName, "wb");
+  if (!File)
+  {
+    return IVCMP_ERROR_FILE_IO;
+  }
+  Ok = WriteValues(File, IndexFileMagic, 1, sizeof(IndexFileMagic)) &&
+       WriteValues(File, &Version, sizeof(uint32_t), 1) &&
+       WriteValues(File, &Index->NumCurves, sizeof(uint32_t), 1) &&
+       WriteValues(File, &Index->NumNodes, sizeof(uint32_t), 1) &&
+       WriteValues(File, &Index->MinVarV, sizeof(double), 1) &&
+       WriteValues(File, &Index->MinVarC, sizeof(double), 1);
+  for (i = 0; i < Index->NumCurves && Ok; i++)
+  {
+    const ivcmp_prepared_t *Curve = Index->Curves[i];
+    Ok = WriteValues(File, &Curve->CurveLength, sizeof(uint32_t), 1) &&
+         WriteValues(File, PREPARED_VOLTAGES(Curve), sizeof(double), Curve->CurveLength) &&
+         WriteValues(File, PREPARED_CURRENTS(Curve), sizeof(double), Curve->CurveLength);
+  }
+  Ok = Ok && WriteValues(File, Index->Order, sizeof(uint32_t), Index->NumCurves);
+  for (i = 0; i < Index->NumNodes && Ok; i++)
+  {
+    const index_node_t *Node = &Index->Nodes[i];
+    Ok = WriteValues(File, &Node->First, sizeof(uint32_t), 1) &&
+         WriteValues(File, &Node->Count, sizeof(uint32_t), 1) &&
+         WriteValues(File, Node->Children, sizeof(uint32_t), 2);
+  }
+  if (fclose(File) != 0)
+  {
+    Ok = 0;
+  }
+  return Ok ? IVCMP_OK : IVCMP_ERROR_FILE_IO;
+}
+
+/**
+ * Reads the curves and the tree of the index saved by SaveIVCIndex() and prepares the curves
+ *
+ * @param Ctx comparison context
+ * @param File file positioned after the header
+ * @param Index index with the number of curves, nodes and the scaling thresholds
+ *
+ * @return IVCMP_OK or error code
+ */
+static ivcmp_status_t ReadIndex(ivcmp_context_t *Ctx, FILE *File, ivcmp_index_t *Index)
+{
+  uint32_t i, k, CurveLength;
+  double *Buffer = NULL;
+  uint32_t BufferLength = 0;
+  ivcmp_status_t Status = IVCMP_OK;
+
+  for (i = 0; i < Index->NumCurves && Status == IVCMP_OK; i++)
+  {
+    if (!ReadValues(File, &CurveLength, sizeof(uint32_t), 1))
+    {
+      Status = IVCMP_ERROR_INVALID_FILE;
+      break;
+    }
+    if (CurveLength > BufferLength)
+    {
+      IvcFree(Buffer);
+      BufferLength = CurveLength;
+      Buffer = (double *)IvcMalloc(2 * (size_t)BufferLength * sizeof(double));
+      if (!Buffer)
+      {
+        Status = IVCMP_ERROR_NO_MEMORY;
+        break;
+      }
+    }
+    if (!ReadValues(File, Buffer, sizeof(double), 2 * (size_t)CurveLength))
+    {
+      Status = IVCMP_ERROR_INVALID_FILE;
+      break;
+    }
+    Status = PrepareCurve(Ctx, Buffer, Buffer + CurveLength, CurveLength, Index->MinVarV, Index->MinVarC,
+                          &Index->Curves[i]);
+  }
+  IvcFree(Buffer);
+  if (Status != IVCMP_OK)
+  {
+    return Status;
+  }
+
+  if (!ReadValues(File, Index->Order, sizeof(uint32_t), Index->NumCurves))
+  {
+    return IVCMP_ERROR_INVALID_FILE;
+  }
+  for (i = 0; i < Index->NumCurves; i++)
+  {
+    if (Index->Order[i] >= Index->NumCurves)
+    {
+      return IVCMP_ERROR_INVALID_FILE;
+    }
+  }
+  for (i = 0; i < Index->NumNodes; i++)
+  {
+    index_node_t *Node = &Index->Nodes[i];
+    if (!ReadValues(File, &Node->First, sizeof(uint32_t), 1) ||
+        !ReadValues(File, &Node->Count, sizeof(uint32_t), 1) ||
+        !ReadValues(File, Node->Children, sizeof(uint32_t), 2))
+    {
+      return IVCMP_ERROR_INVALID_FILE;
+    }
+    /* Children follow their parent, so the search always terminates */
+    if (Node->Count == 0 || Node->First > Index->NumCurves - Node->Count ||
+        (Node->Children[0] == 0) != (Node->Children[1] == 0))
+    {
+      return IVCMP_ERROR_INVALID_FILE;
+    }
+    for (k = 0; k < 2; k++)
+    {
+      if (Node->Children[k] != 0 && (Node->Children[k] <= i || Node->Children[k] >= Index->NumNodes))
+      {
+        return IVCMP_ERROR_INVALID_FILE;
+      }
+    }
+    SummarizeNode(Index, Node);
+  }
+  return IVCMP_OK;
+}
+
+/**
+ * Loads the search index saved by SaveIVCIndex()
+ *
+ * @param Ctx comparison context used for preparation of the curves
+ * @param[in] FileName name of the file
+ * @param[out] IndexPtr index, should be destroyed with DestroyIVCIndex()
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t LoadIVCIndex(ivcmp_context_t *Ctx, const char *FileName, ivcmp_index_t **IndexPtr)
+{
+  char Magic[sizeof(IndexFileMagic)];
+  uint32_t Version, NumCurves, NumNodes;
+  double MinVarV, MinVarC;
+  FILE *File = NULL;
+  ivcmp_index_t *Index;
+  ivcmp_status_t Status;
+
+  if (!Ctx || !FileName || !IndexPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *IndexPtr = NULL;
+  OPEN_FILE(File, FileName, "rb");
+  if (!File)
+  {
+    return IVCMP_ERROR_FILE_IO;
+  }
+  if (!ReadValues(File, Magic, 1, sizeof(Magic)) || memcmp(Magic, IndexFileMagic, sizeof(Magic)) != 0 ||
+      !ReadValues(File, &Version, sizeof(uint32_t), 1) || Version != INDEX_FILE_VERSION ||
+      !ReadValues(File, &NumCurves, sizeof(uint32_t), 1) ||
+      !ReadValues(File, &NumNodes, sizeof(uint32_t), 1) ||
+      !ReadValues(File, &MinVarV, sizeof(double), 1) ||
+      !ReadValues(File, &MinVarC, sizeof(double), 1) ||
+      NumCurves == 0 || NumNodes == 0 || NumNodes >= 2 * (uint64_t)NumCurves)
+  {
+    fclose(File);
+    return IVCMP_ERROR_INVALID_FILE;
+  }
+  Index = CreateIndex(NumCurves, MinVarV, MinVarC);
+  if (!Index)
+  {
+    fclose(File);
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  Index->NumNodes = NumNodes;
+  Status = ReadIndex(Ctx, File, Index);
+  fclose(File);
+  if (Status != IVCMP_OK)
+  {
+    DestroyIVCIndex(Index);
+    return Status;
+  }
+  *IndexPtr = Index;
+  return IVCMP_OK;
+}
+
+
+/* ******************************* */
+/*    Streaming comparison         */
+/* ******************************* */
+
+/**
+ * Comparator of the samples of a period acquired one by one with the reference curve.
+ * The comparison is evaluated in advance on the assumption that the period will have MaxLength samples,
+ * the scales of the pair will be determined by the reference and repeats removal will keep
+ * the expected number of samples (as many as in the previous period).
+ * B-spline points of the samples are evaluated as soon as their defining samples are kept,
+ * each point updates the distance to the reference and the nearest points of the reference nodes.
+ */
+struct ivcmp_stream_s
+{
+  const ivcmp_prepared_t *Reference; /**< Reference curve */
+  uint32_t MaxLength;   /**< Number of samples in a full period */
+  uint32_t Length;      /**< Number of samples of the current period */
+  uint32_t CurveLength; /**< Number of points of the compared B-splines */
+  double MinVarV;       /**< Scaling thresholds of the context the comparator was created with */
+  double MinVarC;
+  double VarV;          /**< Expected scales of the pair */
+  double VarC;
+  double *Voltages;     /**< Samples of the current period */
+  double *Currents;
+  uint32_t Size;        /**< Number of the samples kept by repeats removal with the expected scales */
+  uint32_t ExpectedSize; /**< Expected number of kept samples in a full period */
+  double *KeptV;        /**< Kept samples followed by a zero sample for B-spline */
+  double *KeptC;
+  uint8_t *Kept;        /**< Repeats removal marks of the samples with their own scales */
+  double *Ref[IV_CURVE_NUM_COMPONENTS]; /**< Scaled B-spline of the reference */
+  double *Pts[IV_CURVE_NUM_COMPONENTS]; /**< Scaled B-spline of the samples */
+  double *Dist;         /**< Distances from the B-spline points of the samples to the reference */
+  double *MinBA;        /**< Least squared distance from each reference node to the B-spline nodes of the samples */
+  uint32_t *NearestBA;  /**< First nearest B-spline node of the samples for each reference node */
+  uint32_t *Nearest;    /**< Nearest reference node for each B-spline point of the samples */
+  double *Boxes;        /**< Bounding boxes of the reference nodes */
+  box_tree_t Tree;
+  int UseWindow;        /**< Non-zero if the boxes are used for the nearest node search */
+  basis_table_t Table;  /**< Basis table for ExpectedSize defining points */
+  uint32_t NumPoints;   /**< Number of evaluated B-spline points of the samples */
+  uint32_t LocMinItem;  /**< Nearest reference node of the last evaluated point */
+  double SumAB;         /**< Sum of the distances from the evaluated points to the reference */
+  ivcmp_prepared_t *Prepared; /**< Buffers for the prepared curve of the period */
+};
+
+/**
+ * Creates the streaming comparator with the reference curve
+ *
+ * @param Ctx comparison context, its scaling thresholds give the expected scales of the pair
+ * @param[in] Reference prepared reference curve, should live until the comparator is destroyed
+ * @param[in] MaxLength number of samples in a full period
+ * @param[out] StreamPtr comparator, should be destroyed with DestroyIVCStream()
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t CreateIVCStream(ivcmp_context_t *Ctx, const ivcmp_prepared_t *Reference, uint32_t MaxLength,
+                               ivcmp_stream_t **StreamPtr)
+{
+  uint32_t j;
+  size_t N, Size;
+  ivcmp_stream_t *Stream;
+  ivcmp_status_t Status;
+  workspace_t Ws;
+
+  if (!Ctx || !Reference || !StreamPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *StreamPtr = NULL;
+  if (MaxLength <= MIN_LEN_CURVE)
+  {
+    return IVCMP_ERROR_CURVE_TOO_SHORT;
+  }
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+  N = max(MaxLength, Reference->CurveLength);
+  Status = ReserveWorkspace(Ctx, (uint32_t)N, &Ws);
+  if (Status != IVCMP_OK)
+  {
+    return Status;
+  }
+
+  Size = sizeof(ivcmp_stream_t) +
+         (4 * ((size_t)MaxLength + 1) + (6 + ORDER) * N + 4 * BOX_TREE_SIZE(N)) * sizeof(double) +
+         3 * N * sizeof(uint32_t) + MaxLength;
+  Stream = (ivcmp_stream_t *)IvcMalloc(Size);
+  if (!Stream)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  Stream->Prepared = AllocPrepared(MaxLength);
+  if (!Stream->Prepared)
+  {
+    IvcFree(Stream);
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  Stream->Reference = Reference;
+  Stream->MaxLength = MaxLength;
+  Stream->CurveLength = (uint32_t)N;
+  Stream->MinVarV = Ctx->MinVarV;
+  Stream->MinVarC = Ctx->MinVarC;
+  Stream->VarV = max(Reference->SigmaV, Ctx->MinVarV);
+  Stream->VarC = max(Reference->SigmaC, Ctx->MinVarC);
+  Stream->Voltages = (double *)(Stream + 1);
+  Stream->Currents = Stream->Voltages + MaxLength + 1;
+  Stream->KeptV = Stream->Currents + MaxLength + 1;
+  Stream->KeptC = Stream->KeptV + MaxLength + 1;
+  Stream->Ref[0] = Stream->KeptC + MaxLength + 1;
+  Stream->Ref[1] = Stream->Ref[0] + N;
+  Stream->Pts[0] = Stream->Ref[1] + N;
+  Stream->Pts[1] = Stream->Pts[0] + N;
+  Stream->Dist = Stream->Pts[1] + N;
+  Stream->MinBA = Stream->Dist + N;
+  Stream->Table.Weights = Stream->MinBA + N;
+  Stream->Boxes = Stream->Table.Weights + ORDER * N;
+  Stream->NearestBA = (uint32_t *)(Stream->Boxes + 4 * BOX_TREE_SIZE(N));
+  Stream->Nearest = Stream->NearestBA + N;
+  Stream->Table.First = Stream->Nearest + N;
+  Stream->Kept = (uint8_t *)(Stream->Table.First + N);
+  memset(Stream->KeptV, 0, (MaxLength + 1) * sizeof(double));
+  memset(Stream->KeptC, 0, (MaxLength + 1) * sizeof(double));
+
+  /* The same B-spline of the reference is used by ComparePrepared() with the expected scales */
+  Status = GetScaledSpline(Reference, Stream->VarV, Stream->VarC, Stream->CurveLength, Ws.a_, &Ws);
+  if (Status != IVCMP_OK)
+  {
+    DestroyIVCStream(Stream);
+    return Status;
+  }
+  for (j = 0; j < N; j++)
+  {
+    Stream->Ref[0][j] = Ws.a_[0][j];
+    Stream->Ref[1][j] = Ws.a_[1][j];
+  }
+  Stream->UseWindow = N >= WINDOW_MIN_LEN_CURVE && BuildBoxTree(Stream->Ref, Stream->CurveLength, Stream->Boxes,
+                                                                 &Stream->Tree);
+  /* Periods of one pin usually have the same repeats as the reference */
+  Stream->ExpectedSize = Reference->CurveLength == MaxLength ? Reference->Size : MaxLength;
+  BuildBasisTable(Stream->ExpectedSize, Stream->CurveLength, &Stream->Table);
+  ResetIVCStream(Stream);
+  *StreamPtr = Stream;
+  return IVCMP_OK;
+}
+
+/**
+ * Destroys the streaming comparator
+ *
+ * @param Stream comparator, may be NULL
+ */
+void DestroyIVCStream(ivcmp_stream_t *Stream)
+{
+  if (!Stream)
+  {
+    return;
+  }
+  IvcFree(Stream->Prepared);
+  IvcFree(Stream);
+}
+
+/**
+ * Drops the samples of the current period
+ *
+ * @param Stream comparator
+ */
+void ResetIVCStream(ivcmp_stream_t *Stream)
+{
+  uint32_t j;
+  if (!Stream)
+  {
+    return;
+  }
+  Stream->Length = 0;
+  Stream->Size = 0;
+  Stream->NumPoints = 0;
+  Stream->LocMinItem = 0;
+  Stream->SumAB = 0;
+  /* Initial values of NearestNodeBrute() */
+  for (j = 0; j < Stream->CurveLength; j++)
+  {
+    Stream->MinBA[j] = 100000;
+    Stream->NearestBA[j] = UINT32_MAX;
+  }
+}
+
+/**
+ * Evaluates the next B-spline point of the samples and updates the distances in both directions
+ * the same way as DistCurvePts() does
+ *
+ * @param Stream comparator
+ */
+static void StreamPoint(ivcmp_stream_t *Stream)
+{
+  uint32_t j;
+  double v;
+  double pt[IV_CURVE_NUM_COMPONENTS];
+  const uint32_t i1 = Stream->NumPoints++;
+  const double *w = Stream->Table.Weights + ORDER * i1;
+  double **Ref = Stream->Ref;
+  double **Pts = Stream->Pts;
+
+  /* Scaled B-spline of the prepared curve, see GetScaledSpline() */
+  Pts[0][i1] = BsplinePoint(w, Stream->KeptV + Stream->Table.First[i1]) / Stream->VarV;
+  Pts[1][i1] = BsplinePoint(w, Stream->KeptC + Stream->Table.First[i1]) / Stream->VarC;
+  pt[0] = Pts[0][i1];
+  pt[1] = Pts[1][i1];
+
+  if (Stream->UseWindow)
+  {
+    Stream->LocMinItem = NearestNodeWindow(Ref, Stream->CurveLength, Stream->Boxes, &Stream->Tree, pt,
+                                           Stream->LocMinItem);
+  }
+  else
+  {
+    Stream->LocMinItem = NearestNodeBrute(Ref, Stream->CurveLength, pt, Stream->LocMinItem);
+  }
+  Stream->Nearest[i1] = Stream->LocMinItem;
+  SegDistScalar(Ref, Pts, Stream->CurveLength, i1, 1, Stream->Nearest, Stream->Dist);
+  Stream->SumAB += Stream->Dist[i1];
+
+  /* The new node is the last one checked by NearestNodeBrute() for each reference node */
+  for (j = 0; j < Stream->CurveLength; j++)
+  {
+    v = (Pts[0][i1] - Ref[0][j]) * (Pts[0][i1] - Ref[0][j]) + (Pts[1][i1] - Ref[1][j]) * (Pts[1][i1] - Ref[1][j]);
+    if (v < Stream->MinBA[j])
+    {
+      Stream->MinBA[j] = v;
+      Stream->NearestBA[j] = i1;
+    }
+  }
+}
+
+/**
+ * Keeps the sample for B-spline and evaluates the B-spline points whose defining samples are all kept
+ *
+ * @param Stream comparator
+ * @param[in] j number of the sample
+ */
+static void KeepStreamSample(ivcmp_stream_t *Stream, uint32_t j)
+{
+  /* Samples beyond the expected number mean that the assumption fails, they are not used */
+  if (Stream->Size >= Stream->ExpectedSize)
+  {
+    Stream->Size++;
+    return;
+  }
+  Stream->KeptV[Stream->Size] = Stream->Voltages[j];
+  Stream->KeptC[Stream->Size] = Stream->Currents[j];
+  Stream->Size++;
+  Stream->KeptV[Stream->Size] = 0.;
+  Stream->KeptC[Stream->Size] = 0.;
+
+  /* The last defining sample of the last points is the zero one after the kept samples */
+  while (Stream->NumPoints < Stream->CurveLength &&
+         min(Stream->Table.First[Stream->NumPoints] + ORDER - 1, Stream->ExpectedSize - 1) < Stream->Size)
+  {
+    StreamPoint(Stream);
+  }
+}
+
+/**
+ * Adds the sample to the current period. The previous sample is kept if it is not repeated by this one,
+ * see MarkRepeatsIvc().
+ *
+ * @param Stream comparator
+ * @param[in] Voltage voltage of the sample
+ * @param[in] Current current of the sample
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_INVALID_ARGUMENT if the period already has MaxLength samples
+ */
+ivcmp_status_t PushIVCStreamSample(ivcmp_stream_t *Stream, double Voltage, double Current)
+{
+  if (!Stream)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Stream->Length >= Stream->MaxLength)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  Stream->Voltages[Stream->Length] = Voltage;
+  Stream->Currents[Stream->Length] = Current;
+  Stream->Length++;
+  if (Stream->Length > 1 &&
+      ((Abs(Voltage / Stream->VarV - Stream->Voltages[Stream->Length - 2] / Stream->VarV) > 1.e-6) |
+       (Abs(Current / Stream->VarC - Stream->Currents[Stream->Length - 2] / Stream->VarC) > 1.e-6)))
+  {
+    KeepStreamSample(Stream, Stream->Length - 2);
+  }
+  return IVCMP_OK;
+}
+
+/**
+ * Returns the estimate of the score from the distances of the evaluated B-spline points to the reference
+ *
+ * @param[in] Stream comparator
+ * @param[out] ScorePtr estimate of the score; SCORE_ERROR if no points are evaluated yet
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t GetIVCStreamPartialScore(const ivcmp_stream_t *Stream, double *ScorePtr)
+{
+  if (!Stream || !ScorePtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Stream->NumPoints == 0)
+  {
+    *ScorePtr = SCORE_ERROR;
+    return IVCMP_ERROR_CURVE_TOO_SHORT;
+  }
+  *ScorePtr = RescaleScore(Stream->SumAB / Stream->NumPoints);
+  return IVCMP_OK;
+}
+
+/**
+ * Evaluates the score from the distances accumulated during the period
+ * if the assumptions of the comparator hold for the samples of the full period
+ *
+ * @param Ctx comparison context
+ * @param Stream comparator with MaxLength samples
+ * @param[out] ScorePtr score, the same as ComparePrepared() gives
+ *
+ * @return 1 if the score is evaluated, 0 if the period should be compared in the usual way
+ */
+static int FinishStreamEarly(const ivcmp_context_t *Ctx, ivcmp_stream_t *Stream, double *ScorePtr)
+{
+  uint32_t j;
+  double SigmaV, SigmaC, VarV, VarC, DistAB;
+  double DistBA = 0.0;
+  const uint32_t N = Stream->MaxLength;
+
+  if (Stream->Length != N || Stream->CurveLength != N || Ctx->Precision != IVCMP_PRECISION_DOUBLE ||
+      Ctx->MinVarV != Stream->MinVarV || Ctx->MinVarC != Stream->MinVarC)
+  {
+    return 0;
+  }
+  /* Scales of the pair, see FillPrepared() and ComparePrepared() */
+  SigmaV = sqrt(Disp(Stream->Voltages, N));
+  SigmaC = sqrt(Disp(Stream->Currents, N));
+  VarV = max(max(Stream->Reference->SigmaV, SigmaV), Ctx->MinVarV);
+  VarC = max(max(Stream->Reference->SigmaC, SigmaC), Ctx->MinVarC);
+  if (VarV != Stream->VarV || VarC != Stream->VarC)
+  {
+    return 0;
+  }
+  /* The last sample is always kept */
+  KeepStreamSample(Stream, N - 1);
+  if (Stream->Size != Stream->ExpectedSize || Stream->NumPoints != N)
+  {
+    return 0;
+  }
+  /* The kept samples are the same with the own scales, otherwise B-spline of the scaled samples is compared */
+  MarkRepeatsIvc(Stream->Voltages, Stream->Currents, N, VarV, VarC, Stream->Kept);
+  MarkRepeatsIvc(Stream->Voltages, Stream->Currents, N, max(SigmaV, Ctx->MinVarV), max(SigmaC, Ctx->MinVarC),
+                 PREPARED_KEPT(Stream->Prepared));
+  if (memcmp(Stream->Kept, PREPARED_KEPT(Stream->Prepared), N) != 0)
+  {
+    return 0;
+  }
+  for (j = 0; j < N; j++)
+  {
+    if (Stream->NearestBA[j] == UINT32_MAX)
+    {
+      return 0;
+    }
+  }
+
+  DistAB = Stream->SumAB / N;
+  SegDistScalar(Stream->Pts, Stream->Ref, N, 0, N, Stream->NearestBA, Stream->Dist);
+  for (j = 0; j < N; j++)
+  {
+    DistBA += Stream->Dist[j];
+  }
+  DistBA /= N;
+  *ScorePtr = RescaleScore((DistAB + DistBA) / 2.);
+  return 1;
+}
+
+/**
+ * Compares the samples of the period with the reference and starts the next period.
+ * The score is the same as CompareIVCPrepared() gives for the reference and the prepared samples.
+ *
+ * @param Ctx comparison context
+ * @param Stream comparator
+ * @param[out] ScorePtr score of difference; SCORE_ERROR if comparison failed.
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t FinishIVCStream(ivcmp_context_t *Ctx, ivcmp_stream_t *Stream, double *ScorePtr)
+{
+  uint32_t Size;
+  ivcmp_status_t Status = IVCMP_OK;
+
+  if (!Ctx || !Stream || !ScorePtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *ScorePtr = SCORE_ERROR;
+  if (Stream->Length <= MIN_LEN_CURVE)
+  {
+    Status = IVCMP_ERROR_CURVE_TOO_SHORT;
+  }
+  else if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    Status = IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+  else if (!FinishStreamEarly(Ctx, Stream, ScorePtr))
+  {
+    Status = FillPrepared(Ctx, Stream->Prepared, Stream->Voltages, Stream->Currents, Stream->Length,
+                          Ctx->MinVarV, Ctx->MinVarC);
+    if (Status == IVCMP_OK)
+    {
+      Status = ComparePrepared(Ctx, Stream->Reference, Stream->Prepared, 1., ScorePtr);
+    }
+  }
+  if (Stream->Length == Stream->MaxLength)
+  {
+    /* The next period is expected to have the same repeats */
+    Size = MarkRepeatsIvc(Stream->Voltages, Stream->Currents, Stream->Length, Stream->VarV, Stream->VarC,
+                          Stream->Kept);
+    if (Size != Stream->ExpectedSize && Size > MIN_LEN_CURVE)
+    {
+      Stream->ExpectedSize = Size;
+      BuildBasisTable(Size, Stream->CurveLength, &Stream->Table);
+    }
+  }
+  ResetIVCStream(Stream);
+  return Status;
+}
+
+
+/* ******************************* */
+/*    Signature store              */
+/* ******************************* */
+
+/**
+ * Header at the beginning of the signature store file. Until the writer is closed the magic is zero.
+ */
+typedef struct
+{
+  char Magic[8];          /**< StoreFileMagic */
+  uint32_t Version;       /**< STORE_FILE_VERSION */
+  uint32_t ByteOrder;     /**< STORE_BYTE_ORDER in the byte order of the writer */
+  uint32_t PreparedSize;  /**< Size of ivcmp_prepared_t of the writer, 0 if prepared curves are not stored */
+  uint32_t NumCurves;     /**< Number of curves */
+  uint64_t EntriesOffset; /**< Offset of the table of the curves */
+  uint64_t FileSize;      /**< Size of the file */
+} store_header_t;
+
+/**
+ * Curve in the table of the signature store. Offsets are given from the beginning of the file.
+ */
+typedef struct
+{
+  uint64_t VoltagesOffset;  /**< Offset of the voltages */
+  uint64_t CurrentsOffset;  /**< Offset of the currents */
+  uint64_t PreparedOffset;  /**< Offset of the prepared curve, 0 if it is not stored */
+  uint32_t CurveLength;     /**< Number of points */
+  uint32_t Reserved;        /**< Zero */
+  double MinVarV;           /**< Scaling thresholds the curve is prepared with */
+  double MinVarC;
+  ivcmp_measure_settings_t Settings; /**< Measure settings */
+} store_entry_t;
+
+struct ivcmp_store_writer_s
+{
+  FILE *File;             /**< File */
+  uint64_t Offset;        /**< Size of the written part of the file */
+  int WithPrepared;       /**< Non-zero if the prepared curves are stored */
+  int Failed;             /**< Non-zero after a write error */
+  store_entry_t *Entries; /**< Table of the written curves */
+  uint32_t NumCurves;     /**< Number of the written curves */
+  uint32_t Capacity;      /**< Number of the curves the table can store */
+};
+
+struct ivcmp_store_s
+{
+  ivc_file_map_t Map;           /**< Mapped file */
+  const store_entry_t *Entries; /**< Table of the curves */
+  uint32_t NumCurves;           /**< Number of curves */
+  int HasPrepared;              /**< Non-zero if the prepared curves are stored with the same layout */
+};
+
+static const char StoreFileMagic[8] = {'I', 'V', 'C', 'M', 'P', 'S', 'I', 'G'};
+
+/**
+ * Writes the values to the store file keeping track of its size
+ *
+ * @param Writer writer
+ * @param[in] Values values, NULL for zeros
+ * @param[in] Size size of the values in bytes
+ *
+ * @return 1 if the values are written
+ */
+static int WriteStoreValues(ivcmp_store_writer_t *Writer, const void *Values, size_t Size)
+{
+  static const char Zeros[STORE_ALIGNMENT] = {0};
+  size_t Part;
+  if (!Values)
+  {
+    for (; Size > 0; Size -= Part)
+    {
+      Part = min(Size, sizeof(Zeros));
+      if (!WriteValues(Writer->File, Zeros, 1, Part))
+      {
+        return 0;
+      }
+      Writer->Offset += Part;
+    }
+    return 1;
+  }
+  if (Size > 0 && !WriteValues(Writer->File, Values, 1, Size))
+  {
+    return 0;
+  }
+  Writer->Offset += Size;
+  return 1;
+}
+
+/**
+ * Pads the store file with zeros up to the alignment of the arrays
+ *
+ * @param Writer writer
+ *
+ * @return 1 if the padding is written
+ */
+static int AlignStoreFile(ivcmp_store_writer_t *Writer)
+{
+  return WriteStoreValues(Writer, NULL, (size_t)((STORE_ALIGNMENT - Writer->Offset % STORE_ALIGNMENT) %
+                                                 STORE_ALIGNMENT));
+}
+
+/**
+ * Creates the signature store file. Its header is written by CloseIVCStoreWriter(),
+ * so the file stays invalid until all the curves are added.
+ *
+ * @param[in] FileName name of the file
+ * @param[in] WithPrepared non-zero to store the prepared curves
+ * @param[out] WriterPtr writer, should be closed with CloseIVCStoreWriter()
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t CreateIVCStoreWriter(const char *FileName, int WithPrepared, ivcmp_store_writer_t **WriterPtr)
+{
+  ivcmp_store_writer_t *Writer;
+
+  if (!FileName || !WriterPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *WriterPtr = NULL;
+  Writer = (ivcmp_store_writer_t *)IvcMalloc(sizeof(ivcmp_store_writer_t));
+  if (!Writer)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  Writer->File = NULL;
+  Writer->Offset = 0;
+  Writer->WithPrepared = WithPrepared != 0;
+  Writer->Failed = 0;
+  Writer->Entries = NULL;
+  Writer->NumCurves = 0;
+  Writer->Capacity = 0;
+  OPEN_FILE(Writer->File, FileName, "wb");
+  if (!Writer->File)
+  {
+    IvcFree(Writer);
+    return IVCMP_ERROR_FILE_IO;
+  }
+  if (!WriteStoreValues(Writer, NULL, sizeof(store_header_t)) || !AlignStoreFile(Writer))
+  {
+    fclose(Writer->File);
+    IvcFree(Writer);
+    return IVCMP_ERROR_FILE_IO;
+  }
+  *WriterPtr = Writer;
+  return IVCMP_OK;
+}
+
+/**
+ * Adds the curve to the signature store file: the prepared curve with the copy of the curve
+ * or the curve only
+ *
+ * @param Ctx comparison context, its scaling thresholds are used for preparation
+ * @param Writer writer
+ * @param[in] Voltages voltages of the curve
+ * @param[in] Currents currents of the curve
+ * @param[in] CurveLength number of points in the curve
+ * @param[in] Settings measure settings of the curve, may be NULL
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t AddIVCStoreCurve(ivcmp_context_t *Ctx, ivcmp_store_writer_t *Writer, double *Voltages,
+                                double *Currents, uint32_t CurveLength, const ivcmp_measure_settings_t *Settings)
+{
+  ivcmp_prepared_t *Prepared = NULL;
+  store_entry_t *Entry;
+  store_entry_t *NewEntries;
+  uint32_t NewCapacity;
+  ivcmp_status_t Status;
+  int Ok;
+
+  if (!Ctx || !Writer || !Voltages || !Currents)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Writer->Failed)
+  {
+    return IVCMP_ERROR_FILE_IO;
+  }
+  if (CurveLength <= MIN_LEN_CURVE)
+  {
+    return IVCMP_ERROR_CURVE_TOO_SHORT;
+  }
+  if (Ctx->MinVarC <= 0 || Ctx->MinVarV <= 0)
+  {
+    return IVCMP_ERROR_INVALID_MIN_VAR;
+  }
+  if (Writer->NumCurves == UINT32_MAX)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  if (Writer->NumCurves == Writer->Capacity)
+  {
+    NewCapacity = Writer->Capacity < UINT32_MAX / 2 - 64 ? Writer->Capacity * 2 + 64 : UINT32_MAX;
+    NewEntries = (store_entry_t *)IvcMalloc((size_t)NewCapacity * sizeof(store_entry_t));
+    if (!NewEntries)
+    {
+      return IVCMP_ERROR_NO_MEMORY;
+    }
+    if (Writer->NumCurves > 0)
+    {
+      memcpy(NewEntries, Writer->Entries, Writer->NumCurves * sizeof(store_entry_t));
+    }
+    IvcFree(Writer->Entries);
+    Writer->Entries = NewEntries;
+    Writer->Capacity = NewCapacity;
+  }
+  if (Writer->WithPrepared)
+  {
+    Status = PrepareCurve(Ctx, Voltages, Currents, CurveLength, Ctx->MinVarV, Ctx->MinVarC, &Prepared);
+    if (Status != IVCMP_OK)
+    {
+      return Status;
+    }
+  }
+
+  Entry = &Writer->Entries[Writer->NumCurves];
+  memset(Entry, 0, sizeof(store_entry_t));
+  Entry->CurveLength = CurveLength;
+  Entry->MinVarV = Ctx->MinVarV;
+  Entry->MinVarC = Ctx->MinVarC;
+  if (Settings)
+  {
+    Entry->Settings = *Settings;
+  }
+  if (Prepared)
+  {
+    /* The prepared curve holds the copy of the curve, so it is not stored twice */
+    Entry->PreparedOffset = Writer->Offset;
+    Entry->VoltagesOffset = Writer->Offset + (uint64_t)((char *)PREPARED_VOLTAGES(Prepared) - (char *)Prepared);
+    Entry->CurrentsOffset = Writer->Offset + (uint64_t)((char *)PREPARED_CURRENTS(Prepared) - (char *)Prepared);
+    Ok = WriteStoreValues(Writer, Prepared, sizeof(ivcmp_prepared_t) + 4 * (size_t)CurveLength * sizeof(double) +
+                                            CurveLength);
+    DestroyPreparedIVC(Prepared);
+  }
+  else
+  {
+    Entry->VoltagesOffset = Writer->Offset;
+    Entry->CurrentsOffset = Writer->Offset + CurveLength * sizeof(double);
+    Ok = WriteStoreValues(Writer, Voltages, CurveLength * sizeof(double)) &&
+         WriteStoreValues(Writer, Currents, CurveLength * sizeof(double));
+  }
+  if (!Ok || !AlignStoreFile(Writer))
+  {
+    Writer->Failed = 1;
+    return IVCMP_ERROR_FILE_IO;
+  }
+  Writer->NumCurves++;
+  return IVCMP_OK;
+}
+
+/**
+ * Writes the table of the curves and the header, closes the file and destroys the writer
+ *
+ * @param Writer writer
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t CloseIVCStoreWriter(ivcmp_store_writer_t *Writer)
+{
+  store_header_t Header;
+  int Ok;
+
+  if (!Writer)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  memset(&Header, 0, sizeof(Header));
+  memcpy(Header.Magic, StoreFileMagic, sizeof(StoreFileMagic));
+  Header.Version = STORE_FILE_VERSION;
+  Header.ByteOrder = STORE_BYTE_ORDER;
+  Header.PreparedSize = Writer->WithPrepared ? (uint32_t)sizeof(ivcmp_prepared_t) : 0;
+  Header.NumCurves = Writer->NumCurves;
+  Header.EntriesOffset = Writer->Offset;
+  Header.FileSize = Writer->Offset + (uint64_t)Writer->NumCurves * sizeof(store_entry_t);
+  Ok = !Writer->Failed &&
+       WriteStoreValues(Writer, Writer->Entries, Writer->NumCurves * sizeof(store_entry_t)) &&
+       fseek(Writer->File, 0, SEEK_SET) == 0 &&
+       WriteValues(Writer->File, &Header, sizeof(Header), 1);
+  if (fclose(Writer->File) != 0)
+  {
+    Ok = 0;
+  }
+  IvcFree(Writer->Entries);
+  IvcFree(Writer);
+  return Ok ? IVCMP_OK : IVCMP_ERROR_FILE_IO;
+}
+
+/**
+ * Checks that the part of the mapped store file exists and is aligned for doubles
+ *
+ * @param[in] Store store
+ * @param[in] Offset offset of the part
+ * @param[in] Size size of the part
+ *
+ * @return 1 if the part is inside the file
+ */
+static int IsInStore(const ivcmp_store_t *Store, uint64_t Offset, uint64_t Size)
+{
+  return Offset <= Store->Map.Size && Size <= Store->Map.Size - Offset && Offset % sizeof(double) == 0;
+}
+
+/**
+ * Opens the signature store: maps the file and checks its header.
+ * Curves are checked when they are accessed, so opening does not touch them.
+ *
+ * @param[in] FileName name of the file
+ * @param[out] StorePtr store, should be closed with CloseIVCStore()
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t OpenIVCStore(const char *FileName, ivcmp_store_t **StorePtr)
+{
+  ivcmp_store_t *Store;
+  const store_header_t *Header;
+
+  if (!FileName || !StorePtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *StorePtr = NULL;
+  Store = (ivcmp_store_t *)IvcMalloc(sizeof(ivcmp_store_t));
+  if (!Store)
+  {
+    return IVCMP_ERROR_NO_MEMORY;
+  }
+  if (!IvcMapFile(FileName, &Store->Map))
+  {
+    IvcFree(Store);
+    return IVCMP_ERROR_FILE_IO;
+  }
+  Header = (const store_header_t *)Store->Map.Data;
+  if (Store->Map.Size < sizeof(store_header_t) ||
+      memcmp(Header->Magic, StoreFileMagic, sizeof(StoreFileMagic)) != 0 ||
+      Header->Version != STORE_FILE_VERSION || Header->ByteOrder != STORE_BYTE_ORDER ||
+      Header->FileSize != Store->Map.Size ||
+      !IsInStore(Store, Header->EntriesOffset, (uint64_t)Header->NumCurves * sizeof(store_entry_t)))
+  {
+    CloseIVCStore(Store);
+    return IVCMP_ERROR_INVALID_FILE;
+  }
+  Store->Entries = (const store_entry_t *)((const char *)Store->Map.Data + Header->EntriesOffset);
+  Store->NumCurves = Header->NumCurves;
+  Store->HasPrepared = Header->PreparedSize == sizeof(ivcmp_prepared_t);
+  *StorePtr = Store;
+  return IVCMP_OK;
+}
+
+/**
+ * Closes the signature store and unmaps its file
+ *
+ * @param Store store, may be NULL
+ */
+void CloseIVCStore(ivcmp_store_t *Store)
+{
+  if (!Store)
+  {
+    return;
+  }
+  IvcUnmapFile(&Store->Map);
+  IvcFree(Store);
+}
+
+/**
+ * Gives the number of curves in the signature store
+ *
+ * @param[in] Store store
+ *
+ * @return number of curves
+ */
+uint32_t GetIVCStoreSize(const ivcmp_store_t *Store)
+{
+  return Store ? Store->NumCurves : 0;
+}
+
+/**
+ * Gives the curve of the signature store pointing to the mapped file
+ *
+ * @param[in] Store store
+ * @param[in] Index number of the curve
+ * @param[out] VoltagesPtr voltages
+ * @param[out] CurrentsPtr currents
+ * @param[out] CurveLengthPtr number of points
+ * @param[out] SettingsPtr measure settings, may be NULL
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t GetIVCStoreCurve(const ivcmp_store_t *Store, uint32_t Index, const double **VoltagesPtr,
+                                const double **CurrentsPtr, uint32_t *CurveLengthPtr,
+                                ivcmp_measure_settings_t *SettingsPtr)
+{
+  const store_entry_t *Entry;
+
+  if (!Store || !VoltagesPtr || !CurrentsPtr || !CurveLengthPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  if (Index >= Store->NumCurves)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  Entry = &Store->Entries[Index];
+  if (!IsInStore(Store, Entry->VoltagesOffset, (uint64_t)Entry->CurveLength * sizeof(double)) ||
+      !IsInStore(Store, Entry->CurrentsOffset, (uint64_t)Entry->CurveLength * sizeof(double)))
+  {
+    return IVCMP_ERROR_INVALID_FILE;
+  }
+  *VoltagesPtr = (const double *)((const char *)Store->Map.Data + Entry->VoltagesOffset);
+  *CurrentsPtr = (const double *)((const char *)Store->Map.Data + Entry->CurrentsOffset);
+  *CurveLengthPtr = Entry->CurveLength;
+  if (SettingsPtr)
+  {
+    *SettingsPtr = Entry->Settings;
+  }
+  return IVCMP_OK;
+}
+
+/**
+ * Gives the prepared curve of the signature store pointing to the mapped file
+ *
+ * @param[in] Store store
+ * @param[in] Index number of the curve
+ * @param[out] PreparedPtr prepared curve
+ *
+ * @return IVCMP_OK or error code
+ */
+ivcmp_status_t GetIVCStorePrepared(const ivcmp_store_t *Store, uint32_t Index, const ivcmp_prepared_t **PreparedPtr)
+{
+  const store_entry_t *Entry;
+  const ivcmp_prepared_t *Prepared;
+
+  if (!Store || !PreparedPtr)
+  {
+    return IVCMP_ERROR_NULL_POINTER;
+  }
+  *PreparedPtr = NULL;
+  if (Index >= Store->NumCurves)
+  {
+    return IVCMP_ERROR_INVALID_ARGUMENT;
+  }
+  Entry = &Store->Entries[Index];
+  if (!Store->HasPrepared || Entry->PreparedOffset == 0 ||
+      !IsInStore(Store, Entry->PreparedOffset,
+                 sizeof(ivcmp_prepared_t) + (uint64_t)Entry->CurveLength * (4 * sizeof(double) + 1)))
+  {
+    return IVCMP_ERROR_INVALID_FILE;
+  }
+  Prepared = (const ivcmp_prepared_t *)((const char *)Store->Map.Data + Entry->PreparedOffset);
+  if (Prepared->CurveLength != Entry->CurveLength || Prepared->Capacity != Entry->CurveLength ||
+      Prepared->CurveLength <= MIN_LEN_CURVE || Prepared->Size < MIN_LEN_CURVE ||
+      Prepared->Size > Prepared->CurveLength)
+  {
+    return IVCMP_ERROR_INVALID_FILE;
+  }
+  *PreparedPtr = Prepared;
+  return IVCMP_OK;
+}
@@ -10,6 +10,7 @@ extern "C"
 {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 #if defined(_WIN32) || defined (_WIN64)
 #define EXPORT __declspec(dllexport)
@@ -19,6 +20,203 @@ extern "C"
 #define CCONV
 #endif
 
+/**
+ * Коды результата функций библиотеки.
+ */
+typedef enum
+{
+  IVCMP_OK = 0,                     /**< Успешное выполнение. */
+  IVCMP_ERROR_NULL_POINTER = 1,     /**< Передан нулевой указатель. */
+  IVCMP_ERROR_CURVE_TOO_SHORT = 2,  /**< Слишком мало точек в кривой. */
+  IVCMP_ERROR_INVALID_MIN_VAR = 3,  /**< Пороги масштабирования не заданы или некорректны. */
+  IVCMP_ERROR_IDENTICAL_POINTS = 4, /**< Все точки кривой совпадают. */
+  IVCMP_ERROR_NO_MEMORY = 5,        /**< Недостаточно памяти. */
+  IVCMP_ERROR_WORKSPACE_TOO_SMALL = 6, /**< Рабочая область контекста слишком мала для кривых. */
+  IVCMP_ERROR_UNSUPPORTED_KERNEL = 7, /**< Ядро вычислений не поддерживается процессором или сборкой. */
+  IVCMP_ERROR_INVALID_ARGUMENT = 8,   /**< Недопустимое значение параметра. */
+  IVCMP_ERROR_FILE_IO = 9,            /**< Не удалось открыть, прочитать или записать файл. */
+  IVCMP_ERROR_INVALID_FILE = 10,      /**< Формат файла не поддерживается или файл повреждён. */
+  IVCMP_ERROR_NOT_SUPPORTED = 11      /**< Возможность отключена при сборке библиотеки. */
+} ivcmp_status_t;
+
+/**
+ * Ядра вычисления расстояний между кривыми.
+ * Все ядра дают одинаковый результат и отличаются только скоростью.
+ */
+typedef enum
+{
+  IVCMP_KERNEL_SCALAR = 0, /**< Без векторных инструкций. */
+  IVCMP_KERNEL_AVX2 = 1,   /**< Векторные инструкции AVX2. */
+  IVCMP_KERNEL_AVX512 = 2  /**< Векторные инструкции AVX-512F. */
+} ivcmp_kernel_t;
+
+/**
+ * Точность вычисления расстояний между кривыми.
+ * Нормировка и B-сплайн всегда вычисляются с двойной точностью.
+ */
+typedef enum
+{
+  IVCMP_PRECISION_DOUBLE = 0, /**< Двойная точность (по умолчанию). */
+  IVCMP_PRECISION_FLOAT = 1   /**< Одинарная точность: быстрее, степень различия отличается не более чем на 0.005. */
+} ivcmp_precision_t;
+
+/**
+ * Формат матрицы степеней различия, см. CompareIVCMatrix().
+ */
+typedef enum
+{
+  IVCMP_MATRIX_FULL = 0,  /**< Полная матрица NumCurves x NumCurves по строкам. */
+  IVCMP_MATRIX_PACKED = 1 /**< Элементы над главной диагональью по строкам: (0, 1), (0, 2), ..., (1, 2), ...
+                               Всего NumCurves * (NumCurves - 1) / 2 элементов. */
+} ivcmp_matrix_layout_t;
+
+/**
+ * Результат проверки степени различия по порогу, см. CompareIVCThreshold().
+ */
+typedef enum
+{
+  IVCMP_VERDICT_PASS = 0, /**< Степень различия не превышает порог. */
+  IVCMP_VERDICT_FAIL = 1  /**< Степень различия превышает порог или кривые не удалось сравнить. */
+} ivcmp_verdict_t;
+
+/**
+ * Контекст сравнения.
+ * Хранит пороги масштабирования и рабочие буферы сравнения.
+ * Функции, принимающие контекст, можно одновременно вызывать из разных потоков,
+ * если каждый поток использует собственный контекст.
+ * Функции без параметра контекста работают с общим контекстом по умолчанию.
+ */
+typedef struct ivcmp_context_s ivcmp_context_t;
+
+/**
+ * Подготовленная к сравнению кривая.
+ * Хранит копию кривой и результаты её предварительной обработки
+ * (дисперсии, удаление повторов, B-сплайн), которые не зависят от второй кривой.
+ * Подготовленную кривую можно одновременно использовать в разных потоках.
+ */
+typedef struct ivcmp_prepared_s ivcmp_prepared_t;
+
+/**
+ * Индекс для поиска наиболее похожих кривых в библиотеке эталонных сигнатур, см. BuildIVCIndex().
+ * Индекс можно одновременно использовать в разных потоках.
+ */
+typedef struct ivcmp_index_s ivcmp_index_t;
+
+/**
+ * Потоковый компаратор: сравнивает с эталоном отсчёты периода пробного сигнала по мере их поступления,
+ * см. CreateIVCStream().
+ */
+typedef struct ivcmp_stream_s ivcmp_stream_t;
+
+/**
+ * Хранилище сигнатур: файл с кривыми, параметрами их измерения и подготовленными кривыми,
+ * отображаемый в память, см. OpenIVCStore().
+ * Хранилище можно одновременно использовать в разных потоках.
+ */
+typedef struct ivcmp_store_s ivcmp_store_t;
+
+/**
+ * Запись файла хранилища сигнатур, см. CreateIVCStoreWriter().
+ */
+typedef struct ivcmp_store_writer_s ivcmp_store_writer_t;
+
+/**
+ * Параметры измерения кривой (measure_settings файлов плат EyePoint).
+ */
+typedef struct
+{
+  double ProbeSignalFrequency; /**< Частота пробного сигнала [Гц] */
+  double MaxVoltage;           /**< Амплитуда напряжения пробного сигнала [Вольты] */
+  double MaxCurrent;           /**< Предел измерения тока [мА] */
+  double DescFrequency;        /**< Частота дискретизации [Гц] */
+  uint32_t NumPoints;          /**< Количество точек в периоде */
+  uint32_t NumChargePoints;    /**< Количество точек предварительного заряда */
+  uint32_t Flags;              /**< Флаги измерения */
+  uint32_t Reserved;           /**< Не используется, 0 */
+} ivcmp_measure_settings_t;
+
+/**
+ * Этапы сравнения, время которых измеряется при включённых таймерах статистики, см. SetIVCStatsTimers().
+ */
+typedef enum
+{
+  IVCMP_STAGE_NORMALIZE = 0,      /**< Копирование кривых, вычисление разбросов и нормировка. */
+  IVCMP_STAGE_REMOVE_REPEATS = 1, /**< Удаление повторяющихся точек. */
+  IVCMP_STAGE_BSPLINE = 2,        /**< Построение B-сплайна. */
+  IVCMP_STAGE_DISTANCE = 3        /**< Вычисление расстояний между кривыми. */
+} ivcmp_stage_t;
+
+#define IVCMP_NUM_STAGES 4 /**< Количество этапов сравнения в ivcmp_stage_t */
+
+/**
+ * Статистика работы библиотеки во всех потоках процесса, см. GetIVCStats().
+ * Все поля - счётчики типа uint64_t.
+ */
+typedef struct
+{
+  uint64_t Comparisons;       /**< Выполненные сравнения пар кривых */
+  uint64_t PreparedCurves;    /**< Подготовленные кривые */
+  uint64_t ShortCurves;       /**< Кривые, отклонённые из-за малого количества точек (IVCMP_ERROR_CURVE_TOO_SHORT) */
+  uint64_t IdenticalCurves;   /**< Кривые, отклонённые из-за совпадения точек (IVCMP_ERROR_IDENTICAL_POINTS) */
+  uint64_t CurvesWithRepeats; /**< Кривые, в которых были удалены повторяющиеся точки */
+  uint64_t RepeatsRemoved;    /**< Всего удалено повторяющихся точек */
+  uint64_t MinVarVClamped;    /**< Сравнения, в которых разброс напряжений меньше порога MinVarV */
+  uint64_t MinVarCClamped;    /**< Сравнения, в которых разброс токов меньше порога MinVarC */
+  uint64_t ThresholdCutoffs;  /**< Сравнения, остановленные досрочно по порогу степени различия */
+  uint64_t StageCalls[IVCMP_NUM_STAGES]; /**< Количество измерений времени каждого этапа */
+  uint64_t StageTime[IVCMP_NUM_STAGES];  /**< Суммарное время каждого этапа [нс] */
+} ivcmp_stats_t;
+
+/**
+ * Счётчики кэша результатов сравнения, см. SetIVCCacheCapacity().
+ */
+typedef struct
+{
+  uint64_t Hits;      /**< Сравнения, степень различия которых найдена в кэше */
+  uint64_t Misses;    /**< Сравнения, степень различия которых вычислена и помещена в кэш */
+  uint64_t Evictions; /**< Степени различия, вытесненные из заполненного кэша */
+  uint32_t Entries;   /**< Количество степеней различия в кэше */
+  uint32_t Capacity;  /**< Наибольшее количество степеней различия в кэше, 0 - кэш выключен */
+} ivcmp_cache_stats_t;
+
+/**
+ * Этапы сравнения, передаваемые функции захвата, см. SetContextCapture().
+ * Этапы следуют в порядке перечисления, для каждой кривой - своя запись.
+ */
+typedef enum
+{
+  IVCMP_CAPTURE_INPUT = 0,           /**< Входные кривые. Первая запись каждого сравнения - кривая A. */
+  IVCMP_CAPTURE_COPIED = 1,          /**< Кривые, скопированные в рабочую область. */
+  IVCMP_CAPTURE_VARIATIONS = 2,      /**< Значения: масштабы нормировки по напряжению и току. */
+  IVCMP_CAPTURE_SCALED = 3,          /**< Кривые после масштабирования. */
+  IVCMP_CAPTURE_REPEATS_REMOVED = 4, /**< Кривые после устранения повторов. */
+  IVCMP_CAPTURE_SPLINED = 5,         /**< Кривые после равномерного распределения точек B-сплайном. */
+  IVCMP_CAPTURE_SCORE = 6            /**< Значения: расстояния от A до B, от B до A и степень различия. */
+} ivcmp_capture_stage_t;
+
+/**
+ * Запись этапа сравнения, передаваемая функции захвата. Массивы действительны только во время вызова.
+ */
+typedef struct
+{
+  uint32_t Stage;          /**< Этап, ivcmp_capture_stage_t */
+  uint32_t Curve;          /**< 0 - кривая A, 1 - кривая B; 0 для значений */
+  uint32_t Length;         /**< Количество точек кривой или значений */
+  const double *Voltages;  /**< Напряжения кривой или значения этапа */
+  const double *Currents;  /**< Токи кривой, NULL для значений */
+} ivcmp_capture_record_t;
+
+/**
+ * Функция захвата этапов сравнения, см. SetContextCapture().
+ */
+typedef void (CCONV *ivcmp_capture_func_t)(void *User, const ivcmp_capture_record_t *Record);
+
+/**
+ * Функции выделения и освобождения памяти, см. SetIVCAllocator().
+ */
+typedef void *(CCONV *ivcmp_malloc_t)(size_t Size);
+typedef void (CCONV *ivcmp_free_t)(void *Ptr);
+
 /** 
  * Функция установки порогов масштабирования при нормировке токов и напряжений.
  * Установка этих параметров обязательна для корректной работы библиотеки.
@@ -84,6 +282,24 @@ EXPORT void CCONV SetMinVarVCFromCurves(double *VoltagesOpenC, double *CurrentsO
  */
 EXPORT void CCONV GetMinVarVC(double *NewMinVarVPtr, double *NewMinVarCPtr);
 
+/**
+ * Функция установки точности вычисления расстояний между кривыми.
+ * Одинарная точность ускоряет сравнение длинных кривых,
+ * степень различия при этом отличается от вычисленной с двойной точностью не более чем на 0.005
+ * (проверяется скриптом advanced_tests/test_precision.py).
+ *
+ * @param[in] Precision Точность вычислений.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SetIVCPrecision(ivcmp_precision_t Precision);
+
+/**
+ * Функция для получения текущей точности вычисления расстояний между кривыми.
+ *
+ * @return Точность вычислений.
+ */
+EXPORT ivcmp_precision_t CCONV GetIVCPrecision(void);
+
 /**
  * Функция для сравнения двух сигнатур (ВАХ).
  * Возвращает степень различия в диапазоне [0, 1]
@@ -108,6 +324,736 @@ EXPORT void CCONV GetMinVarVC(double *NewMinVarVPtr, double *NewMinVarCPtr);
  */
 EXPORT double CCONV CompareIVC(double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
                                double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB);
+
+/**
+ * Функция создания контекста сравнения.
+ * Пороги масштабирования нового контекста не заданы,
+ * их необходимо установить функцией SetContextMinVarVC() или SetContextMinVarVCFromCurves().
+ *
+ * @return Указатель на новый контекст или NULL, если не хватило памяти.
+ */
+EXPORT ivcmp_context_t * CCONV CreateIVCContext(void);
+
+/**
+ * Функция удаления контекста сравнения, созданного функцией CreateIVCContext().
+ *
+ * @param[in] Ctx Контекст сравнения (допускается NULL).
+ */
+EXPORT void CCONV DestroyIVCContext(ivcmp_context_t *Ctx);
+
+/**
+ * Функция установки функций выделения и освобождения памяти, которые использует библиотека.
+ * Вызывать следует до создания контекстов и подготовленных кривых:
+ * память должна освобождаться той же функцией, которой выделялась.
+ *
+ * @param[in] NewMallocFunc Функция выделения памяти (NULL - стандартная malloc()).
+ * @param[in] NewFreeFunc Функция освобождения памяти (NULL - стандартная free()).
+ */
+EXPORT void CCONV SetIVCAllocator(ivcmp_malloc_t NewMallocFunc, ivcmp_free_t NewFreeFunc);
+
+/**
+ * Функция для получения размера рабочей области контекста,
+ * достаточной для сравнения кривых заданной максимальной длины.
+ *
+ * @param[in] MaxCurveLength Максимальное количество точек в сравниваемых кривых.
+ * @return Размер рабочей области в байтах.
+ */
+EXPORT size_t CCONV GetIVCWorkspaceSize(uint32_t MaxCurveLength);
+
+/**
+ * Функция установки рабочей области контекста, выделенной пользователем.
+ * Все промежуточные данные сравнения размещаются в этой области,
+ * поэтому сравнения в контексте не обращаются к куче.
+ * Для кривых, не помещающихся в область, возвращается IVCMP_ERROR_WORKSPACE_TOO_SMALL.
+ * Область должна существовать до удаления контекста или установки другой области.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Buffer Рабочая область (NULL - контекст выделяет область сам по мере необходимости).
+ * @param[in] BufferSize Размер рабочей области в байтах, см. GetIVCWorkspaceSize().
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SetContextWorkspace(ivcmp_context_t *Ctx, void *Buffer, size_t BufferSize);
+
+/**
+ * Функция заблаговременного выделения рабочей области контекста для кривых заданной максимальной длины.
+ * После вызова сравнения таких кривых в контексте не выделяют память.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] MaxCurveLength Максимальное количество точек в сравниваемых кривых.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV ReserveContextWorkspace(ivcmp_context_t *Ctx, uint32_t MaxCurveLength);
+
+/**
+ * Функция для получения текстового описания кода результата.
+ *
+ * @param[in] Status Код результата.
+ * @return Строка с описанием.
+ */
+EXPORT const char * CCONV GetIVCStatusMessage(ivcmp_status_t Status);
+
+/**
+ * Функция для получения ядра вычисления расстояний, которое используется при сравнении.
+ * По умолчанию при первом сравнении выбирается самое быстрое ядро, поддерживаемое процессором.
+ *
+ * @return Ядро вычислений.
+ */
+EXPORT ivcmp_kernel_t CCONV GetIVCKernel(void);
+
+/**
+ * Функция для получения названия ядра вычислений.
+ *
+ * @param[in] Kernel Ядро вычислений.
+ * @return Строка с названием.
+ */
+EXPORT const char * CCONV GetIVCKernelName(ivcmp_kernel_t Kernel);
+
+/**
+ * Функция принудительного выбора ядра вычисления расстояний для всех последующих сравнений.
+ * Предназначена для тестов и измерений производительности,
+ * не должна вызываться одновременно со сравнениями в других потоках.
+ *
+ * @param[in] Kernel Ядро вычислений.
+ * @return Код результата, при ошибке активное ядро не меняется.
+ */
+EXPORT ivcmp_status_t CCONV SetIVCKernel(ivcmp_kernel_t Kernel);
+
+/**
+ * Аналог функции SetMinVarVC() для заданного контекста.
+ * При некорректных значениях пороги контекста сбрасываются,
+ * и сравнения в этом контексте будут завершаться ошибкой до их корректной установки.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] NewMinVarV Характерный масштаб по напряжению. Единицы измерения: Вольты.
+ * @param[in] NewMinVarC Характерный масштаб по току. Единицы измерения: мА.
+ * @return IVCMP_OK или IVCMP_ERROR_INVALID_MIN_VAR, если пороги не положительны.
+ */
+EXPORT ivcmp_status_t CCONV SetContextMinVarVC(ivcmp_context_t *Ctx, double NewMinVarV, double NewMinVarC);
+
+/**
+ * Аналог функции SetMinVarVCFromCurves() для заданного контекста.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] VoltagesOpenC Массив напряжений сигнатуры, снятой при разомкнутых щупах [Вольты]
+ * @param[in] CurrentsOpenC Массив токов сигнатуры, снятой при разомкнутых щупах [мА]
+ * @param[in] CurveLengthOpenC Количество элементов в массивах VoltagesOpenC и CurrentsOpenC.
+ * @param[in] VoltagesShortC Массив напряжений сигнатуры, снятой при коротко замкнутых щупах [Вольты]
+ * @param[in] CurrentsShortC Массив токов сигнатуры, снятой при коротко замкнутых щупах [мА]
+ * @param[in] CurveLengthShotC Количество элементов в массивах VoltagesShortC и CurrentsShortC.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SetContextMinVarVCFromCurves(ivcmp_context_t *Ctx,
+                                                         double *VoltagesOpenC, double *CurrentsOpenC,
+                                                         uint32_t CurveLengthOpenC,
+                                                         double *VoltagesShortC, double *CurrentsShortC,
+                                                         uint32_t CurveLengthShotC);
+
+/**
+ * Аналог функции GetMinVarVC() для заданного контекста.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[out] NewMinVarVPtr Указатель для записи масштаба по напряжению [Вольты].
+ * @param[out] NewMinVarCPtr Указатель для записи масштаба по току [мА].
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV GetContextMinVarVC(const ivcmp_context_t *Ctx, double *NewMinVarVPtr, double *NewMinVarCPtr);
+
+/**
+ * Аналог функции SetIVCPrecision() для заданного контекста.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Precision Точность вычислений.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SetContextPrecision(ivcmp_context_t *Ctx, ivcmp_precision_t Precision);
+
+/**
+ * Аналог функции GetIVCPrecision() для заданного контекста.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[out] PrecisionPtr Указатель для записи точности вычислений.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV GetContextPrecision(const ivcmp_context_t *Ctx, ivcmp_precision_t *PrecisionPtr);
+
+/**
+ * Функция установки шага передискретизации кривых.
+ * Обычно обе кривые пересчитываются B-сплайном в max(CurveLengthA, CurveLengthB) точек независимо от их формы.
+ * При ненулевом шаге количество точек выбирается по длине кривых в нормированных координатах
+ * (напряжение и ток, делённые на масштабы): соседние точки каждого B-сплайна отстоят друг от друга вдоль него
+ * не более чем на Step. Поэтому длинные записи простых кривых (например, прямой резистора) сравниваются
+ * по небольшому числу точек, а время сравнения зависит от сложности кривых, а не от количества измеренных точек.
+ * Кривые не пересчитываются больше чем в max(CurveLengthA, CurveLengthB) и меньше чем в 32 точки.
+ *
+ * Ломаная по пересчитанным точкам отстоит от B-сплайна не более чем на Step / 2, поэтому расстояние от любой
+ * точки до кривой изменяется не более чем на Step, а квадрат расстояния d^2 - не более чем на Step * (2 * d + Step).
+ * На кривых advanced_tests/test_data, в том числе дополненных линейной интерполяцией до 2000 точек,
+ * при шаге 0.1 степень различия отличается от вычисленной без передискретизации не более чем на 0.005
+ * (проверяется скриптом advanced_tests/test_resampling.py), а сравнение кривых из 2000 точек ускоряется в 3 раза.
+ * Шаг применяется функциями CompareIVC(), CompareIVCWithContext(), CompareIVCThreshold() и CompareIVCBatch();
+ * подготовленные кривые (PrepareIVC()) сравниваются без передискретизации.
+ *
+ * @param[in] Step Наибольший шаг вдоль кривых в единицах масштабов (0 - без передискретизации).
+ * @return Код результата: IVCMP_ERROR_INVALID_ARGUMENT для отрицательного или бесконечного шага.
+ */
+EXPORT ivcmp_status_t CCONV SetIVCResampling(double Step);
+
+/**
+ * Функция для получения текущего шага передискретизации кривых.
+ *
+ * @return Шаг, 0 - передискретизация выключена.
+ */
+EXPORT double CCONV GetIVCResampling(void);
+
+/**
+ * Аналог функции SetIVCResampling() для заданного контекста.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Step Наибольший шаг вдоль кривых в единицах масштабов (0 - без передискретизации).
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SetContextResampling(ivcmp_context_t *Ctx, double Step);
+
+/**
+ * Аналог функции GetIVCResampling() для заданного контекста.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[out] StepPtr Указатель для записи шага, 0 - передискретизация выключена.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV GetContextResampling(const ivcmp_context_t *Ctx, double *StepPtr);
+
+/**
+ * Аналог функции CompareIVC() для заданного контекста.
+ * Вместо вывода сообщений в консоль возвращает код результата.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] VoltagesA Массив напряжений первой кривой для сравнения [Вольты]
+ * @param[in] CurrentsA Массив токов первой кривой для сравнения [мА]
+ * @param[in] CurveLengthA Количество элементов в массивах VoltagesA и CurrentsA.
+ * @param[in] VoltagesB Массив напряжений второй кривой для сравнения [Вольты]
+ * @param[in] CurrentsB Массив токов второй кривой для сравнения [мА]
+ * @param[in] CurveLengthB Количество элементов в массивах VoltagesB и CurrentsB.
+ * @param[out] ScorePtr Степень различия (0 - кривые совпадают, 1 - кривые совсем разные).
+ * В случае ошибки записывается -1.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV CompareIVCWithContext(ivcmp_context_t *Ctx,
+                                                  double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
+                                                  double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB,
+                                                  double *ScorePtr);
+
+/**
+ * Функция проверки того, что степень различия двух сигнатур не превышает порог
+ * (например, при отбраковке выводов платы).
+ * Вычисление расстояний между кривыми прекращается, как только становится ясно,
+ * что порог превышен, поэтому сильно различающиеся кривые проверяются быстрее,
+ * чем функцией CompareIVCWithContext().
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] VoltagesA Массив напряжений первой кривой для сравнения [Вольты]
+ * @param[in] CurrentsA Массив токов первой кривой для сравнения [мА]
+ * @param[in] CurveLengthA Количество элементов в массивах VoltagesA и CurrentsA.
+ * @param[in] VoltagesB Массив напряжений второй кривой для сравнения [Вольты]
+ * @param[in] CurrentsB Массив токов второй кривой для сравнения [мА]
+ * @param[in] CurveLengthB Количество элементов в массивах VoltagesB и CurrentsB.
+ * @param[in] Threshold Порог степени различия от 0 до 1.
+ * @param[out] VerdictPtr Указатель для записи результата проверки.
+ * В случае ошибки записывается IVCMP_VERDICT_FAIL.
+ * @param[out] ScorePtr Указатель для записи степени различия (допускается NULL).
+ * Если порог не превышен, записывается точная степень различия (как у CompareIVCWithContext()),
+ * иначе - её нижняя оценка, превышающая порог. В случае ошибки записывается -1.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV CompareIVCThreshold(ivcmp_context_t *Ctx,
+                                                double *VoltagesA, double *CurrentsA, uint32_t CurveLengthA,
+                                                double *VoltagesB, double *CurrentsB, uint32_t CurveLengthB,
+                                                double Threshold, ivcmp_verdict_t *VerdictPtr, double *ScorePtr);
+
+/**
+ * Функция подготовки кривой к многократному сравнению.
+ * Используется, когда одна кривая (например, эталонная) сравнивается со многими другими:
+ * предварительная обработка кривой выполняется один раз, а при сравнении
+ * подготовленных кривых остаётся только перемасштабирование и вычисление расстояний.
+ * Для удаления повторов используются пороги масштабирования контекста,
+ * поэтому их необходимо установить до подготовки кривой.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Voltages Массив напряжений кривой [Вольты]
+ * @param[in] Currents Массив токов кривой [мА]
+ * @param[in] CurveLength Количество элементов в массивах Voltages и Currents.
+ * @param[out] PreparedPtr Указатель для записи подготовленной кривой.
+ * Кривую необходимо удалить функцией DestroyPreparedIVC().
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV PrepareIVC(ivcmp_context_t *Ctx, double *Voltages, double *Currents,
+                                       uint32_t CurveLength, ivcmp_prepared_t **PreparedPtr);
+
+/**
+ * Функция удаления кривой, подготовленной функцией PrepareIVC().
+ *
+ * @param[in] Prepared Подготовленная кривая (допускается NULL).
+ */
+EXPORT void CCONV DestroyPreparedIVC(ivcmp_prepared_t *Prepared);
+
+/**
+ * Функция сравнения двух подготовленных кривых.
+ * Результат совпадает с результатом CompareIVCWithContext() для исходных кривых.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] PreparedA Первая подготовленная кривая.
+ * @param[in] PreparedB Вторая подготовленная кривая.
+ * @param[out] ScorePtr Степень различия (0 - кривые совпадают, 1 - кривые совсем разные).
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV CompareIVCPrepared(ivcmp_context_t *Ctx, const ivcmp_prepared_t *PreparedA,
+                                               const ivcmp_prepared_t *PreparedB, double *ScorePtr);
+
+/**
+ * Функция получения нижней оценки степени различия двух подготовленных кривых.
+ * При подготовке кривой вычисляется её дескриптор (ограничивающие прямоугольники частей B-сплайна),
+ * оценка вычисляется только по дескрипторам и не требует вычисления расстояний между кривыми,
+ * поэтому заведомо непохожие кривые можно отбросить без сравнения.
+ * Степень различия, вычисленная функцией CompareIVCPrepared(), не бывает меньше оценки.
+ * Если кривые содержат разное количество точек, оценка равна 0.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] PreparedA Первая подготовленная кривая.
+ * @param[in] PreparedB Вторая подготовленная кривая.
+ * @param[out] BoundPtr Нижняя оценка степени различия.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV GetIVCScoreLowerBound(ivcmp_context_t *Ctx, const ivcmp_prepared_t *PreparedA,
+                                                  const ivcmp_prepared_t *PreparedB, double *BoundPtr);
+
+/**
+ * Функция поиска наиболее похожей кривой в наборе (например, в библиотеке эталонных сигнатур).
+ * Кривые набора сравниваются в порядке возрастания нижних оценок степени различия
+ * (см. GetIVCScoreLowerBound()); кривые, оценка для которых превышает лучшую найденную степень различия,
+ * не сравниваются. Результат совпадает с результатом перебора всех кривых функцией CompareIVCPrepared().
+ * Кривые, которые не удалось сравнить, пропускаются.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Prepared Подготовленная кривая, для которой ищется наиболее похожая.
+ * @param[in] Candidates Массив подготовленных кривых набора.
+ * @param[in] NumCandidates Количество кривых в наборе.
+ * @param[out] IndexPtr Указатель для записи номера первой кривой с наименьшей степенью различия.
+ * @param[out] ScorePtr Указатель для записи наименьшей степени различия (допускается NULL).
+ * @return Код результата. Если не удалось сравнить ни одной кривой, возвращается код первой ошибки.
+ */
+EXPORT ivcmp_status_t CCONV FindIVCBestMatch(ivcmp_context_t *Ctx, const ivcmp_prepared_t *Prepared,
+                                             const ivcmp_prepared_t *const *Candidates, uint32_t NumCandidates,
+                                             uint32_t *IndexPtr, double *ScorePtr);
+
+/**
+ * Функция сравнения каждой кривой из набора с каждой (например, для группировки выводов платы).
+ * Каждая кривая подготавливается один раз, а каждая пара сравнивается один раз,
+ * поскольку степень различия симметрична. Пары сравниваются блоками в нескольких потоках.
+ * Результат для каждой пары совпадает с результатом CompareIVCPrepared().
+ * На диагонали полной матрицы записываются нули.
+ * Если кривую не удалось подготовить или пару не удалось сравнить,
+ * для соответствующих элементов записывается -1, а функция возвращает код первой ошибки;
+ * остальные элементы матрицы при этом заполняются.
+ *
+ * @param[in] Ctx Контекст сравнения. Его пороги масштабирования и точность используются во всех потоках.
+ * @param[in] Voltages Массив указателей на массивы напряжений кривых [Вольты]
+ * @param[in] Currents Массив указателей на массивы токов кривых [мА]
+ * @param[in] CurveLengths Количество точек в каждой кривой.
+ * @param[in] NumCurves Количество кривых.
+ * @param[in] Layout Формат матрицы.
+ * @param[in] NumThreads Количество потоков (0 - по количеству процессоров).
+ * @param[out] Scores Матрица степеней различия: NumCurves * NumCurves элементов для IVCMP_MATRIX_FULL
+ * или NumCurves * (NumCurves - 1) / 2 элементов для IVCMP_MATRIX_PACKED.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV CompareIVCMatrix(ivcmp_context_t *Ctx, double **Voltages, double **Currents,
+                                             const uint32_t *CurveLengths, uint32_t NumCurves,
+                                             ivcmp_matrix_layout_t Layout, uint32_t NumThreads, double *Scores);
+
+/**
+ * Функция сравнения пар кривых в нескольких потоках (например, измерений платы с эталонами).
+ * Кривые пар передаются подряд в общих массивах, границы кривых задаются смещениями,
+ * поэтому кривые могут иметь разную длину. Для каждой пары можно задать собственные пороги масштабирования.
+ * Потоки делят пары поровну, освободившийся поток забирает половину оставшихся пар у самого загруженного.
+ * Пары сравниваются независимо, поэтому результат не зависит от количества потоков
+ * и совпадает с результатом CompareIVCWithContext() для каждой пары.
+ * Если пару не удалось сравнить, для неё записывается -1 и код ошибки, остальные пары при этом сравниваются.
+ *
+ * @param[in] Ctx Контекст сравнения. Его точность (и пороги масштабирования, если пороги пар не заданы)
+ * используются во всех потоках. Пороги контекста не изменяются.
+ * @param[in] VoltagesA Напряжения первых кривых пар подряд [Вольты]
+ * @param[in] CurrentsA Токи первых кривых пар подряд [мА]
+ * @param[in] OffsetsA NumPairs + 1 смещений: первая кривая пары i занимает элементы с OffsetsA[i]
+ * по OffsetsA[i + 1] - 1.
+ * @param[in] VoltagesB Напряжения вторых кривых пар подряд [Вольты]
+ * @param[in] CurrentsB Токи вторых кривых пар подряд [мА]
+ * @param[in] OffsetsB NumPairs + 1 смещений вторых кривых.
+ * @param[in] MinVarV Порог масштабирования напряжения для каждой пары (NULL - порог контекста).
+ * @param[in] MinVarC Порог масштабирования тока для каждой пары (NULL - порог контекста).
+ * @param[in] NumPairs Количество пар.
+ * @param[in] NumThreads Количество потоков (0 - по количеству процессоров).
+ * @param[out] Scores Степень различия для каждой пары.
+ * @param[out] Statuses Код результата для каждой пары (допускается NULL).
+ * @return Код результата: IVCMP_OK или код ошибки первой не сравнённой пары.
+ */
+EXPORT ivcmp_status_t CCONV CompareIVCBatch(ivcmp_context_t *Ctx,
+                                            double *VoltagesA, double *CurrentsA, const size_t *OffsetsA,
+                                            double *VoltagesB, double *CurrentsB, const size_t *OffsetsB,
+                                            const double *MinVarV, const double *MinVarC, uint32_t NumPairs,
+                                            uint32_t NumThreads, double *Scores, ivcmp_status_t *Statuses);
+
+/**
+ * Функция построения индекса для поиска наиболее похожих кривых в наборе
+ * (например, в библиотеке эталонных сигнатур компонентов).
+ * Кривые набора подготавливаются (см. PrepareIVC()) и группируются в дерево по сходству дескрипторов.
+ * Для каждого узла дерева хранятся прямоугольники, охватывающие дескрипторы всех его кривых,
+ * поэтому при поиске целые группы непохожих кривых отбрасываются без сравнения.
+ * Степень различия не удовлетворяет неравенству треугольника, поэтому дерево
+ * не опирается на расстояния между кривыми набора и результат поиска точный.
+ *
+ * @param[in] Ctx Контекст сравнения. Его пороги масштабирования используются для подготовки кривых.
+ * @param[in] Voltages Массив указателей на массивы напряжений кривых [Вольты]
+ * @param[in] Currents Массив указателей на массивы токов кривых [мА]
+ * @param[in] CurveLengths Количество точек в каждой кривой.
+ * @param[in] NumCurves Количество кривых.
+ * @param[out] IndexPtr Указатель для записи индекса. Индекс необходимо удалить функцией DestroyIVCIndex().
+ * @return Код результата. Если какую-либо кривую не удалось подготовить, индекс не строится.
+ */
+EXPORT ivcmp_status_t CCONV BuildIVCIndex(ivcmp_context_t *Ctx, double **Voltages, double **Currents,
+                                          const uint32_t *CurveLengths, uint32_t NumCurves,
+                                          ivcmp_index_t **IndexPtr);
+
+/**
+ * Функция удаления индекса, построенного функцией BuildIVCIndex() или загруженного функцией LoadIVCIndex().
+ *
+ * @param[in] Index Индекс (допускается NULL).
+ */
+EXPORT void CCONV DestroyIVCIndex(ivcmp_index_t *Index);
+
+/**
+ * Функция получения количества кривых в индексе.
+ *
+ * @param[in] Index Индекс.
+ * @return Количество кривых.
+ */
+EXPORT uint32_t CCONV GetIVCIndexSize(const ivcmp_index_t *Index);
+
+/**
+ * Функция поиска K наиболее похожих кривых индекса.
+ * Результат совпадает с результатом перебора всех кривых набора функцией CompareIVCPrepared():
+ * найденные кривые упорядочены по возрастанию степени различия,
+ * кривые с одинаковой степенью различия - по возрастанию номера.
+ * Кривые, которые не удалось сравнить, пропускаются.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Index Индекс.
+ * @param[in] Prepared Подготовленная кривая, для которой ищутся наиболее похожие.
+ * @param[in] K Количество кривых для поиска.
+ * @param[out] Indices Массив из K элементов для записи номеров найденных кривых в наборе,
+ * по которому построен индекс.
+ * @param[out] Scores Массив из K элементов для записи степеней различия найденных кривых.
+ * @param[out] NumFoundPtr Указатель для записи количества найденных кривых.
+ * Оно меньше K, если в индексе меньше K кривых или часть кривых не удалось сравнить.
+ * @return Код результата. Если не удалось сравнить ни одной кривой, возвращается код первой ошибки.
+ */
+EXPORT ivcmp_status_t CCONV SearchIVCIndex(ivcmp_context_t *Ctx, const ivcmp_index_t *Index,
+                                           const ivcmp_prepared_t *Prepared, uint32_t K,
+                                           uint32_t *Indices, double *Scores, uint32_t *NumFoundPtr);
+
+/**
+ * Функция сохранения индекса в файл.
+ * Сохраняются исходные кривые, пороги масштабирования, с которыми они подготовлены, и структура дерева.
+ * Числа записываются в порядке байтов компьютера, поэтому файл переносим
+ * между компьютерами с одинаковым порядком байтов.
+ *
+ * @param[in] Index Индекс.
+ * @param[in] FileName Имя файла.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SaveIVCIndex(const ivcmp_index_t *Index, const char *FileName);
+
+/**
+ * Функция загрузки индекса, сохранённого функцией SaveIVCIndex().
+ * Кривые подготавливаются заново с сохранёнными порогами масштабирования,
+ * дерево не перестраивается, поэтому результаты поиска совпадают с результатами исходного индекса.
+ *
+ * @param[in] Ctx Контекст сравнения (используются только его рабочие буферы).
+ * @param[in] FileName Имя файла.
+ * @param[out] IndexPtr Указатель для записи индекса. Индекс необходимо удалить функцией DestroyIVCIndex().
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV LoadIVCIndex(ivcmp_context_t *Ctx, const char *FileName, ivcmp_index_t **IndexPtr);
+
+/**
+ * Функция создания потокового компаратора для эталонной кривой.
+ * Отсчёты периода пробного сигнала передаются компаратору по мере измерения (PushIVCStreamSample()),
+ * по окончании периода функция FinishIVCStream() возвращает степень различия.
+ * Точки B-сплайна пробной кривой и расстояния в обоих направлениях вычисляются по мере поступления отсчётов
+ * в предположении, что период будет полным, масштабы пары определяются эталоном, а удаление повторов
+ * оставит столько же отсчётов, сколько в предыдущем периоде (в первом периоде - сколько в эталоне).
+ * Если предположение выполнено, по окончании периода остаётся только сложить расстояния,
+ * иначе период сравнивается с эталоном обычным образом. Результат в обоих случаях одинаков.
+ *
+ * @param[in] Ctx Контекст сравнения. Его пороги масштабирования должны совпадать с порогами
+ * при завершении периодов, рабочие буферы резервируются для кривых компаратора.
+ * @param[in] Reference Подготовленная эталонная кривая. Кривая не копируется
+ * и не должна удаляться до удаления компаратора.
+ * @param[in] MaxLength Наибольшее количество отсчётов в периоде.
+ * @param[out] StreamPtr Указатель для записи компаратора.
+ * Компаратор необходимо удалить функцией DestroyIVCStream().
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV CreateIVCStream(ivcmp_context_t *Ctx, const ivcmp_prepared_t *Reference,
+                                            uint32_t MaxLength, ivcmp_stream_t **StreamPtr);
+
+/**
+ * Функция удаления потокового компаратора.
+ *
+ * @param[in] Stream Компаратор (допускается NULL).
+ */
+EXPORT void CCONV DestroyIVCStream(ivcmp_stream_t *Stream);
+
+/**
+ * Функция сброса отсчётов текущего периода (например, при прерывании измерения).
+ *
+ * @param[in] Stream Компаратор.
+ */
+EXPORT void CCONV ResetIVCStream(ivcmp_stream_t *Stream);
+
+/**
+ * Функция добавления отсчёта к текущему периоду.
+ * Для точек B-сплайна, определяемых уже поступившими отсчётами, сразу вычисляются расстояния до эталона,
+ * используемые в том числе в промежуточной оценке степени различия (см. GetIVCStreamPartialScore()).
+ *
+ * @param[in] Stream Компаратор.
+ * @param[in] Voltage Напряжение [Вольты]
+ * @param[in] Current Ток [мА]
+ * @return Код результата. Если в периоде уже MaxLength отсчётов,
+ * отсчёт не добавляется и возвращается IVCMP_ERROR_INVALID_ARGUMENT.
+ */
+EXPORT ivcmp_status_t CCONV PushIVCStreamSample(ivcmp_stream_t *Stream, double Voltage, double Current);
+
+/**
+ * Функция получения промежуточной оценки степени различия по отсчётам текущего периода
+ * (например, для отображения во время измерения).
+ * Оценка вычисляется по расстояниям от вычисленных точек B-сплайна отсчётов до эталона
+ * и может отличаться от окончательной степени различия.
+ *
+ * @param[in] Stream Компаратор.
+ * @param[out] ScorePtr Оценка степени различия. Если точек ещё нет, записывается -1.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV GetIVCStreamPartialScore(const ivcmp_stream_t *Stream, double *ScorePtr);
+
+/**
+ * Функция завершения периода: сравнивает отсчёты периода с эталоном и начинает следующий период.
+ * Результат совпадает с результатом CompareIVCPrepared() для эталона и кривой из отсчётов периода,
+ * подготовленной функцией PrepareIVC().
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Stream Компаратор.
+ * @param[out] ScorePtr Степень различия (0 - кривые совпадают, 1 - кривые совсем разные).
+ * В случае ошибки записывается -1.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV FinishIVCStream(ivcmp_context_t *Ctx, ivcmp_stream_t *Stream, double *ScorePtr);
+
+/**
+ * Функция создания файла хранилища сигнатур (например, библиотеки эталонных сигнатур компонентов).
+ * Кривые добавляются функцией AddIVCStoreCurve(), файл завершается функцией CloseIVCStoreWriter().
+ * Числа записываются в порядке байтов компьютера, массивы выравниваются на 64 байта.
+ *
+ * @param[in] FileName Имя файла.
+ * @param[in] WithPrepared 1 - сохранять подготовленные кривые (см. PrepareIVC()), 0 - только исходные кривые.
+ * Подготовленные кривые используются при сравнении прямо из файла, но занимают примерно вдвое больше места.
+ * @param[out] WriterPtr Указатель для записи объекта записи файла.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV CreateIVCStoreWriter(const char *FileName, int WithPrepared,
+                                                 ivcmp_store_writer_t **WriterPtr);
+
+/**
+ * Функция добавления кривой в файл хранилища сигнатур.
+ *
+ * @param[in] Ctx Контекст сравнения. Его пороги масштабирования используются для подготовки кривой
+ * и сохраняются вместе с ней.
+ * @param[in] Writer Объект записи файла.
+ * @param[in] Voltages Массив напряжений кривой [Вольты]
+ * @param[in] Currents Массив токов кривой [мА]
+ * @param[in] CurveLength Количество элементов в массивах Voltages и Currents.
+ * @param[in] Settings Параметры измерения кривой (допускается NULL - записываются нули).
+ * @return Код результата. После ошибки записи файла кривые не добавляются,
+ * а CloseIVCStoreWriter() возвращает ошибку.
+ */
+EXPORT ivcmp_status_t CCONV AddIVCStoreCurve(ivcmp_context_t *Ctx, ivcmp_store_writer_t *Writer,
+                                             double *Voltages, double *Currents, uint32_t CurveLength,
+                                             const ivcmp_measure_settings_t *Settings);
+
+/**
+ * Функция завершения файла хранилища сигнатур: записывает таблицу кривых и заголовок,
+ * закрывает файл и удаляет объект записи. Пока заголовок не записан, файл не открывается функцией OpenIVCStore().
+ *
+ * @param[in] Writer Объект записи файла.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV CloseIVCStoreWriter(ivcmp_store_writer_t *Writer);
+
+/**
+ * Функция открытия хранилища сигнатур, записанного функциями CreateIVCStoreWriter() и AddIVCStoreCurve().
+ * Файл отображается в память и не читается целиком, поэтому открытие занимает время, не зависящее от размера файла.
+ * Страницы файла загружаются при обращении к кривым и используются совместно всеми процессами,
+ * открывшими тот же файл. Кривые проверяются при обращении к ним.
+ *
+ * @param[in] FileName Имя файла.
+ * @param[out] StorePtr Указатель для записи хранилища. Хранилище необходимо закрыть функцией CloseIVCStore().
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV OpenIVCStore(const char *FileName, ivcmp_store_t **StorePtr);
+
+/**
+ * Функция закрытия хранилища сигнатур. Полученные из него кривые после этого использовать нельзя.
+ *
+ * @param[in] Store Хранилище (допускается NULL).
+ */
+EXPORT void CCONV CloseIVCStore(ivcmp_store_t *Store);
+
+/**
+ * Функция получения количества кривых в хранилище сигнатур.
+ *
+ * @param[in] Store Хранилище.
+ * @return Количество кривых.
+ */
+EXPORT uint32_t CCONV GetIVCStoreSize(const ivcmp_store_t *Store);
+
+/**
+ * Функция получения кривой из хранилища сигнатур. Массивы не копируются и указывают в отображённый файл.
+ *
+ * @param[in] Store Хранилище.
+ * @param[in] Index Номер кривой.
+ * @param[out] VoltagesPtr Указатель для записи массива напряжений [Вольты]
+ * @param[out] CurrentsPtr Указатель для записи массива токов [мА]
+ * @param[out] CurveLengthPtr Указатель для записи количества точек.
+ * @param[out] SettingsPtr Параметры измерения кривой (допускается NULL).
+ * @return Код результата. Для номера за пределами хранилища возвращается IVCMP_ERROR_INVALID_ARGUMENT.
+ */
+EXPORT ivcmp_status_t CCONV GetIVCStoreCurve(const ivcmp_store_t *Store, uint32_t Index,
+                                             const double **VoltagesPtr, const double **CurrentsPtr,
+                                             uint32_t *CurveLengthPtr, ivcmp_measure_settings_t *SettingsPtr);
+
+/**
+ * Функция получения подготовленной кривой из хранилища сигнатур без копирования.
+ * Кривую можно использовать в CompareIVCPrepared(), FindIVCBestMatch() и CreateIVCStream()
+ * с любыми порогами масштабирования, результат совпадает с результатом для кривой, подготовленной PrepareIVC().
+ * Кривую не нужно удалять функцией DestroyPreparedIVC().
+ *
+ * @param[in] Store Хранилище.
+ * @param[in] Index Номер кривой.
+ * @param[out] PreparedPtr Указатель для записи подготовленной кривой.
+ * @return Код результата. Если файл записан без подготовленных кривых или другой версией библиотеки
+ * с иным устройством подготовленной кривой, возвращается IVCMP_ERROR_INVALID_FILE;
+ * в этом случае кривую можно подготовить функцией PrepareIVC().
+ */
+EXPORT ivcmp_status_t CCONV GetIVCStorePrepared(const ivcmp_store_t *Store, uint32_t Index,
+                                                const ivcmp_prepared_t **PreparedPtr);
+
+/**
+ * Функция установки функции захвата промежуточных данных сравнения (замена отладочной сборки с DEBUG_FILE_OUTPUT).
+ * При каждом сравнении с контекстом функция получает массивы каждого этапа, см. ivcmp_capture_stage_t.
+ * Функция вызывается в потоке сравнения. Захват действует только для сравнений функциями с этим контекстом,
+ * но не для CompareIVCMatrix() и CompareIVCBatch(). Выключенный захват не замедляет сравнение.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Func Функция захвата, NULL - выключить захват.
+ * @param[in] User Параметр, передаваемый функции захвата.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SetContextCapture(ivcmp_context_t *Ctx, ivcmp_capture_func_t Func, void *User);
+
+/**
+ * Функция включения захвата промежуточных данных сравнения в буфер пользователя.
+ * Каждое сравнение с контекстом записывает в буфер двоичный дамп своих этапов вместо предыдущего;
+ * дамп можно сохранить в файл и построить графики скриптом utils/plot_debug_data.py.
+ *
+ * Формат дампа (порядок байтов процессора): заголовок - "IVCMPCAP", uint32_t версия (1),
+ * uint32_t количество записей, uint32_t флаги (1 - не все записи поместились в буфер), uint32_t 0;
+ * затем записи - uint32_t этап, uint32_t кривая, uint32_t количество точек N, uint32_t количество массивов M
+ * (2 - напряжения и токи, 1 - значения) и M массивов по N чисел double.
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @param[in] Buffer Буфер, должен существовать, пока включён захват. NULL - выключить захват.
+ * @param[in] BufferSize Размер буфера в байтах, не менее 24.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV SetContextCaptureBuffer(ivcmp_context_t *Ctx, void *Buffer, size_t BufferSize);
+
+/**
+ * Функция получения размера дампа последнего сравнения в буфере, см. SetContextCaptureBuffer().
+ *
+ * @param[in] Ctx Контекст сравнения.
+ * @return Размер дампа в байтах, 0 - если после установки буфера сравнений не было.
+ */
+EXPORT size_t CCONV GetContextCaptureSize(const ivcmp_context_t *Ctx);
+
+/**
+ * Функция получения статистики работы библиотеки: количества сравнений, вырожденных кривых,
+ * удалённых повторяющихся точек, ограничений разброса порогами масштабирования и времени этапов сравнения.
+ * Каждый поток ведёт собственные счётчики, функция суммирует их по всем потокам,
+ * включая завершившиеся, начиная с последнего вызова ResetIVCStats().
+ * Статистика собирается, если библиотека собрана с IVCMP_STATS (по умолчанию включено).
+ *
+ * @param[out] Stats Указатель для записи статистики.
+ * @return Код результата. Если статистика отключена при сборке, возвращается IVCMP_ERROR_NOT_SUPPORTED,
+ * а счётчики равны нулю.
+ */
+EXPORT ivcmp_status_t CCONV GetIVCStats(ivcmp_stats_t *Stats);
+
+/**
+ * Функция обнуления статистики работы библиотеки во всех потоках.
+ * Её можно вызывать одновременно со сравнениями в других потоках.
+ */
+EXPORT void CCONV ResetIVCStats(void);
+
+/**
+ * Функция включения и выключения измерения времени этапов сравнения (StageTime и StageCalls в ivcmp_stats_t).
+ * По умолчанию измерение выключено: каждое измерение времени занимает десятки наносекунд.
+ *
+ * @param[in] Enable 1 - включить измерение, 0 - выключить.
+ * @return Код результата. Если статистика отключена при сборке, возвращается IVCMP_ERROR_NOT_SUPPORTED.
+ */
+EXPORT ivcmp_status_t CCONV SetIVCStatsTimers(int Enable);
+
+/**
+ * Функция включения кэша результатов сравнения и установки его размера.
+ * Кэш общий для всех потоков и контекстов. Он хранит степени различия последних сравнённых пар кривых
+ * и при заполнении вытесняет пары, которые дольше всего не использовались. Ключ пары - хэши значений обеих
+ * кривых, их длины, пороги масштабирования, шаг повторной дискретизации и точность контекста. Если пара найдена,
+ * степень различия возвращается без построения B-сплайна и вычисления расстояний.
+ * Кэш используют CompareIVC(), CompareIVCWithContext(), CompareIVCThreshold() и CompareIVCBatch(),
+ * кроме контекстов с функцией захвата этапов (SetContextCapture()). Сохраняются только точные степени различия:
+ * оценка снизу, полученная CompareIVCThreshold() при досрочной остановке, в кэш не попадает.
+ * Совпадение ключей разных кривых маловероятно, но возможно, поэтому кэш выключен по умолчанию.
+ * Изменение размера очищает кэш и его счётчики.
+ *
+ * @param[in] Capacity Наибольшее количество степеней различия в кэше (около 80 байт на каждую),
+ * 0 - выключить кэш и освободить его память.
+ * @return Код результата. При нехватке памяти кэш выключается.
+ */
+EXPORT ivcmp_status_t CCONV SetIVCCacheCapacity(uint32_t Capacity);
+
+/**
+ * Функция получения счётчиков кэша результатов сравнения: попаданий, промахов и вытеснений с последнего
+ * вызова ClearIVCCache() или SetIVCCacheCapacity(), а также заполненности кэша.
+ *
+ * @param[out] Stats Указатель для записи счётчиков.
+ * @return Код результата.
+ */
+EXPORT ivcmp_status_t CCONV GetIVCCacheStats(ivcmp_cache_stats_t *Stats);
+
+/**
+ * Функция очистки кэша результатов сравнения и обнуления его счётчиков. Размер кэша не меняется.
+ */
+EXPORT void CCONV ClearIVCCache(void);
+
 #ifdef __cplusplus
 }
 #endif
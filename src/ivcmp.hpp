@@ -0,0 +1,485 @@
+/** \file ivcmp.hpp
+ * Заголовочный C++ интерфейс для сравнения ВАХ с известным при компиляции количеством точек.
+ * Для двух кривых из N точек даёт ту же степень различия, что CompareIVCWithContext(), но не выделяет память:
+ * все массивы находятся на стеке, таблица базисных функций B-сплайна для кривых без повторяющихся точек
+ * вычисляется при компиляции. Требуется C++20.
+ */
+
+#ifndef IVCMP_HPP
+#define IVCMP_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include "ivcmp.h"
+
+namespace ivcmp
+{
+
+/* Implementation: the same arithmetic operations in the same order as in ivcmp.c, so the scores are equal */
+namespace detail
+{
+
+/** Shorter curves use brute force nearest node search */
+inline constexpr std::size_t SORTED_MIN_LENGTH = 32;
+
+/**
+ * Sparse table of B-spline basis functions for resampling of defining points to N curve points,
+ * see basis_table_t in ivcmp.c
+ */
+template <std::size_t N, int Order>
+struct BasisTable
+{
+  std::array<std::uint32_t, N> First{};      /**< First vertex with non-zero basis function for each point */
+  std::array<double, Order * N> Weights{};  /**< Order basis functions for each point */
+};
+
+/**
+ * Returns the uniform periodic knot vector x[i] = i - 1 for up to N defining vertices, element 0 is not used
+ */
+template <std::size_t N, int Order>
+constexpr std::array<double, N + Order + 1> MakeKnots()
+{
+  std::array<double, N + Order + 1> Knots{};
+  for (std::size_t i = 0; i < Knots.size(); i++)
+  {
+    Knots[i] = static_cast<double>(i) - 1;
+  }
+  return Knots;
+}
+
+template <std::size_t N, int Order>
+inline constexpr std::array<double, N + Order + 1> Knots = MakeKnots<N, Order>();
+
+/**
+ * Builds the basis table for Npts defining vertices, see BuildBasisTable() in ivcmp.c.
+ * Only the basis functions of the span x[i] <= t < x[i + 1] are evaluated with Cox-de Boor recursive relation.
+ *
+ * @param[in] Npts number of defining vertices, from Order - 1 to N
+ *
+ * @return basis table
+ */
+template <std::size_t N, int Order>
+constexpr BasisTable<N, Order> MakeBasisTable(std::uint32_t Npts)
+{
+  const std::array<double, N + Order + 1> &x = Knots<N, Order>;
+  BasisTable<N, Order> Table;
+  double t = Order - 1; /* special parameter range for periodic basis functions */
+  const double Step = static_cast<float>(Npts - (Order - 1)) / static_cast<float>(N - 1);
+
+  for (std::uint32_t i1 = 0; i1 < N; i1++)
+  {
+    if (static_cast<float>(Npts) - t < 5e-6)
+    {
+      t = static_cast<float>(Npts);
+    }
+    /* t is not negative, so the conversion is floor() */
+    const std::uint32_t i = static_cast<std::uint32_t>(t) + 1;
+
+    /* Basis[k] is the basis function of the vertex i - r + 1 + k of the order r */
+    std::array<double, Order> Basis{};
+    Basis[0] = 1;
+    for (int r = 2; r <= Order; r++)
+    {
+      std::array<double, Order> Next{};
+      for (int k = 0; k < r; k++)
+      {
+        const std::uint32_t j = i - r + 1 + k;
+        if (k == 0)
+        {
+          Next[k] = ((x[j + r] - t) * Basis[k]) / (x[j + r] - x[j + 1]);
+        }
+        else if (k == r - 1)
+        {
+          Next[k] = ((t - x[j]) * Basis[k - 1]) / (x[j + r - 1] - x[j]);
+        }
+        else
+        {
+          Next[k] = ((t - x[j]) * Basis[k - 1]) / (x[j + r - 1] - x[j]) +
+                    ((x[j + r] - t) * Basis[k]) / (x[j + r] - x[j + 1]);
+        }
+      }
+      Basis = Next;
+    }
+
+    /* Vertices are numbered from 0 here and from 1 in Cox-de Boor formula */
+    Table.First[i1] = i - Order;
+    for (int k = 0; k < Order; k++)
+    {
+      /* The vertex after the last one does not exist, it is padded by zero */
+      Table.Weights[Order * i1 + k] = i - Order + k < Npts ? Basis[k] : 0;
+    }
+    t = t + Step;
+  }
+  return Table;
+}
+
+/**
+ * Evaluates one coordinate of a B-spline curve point, the sum is unrolled in the order of BsplinePoint() in ivcmp.c
+ */
+template <int... K>
+inline double BsplinePoint(const double *w, const double *b, std::integer_sequence<int, K...>)
+{
+  double Sum = w[0] * b[0];
+  ((Sum += w[K + 1] * b[K + 1]), ...);
+  return Sum;
+}
+
+/**
+ * Curve with one padding element after the points
+ */
+template <std::size_t N>
+using Curve = std::array<std::array<double, N + 1>, 2>;
+
+/**
+ * Returns the dispersion of N values, see Disp() in ivcmp.c
+ */
+template <std::size_t N>
+inline double Disp(const std::array<double, N + 1> &Values)
+{
+  double Avg = 0;
+  double Result = 0;
+  for (std::size_t i = 0; i < N; i++)
+  {
+    Avg += Values[i];
+  }
+  Avg = Avg / N;
+  for (std::size_t i = 0; i < N; i++)
+  {
+    Result += (Values[i] - Avg) * (Values[i] - Avg);
+  }
+  return Result / N;
+}
+
+/**
+ * Returns the greater value, same as max() macro in ivcmp.c
+ */
+inline double Max(double a, double b)
+{
+  return a > b ? a : b;
+}
+
+/**
+ * Scales the curve and removes repeated points, see ScaleCurve() and RemoveRepeatsIvc() in ivcmp.c.
+ * The element after the kept points is zeroed for Bspline().
+ *
+ * @return number of kept points
+ */
+template <std::size_t N>
+inline std::uint32_t ScaleAndClean(Curve<N> &a, double VarV, double VarC)
+{
+  std::uint32_t n = 0;
+  for (std::size_t i = 0; i < N; i++)
+  {
+    a[0][i] = a[0][i] / VarV;
+    a[1][i] = a[1][i] / VarC;
+  }
+  for (std::size_t i = 0; i < N - 1; i++)
+  {
+    if ((std::fabs(a[0][i + 1] - a[0][i]) > 1.e-6) | (std::fabs(a[1][i + 1] - a[1][i]) > 1.e-6))
+    {
+      a[0][n] = a[0][i];
+      a[1][n++] = a[1][i];
+    }
+  }
+  a[0][n] = a[0][N - 1];
+  a[1][n++] = a[1][N - 1];
+  a[0][n] = 0;
+  a[1][n] = 0;
+  return n;
+}
+
+/**
+ * Resamples Npts defining vertices to N points of B-spline
+ */
+template <std::size_t N, int Order>
+inline void Bspline(const BasisTable<N, Order> &Table, const Curve<N> &b, Curve<N> &p)
+{
+  for (std::size_t j = 0; j < 2; j++)
+  {
+    const double *w = Table.Weights.data();
+    for (std::size_t i1 = 0; i1 < N; i1++, w += Order)
+    {
+      p[j][i1] = BsplinePoint(w, b[j].data() + Table.First[i1], std::make_integer_sequence<int, Order - 1>());
+    }
+  }
+}
+
+/**
+ * Returns the squared distance between a point and a segment, see Dist2PtSeg() in ivcmp_dist.inc
+ */
+inline double Dist2PtSeg(double px, double py, double ax, double ay, double bx, double by)
+{
+  const double v1x = bx - ax;
+  const double v1y = by - ay;
+  const double v2x = px - ax;
+  const double v2y = py - ay;
+  const double SegLen2 = v1x * v1x + v1y * v1y;
+  const double Proj = (v1x * v2x + v1y * v2y) / SegLen2;
+  if (Proj > 1)
+  {
+    return (px - bx) * (px - bx) + (py - by) * (py - by);
+  }
+  else if (Proj < 0)
+  {
+    return v2x * v2x + v2y * v2y;
+  }
+  const double Cross = v1x * v2y - v1y * v2x;
+  return Cross * Cross / SegLen2;
+}
+
+/**
+ * Returns the squared distance between the curve node and the point
+ */
+template <std::size_t N>
+inline double NodeDist2(const Curve<N> &c, std::uint32_t i, double px, double py)
+{
+  return (c[0][i] - px) * (c[0][i] - px) + (c[1][i] - py) * (c[1][i] - py);
+}
+
+/**
+ * Curve nodes sorted by voltage for nearest node search
+ */
+template <std::size_t N>
+struct SortedNodes
+{
+  std::array<double, N> X;            /**< Voltages in ascending order */
+  std::array<std::uint32_t, N> Items; /**< Node numbers */
+};
+
+/**
+ * Sorts the curve nodes by voltage
+ *
+ * @return 0 if the curve has NaN coordinates and the nodes can not be sorted
+ */
+template <std::size_t N>
+inline int SortNodes(const Curve<N> &c, SortedNodes<N> &Nodes)
+{
+  for (std::uint32_t i = 0; i < N; i++)
+  {
+    if (c[0][i] != c[0][i] || c[1][i] != c[1][i])
+    {
+      return 0;
+    }
+    Nodes.Items[i] = i;
+  }
+  std::sort(Nodes.Items.begin(), Nodes.Items.end(),
+            [&c](std::uint32_t i, std::uint32_t k) { return c[0][i] < c[0][k] || (c[0][i] == c[0][k] && i < k); });
+  for (std::uint32_t i = 0; i < N; i++)
+  {
+    Nodes.X[i] = c[0][Nodes.Items[i]];
+  }
+  return 1;
+}
+
+/**
+ * Finds the first nearest curve node to the point, see NearestNodeBrute() in ivcmp_dist.inc.
+ * Nodes are checked in both directions from the voltage of the point until the voltage difference alone
+ * exceeds the found distance. The search starts from the previous nearest node and its position,
+ * since the neighbouring points of the curves are close.
+ *
+ * @param Position position of the voltage of the previous point among the sorted voltages, updated
+ * @param[in] LocMinItem nearest node of the previous point, returned if all the nodes are too far
+ *
+ * @return number of the first nearest node
+ */
+template <std::size_t N>
+inline std::uint32_t NearestNodeSorted(const SortedNodes<N> &Nodes, const Curve<N> &c, double px, double py,
+                                       std::uint32_t &Position, std::uint32_t LocMinItem)
+{
+  double LocMin = 100000;
+  std::uint32_t Found = UINT32_MAX;
+  const double Start = NodeDist2<N>(c, LocMinItem, px, py);
+  if (Start < LocMin)
+  {
+    LocMin = Start;
+    Found = LocMinItem;
+  }
+  /* First voltage not less than px, found by a short walk from the previous one */
+  std::uint32_t k = Position;
+  while (k > 0 && !(Nodes.X[k - 1] < px))
+  {
+    k--;
+  }
+  while (k < N && Nodes.X[k] < px)
+  {
+    k++;
+  }
+  Position = k;
+  /* The squared voltage difference does not exceed the squared distance after rounding too */
+  for (std::uint32_t r = k; r < N && (Nodes.X[r] - px) * (Nodes.X[r] - px) <= LocMin; r++)
+  {
+    const std::uint32_t i = Nodes.Items[r];
+    const double v = NodeDist2<N>(c, i, px, py);
+    if (v < LocMin || (v == LocMin && i < Found))
+    {
+      LocMin = v;
+      Found = i;
+    }
+  }
+  for (std::uint32_t r = k; r > 0 && (Nodes.X[r - 1] - px) * (Nodes.X[r - 1] - px) <= LocMin; r--)
+  {
+    const std::uint32_t i = Nodes.Items[r - 1];
+    const double v = NodeDist2<N>(c, i, px, py);
+    if (v < LocMin || (v == LocMin && i < Found))
+    {
+      LocMin = v;
+      Found = i;
+    }
+  }
+  return Found != UINT32_MAX ? Found : LocMinItem;
+}
+
+/**
+ * Finds the first nearest curve node to the point by checking all the nodes, see NearestNodeBrute()
+ */
+template <std::size_t N>
+inline std::uint32_t NearestNodeBrute(const Curve<N> &c, double px, double py, std::uint32_t LocMinItem)
+{
+  double LocMin = 100000;
+  for (std::uint32_t i = 0; i < N; i++)
+  {
+    const double v = NodeDist2<N>(c, i, px, py);
+    if (v < LocMin)
+    {
+      LocMinItem = i;
+      LocMin = v;
+    }
+  }
+  return LocMinItem;
+}
+
+/**
+ * Returns normalized sum of squared distances from the points to the curve, see DistCurvePts() in ivcmp_dist.inc.
+ * Both nearest node searches give the same nodes as the grid of the library.
+ */
+template <std::size_t N>
+inline double DistCurvePts(const Curve<N> &c, const Curve<N> &pts)
+{
+  double Result = 0.0;
+  std::uint32_t LocMinItem = 0;
+  std::uint32_t Position = 0;
+  SortedNodes<N> Nodes;
+  /* Brute force is faster for short curves */
+  const bool Sorted = N >= SORTED_MIN_LENGTH && SortNodes<N>(c, Nodes);
+  for (std::size_t j = 0; j < N; j++)
+  {
+    const double px = pts[0][j];
+    const double py = pts[1][j];
+    LocMinItem = Sorted ? NearestNodeSorted<N>(Nodes, c, px, py, Position, LocMinItem) :
+                          NearestNodeBrute<N>(c, px, py, LocMinItem);
+    const double Dist1 = LocMinItem > 0 ? Dist2PtSeg(px, py, c[0][LocMinItem - 1], c[1][LocMinItem - 1],
+                                                     c[0][LocMinItem], c[1][LocMinItem]) : 10000;
+    const double Dist2 = LocMinItem < N - 1 ? Dist2PtSeg(px, py, c[0][LocMinItem], c[1][LocMinItem],
+                                                         c[0][LocMinItem + 1], c[1][LocMinItem + 1]) : 10000;
+    Result += Dist1 < Dist2 ? Dist1 : Dist2;
+  }
+  return Result / N;
+}
+
+} // namespace detail
+
+/**
+ * Сравнение кривых из N точек с B-сплайном порядка Order.
+ * Степень различия совпадает с результатом CompareIVCWithContext() только для Order = 3 (порядок B-сплайна
+ * библиотеки); другие порядки меняют сглаживание кривых.
+ * Объект не изменяется при сравнении, поэтому один объект можно использовать из нескольких потоков.
+ */
+template <std::size_t N, int Order = 3>
+class FixedComparator
+{
+  static_assert(N > 2, "Curves should have more than 2 points, see IVCMP_ERROR_CURVE_TOO_SHORT");
+  static_assert(Order >= 2 && static_cast<std::size_t>(Order) <= N, "Unsupported order of B-spline");
+
+public:
+  /**
+   * Создаёт объект сравнения с заданными порогами масштабирования, см. SetMinVarVC().
+   *
+   * @param[in] MinVarV Порог масштабирования по напряжению [Вольты].
+   * @param[in] MinVarC Порог масштабирования по току [мА].
+   */
+  constexpr FixedComparator(double MinVarV, double MinVarC) noexcept : MinVarV(MinVarV), MinVarC(MinVarC)
+  {
+  }
+
+  /**
+   * Функция сравнения двух сигнатур, аналог CompareIVCWithContext().
+   *
+   * @param[in] VoltagesA Напряжения первой кривой [Вольты]
+   * @param[in] CurrentsA Токи первой кривой [мА]
+   * @param[in] VoltagesB Напряжения второй кривой [Вольты]
+   * @param[in] CurrentsB Токи второй кривой [мА]
+   * @param[out] Score Степень различия (0 - кривые совпадают, 1 - кривые совсем разные), -1 при ошибке.
+   * @return Код результата.
+   */
+  ivcmp_status_t Compare(std::span<const double, N> VoltagesA, std::span<const double, N> CurrentsA,
+                         std::span<const double, N> VoltagesB, std::span<const double, N> CurrentsB,
+                         double &Score) const noexcept
+  {
+    detail::Curve<N> a, b, SplinedA, SplinedB;
+    Score = -1;
+    if (MinVarC <= 0 || MinVarV <= 0)
+    {
+      return IVCMP_ERROR_INVALID_MIN_VAR;
+    }
+    for (std::size_t i = 0; i < N; i++)
+    {
+      a[0][i] = VoltagesA[i];
+      a[1][i] = CurrentsA[i];
+      b[0][i] = VoltagesB[i];
+      b[1][i] = CurrentsB[i];
+    }
+
+    const double VarV = detail::Max(detail::Max(std::sqrt(detail::Disp<N>(a[0])), std::sqrt(detail::Disp<N>(b[0]))),
+                                    MinVarV);
+    const double VarC = detail::Max(detail::Max(std::sqrt(detail::Disp<N>(a[1])), std::sqrt(detail::Disp<N>(b[1]))),
+                                    MinVarC);
+    const std::uint32_t SizeA = detail::ScaleAndClean<N>(a, VarV, VarC);
+    const std::uint32_t SizeB = detail::ScaleAndClean<N>(b, VarV, VarC);
+    if (SizeA < MinSize || SizeB < MinSize)
+    {
+      return IVCMP_ERROR_IDENTICAL_POINTS;
+    }
+    Spline(a, SizeA, SplinedA);
+    Spline(b, SizeB, SplinedB);
+
+    const double DistAB = detail::DistCurvePts<N>(SplinedA, SplinedB);
+    const double DistBA = detail::DistCurvePts<N>(SplinedB, SplinedA);
+    Score = 1 - std::exp(-8 * ((DistAB + DistBA) / 2.));
+    return IVCMP_OK;
+  }
+
+private:
+  /** Least number of points after repeats removal: MIN_LEN_CURVE of ivcmp.c or the vertices of one span */
+  static constexpr std::uint32_t MinSize = Order > 3 ? Order - 1 : 2;
+
+  /** Basis table of the curves without repeated points, evaluated at compile time */
+  static constexpr detail::BasisTable<N, Order> FullTable = detail::MakeBasisTable<N, Order>(N);
+
+  /**
+   * Resamples the cleaned curve to N points
+   */
+  static void Spline(const detail::Curve<N> &a, std::uint32_t Size, detail::Curve<N> &Splined) noexcept
+  {
+    if (Size == N)
+    {
+      detail::Bspline<N, Order>(FullTable, a, Splined);
+    }
+    else
+    {
+      const detail::BasisTable<N, Order> Table = detail::MakeBasisTable<N, Order>(Size);
+      detail::Bspline<N, Order>(Table, a, Splined);
+    }
+  }
+
+  double MinVarV; /**< Scaling threshold for voltages */
+  double MinVarC; /**< Scaling threshold for currents */
+};
+
+} // namespace ivcmp
+
+#endif
@@ -0,0 +1,362 @@
+/* AVX2 kernels of the distance stage.
+ * The arithmetic is the same as in the scalar code of ivcmp_dist.inc, so the results are identical.
+ * The module must be compiled with AVX2 enabled and without contraction to FMA.
+ */
+#include <immintrin.h>
+#include "ivcmp_kernels.h"
+
+#define LANES 4
+#define ROWS 4 /**< Points of the first curve processed together by the tile kernels */
+
+/**
+ * Returns squared distances from the points to the segments a-b, see Dist2PtSeg()
+ */
+static __m256d SegDist(__m256d px, __m256d py, __m256d ax, __m256d ay, __m256d bx, __m256d by)
+{
+  const __m256d v1x = _mm256_sub_pd(bx, ax);
+  const __m256d v1y = _mm256_sub_pd(by, ay);
+  const __m256d v2x = _mm256_sub_pd(px, ax);
+  const __m256d v2y = _mm256_sub_pd(py, ay);
+  const __m256d v3x = _mm256_sub_pd(px, bx);
+  const __m256d v3y = _mm256_sub_pd(py, by);
+  const __m256d SegLen2 = _mm256_add_pd(_mm256_mul_pd(v1x, v1x), _mm256_mul_pd(v1y, v1y));
+  const __m256d Proj = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(v1x, v2x), _mm256_mul_pd(v1y, v2y)), SegLen2);
+  const __m256d Cross = _mm256_sub_pd(_mm256_mul_pd(v1x, v2y), _mm256_mul_pd(v1y, v2x));
+  __m256d Result = _mm256_div_pd(_mm256_mul_pd(Cross, Cross), SegLen2);
+  Result = _mm256_blendv_pd(Result, _mm256_add_pd(_mm256_mul_pd(v2x, v2x), _mm256_mul_pd(v2y, v2y)),
+                            _mm256_cmp_pd(Proj, _mm256_setzero_pd(), _CMP_LT_OQ));
+  Result = _mm256_blendv_pd(Result, _mm256_add_pd(_mm256_mul_pd(v3x, v3x), _mm256_mul_pd(v3y, v3y)),
+                            _mm256_cmp_pd(Proj, _mm256_set1_pd(1), _CMP_GT_OQ));
+  return Result;
+}
+
+uint32_t IvcNearestNodeAvx2(double **Curve, uint32_t SizeJ, const double *pt, uint32_t LocMinItem)
+{
+  uint32_t i, l;
+  double Best[LANES], BestItem[LANES];
+  double LocMin = 100000;
+  uint32_t Found = UINT32_MAX;
+  const __m256d px = _mm256_set1_pd(pt[0]);
+  const __m256d py = _mm256_set1_pd(pt[1]);
+  __m256d Item = _mm256_setr_pd(0, 1, 2, 3);
+  __m256d LaneMin = _mm256_set1_pd(LocMin);
+  __m256d LaneItem = _mm256_setzero_pd();
+
+  /* The last group overlaps the previous one instead of a scalar tail */
+  for (i = 0; i < SizeJ; i += LANES)
+  {
+    if (i + LANES > SizeJ)
+    {
+      i = SizeJ - LANES;
+      Item = _mm256_add_pd(_mm256_set1_pd(i), _mm256_setr_pd(0, 1, 2, 3));
+    }
+    const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(Curve[0] + i), px);
+    const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(Curve[1] + i), py);
+    const __m256d v = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    const __m256d Less = _mm256_cmp_pd(v, LaneMin, _CMP_LT_OQ);
+    LaneMin = _mm256_blendv_pd(LaneMin, v, Less);
+    LaneItem = _mm256_blendv_pd(LaneItem, Item, Less);
+    Item = _mm256_add_pd(Item, _mm256_set1_pd(LANES));
+  }
+
+  /* Each lane keeps its first minimum, the first node among the lanes wins */
+  _mm256_storeu_pd(Best, LaneMin);
+  _mm256_storeu_pd(BestItem, LaneItem);
+  for (l = 0; l < LANES; l++)
+  {
+    if (Best[l] < LocMin || (Best[l] == LocMin && Found != UINT32_MAX && (uint32_t)BestItem[l] < Found))
+    {
+      LocMin = Best[l];
+      Found = (uint32_t)BestItem[l];
+    }
+  }
+  return Found != UINT32_MAX ? Found : LocMinItem;
+}
+
+void IvcSegDistAvx2(double **Curve, double **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                    const uint32_t *Nearest, double *Dist)
+{
+  uint32_t j;
+  const uint32_t End = First + Count;
+  const __m128i Zero = _mm_setzero_si128();
+  const __m128i One = _mm_set1_epi32(1);
+  const __m128i Last = _mm_set1_epi32((int)(SizeJ - 1));
+  const __m256d Far = _mm256_set1_pd(10000);
+
+  for (j = First; j < End; j += LANES)
+  {
+    if (j + LANES > End)
+    {
+      j = End - LANES;
+    }
+    const __m128i Cur = _mm_loadu_si128((const __m128i *)(Nearest + j));
+    const __m128i IsFirst = _mm_cmpeq_epi32(Cur, Zero);
+    const __m128i IsLast = _mm_cmpeq_epi32(Cur, Last);
+    /* Missing neighbours are replaced by the node itself and masked out */
+    const __m128i Prev = _mm_add_epi32(_mm_sub_epi32(Cur, One), _mm_and_si128(IsFirst, One));
+    const __m128i Next = _mm_sub_epi32(_mm_add_epi32(Cur, One), _mm_and_si128(IsLast, One));
+    const __m256d px = _mm256_loadu_pd(pts[0] + j);
+    const __m256d py = _mm256_loadu_pd(pts[1] + j);
+    const __m256d cx = _mm256_i32gather_pd(Curve[0], Cur, 8);
+    const __m256d cy = _mm256_i32gather_pd(Curve[1], Cur, 8);
+    __m256d Dist1 = SegDist(px, py, _mm256_i32gather_pd(Curve[0], Prev, 8), _mm256_i32gather_pd(Curve[1], Prev, 8),
+                            cx, cy);
+    __m256d Dist2 = SegDist(px, py, cx, cy, _mm256_i32gather_pd(Curve[0], Next, 8),
+                            _mm256_i32gather_pd(Curve[1], Next, 8));
+    Dist1 = _mm256_blendv_pd(Dist1, Far, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(IsFirst)));
+    Dist2 = _mm256_blendv_pd(Dist2, Far, _mm256_castsi256_pd(_mm256_cvtepi32_epi64(IsLast)));
+    /* min_pd returns the second operand unless the first one is less, as min() does */
+    _mm256_storeu_pd(Dist + j, _mm256_min_pd(Dist1, Dist2));
+  }
+}
+
+void IvcNearestTileAvx2(double **a, double **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                        double *MinA, uint32_t *NearA, double *MinB, uint32_t *NearB)
+{
+  uint32_t i, j, r, l;
+  double Best[LANES], BestItem[LANES];
+  __m256d ax[ROWS], ay[ROWS], Node[ROWS], LaneMin[ROWS], LaneItem[ROWS];
+  const uint32_t EndA = FirstA + CountA;
+  const uint32_t EndB = FirstB + CountB;
+
+  /* The last groups overlap the previous points, they can not be strictly nearer than the found nodes */
+  for (i = FirstA; i < EndA; i += ROWS)
+  {
+    if (i + ROWS > EndA)
+    {
+      i = EndA - ROWS;
+    }
+    for (r = 0; r < ROWS; r++)
+    {
+      ax[r] = _mm256_set1_pd(a[0][i + r]);
+      ay[r] = _mm256_set1_pd(a[1][i + r]);
+      Node[r] = _mm256_set1_pd(i + r);
+      LaneMin[r] = _mm256_set1_pd(MinA[i + r]);
+      LaneItem[r] = _mm256_set1_pd(-1);
+    }
+    __m256d Item = _mm256_add_pd(_mm256_set1_pd(FirstB), _mm256_setr_pd(0, 1, 2, 3));
+    for (j = FirstB; j < EndB; j += LANES)
+    {
+      if (j + LANES > EndB)
+      {
+        j = EndB - LANES;
+        Item = _mm256_add_pd(_mm256_set1_pd(j), _mm256_setr_pd(0, 1, 2, 3));
+      }
+      const __m256d bx = _mm256_loadu_pd(b[0] + j);
+      const __m256d by = _mm256_loadu_pd(b[1] + j);
+      __m256d Min = _mm256_loadu_pd(MinB + j);
+      __m256d Near = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(NearB + j)));
+      /* Rows are independent chains of comparisons, the points of the second curve see them in ascending order */
+      for (r = 0; r < ROWS; r++)
+      {
+        const __m256d dx = _mm256_sub_pd(bx, ax[r]);
+        const __m256d dy = _mm256_sub_pd(by, ay[r]);
+        const __m256d v = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        const __m256d Less = _mm256_cmp_pd(v, LaneMin[r], _CMP_LT_OQ);
+        const __m256d Nearer = _mm256_cmp_pd(v, Min, _CMP_LT_OQ);
+        LaneMin[r] = _mm256_blendv_pd(LaneMin[r], v, Less);
+        LaneItem[r] = _mm256_blendv_pd(LaneItem[r], Item, Less);
+        Min = _mm256_blendv_pd(Min, v, Nearer);
+        Near = _mm256_blendv_pd(Near, Node[r], Nearer);
+      }
+      _mm256_storeu_pd(MinB + j, Min);
+      _mm_storeu_si128((__m128i *)(NearB + j), _mm256_cvttpd_epi32(Near));
+      Item = _mm256_add_pd(Item, _mm256_set1_pd(LANES));
+    }
+
+    /* Lanes are changed only by strictly nearer nodes, the first node among the lanes wins */
+    for (r = 0; r < ROWS; r++)
+    {
+      _mm256_storeu_pd(Best, LaneMin[r]);
+      _mm256_storeu_pd(BestItem, LaneItem[r]);
+      for (l = 0; l < LANES; l++)
+      {
+        if (BestItem[l] >= 0 &&
+            (Best[l] < MinA[i + r] || (Best[l] == MinA[i + r] && (uint32_t)BestItem[l] < NearA[i + r])))
+        {
+          MinA[i + r] = Best[l];
+          NearA[i + r] = (uint32_t)BestItem[l];
+        }
+      }
+    }
+  }
+}
+
+#define LANES_F 8
+
+/**
+ * Returns squared distances from the points to the segments a-b in single precision
+ */
+static __m256 SegDistF(__m256 px, __m256 py, __m256 ax, __m256 ay, __m256 bx, __m256 by)
+{
+  const __m256 v1x = _mm256_sub_ps(bx, ax);
+  const __m256 v1y = _mm256_sub_ps(by, ay);
+  const __m256 v2x = _mm256_sub_ps(px, ax);
+  const __m256 v2y = _mm256_sub_ps(py, ay);
+  const __m256 v3x = _mm256_sub_ps(px, bx);
+  const __m256 v3y = _mm256_sub_ps(py, by);
+  const __m256 SegLen2 = _mm256_add_ps(_mm256_mul_ps(v1x, v1x), _mm256_mul_ps(v1y, v1y));
+  const __m256 Proj = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(v1x, v2x), _mm256_mul_ps(v1y, v2y)), SegLen2);
+  const __m256 Cross = _mm256_sub_ps(_mm256_mul_ps(v1x, v2y), _mm256_mul_ps(v1y, v2x));
+  __m256 Result = _mm256_div_ps(_mm256_mul_ps(Cross, Cross), SegLen2);
+  Result = _mm256_blendv_ps(Result, _mm256_add_ps(_mm256_mul_ps(v2x, v2x), _mm256_mul_ps(v2y, v2y)),
+                            _mm256_cmp_ps(Proj, _mm256_setzero_ps(), _CMP_LT_OQ));
+  Result = _mm256_blendv_ps(Result, _mm256_add_ps(_mm256_mul_ps(v3x, v3x), _mm256_mul_ps(v3y, v3y)),
+                            _mm256_cmp_ps(Proj, _mm256_set1_ps(1), _CMP_GT_OQ));
+  return Result;
+}
+
+uint32_t IvcNearestNodeAvx2F(float **Curve, uint32_t SizeJ, const float *pt, uint32_t LocMinItem)
+{
+  uint32_t i, l;
+  float Best[LANES_F];
+  uint32_t BestItem[LANES_F];
+  float LocMin = 100000;
+  uint32_t Found = UINT32_MAX;
+  const __m256 px = _mm256_set1_ps(pt[0]);
+  const __m256 py = _mm256_set1_ps(pt[1]);
+  const __m256i Lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i Item = Lane;
+  __m256 LaneMin = _mm256_set1_ps(LocMin);
+  __m256i LaneItem = _mm256_setzero_si256();
+
+  /* The last group overlaps the previous one instead of a scalar tail */
+  for (i = 0; i < SizeJ; i += LANES_F)
+  {
+    if (i + LANES_F > SizeJ)
+    {
+      i = SizeJ - LANES_F;
+      Item = _mm256_add_epi32(_mm256_set1_epi32((int)i), Lane);
+    }
+    const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(Curve[0] + i), px);
+    const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(Curve[1] + i), py);
+    const __m256 v = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    const __m256 Less = _mm256_cmp_ps(v, LaneMin, _CMP_LT_OQ);
+    LaneMin = _mm256_blendv_ps(LaneMin, v, Less);
+    LaneItem = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(LaneItem), _mm256_castsi256_ps(Item), Less));
+    Item = _mm256_add_epi32(Item, _mm256_set1_epi32(LANES_F));
+  }
+
+  /* Each lane keeps its first minimum, the first node among the lanes wins */
+  _mm256_storeu_ps(Best, LaneMin);
+  _mm256_storeu_si256((__m256i *)BestItem, LaneItem);
+  for (l = 0; l < LANES_F; l++)
+  {
+    if (Best[l] < LocMin || (Best[l] == LocMin && Found != UINT32_MAX && BestItem[l] < Found))
+    {
+      LocMin = Best[l];
+      Found = BestItem[l];
+    }
+  }
+  return Found != UINT32_MAX ? Found : LocMinItem;
+}
+
+void IvcSegDistAvx2F(float **Curve, float **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                     const uint32_t *Nearest, float *Dist)
+{
+  uint32_t j;
+  const uint32_t End = First + Count;
+  const __m256i Zero = _mm256_setzero_si256();
+  const __m256i One = _mm256_set1_epi32(1);
+  const __m256i Last = _mm256_set1_epi32((int)(SizeJ - 1));
+  const __m256 Far = _mm256_set1_ps(10000);
+
+  for (j = First; j < End; j += LANES_F)
+  {
+    if (j + LANES_F > End)
+    {
+      j = End - LANES_F;
+    }
+    const __m256i Cur = _mm256_loadu_si256((const __m256i *)(Nearest + j));
+    const __m256i IsFirst = _mm256_cmpeq_epi32(Cur, Zero);
+    const __m256i IsLast = _mm256_cmpeq_epi32(Cur, Last);
+    /* Missing neighbours are replaced by the node itself and masked out */
+    const __m256i Prev = _mm256_add_epi32(_mm256_sub_epi32(Cur, One), _mm256_and_si256(IsFirst, One));
+    const __m256i Next = _mm256_sub_epi32(_mm256_add_epi32(Cur, One), _mm256_and_si256(IsLast, One));
+    const __m256 px = _mm256_loadu_ps(pts[0] + j);
+    const __m256 py = _mm256_loadu_ps(pts[1] + j);
+    const __m256 cx = _mm256_i32gather_ps(Curve[0], Cur, 4);
+    const __m256 cy = _mm256_i32gather_ps(Curve[1], Cur, 4);
+    __m256 Dist1 = SegDistF(px, py, _mm256_i32gather_ps(Curve[0], Prev, 4), _mm256_i32gather_ps(Curve[1], Prev, 4),
+                            cx, cy);
+    __m256 Dist2 = SegDistF(px, py, cx, cy, _mm256_i32gather_ps(Curve[0], Next, 4),
+                            _mm256_i32gather_ps(Curve[1], Next, 4));
+    Dist1 = _mm256_blendv_ps(Dist1, Far, _mm256_castsi256_ps(IsFirst));
+    Dist2 = _mm256_blendv_ps(Dist2, Far, _mm256_castsi256_ps(IsLast));
+    _mm256_storeu_ps(Dist + j, _mm256_min_ps(Dist1, Dist2));
+  }
+}
+
+void IvcNearestTileAvx2F(float **a, float **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                         float *MinA, uint32_t *NearA, float *MinB, uint32_t *NearB)
+{
+  uint32_t i, j, r, l;
+  float Best[LANES_F];
+  int32_t BestItem[LANES_F];
+  __m256 ax[ROWS], ay[ROWS], Node[ROWS], LaneMin[ROWS], LaneItem[ROWS];
+  const uint32_t EndA = FirstA + CountA;
+  const uint32_t EndB = FirstB + CountB;
+  const __m256i Lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+  /* The last groups overlap the previous points, they can not be strictly nearer than the found nodes */
+  for (i = FirstA; i < EndA; i += ROWS)
+  {
+    if (i + ROWS > EndA)
+    {
+      i = EndA - ROWS;
+    }
+    for (r = 0; r < ROWS; r++)
+    {
+      ax[r] = _mm256_set1_ps(a[0][i + r]);
+      ay[r] = _mm256_set1_ps(a[1][i + r]);
+      Node[r] = _mm256_castsi256_ps(_mm256_set1_epi32((int)(i + r)));
+      LaneMin[r] = _mm256_set1_ps(MinA[i + r]);
+      LaneItem[r] = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    }
+    __m256i Item = _mm256_add_epi32(_mm256_set1_epi32((int)FirstB), Lane);
+    for (j = FirstB; j < EndB; j += LANES_F)
+    {
+      if (j + LANES_F > EndB)
+      {
+        j = EndB - LANES_F;
+        Item = _mm256_add_epi32(_mm256_set1_epi32((int)j), Lane);
+      }
+      const __m256 bx = _mm256_loadu_ps(b[0] + j);
+      const __m256 by = _mm256_loadu_ps(b[1] + j);
+      __m256 Min = _mm256_loadu_ps(MinB + j);
+      __m256 Near = _mm256_loadu_ps((const float *)(NearB + j));
+      /* Rows are independent chains of comparisons, the points of the second curve see them in ascending order */
+      for (r = 0; r < ROWS; r++)
+      {
+        const __m256 dx = _mm256_sub_ps(bx, ax[r]);
+        const __m256 dy = _mm256_sub_ps(by, ay[r]);
+        const __m256 v = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        const __m256 Less = _mm256_cmp_ps(v, LaneMin[r], _CMP_LT_OQ);
+        const __m256 Nearer = _mm256_cmp_ps(v, Min, _CMP_LT_OQ);
+        LaneMin[r] = _mm256_blendv_ps(LaneMin[r], v, Less);
+        LaneItem[r] = _mm256_blendv_ps(LaneItem[r], _mm256_castsi256_ps(Item), Less);
+        Min = _mm256_blendv_ps(Min, v, Nearer);
+        Near = _mm256_blendv_ps(Near, Node[r], Nearer);
+      }
+      _mm256_storeu_ps(MinB + j, Min);
+      _mm256_storeu_ps((float *)(NearB + j), Near);
+      Item = _mm256_add_epi32(Item, _mm256_set1_epi32(LANES_F));
+    }
+
+    /* Lanes are changed only by strictly nearer nodes, the first node among the lanes wins */
+    for (r = 0; r < ROWS; r++)
+    {
+      _mm256_storeu_ps(Best, LaneMin[r]);
+      _mm256_storeu_si256((__m256i *)BestItem, _mm256_castps_si256(LaneItem[r]));
+      for (l = 0; l < LANES_F; l++)
+      {
+        if (BestItem[l] >= 0 &&
+            (Best[l] < MinA[i + r] || (Best[l] == MinA[i + r] && (uint32_t)BestItem[l] < NearA[i + r])))
+        {
+          MinA[i + r] = Best[l];
+          NearA[i + r] = (uint32_t)BestItem[l];
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,364 @@
+/* AVX-512 kernels of the distance stage.
+ * The arithmetic is the same as in the scalar code of ivcmp_dist.inc, so the results are identical.
+ * The module must be compiled with AVX-512F enabled and without contraction to FMA.
+ */
+#include <immintrin.h>
+#include "ivcmp_kernels.h"
+
+#define LANES 8
+#define ROWS 4 /**< Points of the first curve processed together by the tile kernels */
+
+/**
+ * Returns squared distances from the points to the segments a-b, see Dist2PtSeg()
+ */
+static __m512d SegDist(__m512d px, __m512d py, __m512d ax, __m512d ay, __m512d bx, __m512d by)
+{
+  const __m512d v1x = _mm512_sub_pd(bx, ax);
+  const __m512d v1y = _mm512_sub_pd(by, ay);
+  const __m512d v2x = _mm512_sub_pd(px, ax);
+  const __m512d v2y = _mm512_sub_pd(py, ay);
+  const __m512d v3x = _mm512_sub_pd(px, bx);
+  const __m512d v3y = _mm512_sub_pd(py, by);
+  const __m512d SegLen2 = _mm512_add_pd(_mm512_mul_pd(v1x, v1x), _mm512_mul_pd(v1y, v1y));
+  const __m512d Proj = _mm512_div_pd(_mm512_add_pd(_mm512_mul_pd(v1x, v2x), _mm512_mul_pd(v1y, v2y)), SegLen2);
+  const __m512d Cross = _mm512_sub_pd(_mm512_mul_pd(v1x, v2y), _mm512_mul_pd(v1y, v2x));
+  __m512d Result = _mm512_div_pd(_mm512_mul_pd(Cross, Cross), SegLen2);
+  Result = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(Proj, _mm512_setzero_pd(), _CMP_LT_OQ), Result,
+                                _mm512_add_pd(_mm512_mul_pd(v2x, v2x), _mm512_mul_pd(v2y, v2y)));
+  Result = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(Proj, _mm512_set1_pd(1), _CMP_GT_OQ), Result,
+                                _mm512_add_pd(_mm512_mul_pd(v3x, v3x), _mm512_mul_pd(v3y, v3y)));
+  return Result;
+}
+
+uint32_t IvcNearestNodeAvx512(double **Curve, uint32_t SizeJ, const double *pt, uint32_t LocMinItem)
+{
+  uint32_t i, l;
+  double Best[LANES], BestItem[LANES];
+  double LocMin = 100000;
+  uint32_t Found = UINT32_MAX;
+  const __m512d px = _mm512_set1_pd(pt[0]);
+  const __m512d py = _mm512_set1_pd(pt[1]);
+  const __m512d Lane = _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7);
+  __m512d Item = Lane;
+  __m512d LaneMin = _mm512_set1_pd(LocMin);
+  __m512d LaneItem = _mm512_setzero_pd();
+
+  /* The last group overlaps the previous one instead of a scalar tail */
+  for (i = 0; i < SizeJ; i += LANES)
+  {
+    if (i + LANES > SizeJ)
+    {
+      i = SizeJ - LANES;
+      Item = _mm512_add_pd(_mm512_set1_pd(i), Lane);
+    }
+    const __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(Curve[0] + i), px);
+    const __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(Curve[1] + i), py);
+    const __m512d v = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+    const __mmask8 Less = _mm512_cmp_pd_mask(v, LaneMin, _CMP_LT_OQ);
+    LaneMin = _mm512_mask_blend_pd(Less, LaneMin, v);
+    LaneItem = _mm512_mask_blend_pd(Less, LaneItem, Item);
+    Item = _mm512_add_pd(Item, _mm512_set1_pd(LANES));
+  }
+
+  /* Each lane keeps its first minimum, the first node among the lanes wins */
+  _mm512_storeu_pd(Best, LaneMin);
+  _mm512_storeu_pd(BestItem, LaneItem);
+  for (l = 0; l < LANES; l++)
+  {
+    if (Best[l] < LocMin || (Best[l] == LocMin && Found != UINT32_MAX && (uint32_t)BestItem[l] < Found))
+    {
+      LocMin = Best[l];
+      Found = (uint32_t)BestItem[l];
+    }
+  }
+  return Found != UINT32_MAX ? Found : LocMinItem;
+}
+
+void IvcSegDistAvx512(double **Curve, double **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                      const uint32_t *Nearest, double *Dist)
+{
+  uint32_t j;
+  const uint32_t End = First + Count;
+  const __m256i Zero = _mm256_setzero_si256();
+  const __m256i One = _mm256_set1_epi32(1);
+  const __m256i Last = _mm256_set1_epi32((int)(SizeJ - 1));
+  const __m512d Far = _mm512_set1_pd(10000);
+
+  for (j = First; j < End; j += LANES)
+  {
+    if (j + LANES > End)
+    {
+      j = End - LANES;
+    }
+    const __m256i Cur = _mm256_loadu_si256((const __m256i *)(Nearest + j));
+    const __m256i IsFirst = _mm256_cmpeq_epi32(Cur, Zero);
+    const __m256i IsLast = _mm256_cmpeq_epi32(Cur, Last);
+    /* Missing neighbours are replaced by the node itself and masked out */
+    const __m256i Prev = _mm256_add_epi32(_mm256_sub_epi32(Cur, One), _mm256_and_si256(IsFirst, One));
+    const __m256i Next = _mm256_sub_epi32(_mm256_add_epi32(Cur, One), _mm256_and_si256(IsLast, One));
+    const __m512d px = _mm512_loadu_pd(pts[0] + j);
+    const __m512d py = _mm512_loadu_pd(pts[1] + j);
+    const __m512d cx = _mm512_i32gather_pd(Cur, Curve[0], 8);
+    const __m512d cy = _mm512_i32gather_pd(Cur, Curve[1], 8);
+    __m512d Dist1 = SegDist(px, py, _mm512_i32gather_pd(Prev, Curve[0], 8), _mm512_i32gather_pd(Prev, Curve[1], 8),
+                            cx, cy);
+    __m512d Dist2 = SegDist(px, py, cx, cy, _mm512_i32gather_pd(Next, Curve[0], 8),
+                            _mm512_i32gather_pd(Next, Curve[1], 8));
+    Dist1 = _mm512_mask_blend_pd((__mmask8)_mm256_movemask_ps(_mm256_castsi256_ps(IsFirst)), Dist1, Far);
+    Dist2 = _mm512_mask_blend_pd((__mmask8)_mm256_movemask_ps(_mm256_castsi256_ps(IsLast)), Dist2, Far);
+    /* min_pd returns the second operand unless the first one is less, as min() does */
+    _mm512_storeu_pd(Dist + j, _mm512_min_pd(Dist1, Dist2));
+  }
+}
+
+void IvcNearestTileAvx512(double **a, double **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                          double *MinA, uint32_t *NearA, double *MinB, uint32_t *NearB)
+{
+  uint32_t i, j, r, l;
+  double Best[LANES], BestItem[LANES];
+  __m512d ax[ROWS], ay[ROWS], Node[ROWS], LaneMin[ROWS], LaneItem[ROWS];
+  const uint32_t EndA = FirstA + CountA;
+  const uint32_t EndB = FirstB + CountB;
+  const __m512d Lane = _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7);
+
+  /* The last groups overlap the previous points, they can not be strictly nearer than the found nodes */
+  for (i = FirstA; i < EndA; i += ROWS)
+  {
+    if (i + ROWS > EndA)
+    {
+      i = EndA - ROWS;
+    }
+    for (r = 0; r < ROWS; r++)
+    {
+      ax[r] = _mm512_set1_pd(a[0][i + r]);
+      ay[r] = _mm512_set1_pd(a[1][i + r]);
+      Node[r] = _mm512_set1_pd(i + r);
+      LaneMin[r] = _mm512_set1_pd(MinA[i + r]);
+      LaneItem[r] = _mm512_set1_pd(-1);
+    }
+    __m512d Item = _mm512_add_pd(_mm512_set1_pd(FirstB), Lane);
+    for (j = FirstB; j < EndB; j += LANES)
+    {
+      if (j + LANES > EndB)
+      {
+        j = EndB - LANES;
+        Item = _mm512_add_pd(_mm512_set1_pd(j), Lane);
+      }
+      const __m512d bx = _mm512_loadu_pd(b[0] + j);
+      const __m512d by = _mm512_loadu_pd(b[1] + j);
+      __m512d Min = _mm512_loadu_pd(MinB + j);
+      __m512d Near = _mm512_cvtepi32_pd(_mm256_loadu_si256((const __m256i *)(NearB + j)));
+      /* Rows are independent chains of comparisons, the points of the second curve see them in ascending order */
+      for (r = 0; r < ROWS; r++)
+      {
+        const __m512d dx = _mm512_sub_pd(bx, ax[r]);
+        const __m512d dy = _mm512_sub_pd(by, ay[r]);
+        const __m512d v = _mm512_add_pd(_mm512_mul_pd(dx, dx), _mm512_mul_pd(dy, dy));
+        const __mmask8 Less = _mm512_cmp_pd_mask(v, LaneMin[r], _CMP_LT_OQ);
+        const __mmask8 Nearer = _mm512_cmp_pd_mask(v, Min, _CMP_LT_OQ);
+        LaneMin[r] = _mm512_mask_blend_pd(Less, LaneMin[r], v);
+        LaneItem[r] = _mm512_mask_blend_pd(Less, LaneItem[r], Item);
+        Min = _mm512_mask_blend_pd(Nearer, Min, v);
+        Near = _mm512_mask_blend_pd(Nearer, Near, Node[r]);
+      }
+      _mm512_storeu_pd(MinB + j, Min);
+      _mm256_storeu_si256((__m256i *)(NearB + j), _mm512_cvttpd_epi32(Near));
+      Item = _mm512_add_pd(Item, _mm512_set1_pd(LANES));
+    }
+
+    /* Lanes are changed only by strictly nearer nodes, the first node among the lanes wins */
+    for (r = 0; r < ROWS; r++)
+    {
+      _mm512_storeu_pd(Best, LaneMin[r]);
+      _mm512_storeu_pd(BestItem, LaneItem[r]);
+      for (l = 0; l < LANES; l++)
+      {
+        if (BestItem[l] >= 0 &&
+            (Best[l] < MinA[i + r] || (Best[l] == MinA[i + r] && (uint32_t)BestItem[l] < NearA[i + r])))
+        {
+          MinA[i + r] = Best[l];
+          NearA[i + r] = (uint32_t)BestItem[l];
+        }
+      }
+    }
+  }
+}
+
+#define LANES_F 16
+
+/**
+ * Returns squared distances from the points to the segments a-b in single precision
+ */
+static __m512 SegDistF(__m512 px, __m512 py, __m512 ax, __m512 ay, __m512 bx, __m512 by)
+{
+  const __m512 v1x = _mm512_sub_ps(bx, ax);
+  const __m512 v1y = _mm512_sub_ps(by, ay);
+  const __m512 v2x = _mm512_sub_ps(px, ax);
+  const __m512 v2y = _mm512_sub_ps(py, ay);
+  const __m512 v3x = _mm512_sub_ps(px, bx);
+  const __m512 v3y = _mm512_sub_ps(py, by);
+  const __m512 SegLen2 = _mm512_add_ps(_mm512_mul_ps(v1x, v1x), _mm512_mul_ps(v1y, v1y));
+  const __m512 Proj = _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(v1x, v2x), _mm512_mul_ps(v1y, v2y)), SegLen2);
+  const __m512 Cross = _mm512_sub_ps(_mm512_mul_ps(v1x, v2y), _mm512_mul_ps(v1y, v2x));
+  __m512 Result = _mm512_div_ps(_mm512_mul_ps(Cross, Cross), SegLen2);
+  Result = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(Proj, _mm512_setzero_ps(), _CMP_LT_OQ), Result,
+                                _mm512_add_ps(_mm512_mul_ps(v2x, v2x), _mm512_mul_ps(v2y, v2y)));
+  Result = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(Proj, _mm512_set1_ps(1), _CMP_GT_OQ), Result,
+                                _mm512_add_ps(_mm512_mul_ps(v3x, v3x), _mm512_mul_ps(v3y, v3y)));
+  return Result;
+}
+
+uint32_t IvcNearestNodeAvx512F(float **Curve, uint32_t SizeJ, const float *pt, uint32_t LocMinItem)
+{
+  uint32_t i, l;
+  float Best[LANES_F];
+  uint32_t BestItem[LANES_F];
+  float LocMin = 100000;
+  uint32_t Found = UINT32_MAX;
+  const __m512 px = _mm512_set1_ps(pt[0]);
+  const __m512 py = _mm512_set1_ps(pt[1]);
+  const __m512i Lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  __m512i Item = Lane;
+  __m512 LaneMin = _mm512_set1_ps(LocMin);
+  __m512i LaneItem = _mm512_setzero_si512();
+
+  /* The last group overlaps the previous one instead of a scalar tail */
+  for (i = 0; i < SizeJ; i += LANES_F)
+  {
+    if (i + LANES_F > SizeJ)
+    {
+      i = SizeJ - LANES_F;
+      Item = _mm512_add_epi32(_mm512_set1_epi32((int)i), Lane);
+    }
+    const __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(Curve[0] + i), px);
+    const __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(Curve[1] + i), py);
+    const __m512 v = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+    const __mmask16 Less = _mm512_cmp_ps_mask(v, LaneMin, _CMP_LT_OQ);
+    LaneMin = _mm512_mask_blend_ps(Less, LaneMin, v);
+    LaneItem = _mm512_mask_blend_epi32(Less, LaneItem, Item);
+    Item = _mm512_add_epi32(Item, _mm512_set1_epi32(LANES_F));
+  }
+
+  /* Each lane keeps its first minimum, the first node among the lanes wins */
+  _mm512_storeu_ps(Best, LaneMin);
+  _mm512_storeu_si512(BestItem, LaneItem);
+  for (l = 0; l < LANES_F; l++)
+  {
+    if (Best[l] < LocMin || (Best[l] == LocMin && Found != UINT32_MAX && BestItem[l] < Found))
+    {
+      LocMin = Best[l];
+      Found = BestItem[l];
+    }
+  }
+  return Found != UINT32_MAX ? Found : LocMinItem;
+}
+
+void IvcSegDistAvx512F(float **Curve, float **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                       const uint32_t *Nearest, float *Dist)
+{
+  uint32_t j;
+  const uint32_t End = First + Count;
+  const __m512i One = _mm512_set1_epi32(1);
+  const __m512i Last = _mm512_set1_epi32((int)(SizeJ - 1));
+  const __m512 Far = _mm512_set1_ps(10000);
+
+  for (j = First; j < End; j += LANES_F)
+  {
+    if (j + LANES_F > End)
+    {
+      j = End - LANES_F;
+    }
+    const __m512i Cur = _mm512_loadu_si512(Nearest + j);
+    const __mmask16 IsFirst = _mm512_cmpeq_epi32_mask(Cur, _mm512_setzero_si512());
+    const __mmask16 IsLast = _mm512_cmpeq_epi32_mask(Cur, Last);
+    /* Missing neighbours are replaced by the node itself and masked out */
+    const __m512i Prev = _mm512_mask_sub_epi32(Cur, (__mmask16)~IsFirst, Cur, One);
+    const __m512i Next = _mm512_mask_add_epi32(Cur, (__mmask16)~IsLast, Cur, One);
+    const __m512 px = _mm512_loadu_ps(pts[0] + j);
+    const __m512 py = _mm512_loadu_ps(pts[1] + j);
+    const __m512 cx = _mm512_i32gather_ps(Cur, Curve[0], 4);
+    const __m512 cy = _mm512_i32gather_ps(Cur, Curve[1], 4);
+    __m512 Dist1 = SegDistF(px, py, _mm512_i32gather_ps(Prev, Curve[0], 4), _mm512_i32gather_ps(Prev, Curve[1], 4),
+                            cx, cy);
+    __m512 Dist2 = SegDistF(px, py, cx, cy, _mm512_i32gather_ps(Next, Curve[0], 4),
+                            _mm512_i32gather_ps(Next, Curve[1], 4));
+    Dist1 = _mm512_mask_blend_ps(IsFirst, Dist1, Far);
+    Dist2 = _mm512_mask_blend_ps(IsLast, Dist2, Far);
+    _mm512_storeu_ps(Dist + j, _mm512_min_ps(Dist1, Dist2));
+  }
+}
+
+void IvcNearestTileAvx512F(float **a, float **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                           float *MinA, uint32_t *NearA, float *MinB, uint32_t *NearB)
+{
+  uint32_t i, j, r, l;
+  float Best[LANES_F];
+  int32_t BestItem[LANES_F];
+  __m512 ax[ROWS], ay[ROWS], LaneMin[ROWS];
+  __m512i Node[ROWS], LaneItem[ROWS];
+  const uint32_t EndA = FirstA + CountA;
+  const uint32_t EndB = FirstB + CountB;
+  const __m512i Lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+  /* The last groups overlap the previous points, they can not be strictly nearer than the found nodes */
+  for (i = FirstA; i < EndA; i += ROWS)
+  {
+    if (i + ROWS > EndA)
+    {
+      i = EndA - ROWS;
+    }
+    for (r = 0; r < ROWS; r++)
+    {
+      ax[r] = _mm512_set1_ps(a[0][i + r]);
+      ay[r] = _mm512_set1_ps(a[1][i + r]);
+      Node[r] = _mm512_set1_epi32((int)(i + r));
+      LaneMin[r] = _mm512_set1_ps(MinA[i + r]);
+      LaneItem[r] = _mm512_set1_epi32(-1);
+    }
+    __m512i Item = _mm512_add_epi32(_mm512_set1_epi32((int)FirstB), Lane);
+    for (j = FirstB; j < EndB; j += LANES_F)
+    {
+      if (j + LANES_F > EndB)
+      {
+        j = EndB - LANES_F;
+        Item = _mm512_add_epi32(_mm512_set1_epi32((int)j), Lane);
+      }
+      const __m512 bx = _mm512_loadu_ps(b[0] + j);
+      const __m512 by = _mm512_loadu_ps(b[1] + j);
+      __m512 Min = _mm512_loadu_ps(MinB + j);
+      __m512i Near = _mm512_loadu_si512(NearB + j);
+      /* Rows are independent chains of comparisons, the points of the second curve see them in ascending order */
+      for (r = 0; r < ROWS; r++)
+      {
+        const __m512 dx = _mm512_sub_ps(bx, ax[r]);
+        const __m512 dy = _mm512_sub_ps(by, ay[r]);
+        const __m512 v = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+        const __mmask16 Less = _mm512_cmp_ps_mask(v, LaneMin[r], _CMP_LT_OQ);
+        const __mmask16 Nearer = _mm512_cmp_ps_mask(v, Min, _CMP_LT_OQ);
+        LaneMin[r] = _mm512_mask_blend_ps(Less, LaneMin[r], v);
+        LaneItem[r] = _mm512_mask_blend_epi32(Less, LaneItem[r], Item);
+        Min = _mm512_mask_blend_ps(Nearer, Min, v);
+        Near = _mm512_mask_blend_epi32(Nearer, Near, Node[r]);
+      }
+      _mm512_storeu_ps(MinB + j, Min);
+      _mm512_storeu_si512(NearB + j, Near);
+      Item = _mm512_add_epi32(Item, _mm512_set1_epi32(LANES_F));
+    }
+
+    /* Lanes are changed only by strictly nearer nodes, the first node among the lanes wins */
+    for (r = 0; r < ROWS; r++)
+    {
+      _mm512_storeu_ps(Best, LaneMin[r]);
+      _mm512_storeu_si512(BestItem, LaneItem[r]);
+      for (l = 0; l < LANES_F; l++)
+      {
+        if (BestItem[l] >= 0 &&
+            (Best[l] < MinA[i + r] || (Best[l] == MinA[i + r] && (uint32_t)BestItem[l] < NearA[i + r])))
+        {
+          MinA[i + r] = Best[l];
+          NearA[i + r] = (uint32_t)BestItem[l];
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,666 @@
+/* Benchmark of the comparison of curves. Usage:
+ *   ivcmp_bench [-t seconds] [-n sizes] [-o results.csv] [-b baseline.csv] [-r percent] [file.json...]
+ * Pairs of the synthetic curves of the test generators (resistors, capacitor, open and short circuits)
+ * are compared for each size, the pins of the given EyePoint board files are replayed as one more case.
+ * For each case the tool writes CSV with the throughput, percentiles of the latency of CompareIVCWithContext()
+ * and the time of the stages: normalization, repeats removal, B-spline and distances between the curves.
+ * With a baseline (earlier output of the tool) the throughput of each case is checked,
+ * the exit code is 2 if it dropped by more than the given percent.
+ * The stages are timed by the statistics of the library (IVCMP_STATS), see SetIVCStatsTimers().
+ */
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS /* fopen() is used for portability */
+#endif
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ivcmp.h"
+#include "ivcmp_json.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define DEFAULT_SECONDS 0.2          /**< Time of the measurement of a case */
+#define DEFAULT_SIZES "20,100,200,1000,2000,5000,10000,20000" /**< Sizes of the synthetic curves */
+#define DEFAULT_REGRESSION 10.       /**< Allowed drop of the throughput, percent */
+#define MIN_CALLS 1                  /**< Least number of the timed comparisons of a case */
+#define MIN_CURVE_POINTS 3           /**< Least number of points of the compared curves */
+#define MAX_CASE_NAME 32             /**< Maximum length of the name of a case */
+#define MIN_VAR_FACTOR 0.03          /**< Scaling thresholds relative to the measurement ranges */
+#define BENCH_VOLTAGE_AMPL 12.       /**< Amplitudes of the synthetic curves, as in the example */
+#define BENCH_CURRENT_AMPL (BENCH_VOLTAGE_AMPL / 475. * 1000)
+#define BENCH_NOISE 0.01             /**< Noise of the synthetic curves relative to the amplitudes */
+
+static const char *StageNames[IVCMP_NUM_STAGES] = {"normalize_us", "remove_repeats_us", "bspline_us", "distance_us"};
+
+/**
+ * Pairs of curves compared in one case, curves are stored one after another
+ */
+typedef struct
+{
+  char Name[MAX_CASE_NAME]; /**< Name of the case */
+  double *Voltages[2];      /**< Voltages of the first and the second curves of the pairs */
+  double *Currents[2];      /**< Currents of the first and the second curves of the pairs */
+  size_t *Offsets[2];       /**< NumPairs + 1 offsets of the curves */
+  double *MinVarV;          /**< Scaling thresholds of each pair */
+  double *MinVarC;
+  size_t NumPairs;          /**< Number of pairs */
+  size_t Capacity;          /**< Number of pairs the offsets can store */
+  size_t Points[2];         /**< Number of points the curve arrays can store */
+  uint32_t MaxLength;       /**< Largest number of points of a curve */
+} bench_case_t;
+
+/**
+ * Result of a case
+ */
+typedef struct
+{
+  size_t Calls;              /**< Number of timed comparisons */
+  size_t Failed;             /**< Number of pairs that could not be compared */
+  size_t Mismatches;         /**< Number of pairs whose score with the stage timers differs from the one without */
+  double PairsPerSecond;     /**< Throughput */
+  double Percentiles[3];     /**< 50, 90 and 99 percentiles of the latency, microseconds */
+  double Stages[IVCMP_NUM_STAGES]; /**< Mean time of each stage per pair, microseconds */
+} bench_result_t;
+
+/**
+ * Gives the time of a monotonic clock
+ *
+ * @return time in seconds
+ */
+static double BenchNow(void)
+{
+#if defined(_WIN32)
+  LARGE_INTEGER Counter, Frequency;
+  QueryPerformanceCounter(&Counter);
+  QueryPerformanceFrequency(&Frequency);
+  return (double)Counter.QuadPart / (double)Frequency.QuadPart;
+#else
+  struct timespec Time;
+  clock_gettime(CLOCK_MONOTONIC, &Time);
+  return (double)Time.tv_sec + (double)Time.tv_nsec * 1e-9;
+#endif
+}
+
+/**
+ * Grows the array of doubles if needed
+ *
+ * @param Values array allocated with malloc()
+ * @param Capacity number of values the array can store
+ * @param[in] Count number of values to be stored
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int ReserveDoubles(double **Values, size_t *Capacity, size_t Count)
+{
+  double *NewValues;
+  if (Count <= *Capacity)
+  {
+    return 1;
+  }
+  NewValues = (double *)realloc(*Values, (Count + *Capacity) * sizeof(double));
+  if (!NewValues)
+  {
+    return 0;
+  }
+  *Values = NewValues;
+  *Capacity = Count + *Capacity;
+  return 1;
+}
+
+/**
+ * Adds a pair of curves to the case
+ *
+ * @param Case case
+ * @param[in] Voltages voltages of the first and the second curves
+ * @param[in] Currents currents of the first and the second curves
+ * @param[in] Lengths numbers of points of the curves
+ * @param[in] MinVarV voltage scaling threshold of the pair
+ * @param[in] MinVarC current scaling threshold of the pair
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int AddPair(bench_case_t *Case, double *const *Voltages, double *const *Currents, const size_t *Lengths,
+                   double MinVarV, double MinVarC)
+{
+  size_t k, Offset, Capacity;
+  size_t *NewOffsets;
+  double *NewValues;
+
+  if (Case->NumPairs + 2 > Case->Capacity)
+  {
+    Capacity = Case->Capacity * 2 + 64;
+    for (k = 0; k < 2; k++)
+    {
+      NewOffsets = (size_t *)realloc(Case->Offsets[k], Capacity * sizeof(size_t));
+      if (!NewOffsets)
+      {
+        return 0;
+      }
+      NewOffsets[0] = Case->NumPairs == 0 ? 0 : NewOffsets[0];
+      Case->Offsets[k] = NewOffsets;
+    }
+    NewValues = (double *)realloc(Case->MinVarV, Capacity * sizeof(double));
+    if (!NewValues)
+    {
+      return 0;
+    }
+    Case->MinVarV = NewValues;
+    NewValues = (double *)realloc(Case->MinVarC, Capacity * sizeof(double));
+    if (!NewValues)
+    {
+      return 0;
+    }
+    Case->MinVarC = NewValues;
+    Case->Capacity = Capacity;
+  }
+  for (k = 0; k < 2; k++)
+  {
+    Offset = Case->Offsets[k][Case->NumPairs];
+    Capacity = Case->Points[k];
+    if (!ReserveDoubles(&Case->Voltages[k], &Capacity, Offset + Lengths[k]) ||
+        !ReserveDoubles(&Case->Currents[k], &Case->Points[k], Offset + Lengths[k]))
+    {
+      return 0;
+    }
+    memcpy(Case->Voltages[k] + Offset, Voltages[k], Lengths[k] * sizeof(double));
+    memcpy(Case->Currents[k] + Offset, Currents[k], Lengths[k] * sizeof(double));
+    Case->Offsets[k][Case->NumPairs + 1] = Offset + Lengths[k];
+    Case->MaxLength = Case->MaxLength > (uint32_t)Lengths[k] ? Case->MaxLength : (uint32_t)Lengths[k];
+  }
+  Case->MinVarV[Case->NumPairs] = MinVarV;
+  Case->MinVarC[Case->NumPairs] = MinVarC;
+  Case->NumPairs++;
+  return 1;
+}
+
+/**
+ * Frees the memory of the case
+ *
+ * @param Case case
+ */
+static void FreeCase(bench_case_t *Case)
+{
+  size_t k;
+  for (k = 0; k < 2; k++)
+  {
+    free(Case->Voltages[k]);
+    free(Case->Currents[k]);
+    free(Case->Offsets[k]);
+  }
+  free(Case->MinVarV);
+  free(Case->MinVarC);
+  memset(Case, 0, sizeof(bench_case_t));
+}
+
+/**
+ * Gives the next pseudo-random noise value, the same on all platforms
+ *
+ * @param State state of the generator
+ *
+ * @return value from -1 to 1
+ */
+static double Noise(uint32_t *State)
+{
+  *State = *State * 1664525u + 1013904223u;
+  return (double)(*State >> 8) / (double)(1u << 23) - 1.;
+}
+
+/**
+ * Generates a synthetic curve of the test generators: A * sin(t) + noise, B * sin(t + Phase) + noise
+ *
+ * @param[out] Voltages voltages
+ * @param[out] Currents currents
+ * @param[in] Length number of points
+ * @param[in] AmplV voltage amplitude relative to BENCH_VOLTAGE_AMPL
+ * @param[in] AmplC current amplitude relative to BENCH_CURRENT_AMPL
+ * @param[in] Phase phase of the current, radians
+ * @param State state of the noise generator
+ */
+static void GenerateCurve(double *Voltages, double *Currents, size_t Length, double AmplV, double AmplC,
+                          double Phase, uint32_t *State)
+{
+  size_t i;
+  double t;
+  for (i = 0; i < Length; i++)
+  {
+    t = 2 * M_PI * (double)i / (double)Length;
+    Voltages[i] = BENCH_VOLTAGE_AMPL * (AmplV * sin(t) + BENCH_NOISE * Noise(State));
+    Currents[i] = BENCH_CURRENT_AMPL * (AmplC * sin(t + Phase) + BENCH_NOISE * Noise(State));
+  }
+}
+
+/**
+ * Creates the synthetic case: resistor with a similar resistor, capacitor with resistor
+ * or open circuit with short circuit
+ *
+ * @param Case empty case
+ * @param[in] Kind 0 - resistors, 1 - capacitor, 2 - open and short circuits
+ * @param[in] Length number of points of the curves
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int CreateSyntheticCase(bench_case_t *Case, int Kind, size_t Length)
+{
+  static const char *Names[3] = {"resistor", "capacitor", "open_short"};
+  /* Amplitudes and phase of the first and the second curves */
+  static const double Curves[3][2][3] = {
+    {{0.5, 0.5, 0.}, {0.47, 0.63, 0.}},
+    {{1., 1., M_PI / 2}, {0.5, 0.5, 0.}},
+    {{1., 0., 0.}, {0., 1., 0.}}
+  };
+  double *Voltages[2], *Currents[2];
+  size_t Lengths[2];
+  size_t k;
+  uint32_t State = 1;
+  int Ok;
+
+  strcpy(Case->Name, Names[Kind]);
+  Voltages[0] = (double *)malloc(4 * Length * sizeof(double));
+  if (!Voltages[0])
+  {
+    return 0;
+  }
+  Voltages[1] = Voltages[0] + Length;
+  Currents[0] = Voltages[1] + Length;
+  Currents[1] = Currents[0] + Length;
+  for (k = 0; k < 2; k++)
+  {
+    GenerateCurve(Voltages[k], Currents[k], Length, Curves[Kind][k][0], Curves[Kind][k][1], Curves[Kind][k][2],
+                  &State);
+    Lengths[k] = Length;
+  }
+  Ok = AddPair(Case, Voltages, Currents, Lengths, BENCH_VOLTAGE_AMPL * MIN_VAR_FACTOR,
+               BENCH_CURRENT_AMPL * MIN_VAR_FACTOR);
+  free(Voltages[0]);
+  return Ok;
+}
+
+/**
+ * Adds the curves of the pin of the board file to the case.
+ * Pins without curves or measurement ranges are skipped.
+ *
+ * @param Data case
+ * @param[in] Pin pin
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int AddBoardPin(void *Data, const board_pin_t *Pin)
+{
+  size_t k, Lengths[2];
+  double *Voltages[2], *Currents[2];
+  const ivcmp_measure_settings_t *Settings = &Pin->Curves[0].Settings;
+
+  for (k = 0; k < 2; k++)
+  {
+    Voltages[k] = Pin->Curves[k].Voltages;
+    Currents[k] = Pin->Curves[k].Currents;
+    Lengths[k] = Pin->Curves[k].NumVoltages < Pin->Curves[k].NumCurrents ? Pin->Curves[k].NumVoltages :
+                 Pin->Curves[k].NumCurrents;
+  }
+  /* Thresholds follow the measurement ranges of the measured curve, as in ivcmp_board */
+  if (Lengths[0] < MIN_CURVE_POINTS || Lengths[1] < MIN_CURVE_POINTS || !(Settings->MaxVoltage > 0) ||
+      !(Settings->MaxCurrent > 0))
+  {
+    return 1;
+  }
+  return AddPair((bench_case_t *)Data, Voltages, Currents, Lengths, MIN_VAR_FACTOR * Settings->MaxVoltage,
+                 MIN_VAR_FACTOR * Settings->MaxCurrent);
+}
+
+/**
+ * Adds the pins of the board file to the case
+ *
+ * @param Reader reader of the files
+ * @param Pin storage of the pins
+ * @param Case case
+ * @param[in] FileName name of the file
+ *
+ * @return 1 on success, 0 on error
+ */
+static int ReadBoardFile(json_reader_t *Reader, board_pin_t *Pin, bench_case_t *Case, const char *FileName)
+{
+  int Ok;
+  FILE *File = fopen(FileName, "rb");
+  if (!File)
+  {
+    return 0;
+  }
+  JsonInit(Reader, File);
+  Ok = JsonReadBoard(Reader, Pin, AddBoardPin, Case);
+  fclose(File);
+  return Ok;
+}
+
+/**
+ * Compares the doubles for qsort()
+ */
+static int CompareDoubles(const void *a, const void *b)
+{
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+/**
+ * Measures the case: times the comparisons of its pairs with CompareIVCWithContext()
+ * for the given time, on the first pass each pair is compared once more with the stage timers of the library
+ *
+ * @param Ctx comparison context
+ * @param[in] Case case
+ * @param[in] Seconds time of the measurement of the comparisons
+ * @param[out] Result result
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int RunCase(ivcmp_context_t *Ctx, const bench_case_t *Case, double Seconds, bench_result_t *Result)
+{
+  size_t i, k, Pair, Capacity = 0;
+  double Start, Time, Total = 0., Score, StagedScore;
+  double *Latencies = NULL;
+  ivcmp_stats_t Stats;
+  double *Voltages[2], *Currents[2];
+  uint32_t Lengths[2];
+  size_t NumStaged = 0;
+  ivcmp_status_t Status;
+  static const double Levels[3] = {0.5, 0.9, 0.99};
+
+  memset(Result, 0, sizeof(bench_result_t));
+  ResetIVCStats();
+  /* Whole passes over the pairs, at least MIN_CALLS comparisons */
+  for (Pair = 0; Total < Seconds || Pair % Case->NumPairs != 0 || Result->Calls < MIN_CALLS; Pair++)
+  {
+    i = Pair % Case->NumPairs;
+    for (k = 0; k < 2; k++)
+    {
+      Voltages[k] = Case->Voltages[k] + Case->Offsets[k][i];
+      Currents[k] = Case->Currents[k] + Case->Offsets[k][i];
+      Lengths[k] = (uint32_t)(Case->Offsets[k][i + 1] - Case->Offsets[k][i]);
+    }
+    SetContextMinVarVC(Ctx, Case->MinVarV[i], Case->MinVarC[i]);
+    Start = BenchNow();
+    Status = CompareIVCWithContext(Ctx, Voltages[0], Currents[0], Lengths[0], Voltages[1], Currents[1], Lengths[1],
+                                   &Score);
+    Time = BenchNow() - Start;
+    Total += Time;
+    if (!ReserveDoubles(&Latencies, &Capacity, Result->Calls + 1))
+    {
+      free(Latencies);
+      return 0;
+    }
+    Latencies[Result->Calls++] = Time;
+
+    /* Stages are timed on the first pass only */
+    if (Pair < Case->NumPairs)
+    {
+      if (Status != IVCMP_OK)
+      {
+        Result->Failed++;
+        continue;
+      }
+      /* Stage timers are kept out of the measured latencies */
+      SetIVCStatsTimers(1);
+      Status = CompareIVCWithContext(Ctx, Voltages[0], Currents[0], Lengths[0], Voltages[1], Currents[1],
+                                     Lengths[1], &StagedScore);
+      SetIVCStatsTimers(0);
+      if (Status != IVCMP_OK || StagedScore != Score)
+      {
+        Result->Mismatches++;
+      }
+      NumStaged++;
+    }
+  }
+
+  qsort(Latencies, Result->Calls, sizeof(double), CompareDoubles);
+  for (k = 0; k < 3; k++)
+  {
+    Result->Percentiles[k] = Latencies[(size_t)(Levels[k] * (double)(Result->Calls - 1))] * 1e6;
+  }
+  Result->PairsPerSecond = (double)Result->Calls / Total;
+  /* Zero times if the library is built without IVCMP_STATS */
+  GetIVCStats(&Stats);
+  for (k = 0; k < IVCMP_NUM_STAGES; k++)
+  {
+    Result->Stages[k] = NumStaged > 0 ? (double)Stats.StageTime[k] / (double)NumStaged * 1e-3 : 0.;
+  }
+  free(Latencies);
+  return 1;
+}
+
+/**
+ * Writes the result of the case as a CSV line and checks it against the baseline
+ *
+ * @param Output output file
+ * @param[in] Case case
+ * @param[in] Result result
+ * @param Baseline baseline file or NULL
+ * @param[in] Regression allowed drop of the throughput, percent
+ *
+ * @return 1 if the throughput did not drop, 0 otherwise
+ */
+static int ReportCase(FILE *Output, const bench_case_t *Case, const bench_result_t *Result, FILE *Baseline,
+                      double Regression)
+{
+  size_t k;
+  char Line[512];
+  char Name[MAX_CASE_NAME];
+  unsigned long Points;
+  double BaselinePairsPerSecond;
+
+  fprintf(Output, "%s,%u,%lu,%.1f", Case->Name, Case->MaxLength, (unsigned long)Case->NumPairs,
+          Result->PairsPerSecond);
+  for (k = 0; k < 3; k++)
+  {
+    fprintf(Output, ",%.3f", Result->Percentiles[k]);
+  }
+  for (k = 0; k < IVCMP_NUM_STAGES; k++)
+  {
+    fprintf(Output, ",%.3f", Result->Stages[k]);
+  }
+  fprintf(Output, ",%lu,%lu\n", (unsigned long)Result->Failed, (unsigned long)Result->Mismatches);
+  fflush(Output);
+  if (Result->Mismatches > 0)
+  {
+    fprintf(stderr, "%s %u: %lu scores with the stage timers differ\n", Case->Name, Case->MaxLength,
+            (unsigned long)Result->Mismatches);
+  }
+
+  if (!Baseline)
+  {
+    return 1;
+  }
+  rewind(Baseline);
+  while (fgets(Line, sizeof(Line), Baseline))
+  {
+    if (sscanf(Line, "%31[^,],%lu,%*u,%lf", Name, &Points, &BaselinePairsPerSecond) == 3 &&
+        !strcmp(Name, Case->Name) && Points == Case->MaxLength)
+    {
+      if (Result->PairsPerSecond < BaselinePairsPerSecond * (1. - Regression / 100.))
+      {
+        fprintf(stderr, "Regression: %s %u: %.1f pairs/s, baseline %.1f pairs/s\n", Case->Name, Case->MaxLength,
+                Result->PairsPerSecond, BaselinePairsPerSecond);
+        return 0;
+      }
+      return 1;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Prints the usage of the tool
+ */
+static void PrintUsage(void)
+{
+  printf("Usage: ivcmp_bench [-t seconds] [-n sizes] [-o results.csv] [-b baseline.csv] [-r percent] [file.json...]\n"
+         "Measures the throughput, latency and time of the stages of the comparison of curves.\n"
+         "  -t seconds  time of the measurement of a case (default %.1f)\n"
+         "  -n sizes    comma separated numbers of points of the synthetic curves (default %s), 0 for none\n"
+         "  -o file     output CSV file (default standard output)\n"
+         "  -b file     baseline CSV file written by the tool earlier\n"
+         "  -r percent  allowed drop of the throughput against the baseline (default %.0f)\n"
+         "EyePoint board files given are replayed as the corpus case.\n",
+         DEFAULT_SECONDS, DEFAULT_SIZES, DEFAULT_REGRESSION);
+}
+
+int main(int argc, char **argv)
+{
+  int i, Kind;
+  int Result = 0;
+  int NumFiles = 0;
+  double Seconds = DEFAULT_SECONDS;
+  double Regression = DEFAULT_REGRESSION;
+  const char *Sizes = DEFAULT_SIZES;
+  char *End;
+  unsigned long Size;
+  FILE *Output = stdout;
+  FILE *Baseline = NULL;
+  ivcmp_context_t *Ctx;
+  json_reader_t *Reader;
+  board_pin_t Pin;
+  bench_case_t Case;
+  bench_result_t CaseResult;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-t") && i + 1 < argc)
+    {
+      Seconds = strtod(argv[++i], NULL);
+    }
+    else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+    {
+      Sizes = argv[++i];
+    }
+    else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+    {
+      Regression = strtod(argv[++i], NULL);
+    }
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc && Output == stdout)
+    {
+      Output = fopen(argv[++i], "w");
+      if (!Output)
+      {
+        fprintf(stderr, "Can not open %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "-b") && i + 1 < argc && !Baseline)
+    {
+      Baseline = fopen(argv[++i], "r");
+      if (!Baseline)
+      {
+        fprintf(stderr, "Can not open %s\n", argv[i]);
+        return 1;
+      }
+    }
+    else if (argv[i][0] == '-')
+    {
+      PrintUsage();
+      return 1;
+    }
+    else
+    {
+      NumFiles++;
+    }
+  }
+
+  /* Reader buffer is large, so the state is not on the stack */
+  Reader = (json_reader_t *)malloc(sizeof(json_reader_t));
+  Ctx = CreateIVCContext();
+  if (!Reader || !Ctx)
+  {
+    fprintf(stderr, "Not enough memory\n");
+    free(Reader);
+    DestroyIVCContext(Ctx);
+    return 1;
+  }
+  memset(&Case, 0, sizeof(Case));
+  memset(&Pin, 0, sizeof(Pin));
+  fprintf(stderr, "Kernel %s\n", GetIVCKernelName(GetIVCKernel()));
+  if (SetIVCStatsTimers(0) != IVCMP_OK)
+  {
+    fprintf(stderr, "Stages are not timed: the library is built without IVCMP_STATS\n");
+  }
+  fprintf(Output, "case,points,pairs,pairs_per_s,p50_us,p90_us,p99_us");
+  for (i = 0; i < IVCMP_NUM_STAGES; i++)
+  {
+    fprintf(Output, ",%s", StageNames[i]);
+  }
+  fprintf(Output, ",failed,mismatches\n");
+
+  /* Errors stop the measurement, the results of the cases measured before are kept */
+  while (*Sizes && Result != 1)
+  {
+    Size = strtoul(Sizes, &End, 10);
+    if (End == Sizes || (*End != ',' && *End != 0))
+    {
+      fprintf(stderr, "Invalid sizes\n");
+      Result = 1;
+      break;
+    }
+    Sizes = *End ? End + 1 : End;
+    for (Kind = 0; Size >= MIN_CURVE_POINTS && Kind < 3; Kind++)
+    {
+      if (!CreateSyntheticCase(&Case, Kind, Size) || !RunCase(Ctx, &Case, Seconds, &CaseResult))
+      {
+        fprintf(stderr, "Not enough memory\n");
+        FreeCase(&Case);
+        Result = 1;
+        break;
+      }
+      if (!ReportCase(Output, &Case, &CaseResult, Baseline, Regression))
+      {
+        Result = 2;
+      }
+      FreeCase(&Case);
+    }
+  }
+
+  if (NumFiles > 0 && Result != 1)
+  {
+    strcpy(Case.Name, "corpus");
+    for (i = 1; i < argc; i++)
+    {
+      if (argv[i][0] == '-')
+      {
+        i++;
+        continue;
+      }
+      if (!ReadBoardFile(Reader, &Pin, &Case, argv[i]))
+      {
+        fprintf(stderr, "Can not read %s\n", argv[i]);
+        Result = 1;
+      }
+    }
+    if (Case.NumPairs > 0)
+    {
+      if (!RunCase(Ctx, &Case, Seconds, &CaseResult))
+      {
+        fprintf(stderr, "Not enough memory\n");
+        Result = 1;
+      }
+      else if (!ReportCase(Output, &Case, &CaseResult, Baseline, Regression) && Result == 0)
+      {
+        Result = 2;
+      }
+    }
+    FreeCase(&Case);
+  }
+
+  JsonFreePin(&Pin);
+  free(Reader);
+  DestroyIVCContext(Ctx);
+  if (Output != stdout)
+  {
+    fclose(Output);
+  }
+  if (Baseline)
+  {
+    fclose(Baseline);
+  }
+  return Result;
+}
@@ -0,0 +1,778 @@
+/* Tool comparing the curves of the pins of EyePoint board files (elements JSON format)
+ * with their reference curves. Usage:
+ *   ivcmp_board [-j threads] [-k factor] [-c capacity] [-o output.csv] [-b baseline.csv] [-e tolerance]
+ *               [-s tolerance] file.json...
+ * The curves of many files are compared on several threads by CompareIVCBatch(),
+ * scaling thresholds of each pin are factor * max_voltage and factor * max_current of its measure settings.
+ * With a non-zero capacity of the cache of the library the repeated pins are scored once.
+ * For each pin the tool writes the score, the score stored in the file and their difference.
+ * With -s the exit code is 2 if any of the differences exceeds the given tolerance. The stored scores
+ * come from other versions of the comparison, so by default the differences are only reported.
+ * With a baseline (earlier output of the tool) the scores of the pins are checked against the baseline ones,
+ * the exit code is 2 if any of them drifted by more than the tolerance, could not be compared any more
+ * or was not found among the compared pins.
+ */
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS /* fopen() is used for portability */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ivcmp.h"
+#include "ivcmp_json.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define BATCH_PINS 4096            /**< Number of pins compared in one batch */
+#define DEFAULT_MIN_VAR_FACTOR 0.03 /**< Scaling thresholds relative to the measurement ranges */
+#define DEFAULT_TOLERANCE 1e-6      /**< Allowed drift of the scores from the baseline, one digit of the CSV */
+#define MAX_LINE 4096               /**< Longest line of the baseline file */
+
+/**
+ * Growing array
+ */
+typedef struct
+{
+  void *Items;     /**< Items */
+  size_t Count;    /**< Number of items */
+  size_t Capacity; /**< Number of items the array can store */
+} array_t;
+
+/**
+ * Score of a pin in the baseline
+ */
+typedef struct
+{
+  char *File;       /**< File name without the directories */
+  uint32_t Element; /**< Number of the element in the file */
+  uint32_t Number;  /**< Number of the pin in the element */
+  double Score;     /**< Score, negative if the pin could not be compared */
+  int Matched;      /**< Non-zero if the pin is found among the compared pins */
+} baseline_pin_t;
+
+/**
+ * Pins waiting for the comparison
+ */
+typedef struct
+{
+  array_t VoltagesA;   /**< Measured curves one after another */
+  array_t CurrentsA;
+  array_t OffsetsA;    /**< Offsets of the measured curves */
+  array_t VoltagesB;   /**< Reference curves one after another */
+  array_t CurrentsB;
+  array_t OffsetsB;    /**< Offsets of the reference curves */
+  array_t MinVarV;     /**< Scaling thresholds of each pin */
+  array_t MinVarC;
+  array_t StoredScores; /**< Scores stored in the file, negative if absent */
+  array_t Files;       /**< Number of the file of each pin */
+  array_t Elements;    /**< Number of the element of each pin */
+  array_t Numbers;     /**< Number of each pin in its element */
+  array_t Scores;      /**< Scores */
+  array_t Statuses;    /**< Status of each comparison */
+} batch_t;
+
+/**
+ * Settings of the tool and the state shared by the readers of the files
+ */
+typedef struct
+{
+  uint32_t NumThreads;   /**< Number of threads, 0 for the number of processors */
+  uint32_t CacheSize;    /**< Capacity of the cache of the scores, 0 to compare all the pins */
+  double MinVarFactor;   /**< Scaling thresholds relative to the measurement ranges */
+  FILE *Output;          /**< Output file */
+  char **FileNames;      /**< Names of the files */
+  ivcmp_context_t *Ctx;  /**< Comparison context */
+  json_reader_t Reader;  /**< Reader of the current file */
+  board_pin_t Pin;       /**< Current pin */
+  uint32_t File;         /**< Number of the current file */
+  batch_t Batch;         /**< Pins waiting for the comparison */
+  size_t NumPins;        /**< Number of compared pins */
+  size_t NumFailed;      /**< Number of pins that could not be compared */
+  double CompareTime;    /**< Time of the comparisons, seconds */
+  array_t Deltas;        /**< Absolute differences of the scores from the stored ones */
+  double StoredTolerance; /**< Allowed difference of the scores from the stored ones, negative to not check */
+  size_t NumDiffered;    /**< Number of the pins differing from the stored scores by more than the tolerance */
+  array_t Baseline;      /**< Pins of the baseline */
+  size_t NextBaseline;   /**< Baseline pin expected for the next pin */
+  double Tolerance;      /**< Allowed drift of the scores from the baseline */
+  array_t Drifts;        /**< Absolute differences of the scores from the baseline ones */
+  size_t NumNew;         /**< Number of the compared pins absent in the baseline */
+  size_t NumRegressed;   /**< Number of the pins drifted by more than the tolerance or failed */
+} board_tool_t;
+
+/**
+ * Gives the time of a monotonic clock
+ *
+ * @return time in seconds
+ */
+static double BoardNow(void)
+{
+#if defined(_WIN32)
+  LARGE_INTEGER Counter, Frequency;
+  QueryPerformanceCounter(&Counter);
+  QueryPerformanceFrequency(&Frequency);
+  return (double)Counter.QuadPart / (double)Frequency.QuadPart;
+#else
+  struct timespec Time;
+  clock_gettime(CLOCK_MONOTONIC, &Time);
+  return (double)Time.tv_sec + (double)Time.tv_nsec * 1e-9;
+#endif
+}
+
+/**
+ * Makes room for the items in the array
+ *
+ * @param Array array
+ * @param[in] Count number of the items to be stored in the array
+ * @param[in] ItemSize size of an item
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int Reserve(array_t *Array, size_t Count, size_t ItemSize)
+{
+  void *NewItems;
+  size_t NewCapacity;
+  if (Count > Array->Capacity)
+  {
+    NewCapacity = Array->Capacity * 2 + Count + 64;
+    NewItems = realloc(Array->Items, NewCapacity * ItemSize);
+    if (!NewItems)
+    {
+      return 0;
+    }
+    Array->Items = NewItems;
+    Array->Capacity = NewCapacity;
+  }
+  return 1;
+}
+
+/**
+ * Appends the items to the array
+ *
+ * @param Array array
+ * @param[in] Items items
+ * @param[in] Count number of the items
+ * @param[in] ItemSize size of an item
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int Append(array_t *Array, const void *Items, size_t Count, size_t ItemSize)
+{
+  if (Count == 0)
+  {
+    return 1;
+  }
+  if (!Reserve(Array, Array->Count + Count, ItemSize))
+  {
+    return 0;
+  }
+  memcpy((char *)Array->Items + Array->Count * ItemSize, Items, Count * ItemSize);
+  Array->Count += Count;
+  return 1;
+}
+
+/**
+ * Appends the curve to the batch
+ *
+ * @param Curve curve
+ * @param Voltages voltages of the batch
+ * @param Currents currents of the batch
+ * @param Offsets offsets of the batch
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int AppendCurve(const board_curve_t *Curve, array_t *Voltages, array_t *Currents, array_t *Offsets)
+{
+  size_t Length = Curve->NumVoltages < Curve->NumCurrents ? Curve->NumVoltages : Curve->NumCurrents;
+  if (Offsets->Count == 0 && !Append(Offsets, &Voltages->Count, 1, sizeof(size_t)))
+  {
+    return 0;
+  }
+  if (!Append(Voltages, Curve->Voltages, Length, sizeof(double)) ||
+      !Append(Currents, Curve->Currents, Length, sizeof(double)))
+  {
+    return 0;
+  }
+  return Append(Offsets, &Voltages->Count, 1, sizeof(size_t));
+}
+
+/**
+ * Appends the pin to the batch
+ *
+ * @param Data tool
+ * @param[in] Pin pin
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int AppendPin(void *Data, const board_pin_t *Pin)
+{
+  board_tool_t *Tool = (board_tool_t *)Data;
+  batch_t *Batch = &Tool->Batch;
+  /* Thresholds follow the measurement ranges of the measured curve */
+  const double MinVarV = Tool->MinVarFactor * Pin->Curves[0].Settings.MaxVoltage;
+  const double MinVarC = Tool->MinVarFactor * Pin->Curves[0].Settings.MaxCurrent;
+  return AppendCurve(&Pin->Curves[0], &Batch->VoltagesA, &Batch->CurrentsA, &Batch->OffsetsA) &&
+         AppendCurve(&Pin->Curves[1], &Batch->VoltagesB, &Batch->CurrentsB, &Batch->OffsetsB) &&
+         Append(&Batch->MinVarV, &MinVarV, 1, sizeof(double)) &&
+         Append(&Batch->MinVarC, &MinVarC, 1, sizeof(double)) &&
+         Append(&Batch->StoredScores, &Pin->Score, 1, sizeof(double)) &&
+         Append(&Batch->Files, &Tool->File, 1, sizeof(uint32_t)) &&
+         Append(&Batch->Elements, &Pin->Element, 1, sizeof(uint32_t)) &&
+         Append(&Batch->Numbers, &Pin->Number, 1, sizeof(uint32_t));
+}
+
+/**
+ * Drops the pins of the batch after the given number keeping the memory
+ *
+ * @param Batch batch
+ * @param[in] NumPins number of the pins left
+ */
+static void TruncateBatch(batch_t *Batch, size_t NumPins)
+{
+  array_t *Array = &Batch->MinVarV;
+  for (; Array <= &Batch->Numbers; Array++)
+  {
+    Array->Count = NumPins;
+  }
+  if (NumPins == 0)
+  {
+    Batch->OffsetsA.Count = Batch->OffsetsB.Count = 0;
+    Batch->VoltagesA.Count = Batch->CurrentsA.Count = 0;
+    Batch->VoltagesB.Count = Batch->CurrentsB.Count = 0;
+    return;
+  }
+  Batch->OffsetsA.Count = Batch->OffsetsB.Count = NumPins + 1;
+  Batch->VoltagesA.Count = Batch->CurrentsA.Count = ((size_t *)Batch->OffsetsA.Items)[NumPins];
+  Batch->VoltagesB.Count = Batch->CurrentsB.Count = ((size_t *)Batch->OffsetsB.Items)[NumPins];
+}
+
+/**
+ * Frees the memory of the batch
+ *
+ * @param Batch batch
+ */
+static void FreeBatch(batch_t *Batch)
+{
+  array_t *Array = &Batch->VoltagesA;
+  for (; Array <= &Batch->Statuses; Array++)
+  {
+    free(Array->Items);
+  }
+}
+
+/**
+ * Gives the file name without the directories
+ *
+ * @param[in] Path path of the file
+ *
+ * @return file name
+ */
+static const char *BaseName(const char *Path)
+{
+  const char *Name = Path;
+  for (; *Path; Path++)
+  {
+    if (*Path == '/' || *Path == '\\')
+    {
+      Name = Path + 1;
+    }
+  }
+  return Name;
+}
+
+/**
+ * Reads the scores of the pins from the earlier output of the tool
+ *
+ * @param Tool tool
+ * @param[in] FileName name of the baseline file
+ *
+ * @return 1 on success, 0 on error
+ */
+static int ReadBaseline(board_tool_t *Tool, const char *FileName)
+{
+  char Line[MAX_LINE];
+  char *End;
+  const char *Name;
+  size_t Length;
+  unsigned Element, Number;
+  baseline_pin_t Pin;
+  FILE *File = fopen(FileName, "r");
+  if (!File)
+  {
+    fprintf(stderr, "Can not open %s\n", FileName);
+    return 0;
+  }
+  while (fgets(Line, sizeof(Line), File))
+  {
+    /* Lines of the pins start with the quoted file name, the header is skipped */
+    End = Line[0] == '"' ? strchr(Line + 1, '"') : NULL;
+    if (!End)
+    {
+      continue;
+    }
+    *End = 0;
+    Pin.Score = -1.;
+    if (sscanf(End + 1, ",%u,%u,%lf", &Element, &Number, &Pin.Score) < 2)
+    {
+      continue;
+    }
+    Name = BaseName(Line + 1);
+    Length = strlen(Name) + 1;
+    Pin.Element = Element;
+    Pin.Number = Number;
+    Pin.Matched = 0;
+    Pin.File = (char *)malloc(Length);
+    if (!Pin.File || !Append(&Tool->Baseline, &Pin, 1, sizeof(baseline_pin_t)))
+    {
+      free(Pin.File);
+      fclose(File);
+      fprintf(stderr, "Not enough memory\n");
+      return 0;
+    }
+    memcpy(Pin.File, Name, Length);
+  }
+  fclose(File);
+  if (Tool->Baseline.Count == 0)
+  {
+    fprintf(stderr, "No pins in %s\n", FileName);
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * Frees the memory of the baseline
+ *
+ * @param Tool tool
+ */
+static void FreeBaseline(board_tool_t *Tool)
+{
+  size_t i;
+  for (i = 0; i < Tool->Baseline.Count; i++)
+  {
+    free(((baseline_pin_t *)Tool->Baseline.Items)[i].File);
+  }
+  free(Tool->Baseline.Items);
+}
+
+/**
+ * Finds the pin in the baseline
+ *
+ * @param Tool tool
+ * @param[in] File file name without the directories
+ * @param[in] Element number of the element in the file
+ * @param[in] Number number of the pin in the element
+ *
+ * @return baseline pin or NULL if the pin is absent
+ */
+static baseline_pin_t *FindBaselinePin(board_tool_t *Tool, const char *File, uint32_t Element, uint32_t Number)
+{
+  size_t i, k;
+  baseline_pin_t *Pins = (baseline_pin_t *)Tool->Baseline.Items;
+  /* Files given in the same order as for the baseline give the pins in the same order */
+  for (k = 0; k < Tool->Baseline.Count; k++)
+  {
+    i = (Tool->NextBaseline + k) % Tool->Baseline.Count;
+    if (Pins[i].Element == Element && Pins[i].Number == Number && !strcmp(Pins[i].File, File))
+    {
+      Tool->NextBaseline = i + 1;
+      return &Pins[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Checks the score of the pin against the baseline
+ *
+ * @param Tool tool
+ * @param[in] File file name without the directories
+ * @param[in] Element number of the element in the file
+ * @param[in] Number number of the pin in the element
+ * @param[in] Score score, negative if the pin could not be compared
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int CheckBaselinePin(board_tool_t *Tool, const char *File, uint32_t Element, uint32_t Number, double Score)
+{
+  double Drift;
+  char Printed[32];
+  baseline_pin_t *Pin = FindBaselinePin(Tool, File, Element, Number);
+  if (!Pin)
+  {
+    Tool->NumNew++;
+    return 1;
+  }
+  Pin->Matched = 1;
+  if (Pin->Score < 0)
+  {
+    /* Pins that could not be compared before are not a regression */
+    return 1;
+  }
+  if (Score >= 0)
+  {
+    /* Baseline has the digits of the output */
+    sprintf(Printed, "%.6f", Score);
+    Score = strtod(Printed, NULL);
+  }
+  Drift = Score < 0 ? 1. : Score > Pin->Score ? Score - Pin->Score : Pin->Score - Score;
+  if (Drift > Tool->Tolerance)
+  {
+    fprintf(stderr, "Regression: %s element %u pin %u: score %.6f, baseline %.6f\n", File, Element, Number, Score,
+            Pin->Score);
+    Tool->NumRegressed++;
+  }
+  return Append(&Tool->Drifts, &Drift, 1, sizeof(double));
+}
+
+/**
+ * Counts the pins of the baseline not found among the compared pins
+ *
+ * @param[in] Tool tool
+ *
+ * @return number of the missing pins
+ */
+static size_t CountMissingPins(const board_tool_t *Tool)
+{
+  size_t i, NumMissing = 0;
+  const baseline_pin_t *Pins = (const baseline_pin_t *)Tool->Baseline.Items;
+  for (i = 0; i < Tool->Baseline.Count; i++)
+  {
+    if (!Pins[i].Matched)
+    {
+      fprintf(stderr, "Missing: %s element %u pin %u\n", Pins[i].File, Pins[i].Element, Pins[i].Number);
+      NumMissing++;
+    }
+  }
+  return NumMissing;
+}
+
+/**
+ * Orders doubles for qsort()
+ *
+ * @param[in] a first double
+ * @param[in] b second double
+ *
+ * @return negative, zero or positive number
+ */
+static int CompareDoubles(const void *a, const void *b)
+{
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+/**
+ * Prints the mean, the percentiles and the maximum of the values
+ *
+ * @param[in] Title name of the values
+ * @param Values values, sorted by the function
+ */
+static void PrintDistribution(const char *Title, array_t *Values)
+{
+  size_t i;
+  double Sum = 0;
+  double *v = (double *)Values->Items;
+  const size_t n = Values->Count;
+  if (n == 0)
+  {
+    return;
+  }
+  qsort(v, n, sizeof(double), CompareDoubles);
+  for (i = 0; i < n; i++)
+  {
+    Sum += v[i];
+  }
+  fprintf(stderr, "%s of %lu pins: mean %.3g, p50 %.3g, p90 %.3g, p99 %.3g, max %.3g\n", Title, (unsigned long)n,
+          Sum / n, v[(n - 1) / 2], v[(n - 1) * 9 / 10], v[(n - 1) * 99 / 100], v[n - 1]);
+}
+
+/**
+ * Compares the pins of the batch, writes the results and clears the batch
+ *
+ * @param Tool tool
+ *
+ * @return 1 on success, 0 if there is not enough memory
+ */
+static int CompareBatch(board_tool_t *Tool)
+{
+  size_t i;
+  double Delta, Start;
+  const char *File;
+  uint32_t Element, Number;
+  batch_t *Batch = &Tool->Batch;
+  const uint32_t NumPins = (uint32_t)Batch->MinVarV.Count;
+  double *Scores, *StoredScores;
+  ivcmp_status_t *Statuses;
+
+  if (NumPins == 0)
+  {
+    return 1;
+  }
+  /* Curves of all the pins may be empty, the arrays should be allocated anyway */
+  if (!Reserve(&Batch->Scores, NumPins, sizeof(double)) ||
+      !Reserve(&Batch->Statuses, NumPins, sizeof(ivcmp_status_t)) ||
+      !Reserve(&Batch->VoltagesA, 1, sizeof(double)) || !Reserve(&Batch->CurrentsA, 1, sizeof(double)) ||
+      !Reserve(&Batch->VoltagesB, 1, sizeof(double)) || !Reserve(&Batch->CurrentsB, 1, sizeof(double)))
+  {
+    return 0;
+  }
+  Scores = (double *)Batch->Scores.Items;
+  Statuses = (ivcmp_status_t *)Batch->Statuses.Items;
+  StoredScores = (double *)Batch->StoredScores.Items;
+  Start = BoardNow();
+  if (CompareIVCBatch(Tool->Ctx, (double *)Batch->VoltagesA.Items, (double *)Batch->CurrentsA.Items,
+                      (const size_t *)Batch->OffsetsA.Items, (double *)Batch->VoltagesB.Items,
+                      (double *)Batch->CurrentsB.Items, (const size_t *)Batch->OffsetsB.Items,
+                      (const double *)Batch->MinVarV.Items, (const double *)Batch->MinVarC.Items, NumPins,
+                      Tool->NumThreads, Scores, Statuses) == IVCMP_ERROR_NO_MEMORY)
+  {
+    return 0;
+  }
+  Tool->CompareTime += BoardNow() - Start;
+
+  for (i = 0; i < NumPins; i++)
+  {
+    File = Tool->FileNames[((uint32_t *)Batch->Files.Items)[i]];
+    Element = ((uint32_t *)Batch->Elements.Items)[i];
+    Number = ((uint32_t *)Batch->Numbers.Items)[i];
+    fprintf(Tool->Output, "\"%s\",%u,%u,", File, Element, Number);
+    /* Invalid scores are failures too */
+    if (Statuses[i] == IVCMP_OK && !(Scores[i] >= 0 && Scores[i] <= 1))
+    {
+      Statuses[i] = IVCMP_ERROR_INVALID_ARGUMENT;
+    }
+    if (Tool->Baseline.Count > 0 &&
+        !CheckBaselinePin(Tool, BaseName(File), Element, Number, Statuses[i] == IVCMP_OK ? Scores[i] : -1.))
+    {
+      return 0;
+    }
+    if (Statuses[i] != IVCMP_OK)
+    {
+      Tool->NumFailed++;
+      fprintf(Tool->Output, ",,,%s\n", GetIVCStatusMessage(Statuses[i]));
+      continue;
+    }
+    fprintf(Tool->Output, "%.6f,", Scores[i]);
+    if (StoredScores[i] < 0)
+    {
+      fprintf(Tool->Output, ",,OK\n");
+      continue;
+    }
+    Delta = Scores[i] - StoredScores[i];
+    fprintf(Tool->Output, "%.6f,%.6f,OK\n", StoredScores[i], Delta);
+    Delta = Delta < 0 ? -Delta : Delta;
+    if (Tool->StoredTolerance >= 0 && Delta > Tool->StoredTolerance)
+    {
+      Tool->NumDiffered++;
+    }
+    if (!Append(&Tool->Deltas, &Delta, 1, sizeof(double)))
+    {
+      return 0;
+    }
+  }
+  Tool->NumPins += NumPins;
+  TruncateBatch(Batch, 0);
+  return 1;
+}
+
+/**
+ * Prints the usage of the tool
+ */
+static void PrintUsage(void)
+{
+  printf("Usage: ivcmp_board [-j threads] [-k factor] [-c capacity] [-o output.csv] [-b baseline.csv]"
+         " [-e tolerance] [-s tolerance] file.json...\n"
+         "Compares the curves of the pins of EyePoint board files with their reference curves.\n"
+         "  -j threads  number of threads, 0 for the number of processors (default)\n"
+         "  -k factor   scaling thresholds relative to max_voltage and max_current of the measure settings"
+         " (default %.2f)\n"
+         "  -c capacity number of scores in the cache of repeated pins, 0 for no cache (default)\n"
+         "  -o file     output CSV file (default standard output)\n"
+         "  -b file     baseline CSV file written by the tool earlier\n"
+         "  -e tolerance allowed drift of the scores from the baseline (default %g)\n"
+         "  -s tolerance allowed difference of the scores from the ones stored in the files (default no check)\n",
+         DEFAULT_MIN_VAR_FACTOR, DEFAULT_TOLERANCE);
+}
+
+int main(int argc, char **argv)
+{
+  int i;
+  int NumFiles = 0;
+  int Result = 0;
+  uint32_t File;
+  FILE *JsonFile;
+  size_t NumPins, NumMissing;
+  const char *BaselineName = NULL;
+  board_tool_t *Tool;
+
+  /* Reader buffer is large, so the state is not on the stack */
+  Tool = (board_tool_t *)calloc(1, sizeof(board_tool_t));
+  if (!Tool)
+  {
+    fprintf(stderr, "Not enough memory\n");
+    return 1;
+  }
+  Tool->MinVarFactor = DEFAULT_MIN_VAR_FACTOR;
+  Tool->Tolerance = DEFAULT_TOLERANCE;
+  Tool->StoredTolerance = -1.;
+  Tool->Output = stdout;
+  Tool->FileNames = argv;
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+    {
+      Tool->NumThreads = (uint32_t)strtoul(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "-k") && i + 1 < argc)
+    {
+      Tool->MinVarFactor = strtod(argv[++i], NULL);
+    }
+    else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+    {
+      Tool->CacheSize = (uint32_t)strtoul(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "-e") && i + 1 < argc)
+    {
+      Tool->Tolerance = strtod(argv[++i], NULL);
+    }
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+    {
+      Tool->StoredTolerance = strtod(argv[++i], NULL);
+      if (!(Tool->StoredTolerance >= 0))
+      {
+        PrintUsage();
+        free(Tool);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "-b") && i + 1 < argc)
+    {
+      BaselineName = argv[++i];
+    }
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+    {
+      Tool->Output = fopen(argv[++i], "w");
+      if (!Tool->Output)
+      {
+        fprintf(stderr, "Can not open %s\n", argv[i]);
+        free(Tool);
+        return 1;
+      }
+    }
+    else if (argv[i][0] == '-')
+    {
+      PrintUsage();
+      free(Tool);
+      return 1;
+    }
+    else
+    {
+      NumFiles++;
+    }
+  }
+  if (NumFiles == 0 || !(Tool->MinVarFactor > 0) || !(Tool->Tolerance >= 0))
+  {
+    PrintUsage();
+    free(Tool);
+    return 1;
+  }
+  if (BaselineName && !ReadBaseline(Tool, BaselineName))
+  {
+    FreeBaseline(Tool);
+    free(Tool);
+    return 1;
+  }
+
+  Tool->Ctx = CreateIVCContext();
+  if (!Tool->Ctx || SetIVCCacheCapacity(Tool->CacheSize) != IVCMP_OK)
+  {
+    DestroyIVCContext(Tool->Ctx);
+    fprintf(stderr, "Not enough memory\n");
+    free(Tool);
+    return 1;
+  }
+  fprintf(Tool->Output, "file,element,pin,score,stored_score,delta,status\n");
+  for (File = 1; File < (uint32_t)argc; File++)
+  {
+    if (argv[File][0] == '-')
+    {
+      File++;
+      continue;
+    }
+    JsonFile = fopen(argv[File], "rb");
+    if (!JsonFile)
+    {
+      fprintf(stderr, "Can not open %s\n", argv[File]);
+      Result = 1;
+      continue;
+    }
+    JsonInit(&Tool->Reader, JsonFile);
+    /* Pins of the broken file are dropped, the other files are processed */
+    NumPins = Tool->Batch.MinVarV.Count;
+    Tool->File = File;
+    if (!JsonReadBoard(&Tool->Reader, &Tool->Pin, AppendPin, Tool))
+    {
+      fprintf(stderr, "Can not read %s\n", argv[File]);
+      TruncateBatch(&Tool->Batch, NumPins);
+      Result = 1;
+    }
+    fclose(JsonFile);
+    if (Tool->Batch.MinVarV.Count >= BATCH_PINS && !CompareBatch(Tool))
+    {
+      break;
+    }
+  }
+  if (File < (uint32_t)argc || !CompareBatch(Tool))
+  {
+    fprintf(stderr, "Not enough memory\n");
+    Result = 1;
+  }
+  fprintf(stderr, "%lu pins, %lu failed, %.0f pins/s\n", (unsigned long)Tool->NumPins,
+          (unsigned long)Tool->NumFailed, Tool->CompareTime > 0 ? Tool->NumPins / Tool->CompareTime : 0.);
+  PrintDistribution("|delta| from the stored scores", &Tool->Deltas);
+  if (Tool->StoredTolerance >= 0)
+  {
+    fprintf(stderr, "stored scores: %lu pins differ by more than %g\n", (unsigned long)Tool->NumDiffered,
+            Tool->StoredTolerance);
+    if (Tool->NumDiffered > 0 && Result == 0)
+    {
+      Result = 2;
+    }
+  }
+  if (Tool->Baseline.Count > 0)
+  {
+    PrintDistribution("|drift| from the baseline", &Tool->Drifts);
+    NumMissing = CountMissingPins(Tool);
+    fprintf(stderr, "baseline: %lu pins regressed, %lu pins missing, %lu pins new\n",
+            (unsigned long)Tool->NumRegressed, (unsigned long)NumMissing, (unsigned long)Tool->NumNew);
+    if ((Tool->NumRegressed > 0 || NumMissing > 0) && Result == 0)
+    {
+      Result = 2;
+    }
+  }
+  if (Tool->CacheSize)
+  {
+    ivcmp_cache_stats_t CacheStats;
+    GetIVCCacheStats(&CacheStats);
+    fprintf(stderr, "cache: %lu hits, %lu misses, %lu evictions\n", (unsigned long)CacheStats.Hits,
+            (unsigned long)CacheStats.Misses, (unsigned long)CacheStats.Evictions);
+    SetIVCCacheCapacity(0);
+  }
+
+  if (Tool->Output != stdout)
+  {
+    fclose(Tool->Output);
+  }
+  DestroyIVCContext(Tool->Ctx);
+  FreeBatch(&Tool->Batch);
+  FreeBaseline(Tool);
+  free(Tool->Deltas.Items);
+  free(Tool->Drifts.Items);
+  JsonFreePin(&Tool->Pin);
+  free(Tool);
+  return Result;
+}
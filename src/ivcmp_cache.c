@@ -0,0 +1,334 @@
+/* This module keeps the scores of the recently compared pairs of curves
+ */
+#include "ivcmp_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define NO_ENTRY UINT32_MAX /**< End of the lists of the entries */
+
+#if defined(_WIN32)
+static SRWLOCK CacheLock = SRWLOCK_INIT;
+#define LockCache() AcquireSRWLockExclusive(&CacheLock)
+#define UnlockCache() ReleaseSRWLockExclusive(&CacheLock)
+#else
+static pthread_mutex_t CacheLock = PTHREAD_MUTEX_INITIALIZER;
+#define LockCache() pthread_mutex_lock(&CacheLock)
+#define UnlockCache() pthread_mutex_unlock(&CacheLock)
+#endif
+
+/**
+ * Score of a pair of curves. Entries are linked into the chain of their bucket
+ * and into the list of all the used entries from the most to the least recently used one.
+ */
+typedef struct
+{
+  ivc_cache_key_t Key;
+  double Score;
+  uint32_t Bucket;    /**< Bucket of the key */
+  uint32_t ChainNext; /**< Next entry of the bucket */
+  uint32_t Newer;     /**< More recently used entry */
+  uint32_t Older;     /**< Less recently used entry */
+} cache_entry_t;
+
+volatile uint32_t IvcCacheCapacity = 0;
+
+/* All the following variables are protected by CacheLock */
+static cache_entry_t *Entries = NULL; /**< IvcCacheCapacity entries */
+static uint32_t *Buckets = NULL;      /**< First entries of the chains, NumBuckets is a power of 2 */
+static uint32_t NumBuckets = 0;
+static uint32_t NumEntries = 0;       /**< Entries from 0 to NumEntries - 1 are used */
+static uint32_t Newest = NO_ENTRY;
+static uint32_t Oldest = NO_ENTRY;
+static uint64_t Hits = 0;
+static uint64_t Misses = 0;
+static uint64_t Evictions = 0;
+
+/**
+ * Mixes the bits of the value (finalizer of SplitMix64)
+ *
+ * @param[in] x value
+ *
+ * @return mixed value
+ */
+static uint64_t Mix(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9u;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBu;
+  return x ^ (x >> 31);
+}
+
+uint64_t IvcHashCurve(const double *Voltages, const double *Currents, uint32_t Length)
+{
+  /* Voltages and currents are hashed independently to overlap the multiplications */
+  uint64_t HashV = Length, HashC = ~(uint64_t)Length;
+  uint64_t v, c;
+  uint32_t i;
+  for (i = 0; i < Length; i++)
+  {
+    memcpy(&v, &Voltages[i], sizeof(v));
+    memcpy(&c, &Currents[i], sizeof(c));
+    HashV = (HashV ^ v) * 0x9E3779B97F4A7C15u;
+    HashV ^= HashV >> 29;
+    HashC = (HashC ^ c) * 0x9E3779B97F4A7C15u;
+    HashC ^= HashC >> 29;
+  }
+  return Mix(HashV ^ Mix(HashC));
+}
+
+/**
+ * Gives the bucket of the key, NumBuckets should be non-zero
+ *
+ * @param[in] Key key
+ *
+ * @return bucket
+ */
+static uint32_t KeyBucket(const ivc_cache_key_t *Key)
+{
+  uint64_t Bits[3];
+  memcpy(&Bits[0], &Key->MinVarV, sizeof(double));
+  memcpy(&Bits[1], &Key->MinVarC, sizeof(double));
+  memcpy(&Bits[2], &Key->ResampleStep, sizeof(double));
+  uint64_t Hash = Mix(Key->HashA ^ Mix(Key->HashB ^ ((uint64_t)Key->LengthA << 32 | Key->LengthB)));
+  Hash = Mix(Hash ^ Bits[0] ^ Mix(Bits[1] ^ Mix(Bits[2] ^ Key->Precision)));
+  return (uint32_t)Hash & (NumBuckets - 1);
+}
+
+/**
+ * Checks whether the keys are the same
+ *
+ * @return 1 if the keys are the same
+ */
+static int SameKeys(const ivc_cache_key_t *a, const ivc_cache_key_t *b)
+{
+  return a->HashA == b->HashA && a->HashB == b->HashB && a->LengthA == b->LengthA && a->LengthB == b->LengthB &&
+         a->MinVarV == b->MinVarV && a->MinVarC == b->MinVarC && a->ResampleStep == b->ResampleStep &&
+         a->Precision == b->Precision;
+}
+
+/**
+ * Removes the entry from the recently used list, CacheLock should be locked
+ *
+ * @param[in] i entry
+ */
+static void Unlink(uint32_t i)
+{
+  cache_entry_t *Entry = &Entries[i];
+  if (Entry->Newer != NO_ENTRY)
+  {
+    Entries[Entry->Newer].Older = Entry->Older;
+  }
+  else
+  {
+    Newest = Entry->Older;
+  }
+  if (Entry->Older != NO_ENTRY)
+  {
+    Entries[Entry->Older].Newer = Entry->Newer;
+  }
+  else
+  {
+    Oldest = Entry->Newer;
+  }
+}
+
+/**
+ * Puts the entry at the head of the recently used list, CacheLock should be locked
+ *
+ * @param[in] i entry
+ */
+static void LinkNewest(uint32_t i)
+{
+  Entries[i].Newer = NO_ENTRY;
+  Entries[i].Older = Newest;
+  if (Newest != NO_ENTRY)
+  {
+    Entries[Newest].Newer = i;
+  }
+  else
+  {
+    Oldest = i;
+  }
+  Newest = i;
+}
+
+/**
+ * Removes the entry from the chain of its bucket, CacheLock should be locked
+ *
+ * @param[in] i entry
+ */
+static void RemoveFromBucket(uint32_t i)
+{
+  uint32_t *Link = &Buckets[Entries[i].Bucket];
+  while (*Link != i)
+  {
+    Link = &Entries[*Link].ChainNext;
+  }
+  *Link = Entries[i].ChainNext;
+}
+
+/**
+ * Finds the entry of the key, CacheLock should be locked
+ *
+ * @param[in] Key key
+ * @param[in] Bucket bucket of the key
+ *
+ * @return entry or NO_ENTRY
+ */
+static uint32_t FindEntry(const ivc_cache_key_t *Key, uint32_t Bucket)
+{
+  uint32_t i;
+  for (i = Buckets[Bucket]; i != NO_ENTRY; i = Entries[i].ChainNext)
+  {
+    if (SameKeys(&Entries[i].Key, Key))
+    {
+      break;
+    }
+  }
+  return i;
+}
+
+int IvcCacheLookup(const ivc_cache_key_t *Key, double *Score)
+{
+  uint32_t i;
+  LockCache();
+  if (!Entries)
+  {
+    UnlockCache();
+    return 0;
+  }
+  i = FindEntry(Key, KeyBucket(Key));
+  if (i != NO_ENTRY)
+  {
+    *Score = Entries[i].Score;
+    Unlink(i);
+    LinkNewest(i);
+    Hits++;
+  }
+  else
+  {
+    Misses++;
+  }
+  UnlockCache();
+  return i != NO_ENTRY;
+}
+
+void IvcCacheStore(const ivc_cache_key_t *Key, double Score)
+{
+  uint32_t i, Bucket;
+  LockCache();
+  if (!Entries)
+  {
+    UnlockCache();
+    return;
+  }
+  Bucket = KeyBucket(Key);
+  /* Another thread may have stored the same pair meanwhile */
+  i = FindEntry(Key, Bucket);
+  if (i != NO_ENTRY)
+  {
+    Unlink(i);
+  }
+  else
+  {
+    if (NumEntries < IvcCacheCapacity)
+    {
+      i = NumEntries++;
+    }
+    else
+    {
+      i = Oldest;
+      Unlink(i);
+      RemoveFromBucket(i);
+      Evictions++;
+    }
+    Entries[i].Key = *Key;
+    Entries[i].Bucket = Bucket;
+    Entries[i].ChainNext = Buckets[Bucket];
+    Buckets[Bucket] = i;
+  }
+  Entries[i].Score = Score;
+  LinkNewest(i);
+  UnlockCache();
+}
+
+/**
+ * Drops all the entries and the counters, CacheLock should be locked
+ */
+static void ClearEntries(void)
+{
+  uint32_t i;
+  for (i = 0; i < NumBuckets; i++)
+  {
+    Buckets[i] = NO_ENTRY;
+  }
+  NumEntries = 0;
+  Newest = NO_ENTRY;
+  Oldest = NO_ENTRY;
+  Hits = 0;
+  Misses = 0;
+  Evictions = 0;
+}
+
+ivcmp_status_t IvcSetCacheCapacity(uint32_t Capacity)
+{
+  /* The allocator of the library may be changed while the cache lives, so the standard one is used */
+  cache_entry_t *NewEntries = NULL;
+  uint32_t *NewBuckets = NULL;
+  uint32_t NewNumBuckets = 0;
+  ivcmp_status_t Status = IVCMP_OK;
+  if (Capacity > 0)
+  {
+    for (NewNumBuckets = 1; NewNumBuckets < Capacity && NewNumBuckets < (UINT32_MAX >> 1) + 1; NewNumBuckets *= 2)
+    {
+    }
+    if ((uint64_t)Capacity * sizeof(cache_entry_t) <= SIZE_MAX)
+    {
+      NewEntries = (cache_entry_t *)malloc((size_t)Capacity * sizeof(cache_entry_t));
+      NewBuckets = (uint32_t *)malloc((size_t)NewNumBuckets * sizeof(uint32_t));
+    }
+    if (!NewEntries || !NewBuckets)
+    {
+      free(NewEntries);
+      free(NewBuckets);
+      NewEntries = NULL;
+      NewBuckets = NULL;
+      NewNumBuckets = 0;
+      Capacity = 0;
+      Status = IVCMP_ERROR_NO_MEMORY;
+    }
+  }
+
+  LockCache();
+  free(Entries);
+  free(Buckets);
+  Entries = NewEntries;
+  Buckets = NewBuckets;
+  NumBuckets = NewNumBuckets;
+  IvcCacheCapacity = Capacity;
+  ClearEntries();
+  UnlockCache();
+  return Status;
+}
+
+void IvcGetCacheStats(ivcmp_cache_stats_t *Stats)
+{
+  LockCache();
+  Stats->Hits = Hits;
+  Stats->Misses = Misses;
+  Stats->Evictions = Evictions;
+  Stats->Entries = NumEntries;
+  Stats->Capacity = IvcCacheCapacity;
+  UnlockCache();
+}
+
+void IvcClearCache(void)
+{
+  LockCache();
+  ClearEntries();
+  UnlockCache();
+}
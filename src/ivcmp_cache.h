@@ -0,0 +1,78 @@
+/* Internal interface of the cache of comparison results. The cache is shared by all the threads,
+ * it keeps the scores of the last compared pairs of curves and evicts the least recently used ones.
+ */
+#ifndef IVCMP_CACHE_H
+#define IVCMP_CACHE_H
+
+#include <stdint.h>
+#include "ivcmp.h"
+
+/**
+ * Everything the score of a pair of curves depends on
+ */
+typedef struct
+{
+  uint64_t HashA;      /**< Hash of the first curve, see IvcHashCurve() */
+  uint64_t HashB;      /**< Hash of the second curve, 0 if there is no second curve */
+  uint32_t LengthA;    /**< Number of points of the first curve */
+  uint32_t LengthB;    /**< Number of points of the second curve */
+  double MinVarV;      /**< Scaling thresholds of the context */
+  double MinVarC;
+  double ResampleStep; /**< Resampling step of the context */
+  uint32_t Precision;  /**< Precision of the distances, ivcmp_precision_t */
+} ivc_cache_key_t;
+
+/** Non-zero capacity of the cache if it is enabled, may be read without the lock to skip hashing */
+extern volatile uint32_t IvcCacheCapacity;
+
+/**
+ * Computes the hash of the bits of the curve values
+ *
+ * @param[in] Voltages voltages of the curve
+ * @param[in] Currents currents of the curve
+ * @param[in] Length number of points
+ *
+ * @return hash
+ */
+uint64_t IvcHashCurve(const double *Voltages, const double *Currents, uint32_t Length);
+
+/**
+ * Finds the score of the pair of curves in the cache and marks it as recently used
+ *
+ * @param[in] Key key of the pair
+ * @param[out] Score score found
+ *
+ * @return 1 if the score is found
+ */
+int IvcCacheLookup(const ivc_cache_key_t *Key, double *Score);
+
+/**
+ * Stores the score of the pair of curves, evicting the least recently used one if the cache is full
+ *
+ * @param[in] Key key of the pair
+ * @param[in] Score score of the pair
+ */
+void IvcCacheStore(const ivc_cache_key_t *Key, double Score);
+
+/**
+ * Changes the capacity of the cache, the stored scores and the counters are dropped
+ *
+ * @param[in] Capacity largest number of scores, 0 to disable the cache
+ *
+ * @return IVCMP_OK or IVCMP_ERROR_NO_MEMORY, the cache is disabled then
+ */
+ivcmp_status_t IvcSetCacheCapacity(uint32_t Capacity);
+
+/**
+ * Gives the counters of the cache
+ *
+ * @param[out] Stats counters
+ */
+void IvcGetCacheStats(ivcmp_cache_stats_t *Stats);
+
+/**
+ * Drops the stored scores and the counters of the cache
+ */
+void IvcClearCache(void);
+
+#endif
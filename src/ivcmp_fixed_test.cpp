@@ -0,0 +1,174 @@
+/* Checks that the C++ header ivcmp.hpp gives the same scores as the library and measures its latency
+ */
+#define _USE_MATH_DEFINES
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "ivcmp.hpp"
+
+#define VOLTAGE_AMPL 12.
+#define CURRENT_AMPL (VOLTAGE_AMPL / 475. * 1000)
+#define NUM_LATENCY_CALLS 20000
+
+/* Kinds of the test curves */
+enum curve_kind_t
+{
+  CURVE_RESISTOR,
+  CURVE_CAPACITOR,
+  CURVE_DIODE,
+  CURVE_OPEN,
+  CURVE_STEPS,
+  NUM_CURVE_KINDS
+};
+
+/**
+ * Fills the curve of the given kind with noise
+ *
+ * @param[in] Kind kind of the curve
+ * @param[in] Noise relative noise amplitude
+ * @param Random random numbers generator
+ * @param[out] Voltages voltages
+ * @param[out] Currents currents
+ */
+static void MakeCurve(curve_kind_t Kind, double Noise, std::mt19937 &Random, std::vector<double> &Voltages,
+                      std::vector<double> &Currents)
+{
+  std::uniform_real_distribution<double> Uniform(-1., 1.);
+  const size_t n = Voltages.size();
+  for (size_t i = 0; i < n; i++)
+  {
+    const double Phase = 2 * M_PI * i / n;
+    double v = VOLTAGE_AMPL * std::sin(Phase);
+    double c = 0;
+    switch (Kind)
+    {
+    case CURVE_RESISTOR:
+      c = 0.5 * CURRENT_AMPL * std::sin(Phase);
+      break;
+    case CURVE_CAPACITOR:
+      c = 0.7 * CURRENT_AMPL * std::cos(Phase);
+      break;
+    case CURVE_DIODE:
+      c = v > 0.6 ? CURRENT_AMPL * (v - 0.6) / VOLTAGE_AMPL : 0;
+      break;
+    case CURVE_OPEN:
+      break;
+    default:
+      /* Held values give repeated points removed before B-spline */
+      v = VOLTAGE_AMPL * std::sin(2 * M_PI * (i / 4 * 4) / n);
+      c = 0.3 * CURRENT_AMPL * std::sin(2 * M_PI * (i / 4 * 4) / n);
+      break;
+    }
+    Voltages[i] = v + (Kind == CURVE_STEPS ? 0 : Noise * VOLTAGE_AMPL * Uniform(Random));
+    Currents[i] = c + (Kind == CURVE_STEPS ? 0 : Noise * CURRENT_AMPL * Uniform(Random));
+  }
+}
+
+/**
+ * Compares all pairs of test curves of N points with the library and with the header
+ *
+ * @return number of mismatching scores
+ */
+template <std::size_t N>
+static int CheckSize(ivcmp_context_t *Ctx, std::mt19937 &Random)
+{
+  const ivcmp::FixedComparator<N> Comparator(VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  std::vector<std::vector<double>> Voltages(2 * NUM_CURVE_KINDS, std::vector<double>(N));
+  std::vector<std::vector<double>> Currents(2 * NUM_CURVE_KINDS, std::vector<double>(N));
+  int Mismatches = 0;
+  double MaxDifference = 0;
+  for (size_t k = 0; k < Voltages.size(); k++)
+  {
+    MakeCurve((curve_kind_t)(k % NUM_CURVE_KINDS), k < NUM_CURVE_KINDS ? 0.01 : 0.03, Random, Voltages[k],
+              Currents[k]);
+  }
+  for (size_t i = 0; i < Voltages.size(); i++)
+  {
+    for (size_t j = 0; j < Voltages.size(); j++)
+    {
+      double Score, FixedScore;
+      const ivcmp_status_t Status = CompareIVCWithContext(Ctx, Voltages[i].data(), Currents[i].data(), N,
+                                                          Voltages[j].data(), Currents[j].data(), N, &Score);
+      const ivcmp_status_t FixedStatus = Comparator.Compare(std::span<const double, N>(Voltages[i]),
+                                                            std::span<const double, N>(Currents[i]),
+                                                            std::span<const double, N>(Voltages[j]),
+                                                            std::span<const double, N>(Currents[j]), FixedScore);
+      if (Status != FixedStatus || Score != FixedScore)
+      {
+        printf("Curves %u and %u of %u points: score %.17g (status %d), should be %.17g (status %d)\n",
+               (unsigned)i, (unsigned)j, (unsigned)N, FixedScore, (int)FixedStatus, Score, (int)Status);
+        Mismatches++;
+      }
+      MaxDifference = std::fmax(MaxDifference, std::fabs(Score - FixedScore));
+    }
+  }
+  printf("%u points: %u pairs, max difference %g\n", (unsigned)N, (unsigned)(Voltages.size() * Voltages.size()),
+         MaxDifference);
+  return Mismatches;
+}
+
+/**
+ * Measures the latency of one comparison of N points with the library and with the header
+ */
+template <std::size_t N>
+static void MeasureLatency(ivcmp_context_t *Ctx, std::mt19937 &Random)
+{
+  const ivcmp::FixedComparator<N> Comparator(VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  std::vector<double> VoltagesA(N), CurrentsA(N), VoltagesB(N), CurrentsB(N);
+  double Score, Sum = 0;
+  /* Typical case: a measured curve and its reference */
+  MakeCurve(CURVE_CAPACITOR, 0.01, Random, VoltagesA, CurrentsA);
+  MakeCurve(CURVE_CAPACITOR, 0.01, Random, VoltagesB, CurrentsB);
+
+  auto Start = std::chrono::steady_clock::now();
+  for (int i = 0; i < NUM_LATENCY_CALLS; i++)
+  {
+    CompareIVCWithContext(Ctx, VoltagesA.data(), CurrentsA.data(), N, VoltagesB.data(), CurrentsB.data(), N, &Score);
+    Sum += Score;
+  }
+  const double LibraryTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+  Start = std::chrono::steady_clock::now();
+  for (int i = 0; i < NUM_LATENCY_CALLS; i++)
+  {
+    Comparator.Compare(std::span<const double, N>(VoltagesA), std::span<const double, N>(CurrentsA),
+                       std::span<const double, N>(VoltagesB), std::span<const double, N>(CurrentsB), Score);
+    Sum += Score;
+  }
+  const double FixedTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+  printf("%u points: CompareIVCWithContext() %.2f us, FixedComparator %.2f us (checksum %.3f)\n", (unsigned)N,
+         LibraryTime / NUM_LATENCY_CALLS, FixedTime / NUM_LATENCY_CALLS, Sum);
+}
+
+int main(void)
+{
+  std::mt19937 Random(0);
+  int Mismatches = 0;
+  ivcmp_context_t *Ctx = CreateIVCContext();
+  if (!Ctx)
+  {
+    return -1;
+  }
+  SetContextMinVarVC(Ctx, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+
+  printf("--- Scores of the header and the library.\n");
+  Mismatches += CheckSize<20>(Ctx, Random);
+  Mismatches += CheckSize<100>(Ctx, Random);
+  Mismatches += CheckSize<200>(Ctx, Random);
+  Mismatches += CheckSize<1000>(Ctx, Random);
+
+  printf("--- Latency of one comparison.\n");
+  MeasureLatency<20>(Ctx, Random);
+  MeasureLatency<100>(Ctx, Random);
+  MeasureLatency<200>(Ctx, Random);
+  DestroyIVCContext(Ctx);
+
+  if (Mismatches)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  printf("All tests successfully passed.\n");
+  return 0;
+}
@@ -0,0 +1,592 @@
+/* This module reads JSON files token by token and the pins of board files for the tools processing them
+ */
+#include "ivcmp_json.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_MAX_NUMBER 64 /**< Maximum length of a number */
+
+/**
+ * Returns the next character without taking it, reading the next block if needed
+ *
+ * @param Reader reader
+ *
+ * @return character or EOF
+ */
+static int PeekChar(json_reader_t *Reader)
+{
+  if (Reader->Pos == Reader->Len)
+  {
+    Reader->Len = fread(Reader->Buffer, 1, JSON_BUFFER_SIZE, Reader->File);
+    Reader->Pos = 0;
+    if (Reader->Len == 0)
+    {
+      return EOF;
+    }
+  }
+  return (unsigned char)Reader->Buffer[Reader->Pos];
+}
+
+/**
+ * Takes the next character
+ *
+ * @param Reader reader
+ *
+ * @return character or EOF
+ */
+static int TakeChar(json_reader_t *Reader)
+{
+  int c = PeekChar(Reader);
+  if (c != EOF)
+  {
+    Reader->Pos++;
+  }
+  return c;
+}
+
+/**
+ * Checks that the rest of the literal follows
+ *
+ * @param Reader reader
+ * @param[in] Rest characters of the literal after the first one
+ *
+ * @return 1 if the literal matches, 0 otherwise
+ */
+static int ReadLiteral(json_reader_t *Reader, const char *Rest)
+{
+  for (; *Rest; Rest++)
+  {
+    if (TakeChar(Reader) != *Rest)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Reads the number of 4 hexadecimal digits of the \u escape
+ *
+ * @param Reader reader
+ *
+ * @return code or -1 on error
+ */
+static long ReadHex4(json_reader_t *Reader)
+{
+  int i, c;
+  long Code = 0;
+  for (i = 0; i < 4; i++)
+  {
+    c = TakeChar(Reader);
+    if (c >= '0' && c <= '9')
+    {
+      Code = Code * 16 + (c - '0');
+    }
+    else if (c >= 'a' && c <= 'f')
+    {
+      Code = Code * 16 + (c - 'a' + 10);
+    }
+    else if (c >= 'A' && c <= 'F')
+    {
+      Code = Code * 16 + (c - 'A' + 10);
+    }
+    else
+    {
+      return -1;
+    }
+  }
+  return Code;
+}
+
+/**
+ * Reads the string after the opening quote to Reader->String
+ *
+ * @param Reader reader
+ *
+ * @return JSON_STRING or JSON_ERROR
+ */
+static json_token_t ReadString(json_reader_t *Reader)
+{
+  int c;
+  long Code;
+  size_t Len = 0;
+
+  for (;;)
+  {
+    c = TakeChar(Reader);
+    if (c == EOF)
+    {
+      return JSON_ERROR;
+    }
+    if (c == '"')
+    {
+      break;
+    }
+    if (c == '\\')
+    {
+      c = TakeChar(Reader);
+      switch (c)
+      {
+        case '"':
+        case '\\':
+        case '/':
+          break;
+        case 'b':
+          c = '\b';
+          break;
+        case 'f':
+          c = '\f';
+          break;
+        case 'n':
+          c = '\n';
+          break;
+        case 'r':
+          c = '\r';
+          break;
+        case 't':
+          c = '\t';
+          break;
+        case 'u':
+          /* Names of the fields are ASCII, other characters are replaced */
+          Code = ReadHex4(Reader);
+          if (Code < 0)
+          {
+            return JSON_ERROR;
+          }
+          c = Code < 128 ? (int)Code : '?';
+          break;
+        default:
+          return JSON_ERROR;
+      }
+    }
+    if (Len < JSON_MAX_STRING - 1)
+    {
+      Reader->String[Len++] = (char)c;
+    }
+  }
+  Reader->String[Len] = 0;
+  return JSON_STRING;
+}
+
+/**
+ * Reads the number starting with the given character to Reader->Number
+ *
+ * @param Reader reader
+ * @param[in] First first character of the number
+ *
+ * @return JSON_NUMBER or JSON_ERROR
+ */
+static json_token_t ReadNumber(json_reader_t *Reader, int First)
+{
+  int c;
+  char *End;
+  char Text[JSON_MAX_NUMBER];
+  size_t Len = 0;
+
+  Text[Len++] = (char)First;
+  for (;;)
+  {
+    c = PeekChar(Reader);
+    if (!((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-'))
+    {
+      break;
+    }
+    if (Len == JSON_MAX_NUMBER - 1)
+    {
+      return JSON_ERROR;
+    }
+    Text[Len++] = (char)TakeChar(Reader);
+  }
+  Text[Len] = 0;
+  Reader->Number = strtod(Text, &End);
+  return *End == 0 ? JSON_NUMBER : JSON_ERROR;
+}
+
+void JsonInit(json_reader_t *Reader, FILE *File)
+{
+  Reader->File = File;
+  Reader->Pos = 0;
+  Reader->Len = 0;
+  Reader->String[0] = 0;
+  Reader->Number = 0.;
+}
+
+json_token_t JsonNext(json_reader_t *Reader)
+{
+  int c;
+  do
+  {
+    c = TakeChar(Reader);
+  } while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == ',' || c == ':');
+
+  switch (c)
+  {
+    case EOF:
+      return ferror(Reader->File) ? JSON_ERROR : JSON_END;
+    case '{':
+      return JSON_OBJECT_BEGIN;
+    case '}':
+      return JSON_OBJECT_END;
+    case '[':
+      return JSON_ARRAY_BEGIN;
+    case ']':
+      return JSON_ARRAY_END;
+    case '"':
+      return ReadString(Reader);
+    case 't':
+      return ReadLiteral(Reader, "rue") ? JSON_TRUE : JSON_ERROR;
+    case 'f':
+      return ReadLiteral(Reader, "alse") ? JSON_FALSE : JSON_ERROR;
+    case 'n':
+      return ReadLiteral(Reader, "ull") ? JSON_NULL : JSON_ERROR;
+    default:
+      if (c == '-' || (c >= '0' && c <= '9'))
+      {
+        return ReadNumber(Reader, c);
+      }
+      return JSON_ERROR;
+  }
+}
+
+int JsonSkip(json_reader_t *Reader, json_token_t Token)
+{
+  uint32_t Depth = 0;
+  for (;;)
+  {
+    switch (Token)
+    {
+      case JSON_ERROR:
+      case JSON_END:
+      case JSON_OBJECT_END:
+      case JSON_ARRAY_END:
+        if (Depth == 0 || (Token != JSON_OBJECT_END && Token != JSON_ARRAY_END))
+        {
+          return 0;
+        }
+        Depth--;
+        break;
+      case JSON_OBJECT_BEGIN:
+      case JSON_ARRAY_BEGIN:
+        Depth++;
+        break;
+      default:
+        break;
+    }
+    if (Depth == 0)
+    {
+      return 1;
+    }
+    Token = JsonNext(Reader);
+  }
+}
+
+int JsonReadNumbers(json_reader_t *Reader, double **Values, size_t *Capacity, size_t *Count)
+{
+  json_token_t Token;
+  double *NewValues;
+
+  *Count = 0;
+  for (;;)
+  {
+    Token = JsonNext(Reader);
+    if (Token == JSON_ARRAY_END)
+    {
+      return 1;
+    }
+    if (Token != JSON_NUMBER)
+    {
+      return 0;
+    }
+    if (*Count == *Capacity)
+    {
+      NewValues = (double *)realloc(*Values, (*Capacity * 2 + 64) * sizeof(double));
+      if (!NewValues)
+      {
+        return 0;
+      }
+      *Values = NewValues;
+      *Capacity = *Capacity * 2 + 64;
+    }
+    (*Values)[(*Count)++] = Reader->Number;
+  }
+}
+
+/**
+ * Reads the measure settings object whose begin token is already read
+ *
+ * @param Reader reader
+ * @param[out] Settings settings
+ *
+ * @return 1 on success, 0 on error
+ */
+static int ReadMeasureSettings(json_reader_t *Reader, ivcmp_measure_settings_t *Settings)
+{
+  json_token_t Token;
+  double *Value;
+  uint32_t *Count;
+  for (;;)
+  {
+    Token = JsonNext(Reader);
+    if (Token == JSON_OBJECT_END)
+    {
+      return 1;
+    }
+    if (Token != JSON_STRING)
+    {
+      return 0;
+    }
+    Value = !strcmp(Reader->String, "probe_signal_frequency") ? &Settings->ProbeSignalFrequency :
+            !strcmp(Reader->String, "max_voltage") ? &Settings->MaxVoltage :
+            !strcmp(Reader->String, "max_current") ? &Settings->MaxCurrent :
+            !strcmp(Reader->String, "desc_frequency") ? &Settings->DescFrequency : NULL;
+    Count = !strcmp(Reader->String, "n_points") ? &Settings->NumPoints :
+            !strcmp(Reader->String, "n_charge_points") ? &Settings->NumChargePoints :
+            !strcmp(Reader->String, "flags") ? &Settings->Flags : NULL;
+    Token = JsonNext(Reader);
+    if (Value && Token == JSON_NUMBER)
+    {
+      *Value = Reader->Number;
+    }
+    else if (Count && Token == JSON_NUMBER && Reader->Number >= 0)
+    {
+      *Count = (uint32_t)Reader->Number;
+    }
+    else if (!JsonSkip(Reader, Token))
+    {
+      return 0;
+    }
+  }
+}
+
+/**
+ * Reads a curve object: its measure settings, voltages and currents
+ *
+ * @param Reader reader
+ * @param Curve curve
+ * @param[in] Token first token of the curve value
+ *
+ * @return 1 on success, 0 on error
+ */
+static int ReadCurve(json_reader_t *Reader, board_curve_t *Curve, json_token_t Token)
+{
+  if (Token == JSON_NULL)
+  {
+    return 1;
+  }
+  if (Token != JSON_OBJECT_BEGIN)
+  {
+    return 0;
+  }
+  Curve->Present = 1;
+  for (;;)
+  {
+    Token = JsonNext(Reader);
+    if (Token == JSON_OBJECT_END)
+    {
+      return 1;
+    }
+    if (Token != JSON_STRING)
+    {
+      return 0;
+    }
+    if (!strcmp(Reader->String, "voltage"))
+    {
+      if (JsonNext(Reader) != JSON_ARRAY_BEGIN ||
+          !JsonReadNumbers(Reader, &Curve->Voltages, &Curve->VoltagesSize, &Curve->NumVoltages))
+      {
+        return 0;
+      }
+    }
+    else if (!strcmp(Reader->String, "current"))
+    {
+      if (JsonNext(Reader) != JSON_ARRAY_BEGIN ||
+          !JsonReadNumbers(Reader, &Curve->Currents, &Curve->CurrentsSize, &Curve->NumCurrents))
+      {
+        return 0;
+      }
+    }
+    else if (!strcmp(Reader->String, "measure_settings"))
+    {
+      Token = JsonNext(Reader);
+      if (Token == JSON_OBJECT_BEGIN ? !ReadMeasureSettings(Reader, &Curve->Settings) : !JsonSkip(Reader, Token))
+      {
+        return 0;
+      }
+    }
+    else if (!JsonSkip(Reader, JsonNext(Reader)))
+    {
+      return 0;
+    }
+  }
+}
+
+/**
+ * Reads a pin object whose begin token is already read and passes it to the handler
+ *
+ * @param Reader reader
+ * @param Pin pin with the numbers of the element and the pin set
+ * @param[in] Handler handler of the pins
+ * @param Data data of the handler
+ *
+ * @return 1 on success, 0 on error
+ */
+static int ReadPin(json_reader_t *Reader, board_pin_t *Pin, board_pin_handler_t Handler, void *Data)
+{
+  json_token_t Token;
+  size_t k;
+
+  for (k = 0; k < 2; k++)
+  {
+    Pin->Curves[k].NumVoltages = Pin->Curves[k].NumCurrents = 0;
+    memset(&Pin->Curves[k].Settings, 0, sizeof(ivcmp_measure_settings_t));
+    Pin->Curves[k].Present = 0;
+  }
+  Pin->Score = -1.;
+  for (;;)
+  {
+    Token = JsonNext(Reader);
+    if (Token == JSON_OBJECT_END)
+    {
+      return Handler(Data, Pin);
+    }
+    if (Token != JSON_STRING)
+    {
+      return 0;
+    }
+    k = !strcmp(Reader->String, "ivc") ? 0 : !strcmp(Reader->String, "reference_ivc") ? 1 : 2;
+    if (k < 2)
+    {
+      if (!ReadCurve(Reader, &Pin->Curves[k], JsonNext(Reader)))
+      {
+        return 0;
+      }
+    }
+    else if (!strcmp(Reader->String, "score"))
+    {
+      Token = JsonNext(Reader);
+      if (Token == JSON_NUMBER)
+      {
+        Pin->Score = Reader->Number;
+      }
+      else if (!JsonSkip(Reader, Token))
+      {
+        return 0;
+      }
+    }
+    else if (!JsonSkip(Reader, JsonNext(Reader)))
+    {
+      return 0;
+    }
+  }
+}
+
+/**
+ * Reads the values of the object whose begin token is already read up to the array with the given name,
+ * other values are skipped
+ *
+ * @param Reader reader
+ * @param[in] Name name of the array
+ *
+ * @return JSON_ARRAY_BEGIN if the array is found, JSON_OBJECT_END at the end of the object, JSON_ERROR on error
+ */
+static json_token_t FindArray(json_reader_t *Reader, const char *Name)
+{
+  json_token_t Token;
+  for (;;)
+  {
+    Token = JsonNext(Reader);
+    if (Token == JSON_OBJECT_END)
+    {
+      return Token;
+    }
+    if (Token != JSON_STRING)
+    {
+      return JSON_ERROR;
+    }
+    Token = JsonNext(Reader);
+    if (!strcmp(Reader->String, Name) && Token == JSON_ARRAY_BEGIN)
+    {
+      return Token;
+    }
+    if (!JsonSkip(Reader, Token))
+    {
+      return JSON_ERROR;
+    }
+  }
+}
+
+/**
+ * Reads an element object whose begin token is already read and passes its pins to the handler
+ *
+ * @param Reader reader
+ * @param Pin pin with the number of the element set
+ * @param[in] Handler handler of the pins
+ * @param Data data of the handler
+ *
+ * @return 1 on success, 0 on error
+ */
+static int ReadElement(json_reader_t *Reader, board_pin_t *Pin, board_pin_handler_t Handler, void *Data)
+{
+  json_token_t Token;
+  for (;;)
+  {
+    Token = FindArray(Reader, "pins");
+    if (Token != JSON_ARRAY_BEGIN)
+    {
+      return Token == JSON_OBJECT_END;
+    }
+    for (Pin->Number = 0;; Pin->Number++)
+    {
+      Token = JsonNext(Reader);
+      if (Token == JSON_ARRAY_END)
+      {
+        break;
+      }
+      if (Token != JSON_OBJECT_BEGIN || !ReadPin(Reader, Pin, Handler, Data))
+      {
+        return 0;
+      }
+    }
+  }
+}
+
+int JsonReadBoard(json_reader_t *Reader, board_pin_t *Pin, board_pin_handler_t Handler, void *Data)
+{
+  json_token_t Token;
+  if (JsonNext(Reader) != JSON_OBJECT_BEGIN)
+  {
+    return 0;
+  }
+  for (;;)
+  {
+    Token = FindArray(Reader, "elements");
+    if (Token != JSON_ARRAY_BEGIN)
+    {
+      return Token == JSON_OBJECT_END;
+    }
+    for (Pin->Element = 0;; Pin->Element++)
+    {
+      Token = JsonNext(Reader);
+      if (Token == JSON_ARRAY_END)
+      {
+        break;
+      }
+      if (Token != JSON_OBJECT_BEGIN || !ReadElement(Reader, Pin, Handler, Data))
+      {
+        return 0;
+      }
+    }
+  }
+}
+
+void JsonFreePin(board_pin_t *Pin)
+{
+  size_t k;
+  for (k = 0; k < 2; k++)
+  {
+    free(Pin->Curves[k].Voltages);
+    free(Pin->Curves[k].Currents);
+    Pin->Curves[k].Voltages = Pin->Curves[k].Currents = NULL;
+    Pin->Curves[k].VoltagesSize = Pin->Curves[k].CurrentsSize = 0;
+  }
+}
@@ -0,0 +1,140 @@
+/* Internal interface of the streaming JSON reader and the reader of board files used by the tools.
+ */
+#ifndef IVCMP_JSON_H
+#define IVCMP_JSON_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ivcmp.h"
+
+#define JSON_BUFFER_SIZE 65536 /**< Size of the block read from the file at once */
+#define JSON_MAX_STRING 256    /**< Maximum stored length of a string, longer strings are truncated */
+
+/**
+ * Token of the JSON text
+ */
+typedef enum
+{
+  JSON_ERROR = 0,    /**< Syntax error or read error */
+  JSON_END,          /**< End of the file */
+  JSON_OBJECT_BEGIN, /**< { */
+  JSON_OBJECT_END,   /**< } */
+  JSON_ARRAY_BEGIN,  /**< [ */
+  JSON_ARRAY_END,    /**< ] */
+  JSON_STRING,       /**< String, see json_reader_t.String */
+  JSON_NUMBER,       /**< Number, see json_reader_t.Number */
+  JSON_TRUE,         /**< true */
+  JSON_FALSE,        /**< false */
+  JSON_NULL          /**< null */
+} json_token_t;
+
+/**
+ * Reader of the tokens of a JSON file. The file is read by blocks, so its size is not limited.
+ */
+typedef struct
+{
+  FILE *File;                     /**< File */
+  char Buffer[JSON_BUFFER_SIZE];  /**< Block of the file */
+  size_t Pos;                     /**< Position of the next character in the block */
+  size_t Len;                     /**< Number of characters in the block */
+  char String[JSON_MAX_STRING];   /**< Last string token, zero terminated */
+  double Number;                  /**< Last number token */
+} json_reader_t;
+
+/**
+ * Starts reading the file
+ *
+ * @param Reader reader
+ * @param File file opened for reading
+ */
+void JsonInit(json_reader_t *Reader, FILE *File);
+
+/**
+ * Reads the next token. Separators ',' and ':' are skipped as white space,
+ * so the callers rely on the structure of the objects and arrays only.
+ *
+ * @param Reader reader
+ *
+ * @return token
+ */
+json_token_t JsonNext(json_reader_t *Reader);
+
+/**
+ * Skips the value whose first token is already read
+ *
+ * @param Reader reader
+ * @param[in] Token first token of the value
+ *
+ * @return 1 on success, 0 on error
+ */
+int JsonSkip(json_reader_t *Reader, json_token_t Token);
+
+/**
+ * Reads the numbers of the array whose begin token is already read, up to the array end.
+ * The storage grows as needed.
+ *
+ * @param Reader reader
+ * @param Values array of the numbers allocated with malloc(), may be NULL
+ * @param Capacity number of the numbers the array can store
+ * @param[out] Count number of the numbers read
+ *
+ * @return 1 on success, 0 on syntax error, non-number item or lack of memory
+ */
+int JsonReadNumbers(json_reader_t *Reader, double **Values, size_t *Capacity, size_t *Count);
+
+/**
+ * Curve of a pin of the board file
+ */
+typedef struct
+{
+  double *Voltages;                  /**< Voltages */
+  size_t VoltagesSize;               /**< Capacity of Voltages */
+  size_t NumVoltages;                /**< Number of voltages */
+  double *Currents;                  /**< Currents */
+  size_t CurrentsSize;               /**< Capacity of Currents */
+  size_t NumCurrents;                /**< Number of currents */
+  ivcmp_measure_settings_t Settings; /**< Measure settings, zeros if absent */
+  int Present;                       /**< Non-zero if the pin has the curve object */
+} board_curve_t;
+
+/**
+ * Pin of the board file (elements JSON format of EyePoint)
+ */
+typedef struct
+{
+  board_curve_t Curves[2]; /**< Measured (ivc) and reference (reference_ivc) curves */
+  double Score;            /**< Score stored in the file, negative if absent */
+  uint32_t Element;        /**< Number of the element in the file */
+  uint32_t Number;         /**< Number of the pin in the element */
+} board_pin_t;
+
+/**
+ * Handler of the pins read from the board file
+ *
+ * @param Data data of the handler
+ * @param[in] Pin pin
+ *
+ * @return 1 to go on reading, 0 to stop with error
+ */
+typedef int (*board_pin_handler_t)(void *Data, const board_pin_t *Pin);
+
+/**
+ * Reads the board file calling the handler for each of its pins
+ *
+ * @param Reader reader of the file
+ * @param Pin storage of the pin, its arrays are reused from pin to pin, see JsonFreePin()
+ * @param[in] Handler handler of the pins
+ * @param Data data of the handler
+ *
+ * @return 1 on success, 0 on syntax error, lack of memory or error of the handler
+ */
+int JsonReadBoard(json_reader_t *Reader, board_pin_t *Pin, board_pin_handler_t Handler, void *Data);
+
+/**
+ * Frees the arrays of the pin
+ *
+ * @param Pin pin
+ */
+void JsonFreePin(board_pin_t *Pin);
+
+#endif
@@ -0,0 +1,93 @@
+/* Internal interface of the vectorized distance kernels.
+ * Kernels are compiled in separate modules with the instruction set enabled
+ * and are selected at run time by the processor features.
+ */
+#ifndef IVCMP_KERNELS_H
+#define IVCMP_KERNELS_H
+
+#include <stdint.h>
+
+/**
+ * Finds the first nearest curve node to the point.
+ * Returns LocMinItem if all the squared distances are not less than 100000.
+ *
+ * @param[in] Curve curve
+ * @param[in] SizeJ number of points in the curve
+ * @param[in] pt point
+ * @param[in] LocMinItem node returned if all the nodes are too far
+ *
+ * @return number of the first nearest node
+ */
+typedef uint32_t (*nearest_node_kernel_t)(double **Curve, uint32_t SizeJ, const double *pt, uint32_t LocMinItem);
+
+/**
+ * Evaluates squared distances from the points to the curve segments adjacent to their nearest nodes
+ *
+ * @param[in] Curve curve
+ * @param[in] pts points
+ * @param[in] SizeJ number of points in the curve and the points
+ * @param[in] First first point to process
+ * @param[in] Count number of points to process
+ * @param[in] Nearest nearest curve node for each point
+ * @param[out] Dist distance for each point
+ */
+typedef void (*seg_dist_kernel_t)(double **Curve, double **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                                  const uint32_t *Nearest, double *Dist);
+
+/**
+ * Updates the nearest nodes of the points of both curves for a tile, see NearestTileScalar().
+ * Vector kernels process the points of both curves in groups, the last groups overlap the previous points,
+ * so FirstB + CountB must be at least the number of lanes and FirstA + CountA must be at least 4.
+ *
+ * @param[in] a first curve
+ * @param[in] b second curve
+ * @param[in] FirstA first point of the first curve in the tile
+ * @param[in] CountA number of points of the first curve in the tile
+ * @param[in] FirstB first point of the second curve in the tile
+ * @param[in] CountB number of points of the second curve in the tile
+ * @param MinA squared distance from each point of the first curve to its nearest node, updated
+ * @param NearA nearest node of the second curve for each point of the first one, updated
+ * @param MinB squared distance from each point of the second curve to its nearest node, updated
+ * @param NearB nearest node of the first curve for each point of the second one, updated
+ */
+typedef void (*nearest_tile_kernel_t)(double **a, double **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB,
+                                      uint32_t CountB, double *MinA, uint32_t *NearA, double *MinB, uint32_t *NearB);
+
+/* Same kernels in single precision */
+typedef uint32_t (*nearest_node_f_kernel_t)(float **Curve, uint32_t SizeJ, const float *pt, uint32_t LocMinItem);
+typedef void (*seg_dist_f_kernel_t)(float **Curve, float **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                                    const uint32_t *Nearest, float *Dist);
+typedef void (*nearest_tile_f_kernel_t)(float **a, float **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB,
+                                        uint32_t CountB, float *MinA, uint32_t *NearA, float *MinB, uint32_t *NearB);
+
+#if defined(IVCMP_SIMD_X86)
+/* AVX2 kernels, SizeJ and Count must be at least 4 */
+uint32_t IvcNearestNodeAvx2(double **Curve, uint32_t SizeJ, const double *pt, uint32_t LocMinItem);
+void IvcSegDistAvx2(double **Curve, double **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                    const uint32_t *Nearest, double *Dist);
+void IvcNearestTileAvx2(double **a, double **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                        double *MinA, uint32_t *NearA, double *MinB, uint32_t *NearB);
+
+/* AVX2 kernels in single precision, SizeJ and Count must be at least 8 */
+uint32_t IvcNearestNodeAvx2F(float **Curve, uint32_t SizeJ, const float *pt, uint32_t LocMinItem);
+void IvcSegDistAvx2F(float **Curve, float **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                     const uint32_t *Nearest, float *Dist);
+void IvcNearestTileAvx2F(float **a, float **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                         float *MinA, uint32_t *NearA, float *MinB, uint32_t *NearB);
+
+/* AVX-512 kernels, SizeJ and Count must be at least 8 */
+uint32_t IvcNearestNodeAvx512(double **Curve, uint32_t SizeJ, const double *pt, uint32_t LocMinItem);
+void IvcSegDistAvx512(double **Curve, double **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                      const uint32_t *Nearest, double *Dist);
+void IvcNearestTileAvx512(double **a, double **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                          double *MinA, uint32_t *NearA, double *MinB, uint32_t *NearB);
+
+/* AVX-512 kernels in single precision, SizeJ and Count must be at least 16 */
+uint32_t IvcNearestNodeAvx512F(float **Curve, uint32_t SizeJ, const float *pt, uint32_t LocMinItem);
+void IvcSegDistAvx512F(float **Curve, float **pts, uint32_t SizeJ, uint32_t First, uint32_t Count,
+                       const uint32_t *Nearest, float *Dist);
+void IvcNearestTileAvx512F(float **a, float **b, uint32_t FirstA, uint32_t CountA, uint32_t FirstB, uint32_t CountB,
+                           float *MinA, uint32_t *NearA, float *MinB, uint32_t *NearB);
+#endif
+
+#endif
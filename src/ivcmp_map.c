@@ -0,0 +1,112 @@
+/* This module maps files of the signature store to memory
+ */
+#include "ivcmp_map.h"
+#include <stddef.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+int IvcMapFile(const char *FileName, ivc_file_map_t *Map)
+{
+  HANDLE File, Mapping;
+  LARGE_INTEGER Size;
+
+  Map->Data = NULL;
+  Map->Size = 0;
+  File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (File == INVALID_HANDLE_VALUE)
+  {
+    return 0;
+  }
+  if (!GetFileSizeEx(File, &Size) || (uint64_t)Size.QuadPart > (size_t)-1)
+  {
+    CloseHandle(File);
+    return 0;
+  }
+  if (Size.QuadPart == 0)
+  {
+    CloseHandle(File);
+    return 1;
+  }
+  /* The view keeps the mapping and the file open */
+  Mapping = CreateFileMappingA(File, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(File);
+  if (!Mapping)
+  {
+    return 0;
+  }
+  Map->Data = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(Mapping);
+  if (!Map->Data)
+  {
+    return 0;
+  }
+  Map->Size = (uint64_t)Size.QuadPart;
+  return 1;
+}
+
+void IvcUnmapFile(ivc_file_map_t *Map)
+{
+  if (Map->Data)
+  {
+    UnmapViewOfFile(Map->Data);
+  }
+  Map->Data = NULL;
+  Map->Size = 0;
+}
+
+#else
+
+int IvcMapFile(const char *FileName, ivc_file_map_t *Map)
+{
+  int File;
+  struct stat Stat;
+  void *Data;
+
+  Map->Data = NULL;
+  Map->Size = 0;
+  File = open(FileName, O_RDONLY);
+  if (File < 0)
+  {
+    return 0;
+  }
+  if (fstat(File, &Stat) != 0 || (uint64_t)Stat.st_size > (size_t)-1)
+  {
+    close(File);
+    return 0;
+  }
+  if (Stat.st_size == 0)
+  {
+    close(File);
+    return 1;
+  }
+  /* The mapping keeps the file open */
+  Data = mmap(NULL, (size_t)Stat.st_size, PROT_READ, MAP_SHARED, File, 0);
+  close(File);
+  if (Data == MAP_FAILED)
+  {
+    return 0;
+  }
+  Map->Data = Data;
+  Map->Size = (uint64_t)Stat.st_size;
+  return 1;
+}
+
+void IvcUnmapFile(ivc_file_map_t *Map)
+{
+  if (Map->Data)
+  {
+    munmap((void *)Map->Data, (size_t)Map->Size);
+  }
+  Map->Data = NULL;
+  Map->Size = 0;
+}
+
+#endif
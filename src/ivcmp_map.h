@@ -0,0 +1,34 @@
+/* Internal interface of the read-only mapping of files to memory used by the signature store.
+ */
+#ifndef IVCMP_MAP_H
+#define IVCMP_MAP_H
+
+#include <stdint.h>
+
+/**
+ * File mapped to memory. The pages are shared by all the processes mapping the same file.
+ */
+typedef struct
+{
+  const void *Data; /**< Contents of the file, NULL for an empty file */
+  uint64_t Size;    /**< Size of the file in bytes */
+} ivc_file_map_t;
+
+/**
+ * Maps the whole file to memory for reading
+ *
+ * @param[in] FileName name of the file
+ * @param[out] Map mapping
+ *
+ * @return 1 on success, 0 if the file can not be opened or mapped
+ */
+int IvcMapFile(const char *FileName, ivc_file_map_t *Map);
+
+/**
+ * Unmaps the file mapped by IvcMapFile()
+ *
+ * @param Map mapping
+ */
+void IvcUnmapFile(ivc_file_map_t *Map);
+
+#endif
@@ -0,0 +1,263 @@
+/* This module runs tasks of the functions comparing many curves on several threads
+ */
+#include "ivcmp_pool.h"
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+typedef CRITICAL_SECTION ivc_mutex_t;
+typedef HANDLE ivc_thread_t;
+#define MutexInit(Mutex) InitializeCriticalSection(Mutex)
+#define MutexDestroy(Mutex) DeleteCriticalSection(Mutex)
+#define MutexLock(Mutex) EnterCriticalSection(Mutex)
+#define MutexUnlock(Mutex) LeaveCriticalSection(Mutex)
+#else
+typedef pthread_mutex_t ivc_mutex_t;
+typedef pthread_t ivc_thread_t;
+#define MutexInit(Mutex) pthread_mutex_init(Mutex, NULL)
+#define MutexDestroy(Mutex) pthread_mutex_destroy(Mutex)
+#define MutexLock(Mutex) pthread_mutex_lock(Mutex)
+#define MutexUnlock(Mutex) pthread_mutex_unlock(Mutex)
+#endif
+
+/**
+ * Tasks owned by one worker: the worker takes them from the front, the others steal from the back
+ */
+typedef struct
+{
+  uint32_t Next;    /**< First task not taken */
+  uint32_t End;     /**< Task after the last one */
+  ivc_mutex_t Lock; /**< Protects Next and End */
+} task_range_t;
+
+/**
+ * Tasks shared by the workers of one IvcParallelFor() call
+ */
+typedef struct
+{
+  ivc_task_func_t Func;                /**< Task function */
+  void *Arg;                           /**< Argument for the task function */
+  uint32_t NumWorkers;                 /**< Number of workers */
+  task_range_t Ranges[IVC_MAX_WORKERS]; /**< Tasks of each worker */
+} task_queue_t;
+
+/**
+ * Argument of a worker thread
+ */
+typedef struct
+{
+  task_queue_t *Queue; /**< Tasks */
+  uint32_t Worker;     /**< Number of the worker */
+} worker_t;
+
+/**
+ * Takes the next task of the worker
+ *
+ * @param Range tasks of the worker
+ * @param[out] Task task
+ *
+ * @return 1 if the task is taken, 0 if the worker has no tasks
+ */
+static int TakeTask(task_range_t *Range, uint32_t *Task)
+{
+  int Taken;
+  MutexLock(&Range->Lock);
+  Taken = Range->Next < Range->End;
+  if (Taken)
+  {
+    *Task = Range->Next++;
+  }
+  MutexUnlock(&Range->Lock);
+  return Taken;
+}
+
+/**
+ * Moves the back half of the tasks of the most loaded worker to the idle one
+ * and takes the first of them. Only one lock is held at a time.
+ *
+ * @param Queue tasks
+ * @param[in] Worker number of the idle worker
+ * @param[out] Task task
+ *
+ * @return 1 if the task is taken, 0 if no tasks are left in the queue
+ */
+static int StealTask(task_queue_t *Queue, uint32_t Worker, uint32_t *Task)
+{
+  uint32_t i, Victim, Count, Middle, End;
+  uint32_t MaxCount;
+  task_range_t *Range;
+
+  for (;;)
+  {
+    /* Victim is chosen by the counts seen, they may change until its lock is taken */
+    MaxCount = 0;
+    Victim = Worker;
+    for (i = 1; i < Queue->NumWorkers; i++)
+    {
+      Range = &Queue->Ranges[(Worker + i) % Queue->NumWorkers];
+      MutexLock(&Range->Lock);
+      Count = Range->End - Range->Next;
+      MutexUnlock(&Range->Lock);
+      if (Count > MaxCount)
+      {
+        MaxCount = Count;
+        Victim = (Worker + i) % Queue->NumWorkers;
+      }
+    }
+    if (MaxCount == 0)
+    {
+      return 0;
+    }
+
+    Range = &Queue->Ranges[Victim];
+    MutexLock(&Range->Lock);
+    Count = Range->End - Range->Next;
+    End = Range->End;
+    Middle = End - (Count + 1) / 2;
+    Range->End = Middle;
+    MutexUnlock(&Range->Lock);
+    if (Count > 0)
+    {
+      Range = &Queue->Ranges[Worker];
+      MutexLock(&Range->Lock);
+      Range->Next = Middle + 1;
+      Range->End = End;
+      MutexUnlock(&Range->Lock);
+      *Task = Middle;
+      return 1;
+    }
+  }
+}
+
+/**
+ * Executes own tasks, then the tasks stolen from the other workers until all of them are taken
+ *
+ * @param Worker worker
+ */
+static void RunWorker(const worker_t *Worker)
+{
+  uint32_t Task;
+  task_queue_t *Queue = Worker->Queue;
+  while (TakeTask(&Queue->Ranges[Worker->Worker], &Task) || StealTask(Queue, Worker->Worker, &Task))
+  {
+    Queue->Func(Queue->Arg, Task, Worker->Worker);
+  }
+}
+
+#if defined(_WIN32)
+static unsigned __stdcall ThreadMain(void *Arg)
+{
+  RunWorker((const worker_t *)Arg);
+  return 0;
+}
+#else
+static void *ThreadMain(void *Arg)
+{
+  RunWorker((const worker_t *)Arg);
+  return NULL;
+}
+#endif
+
+/**
+ * Starts a thread executing the worker
+ *
+ * @param[out] Thread thread handle
+ * @param Worker worker
+ *
+ * @return 1 if the thread is started, 0 otherwise
+ */
+static int StartThread(ivc_thread_t *Thread, worker_t *Worker)
+{
+#if defined(_WIN32)
+  *Thread = (HANDLE)_beginthreadex(NULL, 0, ThreadMain, Worker, 0, NULL);
+  return *Thread != 0;
+#else
+  return pthread_create(Thread, NULL, ThreadMain, Worker) == 0;
+#endif
+}
+
+/**
+ * Waits for the thread to finish and releases it
+ *
+ * @param Thread thread handle
+ */
+static void JoinThread(ivc_thread_t Thread)
+{
+#if defined(_WIN32)
+  WaitForSingleObject(Thread, INFINITE);
+  CloseHandle(Thread);
+#else
+  pthread_join(Thread, NULL);
+#endif
+}
+
+uint32_t IvcGetNumProcessors(void)
+{
+#if defined(_WIN32)
+  SYSTEM_INFO Info;
+  GetSystemInfo(&Info);
+  return Info.dwNumberOfProcessors > 0 ? (uint32_t)Info.dwNumberOfProcessors : 1;
+#else
+  long Count = sysconf(_SC_NPROCESSORS_ONLN);
+  return Count > 0 ? (uint32_t)Count : 1;
+#endif
+}
+
+void IvcParallelFor(uint32_t NumWorkers, uint32_t NumTasks, ivc_task_func_t Func, void *Arg)
+{
+  uint32_t i;
+  uint32_t NumThreads = 0;
+  task_queue_t Queue;
+  worker_t Workers[IVC_MAX_WORKERS];
+  ivc_thread_t Threads[IVC_MAX_WORKERS];
+
+  if (NumWorkers > IVC_MAX_WORKERS)
+  {
+    NumWorkers = IVC_MAX_WORKERS;
+  }
+  if (NumWorkers > NumTasks)
+  {
+    NumWorkers = NumTasks;
+  }
+  if (NumWorkers == 0)
+  {
+    NumWorkers = 1;
+  }
+  Queue.Func = Func;
+  Queue.Arg = Arg;
+  Queue.NumWorkers = NumWorkers;
+  /* Workers start with equal contiguous parts of the tasks */
+  for (i = 0; i < NumWorkers; i++)
+  {
+    Queue.Ranges[i].Next = (uint32_t)((uint64_t)i * NumTasks / NumWorkers);
+    Queue.Ranges[i].End = (uint32_t)((uint64_t)(i + 1) * NumTasks / NumWorkers);
+    MutexInit(&Queue.Ranges[i].Lock);
+    Workers[i].Queue = &Queue;
+    Workers[i].Worker = i;
+  }
+  /* Tasks of the workers that failed to start are taken by the others */
+  for (i = 1; i < NumWorkers; i++)
+  {
+    if (StartThread(&Threads[NumThreads], &Workers[i]))
+    {
+      NumThreads++;
+    }
+  }
+  if (NumTasks > 0)
+  {
+    RunWorker(&Workers[0]);
+  }
+  for (i = 0; i < NumThreads; i++)
+  {
+    JoinThread(Threads[i]);
+  }
+  for (i = 0; i < NumWorkers; i++)
+  {
+    MutexDestroy(&Queue.Ranges[i].Lock);
+  }
+}
@@ -0,0 +1,40 @@
+/* Internal interface of the worker threads used by the functions comparing many curves.
+ */
+#ifndef IVCMP_POOL_H
+#define IVCMP_POOL_H
+
+#include <stdint.h>
+
+#define IVC_MAX_WORKERS 256 /**< Maximum number of workers including the calling thread */
+
+/**
+ * Task executed by a worker
+ *
+ * @param Arg argument given to IvcParallelFor()
+ * @param[in] Task number of the task
+ * @param[in] Worker number of the worker executing the task, from 0 to NumWorkers - 1
+ */
+typedef void (*ivc_task_func_t)(void *Arg, uint32_t Task, uint32_t Worker);
+
+/**
+ * Returns the number of processors available to the process
+ *
+ * @return number of processors, at least 1
+ */
+uint32_t IvcGetNumProcessors(void);
+
+/**
+ * Executes tasks from 0 to NumTasks - 1 on NumWorkers workers.
+ * The calling thread is worker 0, the others are started for the call.
+ * Each worker starts with an equal contiguous part of the tasks and takes them in increasing order,
+ * an idle worker steals the back half of the tasks left to the most loaded one.
+ * All the tasks are executed even if some threads can not be started.
+ *
+ * @param[in] NumWorkers number of workers, from 1 to IVC_MAX_WORKERS
+ * @param[in] NumTasks number of tasks
+ * @param[in] Func task function
+ * @param Arg argument for the task function
+ */
+void IvcParallelFor(uint32_t NumWorkers, uint32_t NumTasks, ivc_task_func_t Func, void *Arg);
+
+#endif
@@ -0,0 +1,194 @@
+/* This module keeps the runtime statistics of the threads and sums them on reading
+ */
+#include "ivcmp_stats.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+#define NUM_COUNTERS (sizeof(ivcmp_stats_t) / sizeof(uint64_t)) /**< All the fields are uint64_t counters */
+
+#if defined(_WIN32)
+static SRWLOCK StatsLock = SRWLOCK_INIT;
+static INIT_ONCE StatsOnce = INIT_ONCE_STATIC_INIT;
+static DWORD StatsKey = FLS_OUT_OF_INDEXES;
+#define LockStats() AcquireSRWLockExclusive(&StatsLock)
+#define UnlockStats() ReleaseSRWLockExclusive(&StatsLock)
+#else
+static pthread_mutex_t StatsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t StatsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t StatsKey;
+static int StatsKeyCreated = 0;
+#define LockStats() pthread_mutex_lock(&StatsLock)
+#define UnlockStats() pthread_mutex_unlock(&StatsLock)
+#endif
+
+IVC_THREAD_LOCAL ivc_stats_block_t *IvcThreadStats = NULL;
+volatile int IvcStatsTimers = 0;
+
+/* Blocks are never freed: a block of a finished thread keeps its counts and is given to a new thread */
+static ivc_stats_block_t *StatsBlocks = NULL; /**< List of all the blocks, protected by StatsLock */
+static ivcmp_stats_t StatsBase;               /**< Sums at the last reset, protected by StatsLock */
+
+/**
+ * Releases the block of the finishing thread
+ *
+ * @param Block block of the thread
+ */
+static void ReleaseThreadStats(void *Block)
+{
+  if (!Block)
+  {
+    return;
+  }
+  LockStats();
+  ((ivc_stats_block_t *)Block)->InUse = 0;
+  UnlockStats();
+  IvcThreadStats = NULL;
+}
+
+#if defined(_WIN32)
+static VOID WINAPI ReleaseThreadStatsFls(PVOID Block)
+{
+  ReleaseThreadStats(Block);
+}
+
+static BOOL CALLBACK CreateStatsKey(PINIT_ONCE Once, PVOID Parameter, PVOID *Context)
+{
+  (void)Once;
+  (void)Parameter;
+  (void)Context;
+  StatsKey = FlsAlloc(ReleaseThreadStatsFls);
+  return TRUE;
+}
+
+/**
+ * Makes ReleaseThreadStats() be called for the block when the calling thread finishes
+ *
+ * @param Block block of the thread
+ */
+static void WatchThreadExit(ivc_stats_block_t *Block)
+{
+  InitOnceExecuteOnce(&StatsOnce, CreateStatsKey, NULL, NULL);
+  if (StatsKey != FLS_OUT_OF_INDEXES)
+  {
+    FlsSetValue(StatsKey, Block);
+  }
+}
+
+uint64_t IvcStatsNow(void)
+{
+  static LARGE_INTEGER Frequency;
+  LARGE_INTEGER Counter;
+  if (!Frequency.QuadPart)
+  {
+    QueryPerformanceFrequency(&Frequency);
+  }
+  QueryPerformanceCounter(&Counter);
+  return (uint64_t)Counter.QuadPart / (uint64_t)Frequency.QuadPart * 1000000000u +
+         (uint64_t)Counter.QuadPart % (uint64_t)Frequency.QuadPart * 1000000000u / (uint64_t)Frequency.QuadPart;
+}
+#else
+static void CreateStatsKey(void)
+{
+  StatsKeyCreated = pthread_key_create(&StatsKey, ReleaseThreadStats) == 0;
+}
+
+/**
+ * Makes ReleaseThreadStats() be called for the block when the calling thread finishes
+ *
+ * @param Block block of the thread
+ */
+static void WatchThreadExit(ivc_stats_block_t *Block)
+{
+  pthread_once(&StatsOnce, CreateStatsKey);
+  if (StatsKeyCreated)
+  {
+    pthread_setspecific(StatsKey, Block);
+  }
+}
+
+uint64_t IvcStatsNow(void)
+{
+  struct timespec Time;
+  clock_gettime(CLOCK_MONOTONIC, &Time);
+  return (uint64_t)Time.tv_sec * 1000000000u + (uint64_t)Time.tv_nsec;
+}
+#endif
+
+ivc_stats_block_t *IvcAcquireThreadStats(void)
+{
+  ivc_stats_block_t *Block;
+  LockStats();
+  for (Block = StatsBlocks; Block && Block->InUse; Block = Block->Next)
+  {
+  }
+  if (!Block)
+  {
+    /* The allocator of the library may be changed later, so the blocks use the standard one */
+    Block = (ivc_stats_block_t *)calloc(1, sizeof(ivc_stats_block_t));
+    if (Block)
+    {
+      Block->Next = StatsBlocks;
+      StatsBlocks = Block;
+    }
+  }
+  if (Block)
+  {
+    Block->InUse = 1;
+  }
+  UnlockStats();
+  if (Block)
+  {
+    IvcThreadStats = Block;
+    WatchThreadExit(Block);
+  }
+  return Block;
+}
+
+/**
+ * Sums the counters of all the blocks, StatsLock should be locked
+ *
+ * @param[out] Stats sums
+ */
+static void SumBlocks(ivcmp_stats_t *Stats)
+{
+  uint32_t i;
+  const ivc_stats_block_t *Block;
+  uint64_t *Sums = (uint64_t *)Stats;
+  memset(Stats, 0, sizeof(ivcmp_stats_t));
+  for (Block = StatsBlocks; Block; Block = Block->Next)
+  {
+    const uint64_t *Counters = (const uint64_t *)&Block->Stats;
+    for (i = 0; i < NUM_COUNTERS; i++)
+    {
+      Sums[i] += IVC_STATS_LOAD(Counters[i]);
+    }
+  }
+}
+
+void IvcCollectStats(ivcmp_stats_t *Stats)
+{
+  uint32_t i;
+  uint64_t *Sums = (uint64_t *)Stats;
+  const uint64_t *Base = (const uint64_t *)&StatsBase;
+  LockStats();
+  SumBlocks(Stats);
+  for (i = 0; i < NUM_COUNTERS; i++)
+  {
+    Sums[i] -= Base[i];
+  }
+  UnlockStats();
+}
+
+void IvcResetStats(void)
+{
+  /* Counters of running threads can not be cleared from another thread, their current sums are remembered */
+  LockStats();
+  SumBlocks(&StatsBase);
+  UnlockStats();
+}
@@ -0,0 +1,104 @@
+/* Internal interface of the runtime statistics. Each thread counts in its own block,
+ * the blocks are summed on reading. Without IVCMP_STATS the macros compile to nothing.
+ */
+#ifndef IVCMP_STATS_H
+#define IVCMP_STATS_H
+
+#include <stdint.h>
+#include "ivcmp.h"
+
+#ifdef IVCMP_STATS
+
+#if defined(_MSC_VER)
+#define IVC_THREAD_LOCAL __declspec(thread)
+#else
+#define IVC_THREAD_LOCAL __thread
+#endif
+
+/* Counters are written by the owner thread only and read by any thread, so relaxed accesses are enough */
+#if defined(_MSC_VER)
+#define IVC_STATS_LOAD(Counter) (*(volatile uint64_t *)&(Counter))
+#define IVC_STATS_STORE(Counter, Value) (*(volatile uint64_t *)&(Counter) = (Value))
+#else
+#define IVC_STATS_LOAD(Counter) __atomic_load_n(&(Counter), __ATOMIC_RELAXED)
+#define IVC_STATS_STORE(Counter, Value) __atomic_store_n(&(Counter), (Value), __ATOMIC_RELAXED)
+#endif
+
+/**
+ * Counters of one thread
+ */
+typedef struct ivc_stats_block_s
+{
+  ivcmp_stats_t Stats;            /**< Counters, only the owner thread changes them */
+  int InUse;                      /**< The block belongs to a running thread */
+  struct ivc_stats_block_s *Next; /**< Next block of the list of all blocks */
+} ivc_stats_block_t;
+
+/** Block of the calling thread, NULL until the first count */
+extern IVC_THREAD_LOCAL ivc_stats_block_t *IvcThreadStats;
+
+/** Non-zero if the stages are timed */
+extern volatile int IvcStatsTimers;
+
+/**
+ * Gives the block to the calling thread: takes a block released by a finished thread or allocates a new one
+ *
+ * @return block or NULL if there is not enough memory
+ */
+ivc_stats_block_t *IvcAcquireThreadStats(void);
+
+/**
+ * Returns the time of a monotonic clock
+ *
+ * @return time in nanoseconds
+ */
+uint64_t IvcStatsNow(void);
+
+/**
+ * Sums the counters of all the threads since the last IvcResetStats() call
+ *
+ * @param[out] Stats sums
+ */
+void IvcCollectStats(ivcmp_stats_t *Stats);
+
+/**
+ * Makes the following IvcCollectStats() calls count from zero
+ */
+void IvcResetStats(void);
+
+#define IVC_STATS_BLOCK() (IvcThreadStats ? IvcThreadStats : IvcAcquireThreadStats())
+
+/** Adds Value to the counter Field of ivcmp_stats_t of the calling thread */
+#define IVC_STATS_ADD(Field, Value)                                                              \
+  do                                                                                             \
+  {                                                                                              \
+    ivc_stats_block_t *StatsBlock_ = IVC_STATS_BLOCK();                                          \
+    if (StatsBlock_)                                                                             \
+    {                                                                                            \
+      IVC_STATS_STORE(StatsBlock_->Stats.Field, IVC_STATS_LOAD(StatsBlock_->Stats.Field) + (Value)); \
+    }                                                                                            \
+  } while (0)
+
+/** Declares the timer Name started now if the stages are timed */
+#define IVC_STATS_TIMER(Name) const uint64_t Name = IvcStatsTimers ? IvcStatsNow() : 0
+
+/** Adds the time since the start of the timer Name to the stage */
+#define IVC_STATS_STAGE(Stage, Name)                           \
+  do                                                           \
+  {                                                            \
+    if (Name)                                                  \
+    {                                                          \
+      IVC_STATS_ADD(StageTime[Stage], IvcStatsNow() - (Name)); \
+      IVC_STATS_ADD(StageCalls[Stage], 1);                     \
+    }                                                          \
+  } while (0)
+
+#else
+
+#define IVC_STATS_ADD(Field, Value)
+#define IVC_STATS_TIMER(Name)
+#define IVC_STATS_STAGE(Stage, Name)
+
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+/* Tool converting EyePoint board files (elements JSON format) to the signature store of the library.
+ * Usage:
+ *   ivcmp_store [-m] [-n] [-k factor] -o library.ivcs file.json...
+ * The reference curves of the pins (or the measured curves with -m) are written to the store
+ * with their measure settings. Unless -n is given, the prepared curves are stored too,
+ * scaling thresholds of each curve are factor * max_voltage and factor * max_current of its measure settings.
+ */
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS /* fopen() is used for portability */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ivcmp.h"
+#include "ivcmp_json.h"
+
+#define DEFAULT_MIN_VAR_FACTOR 0.03 /**< Scaling thresholds relative to the measurement ranges */
+
+/**
+ * Settings of the tool and the state of the conversion
+ */
+typedef struct
+{
+  size_t CurveIndex;              /**< Stored curve of the pin, see board_pin_t.Curves */
+  double MinVarFactor;            /**< Scaling thresholds relative to the measurement ranges */
+  ivcmp_context_t *Ctx;           /**< Context used for preparation */
+  ivcmp_store_writer_t *Writer;   /**< Writer of the store */
+  json_reader_t Reader;           /**< Reader of the current file */
+  board_pin_t Pin;                /**< Current pin */
+  size_t NumCurves;               /**< Number of stored curves */
+  size_t NumSkipped;              /**< Number of curves that could not be stored */
+} store_tool_t;
+
+/**
+ * Adds the curve of the pin to the store, pins without the curve are skipped
+ *
+ * @param Data tool
+ * @param[in] Pin pin
+ *
+ * @return 1
+ */
+static int StorePin(void *Data, const board_pin_t *Pin)
+{
+  store_tool_t *Tool = (store_tool_t *)Data;
+  const board_curve_t *Curve = &Pin->Curves[Tool->CurveIndex];
+  size_t Length;
+  if (!Curve->Present)
+  {
+    return 1;
+  }
+
+  /* Curves without the measurement ranges have no scaling thresholds */
+  Length = Curve->NumVoltages < Curve->NumCurrents ? Curve->NumVoltages : Curve->NumCurrents;
+  if (SetContextMinVarVC(Tool->Ctx, Tool->MinVarFactor * Curve->Settings.MaxVoltage,
+                         Tool->MinVarFactor * Curve->Settings.MaxCurrent) != IVCMP_OK ||
+      Length > UINT32_MAX ||
+      AddIVCStoreCurve(Tool->Ctx, Tool->Writer, Curve->Voltages, Curve->Currents, (uint32_t)Length,
+                       &Curve->Settings) != IVCMP_OK)
+  {
+    Tool->NumSkipped++;
+    return 1;
+  }
+  Tool->NumCurves++;
+  return 1;
+}
+
+/**
+ * Prints the usage of the tool
+ */
+static void PrintUsage(void)
+{
+  printf("Usage: ivcmp_store [-m] [-n] [-k factor] -o library.ivcs file.json...\n"
+         "Writes the reference curves of the pins of EyePoint board files to the signature store.\n"
+         "  -m          store the measured curves instead of the reference ones\n"
+         "  -n          do not store the prepared curves\n"
+         "  -k factor   scaling thresholds of the prepared curves relative to max_voltage and max_current"
+         " of the measure settings (default %.2f)\n"
+         "  -o file     output store file\n",
+         DEFAULT_MIN_VAR_FACTOR);
+}
+
+int main(int argc, char **argv)
+{
+  int i;
+  int NumFiles = 0;
+  int Result = 0;
+  int WithPrepared = 1;
+  const char *OutputName = NULL;
+  FILE *JsonFile;
+  store_tool_t *Tool;
+  ivcmp_status_t Status;
+
+  /* Reader buffer is large, so the state is not on the stack */
+  Tool = (store_tool_t *)calloc(1, sizeof(store_tool_t));
+  if (!Tool)
+  {
+    fprintf(stderr, "Not enough memory\n");
+    return 1;
+  }
+  Tool->CurveIndex = 1;
+  Tool->MinVarFactor = DEFAULT_MIN_VAR_FACTOR;
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-m"))
+    {
+      Tool->CurveIndex = 0;
+    }
+    else if (!strcmp(argv[i], "-n"))
+    {
+      WithPrepared = 0;
+    }
+    else if (!strcmp(argv[i], "-k") && i + 1 < argc)
+    {
+      Tool->MinVarFactor = strtod(argv[++i], NULL);
+    }
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+    {
+      OutputName = argv[++i];
+    }
+    else if (argv[i][0] == '-')
+    {
+      PrintUsage();
+      free(Tool);
+      return 1;
+    }
+    else
+    {
+      NumFiles++;
+    }
+  }
+  if (NumFiles == 0 || !OutputName || !(Tool->MinVarFactor > 0))
+  {
+    PrintUsage();
+    free(Tool);
+    return 1;
+  }
+
+  Tool->Ctx = CreateIVCContext();
+  if (!Tool->Ctx)
+  {
+    fprintf(stderr, "Not enough memory\n");
+    free(Tool);
+    return 1;
+  }
+  Status = CreateIVCStoreWriter(OutputName, WithPrepared, &Tool->Writer);
+  if (Status != IVCMP_OK)
+  {
+    fprintf(stderr, "Can not create %s: %s\n", OutputName, GetIVCStatusMessage(Status));
+    DestroyIVCContext(Tool->Ctx);
+    free(Tool);
+    return 1;
+  }
+  for (i = 1; i < argc; i++)
+  {
+    if (argv[i][0] == '-')
+    {
+      i += !strcmp(argv[i], "-k") || !strcmp(argv[i], "-o");
+      continue;
+    }
+    JsonFile = fopen(argv[i], "rb");
+    if (!JsonFile)
+    {
+      fprintf(stderr, "Can not open %s\n", argv[i]);
+      Result = 1;
+      continue;
+    }
+    JsonInit(&Tool->Reader, JsonFile);
+    /* Curves read before the error stay in the store */
+    if (!JsonReadBoard(&Tool->Reader, &Tool->Pin, StorePin, Tool))
+    {
+      fprintf(stderr, "Can not read %s\n", argv[i]);
+      Result = 1;
+    }
+    fclose(JsonFile);
+  }
+  Status = CloseIVCStoreWriter(Tool->Writer);
+  if (Status != IVCMP_OK)
+  {
+    fprintf(stderr, "Can not write %s: %s\n", OutputName, GetIVCStatusMessage(Status));
+    Result = 1;
+  }
+  fprintf(stderr, "%lu curves stored, %lu skipped\n", (unsigned long)Tool->NumCurves,
+          (unsigned long)Tool->NumSkipped);
+
+  DestroyIVCContext(Tool->Ctx);
+  JsonFreePin(&Tool->Pin);
+  free(Tool);
+  return Result;
+}
@@ -1,10 +1,18 @@
 #include "stdio.h"
 #include "stdlib.h"
+#include "string.h"
 #define _USE_MATH_DEFINES
 #include "math.h"
 #include "ivcmp.h"
 
 #define MAX_NUM_POINTS 20
+#define NUM_MATRIX_CURVES 6
+#define NUM_INDEX_RESULTS 3
+#define NUM_BATCH_PAIRS (NUM_MATRIX_CURVES + 1)
+#define NUM_LONG_POINTS 2000
+#define NUM_SCALE_POINTS 100
+#define NUM_SCALE_CURVES 8
+#define NUM_INDEX_SCALE_CURVES 16
 
 #define VOLTAGE_AMPL 12.
 #define NOISE_AMPL_PCNT 1.
@@ -20,6 +28,47 @@ typedef struct
   double Currents[MAX_NUM_POINTS]; /**< Array of points of current in mA. */
 } iv_curve_t;
 
+static uint32_t AllocCount = 0;
+
+/* Allocator that counts allocations made by the library */
+static void * CCONV CountingMalloc(size_t Size)
+{
+  AllocCount++;
+  return malloc(Size);
+}
+
+static void CCONV CountingFree(void *Ptr)
+{
+  free(Ptr);
+}
+
+/* Capture function that counts the records */
+static void CCONV CountRecord(void *User, const ivcmp_capture_record_t *Record)
+{
+  (void)Record;
+  (*(uint32_t *)User)++;
+}
+
+/* Capture function that keeps the number of points of the splined curves */
+static void CCONV KeepSplinedLength(void *User, const ivcmp_capture_record_t *Record)
+{
+  if (Record->Stage == IVCMP_CAPTURE_SPLINED)
+  {
+    *(uint32_t *)User = Record->Length;
+  }
+}
+
+/* Fills the circle of the given radius centered at zero */
+static void MakeCircle(double *Voltages, double *Currents, uint32_t Length, double Radius)
+{
+  uint32_t i;
+  for (i = 0; i < Length; i++)
+  {
+    Voltages[i] = Radius * cos(2 * M_PI * i / Length);
+    Currents[i] = Radius * sin(2 * M_PI * i / Length);
+  }
+}
+
 
 int main(void)
 {
@@ -140,6 +189,875 @@ int main(void)
     return -1;
   }
 
+  printf("--- Test 6. Compare curves in independent contexts.\n");
+  ivcmp_context_t *CtxRough = CreateIVCContext();
+  ivcmp_context_t *CtxNoise = CreateIVCContext();
+  double ScoreRough, ScoreNoise, MinVarV, MinVarC;
+  if (!CtxRough || !CtxNoise)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  if (CompareIVCWithContext(CtxRough, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                            IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength,
+                            &ScoreRough) != IVCMP_ERROR_INVALID_MIN_VAR)
+  {
+    printf("Comparison without thresholds should fail.\n");
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* Thresholds as large as measurement ranges make curves look more similar */
+  SetContextMinVarVC(CtxRough, VOLTAGE_AMPL, CURRENT_AMPL);
+  SetContextMinVarVCFromCurves(CtxNoise, IVCOpenCircuit.Voltages, IVCOpenCircuit.Currents, CurveLength,
+                               IVCShortCircuit.Voltages, IVCShortCircuit.Currents, CurveLength);
+  if (CompareIVCWithContext(CtxRough, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                            IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength,
+                            &ScoreRough) != IVCMP_OK ||
+      CompareIVCWithContext(CtxNoise, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                            IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength,
+                            &ScoreNoise) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* Default context still holds thresholds from curves */
+  ResultScore = CompareIVC(IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                           IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength);
+  printf("Rough thresholds Score = %.2f, noise thresholds Score = %.2f, default context Score = %.2f.\n",
+         (float)ScoreRough, (float)ScoreNoise, (float)ResultScore);
+  if (ScoreNoise != ResultScore || ScoreRough == ScoreNoise)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  if (GetContextMinVarVC(CtxRough, &MinVarV, &MinVarC) != IVCMP_OK || MinVarV != VOLTAGE_AMPL ||
+      MinVarC != CURRENT_AMPL || GetContextMinVarVC(NULL, &MinVarV, &MinVarC) != IVCMP_ERROR_NULL_POINTER ||
+      CompareIVCWithContext(CtxRough, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                            IVCResistor2.Voltages, NULL, CurveLength, &ScoreRough) != IVCMP_ERROR_NULL_POINTER)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCContext(CtxRough);
+
+  printf("--- Test 7. Compare prepared curves.\n");
+  ivcmp_prepared_t *PreparedR1, *PreparedR2, *PreparedR3;
+  if (PrepareIVC(CtxNoise, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength, &PreparedR1) != IVCMP_OK ||
+      PrepareIVC(CtxNoise, IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &PreparedR2) != IVCMP_OK ||
+      PrepareIVC(CtxNoise, IVCResistor3.Voltages, IVCResistor3.Currents, num_points_for_r_3, &PreparedR3) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* Prepared reference is reused for several comparisons */
+  CompareIVCPrepared(CtxNoise, PreparedR1, PreparedR2, &ResultScore1);
+  CompareIVCPrepared(CtxNoise, PreparedR1, PreparedR3, &ResultScore2);
+  printf("Prepared Score 1 = %.2f, Score 2 = %.2f.\n", (float)ResultScore1, (float)ResultScore2);
+  if (fabs(ResultScore1 - ScoreNoise) > 1e-9 ||
+      fabs(ResultScore2 - CompareIVC(IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                                     IVCResistor3.Voltages, IVCResistor3.Currents, num_points_for_r_3)) > 1e-9)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyPreparedIVC(PreparedR1);
+  DestroyPreparedIVC(PreparedR2);
+  DestroyPreparedIVC(PreparedR3);
+  DestroyIVCContext(CtxNoise);
+
+  printf("--- Test 8. Compare curves without memory allocations.\n");
+  SetIVCAllocator(CountingMalloc, CountingFree);
+  ivcmp_context_t *CtxUserWs = CreateIVCContext();
+  ivcmp_context_t *CtxReserved = CreateIVCContext();
+  const size_t WorkspaceSize = GetIVCWorkspaceSize(MAX_NUM_POINTS);
+  void *Workspace = malloc(WorkspaceSize);
+  SetContextMinVarVC(CtxUserWs, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  SetContextMinVarVC(CtxReserved, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  SetContextWorkspace(CtxUserWs, Workspace, WorkspaceSize);
+  ReserveContextWorkspace(CtxReserved, MAX_NUM_POINTS);
+  PrepareIVC(CtxUserWs, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength, &PreparedR1);
+  PrepareIVC(CtxUserWs, IVCCapacitor.Voltages, IVCCapacitor.Currents, CurveLength, &PreparedR2);
+  AllocCount = 0;
+  CompareIVCWithContext(CtxUserWs, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCCapacitor.Voltages, IVCCapacitor.Currents, CurveLength, &ResultScore);
+  CompareIVCWithContext(CtxReserved, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor3.Voltages, IVCResistor3.Currents, num_points_for_r_3, &ResultScore1);
+  CompareIVCPrepared(CtxUserWs, PreparedR1, PreparedR2, &ResultScore2);
+  printf("Got %u allocations, should be 0.\n", AllocCount);
+  if (AllocCount != 0 || fabs(ResultScore - ResultScore2) > 1e-9)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyPreparedIVC(PreparedR1);
+  DestroyPreparedIVC(PreparedR2);
+  DestroyIVCContext(CtxUserWs);
+  DestroyIVCContext(CtxReserved);
+  SetIVCAllocator(NULL, NULL);
+  free(Workspace);
+
+  printf("--- Test 9. Repeat comparisons with cached spline tables.\n");
+  ivcmp_context_t *CtxCache = CreateIVCContext();
+  const uint32_t CacheLengths[4] = {CurveLength, CurveLength / 2, CurveLength / 3, CurveLength / 4};
+  double CacheScores[4];
+  SetContextMinVarVC(CtxCache, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  for (i = 0; i < 8; i++)
+  {
+    CompareIVCWithContext(CtxCache, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                          IVCResistor2.Voltages, IVCResistor2.Currents, CacheLengths[i % 4], &ResultScore);
+    if (i >= 4 && CacheScores[i % 4] != ResultScore)
+    {
+      printf("Score %.2f differs from the first comparison %.2f.\n", (float)ResultScore,
+             (float)CacheScores[i % 4]);
+      printf("Test failed!!!\n");
+      return -1;
+    }
+    CacheScores[i % 4] = ResultScore;
+  }
+  printf("Scores are the same.\n");
+  DestroyIVCContext(CtxCache);
+
+  printf("--- Test 10. Compare curves with all supported kernels.\n");
+  const ivcmp_kernel_t ActiveKernel = GetIVCKernel();
+  ivcmp_kernel_t Kernel;
+  printf("Active kernel: %s.\n", GetIVCKernelName(ActiveKernel));
+  SetIVCKernel(IVCMP_KERNEL_SCALAR);
+  ResultScore1 = CompareIVC(IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                            IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength);
+  for (Kernel = IVCMP_KERNEL_SCALAR; Kernel <= IVCMP_KERNEL_AVX512; Kernel++)
+  {
+    if (SetIVCKernel(Kernel) != IVCMP_OK)
+    {
+      printf("Kernel %s is not supported.\n", GetIVCKernelName(Kernel));
+      continue;
+    }
+    ResultScore = CompareIVC(IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                             IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength);
+    printf("Kernel %s Score = %.2f.\n", GetIVCKernelName(Kernel), (float)ResultScore);
+    if (ResultScore != ResultScore1)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  SetIVCKernel(ActiveKernel);
+
+  printf("--- Test 11. Compare curves in single precision.\n");
+  ivcmp_context_t *CtxFloat = CreateIVCContext();
+  ivcmp_precision_t Precision;
+  SetContextMinVarVC(CtxFloat, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  CompareIVCWithContext(CtxFloat, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCCapacitor.Voltages, IVCCapacitor.Currents, CurveLength, &ResultScore1);
+  if (SetContextPrecision(CtxFloat, (ivcmp_precision_t)2) != IVCMP_ERROR_INVALID_ARGUMENT ||
+      SetContextPrecision(CtxFloat, IVCMP_PRECISION_FLOAT) != IVCMP_OK ||
+      GetContextPrecision(CtxFloat, &Precision) != IVCMP_OK || Precision != IVCMP_PRECISION_FLOAT ||
+      GetContextPrecision(NULL, &Precision) != IVCMP_ERROR_NULL_POINTER)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  CompareIVCWithContext(CtxFloat, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCCapacitor.Voltages, IVCCapacitor.Currents, CurveLength, &ResultScore);
+  printf("Double Score = %.4f, float Score = %.4f.\n", (float)ResultScore1, (float)ResultScore);
+  if (fabs(ResultScore - ResultScore1) > 0.005)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCContext(CtxFloat);
+
+  printf("--- Test 12. Compare each curve with each other one.\n");
+  double *MatrixV[NUM_MATRIX_CURVES] = {IVCOpenCircuit.Voltages, IVCShortCircuit.Voltages, IVCResistor1.Voltages,
+                                        IVCResistor2.Voltages, IVCCapacitor.Voltages, IVCResistor3.Voltages};
+  double *MatrixC[NUM_MATRIX_CURVES] = {IVCOpenCircuit.Currents, IVCShortCircuit.Currents, IVCResistor1.Currents,
+                                        IVCResistor2.Currents, IVCCapacitor.Currents, IVCResistor3.Currents};
+  const uint32_t MatrixLengths[NUM_MATRIX_CURVES] = {CurveLength, CurveLength, CurveLength,
+                                                     CurveLength, CurveLength, num_points_for_r_3};
+  double FullScores[NUM_MATRIX_CURVES * NUM_MATRIX_CURVES];
+  double PackedScores[NUM_MATRIX_CURVES * (NUM_MATRIX_CURVES - 1) / 2];
+  uint32_t j, k;
+  ivcmp_context_t *CtxMatrix = CreateIVCContext();
+  SetContextMinVarVC(CtxMatrix, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  if (CompareIVCMatrix(CtxMatrix, MatrixV, MatrixC, MatrixLengths, NUM_MATRIX_CURVES, IVCMP_MATRIX_FULL, 3,
+                       FullScores) != IVCMP_OK ||
+      CompareIVCMatrix(CtxMatrix, MatrixV, MatrixC, MatrixLengths, NUM_MATRIX_CURVES, IVCMP_MATRIX_PACKED, 1,
+                       PackedScores) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  for (i = 0, k = 0; i < NUM_MATRIX_CURVES; i++)
+  {
+    PrepareIVC(CtxMatrix, MatrixV[i], MatrixC[i], MatrixLengths[i], &PreparedR1);
+    for (j = i + 1; j < NUM_MATRIX_CURVES; j++, k++)
+    {
+      PrepareIVC(CtxMatrix, MatrixV[j], MatrixC[j], MatrixLengths[j], &PreparedR2);
+      CompareIVCPrepared(CtxMatrix, PreparedR1, PreparedR2, &ResultScore);
+      DestroyPreparedIVC(PreparedR2);
+      if (FullScores[i * NUM_MATRIX_CURVES + j] != ResultScore ||
+          FullScores[j * NUM_MATRIX_CURVES + i] != ResultScore || PackedScores[k] != ResultScore)
+      {
+        printf("Score of curves %u and %u is %.2f, should be %.2f.\n", i, j,
+               (float)FullScores[i * NUM_MATRIX_CURVES + j], (float)ResultScore);
+        printf("Test failed!!!\n");
+        return -1;
+      }
+    }
+    DestroyPreparedIVC(PreparedR1);
+    if (FullScores[i * NUM_MATRIX_CURVES + i] != 0.)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  printf("Matrix scores are the same as pairwise scores.\n");
+  DestroyIVCContext(CtxMatrix);
+
+  printf("--- Test 13. Check curves against score threshold.\n");
+  ivcmp_context_t *CtxThreshold = CreateIVCContext();
+  ivcmp_verdict_t VerdictPass, VerdictFail;
+  SetContextMinVarVC(CtxThreshold, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  CompareIVCWithContext(CtxThreshold, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore);
+  if (CompareIVCThreshold(CtxThreshold, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                          IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, ResultScore,
+                          &VerdictPass, &ResultScore1) != IVCMP_OK ||
+      CompareIVCThreshold(CtxThreshold, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                          IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, ResultScore / 2,
+                          &VerdictFail, &ResultScore2) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  printf("Score = %.2f, passed with Score = %.2f, failed with Score bound = %.2f.\n", (float)ResultScore,
+         (float)ResultScore1, (float)ResultScore2);
+  if (VerdictPass != IVCMP_VERDICT_PASS || ResultScore1 != ResultScore ||
+      VerdictFail != IVCMP_VERDICT_FAIL || ResultScore2 <= ResultScore / 2 || ResultScore2 > ResultScore)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCContext(CtxThreshold);
+
+  printf("--- Test 14. Find the best match with score lower bounds.\n");
+  ivcmp_context_t *CtxMatch = CreateIVCContext();
+  ivcmp_prepared_t *Candidates[NUM_MATRIX_CURVES - 1];
+  uint32_t BestIndex;
+  double Bound;
+  SetContextMinVarVC(CtxMatch, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  for (i = 0; i < NUM_MATRIX_CURVES - 1; i++)
+  {
+    PrepareIVC(CtxMatch, MatrixV[i], MatrixC[i], MatrixLengths[i], &Candidates[i]);
+  }
+  PrepareIVC(CtxMatch, IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &PreparedR1);
+  for (i = 0; i < NUM_MATRIX_CURVES - 1; i++)
+  {
+    CompareIVCPrepared(CtxMatch, PreparedR1, Candidates[i], &ResultScore);
+    GetIVCScoreLowerBound(CtxMatch, PreparedR1, Candidates[i], &Bound);
+    printf("Candidate %u Score = %.2f, lower bound = %.2f.\n", i, (float)ResultScore, (float)Bound);
+    if (Bound > ResultScore)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  if (FindIVCBestMatch(CtxMatch, PreparedR1, (const ivcmp_prepared_t *const *)Candidates, NUM_MATRIX_CURVES - 1,
+                       &BestIndex, &ResultScore) != IVCMP_OK || BestIndex != 3 || ResultScore != 0.)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  for (i = 0; i < NUM_MATRIX_CURVES - 1; i++)
+  {
+    DestroyPreparedIVC(Candidates[i]);
+  }
+  DestroyPreparedIVC(PreparedR1);
+  DestroyIVCContext(CtxMatch);
+
+  printf("--- Test 15. Find the most similar curves with the search index.\n");
+  ivcmp_context_t *CtxIndex = CreateIVCContext();
+  ivcmp_index_t *Index, *LoadedIndex;
+  uint32_t Found[NUM_INDEX_RESULTS], LoadedFound[NUM_INDEX_RESULTS];
+  double FoundScores[NUM_INDEX_RESULTS], LoadedScores[NUM_INDEX_RESULTS];
+  uint32_t NumFound, LoadedNumFound;
+  SetContextMinVarVC(CtxIndex, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  PrepareIVC(CtxIndex, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength, &PreparedR1);
+  if (BuildIVCIndex(CtxIndex, MatrixV, MatrixC, MatrixLengths, NUM_MATRIX_CURVES, &Index) != IVCMP_OK ||
+      SearchIVCIndex(CtxIndex, Index, PreparedR1, NUM_INDEX_RESULTS, Found, FoundScores, &NumFound) != IVCMP_OK ||
+      SaveIVCIndex(Index, "ivcmp_index.bin") != IVCMP_OK ||
+      LoadIVCIndex(CtxIndex, "ivcmp_index.bin", &LoadedIndex) != IVCMP_OK ||
+      SearchIVCIndex(CtxIndex, LoadedIndex, PreparedR1, NUM_INDEX_RESULTS, LoadedFound, LoadedScores,
+                     &LoadedNumFound) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  remove("ivcmp_index.bin");
+  if (NumFound != NUM_INDEX_RESULTS || LoadedNumFound != NumFound || Found[0] != 2 || FoundScores[0] != 0.)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  for (i = 0; i < NUM_MATRIX_CURVES; i++)
+  {
+    PrepareIVC(CtxIndex, MatrixV[i], MatrixC[i], MatrixLengths[i], &PreparedR2);
+    CompareIVCPrepared(CtxIndex, PreparedR1, PreparedR2, &ResultScore);
+    DestroyPreparedIVC(PreparedR2);
+    k = 0;
+    while (k < NumFound && Found[k] != i)
+    {
+      k++;
+    }
+    /* Found curves have their own scores, the others are not more similar */
+    if ((k < NumFound && (FoundScores[k] != ResultScore || LoadedFound[k] != i || LoadedScores[k] != ResultScore)) ||
+        (k == NumFound && ResultScore < FoundScores[NumFound - 1]))
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  for (k = 0; k < NumFound; k++)
+  {
+    printf("Match %u: curve %u, Score = %.2f.\n", k, Found[k], (float)FoundScores[k]);
+  }
+  DestroyPreparedIVC(PreparedR1);
+  DestroyIVCIndex(Index);
+  DestroyIVCIndex(LoadedIndex);
+  DestroyIVCContext(CtxIndex);
+
+  printf("--- Test 16. Compare samples with the reference while they are acquired.\n");
+  ivcmp_context_t *CtxStream = CreateIVCContext();
+  ivcmp_stream_t *Stream;
+  double PartialScore;
+  SetContextMinVarVC(CtxStream, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  PrepareIVC(CtxStream, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength, &PreparedR1);
+  PrepareIVC(CtxStream, IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &PreparedR2);
+  CompareIVCPrepared(CtxStream, PreparedR1, PreparedR2, &ResultScore);
+  if (CreateIVCStream(CtxStream, PreparedR1, CurveLength, &Stream) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* Two periods in a row give the same score */
+  for (k = 0; k < 2; k++)
+  {
+    for (i = 0; i < CurveLength; i++)
+    {
+      PushIVCStreamSample(Stream, IVCResistor2.Voltages[i], IVCResistor2.Currents[i]);
+    }
+    GetIVCStreamPartialScore(Stream, &PartialScore);
+    if (PushIVCStreamSample(Stream, 0., 0.) != IVCMP_ERROR_INVALID_ARGUMENT ||
+        FinishIVCStream(CtxStream, Stream, &ResultScore1) != IVCMP_OK)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+    printf("Period %u: partial Score = %.2f, Score = %.2f, should be %.2f.\n", k, (float)PartialScore,
+           (float)ResultScore1, (float)ResultScore);
+    if (ResultScore1 != ResultScore || PartialScore < 0 || PartialScore > 1)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  if (FinishIVCStream(CtxStream, Stream, &ResultScore1) != IVCMP_ERROR_CURVE_TOO_SHORT)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCStream(Stream);
+  DestroyPreparedIVC(PreparedR1);
+  DestroyPreparedIVC(PreparedR2);
+  DestroyIVCContext(CtxStream);
+
+  printf("--- Test 17. Compare a batch of pairs on several threads.\n");
+  ivcmp_context_t *CtxBatch = CreateIVCContext();
+  double BatchVA[NUM_BATCH_PAIRS * MAX_NUM_POINTS], BatchCA[NUM_BATCH_PAIRS * MAX_NUM_POINTS];
+  double BatchVB[NUM_BATCH_PAIRS * MAX_NUM_POINTS], BatchCB[NUM_BATCH_PAIRS * MAX_NUM_POINTS];
+  size_t OffsetsA[NUM_BATCH_PAIRS + 1], OffsetsB[NUM_BATCH_PAIRS + 1];
+  double BatchMinVarV[NUM_BATCH_PAIRS], BatchMinVarC[NUM_BATCH_PAIRS];
+  double BatchScores[NUM_BATCH_PAIRS], BatchScores1[NUM_BATCH_PAIRS];
+  ivcmp_status_t BatchStatuses[NUM_BATCH_PAIRS], BatchStatuses1[NUM_BATCH_PAIRS];
+  /* Pair i is curve i with the next one, the last pair has too short curve */
+  OffsetsA[0] = OffsetsB[0] = 0;
+  for (i = 0; i < NUM_BATCH_PAIRS; i++)
+  {
+    j = i % NUM_MATRIX_CURVES;
+    k = (i + 1) % NUM_MATRIX_CURVES;
+    OffsetsA[i + 1] = OffsetsA[i] + (i < NUM_MATRIX_CURVES ? MatrixLengths[j] : 2);
+    OffsetsB[i + 1] = OffsetsB[i] + MatrixLengths[k];
+    memcpy(BatchVA + OffsetsA[i], MatrixV[j], (OffsetsA[i + 1] - OffsetsA[i]) * sizeof(double));
+    memcpy(BatchCA + OffsetsA[i], MatrixC[j], (OffsetsA[i + 1] - OffsetsA[i]) * sizeof(double));
+    memcpy(BatchVB + OffsetsB[i], MatrixV[k], MatrixLengths[k] * sizeof(double));
+    memcpy(BatchCB + OffsetsB[i], MatrixC[k], MatrixLengths[k] * sizeof(double));
+    BatchMinVarV[i] = VOLTAGE_AMPL * (i % 2 ? 3 : 10) / 100;
+    BatchMinVarC[i] = CURRENT_AMPL * (i % 2 ? 3 : 10) / 100;
+  }
+  if (CompareIVCBatch(CtxBatch, BatchVA, BatchCA, OffsetsA, BatchVB, BatchCB, OffsetsB, BatchMinVarV, BatchMinVarC,
+                      NUM_BATCH_PAIRS, 1, BatchScores, BatchStatuses) != IVCMP_ERROR_CURVE_TOO_SHORT ||
+      CompareIVCBatch(CtxBatch, BatchVA, BatchCA, OffsetsA, BatchVB, BatchCB, OffsetsB, BatchMinVarV, BatchMinVarC,
+                      NUM_BATCH_PAIRS, 4, BatchScores1, BatchStatuses1) != IVCMP_ERROR_CURVE_TOO_SHORT)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  for (i = 0; i < NUM_BATCH_PAIRS; i++)
+  {
+    SetContextMinVarVC(CtxBatch, BatchMinVarV[i], BatchMinVarC[i]);
+    k = CompareIVCWithContext(CtxBatch, BatchVA + OffsetsA[i], BatchCA + OffsetsA[i],
+                              (uint32_t)(OffsetsA[i + 1] - OffsetsA[i]), BatchVB + OffsetsB[i],
+                              BatchCB + OffsetsB[i], (uint32_t)(OffsetsB[i + 1] - OffsetsB[i]), &ResultScore);
+    printf("Pair %u: Score = %.2f, status %u.\n", i, (float)BatchScores[i], (uint32_t)BatchStatuses[i]);
+    if (BatchStatuses[i] != k || BatchStatuses1[i] != k || BatchScores[i] != ResultScore ||
+        BatchScores1[i] != ResultScore)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  DestroyIVCContext(CtxBatch);
+
+  printf("--- Test 18. Compare with the curves of the signature store.\n");
+  ivcmp_context_t *CtxStore = CreateIVCContext();
+  ivcmp_store_writer_t *Writer;
+  ivcmp_store_t *Store;
+  const ivcmp_prepared_t *StorePrepared;
+  const double *StoreV, *StoreC;
+  uint32_t StoreLength;
+  ivcmp_measure_settings_t Settings, StoreSettings;
+  memset(&Settings, 0, sizeof(Settings));
+  Settings.ProbeSignalFrequency = 100.;
+  Settings.MaxVoltage = VOLTAGE_AMPL;
+  Settings.MaxCurrent = CURRENT_AMPL;
+  Settings.DescFrequency = 10000.;
+  SetContextMinVarVC(CtxStore, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  if (CreateIVCStoreWriter("ivcmp_store.bin", 1, &Writer) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  for (i = 0; i < NUM_MATRIX_CURVES; i++)
+  {
+    Settings.NumPoints = MatrixLengths[i];
+    AddIVCStoreCurve(CtxStore, Writer, MatrixV[i], MatrixC[i], MatrixLengths[i], &Settings);
+  }
+  if (CloseIVCStoreWriter(Writer) != IVCMP_OK || OpenIVCStore("ivcmp_store.bin", &Store) != IVCMP_OK ||
+      GetIVCStoreSize(Store) != NUM_MATRIX_CURVES ||
+      GetIVCStorePrepared(Store, NUM_MATRIX_CURVES, &StorePrepared) != IVCMP_ERROR_INVALID_ARGUMENT)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* Stored curves are compared in place with other scaling thresholds as well */
+  SetContextMinVarVC(CtxStore, VOLTAGE_AMPL * 10 / 100, CURRENT_AMPL * 10 / 100);
+  PrepareIVC(CtxStore, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength, &PreparedR1);
+  for (i = 0; i < NUM_MATRIX_CURVES; i++)
+  {
+    PrepareIVC(CtxStore, MatrixV[i], MatrixC[i], MatrixLengths[i], &PreparedR2);
+    CompareIVCPrepared(CtxStore, PreparedR1, PreparedR2, &ResultScore);
+    DestroyPreparedIVC(PreparedR2);
+    if (GetIVCStoreCurve(Store, i, &StoreV, &StoreC, &StoreLength, &StoreSettings) != IVCMP_OK ||
+        GetIVCStorePrepared(Store, i, &StorePrepared) != IVCMP_OK ||
+        CompareIVCPrepared(CtxStore, PreparedR1, StorePrepared, &ResultScore1) != IVCMP_OK)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+    printf("Curve %u: Score = %.2f, should be %.2f.\n", i, (float)ResultScore1, (float)ResultScore);
+    if (ResultScore1 != ResultScore || StoreLength != MatrixLengths[i] ||
+        memcmp(StoreV, MatrixV[i], StoreLength * sizeof(double)) != 0 ||
+        memcmp(StoreC, MatrixC[i], StoreLength * sizeof(double)) != 0 ||
+        StoreSettings.NumPoints != MatrixLengths[i] || StoreSettings.MaxVoltage != VOLTAGE_AMPL)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  CloseIVCStore(Store);
+  /* Store without prepared curves keeps the curves only */
+  if (CreateIVCStoreWriter("ivcmp_store.bin", 0, &Writer) != IVCMP_OK ||
+      AddIVCStoreCurve(CtxStore, Writer, MatrixV[0], MatrixC[0], MatrixLengths[0], NULL) != IVCMP_OK ||
+      CloseIVCStoreWriter(Writer) != IVCMP_OK || OpenIVCStore("ivcmp_store.bin", &Store) != IVCMP_OK ||
+      GetIVCStoreCurve(Store, 0, &StoreV, &StoreC, &StoreLength, NULL) != IVCMP_OK ||
+      memcmp(StoreC, MatrixC[0], StoreLength * sizeof(double)) != 0 ||
+      GetIVCStorePrepared(Store, 0, &StorePrepared) != IVCMP_ERROR_INVALID_FILE)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  CloseIVCStore(Store);
+  remove("ivcmp_store.bin");
+  DestroyPreparedIVC(PreparedR1);
+  DestroyIVCContext(CtxStore);
+
+  printf("--- Test 19. Collect statistics of the comparisons on several threads.\n");
+  ivcmp_context_t *CtxStats = CreateIVCContext();
+  ivcmp_stats_t Stats;
+  iv_curve_t IVCRepeats = IVCResistor1;
+  IVCRepeats.Voltages[1] = IVCRepeats.Voltages[0];
+  IVCRepeats.Currents[1] = IVCRepeats.Currents[0];
+  ResetIVCStats();
+  SetIVCStatsTimers(1);
+  SetContextMinVarVC(CtxStats, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  CompareIVCBatch(CtxStats, BatchVA, BatchCA, OffsetsA, BatchVB, BatchCB, OffsetsB, BatchMinVarV, BatchMinVarC,
+                  NUM_BATCH_PAIRS, 4, BatchScores, BatchStatuses);
+  CompareIVCWithContext(CtxStats, IVCRepeats.Voltages, IVCRepeats.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore);
+  CompareIVCWithContext(CtxStats, IVCOpenCircuit.Voltages, IVCOpenCircuit.Currents, CurveLength,
+                        IVCOpenCircuit.Voltages, IVCOpenCircuit.Currents, 2, &ResultScore);
+  k = GetIVCStats(&Stats);
+  if (k == IVCMP_ERROR_NOT_SUPPORTED)
+  {
+    printf("Statistics are disabled in the library build.\n");
+  }
+  else
+  {
+    printf("Comparisons %u, short curves %u, curves with repeats %u, distance time %.3f ms.\n",
+           (uint32_t)Stats.Comparisons, (uint32_t)Stats.ShortCurves, (uint32_t)Stats.CurvesWithRepeats,
+           (double)Stats.StageTime[IVCMP_STAGE_DISTANCE] * 1e-6);
+    /* All the pairs of the batch except the last one and the pair with repeats are compared */
+    if (k != IVCMP_OK || Stats.Comparisons != NUM_BATCH_PAIRS || Stats.ShortCurves < 1 ||
+        Stats.CurvesWithRepeats < 1 || Stats.RepeatsRemoved < Stats.CurvesWithRepeats ||
+        Stats.StageCalls[IVCMP_STAGE_DISTANCE] != NUM_BATCH_PAIRS ||
+        Stats.StageCalls[IVCMP_STAGE_BSPLINE] != 2 * NUM_BATCH_PAIRS)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+    ResetIVCStats();
+    if (GetIVCStats(&Stats) != IVCMP_OK || Stats.Comparisons != 0 || Stats.StageTime[IVCMP_STAGE_DISTANCE] != 0)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  SetIVCStatsTimers(0);
+  DestroyIVCContext(CtxStats);
+
+  printf("--- Test 20. Capture the stages of a comparison.\n");
+  ivcmp_context_t *CtxCapture = CreateIVCContext();
+  static double CaptureDump[1024];
+  uint32_t CaptureHeader[6], RecordHeader[4];
+  size_t CaptureSize, Offset;
+  uint32_t NumCaptured = 0;
+  SetContextMinVarVC(CtxCapture, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  SetContextCaptureBuffer(CtxCapture, CaptureDump, sizeof(CaptureDump));
+  CompareIVCWithContext(CtxCapture, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore);
+  CaptureSize = GetContextCaptureSize(CtxCapture);
+  memcpy(CaptureHeader, CaptureDump, sizeof(CaptureHeader));
+  /* Inputs, copies, scaled, cleaned and splined curves of both curves, variations and score */
+  if (memcmp(CaptureDump, "IVCMPCAP", 8) != 0 || CaptureHeader[3] != 12 || CaptureHeader[4] != 0)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  for (Offset = sizeof(CaptureHeader), i = 0; i < CaptureHeader[3]; i++)
+  {
+    memcpy(RecordHeader, (char *)CaptureDump + Offset, sizeof(RecordHeader));
+    Offset += sizeof(RecordHeader) + RecordHeader[2] * RecordHeader[3] * sizeof(double);
+  }
+  /* The last record is the distances and the score */
+  memcpy(&ResultScore1, (char *)CaptureDump + Offset - sizeof(double), sizeof(double));
+  printf("Captured %u records, %u bytes, Score = %.2f, should be %.2f.\n", CaptureHeader[3], (uint32_t)CaptureSize,
+         (float)ResultScore1, (float)ResultScore);
+  if (Offset != CaptureSize || RecordHeader[0] != IVCMP_CAPTURE_SCORE || ResultScore1 != ResultScore)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* Records not fitting the buffer are dropped */
+  SetContextCaptureBuffer(CtxCapture, CaptureDump, 1000);
+  CompareIVCWithContext(CtxCapture, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore);
+  memcpy(CaptureHeader, CaptureDump, sizeof(CaptureHeader));
+  if (GetContextCaptureSize(CtxCapture) > 1000 || CaptureHeader[4] != 1)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  SetContextCapture(CtxCapture, CountRecord, &NumCaptured);
+  CompareIVCWithContext(CtxCapture, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore);
+  SetContextCapture(CtxCapture, NULL, NULL);
+  CompareIVCWithContext(CtxCapture, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore);
+  if (NumCaptured != 12)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCContext(CtxCapture);
+
+  printf("--- Test 21. Resample long curves by their length.\n");
+  ivcmp_context_t *CtxResample = CreateIVCContext();
+  static double LongVoltagesA[NUM_LONG_POINTS], LongCurrentsA[NUM_LONG_POINTS];
+  static double LongVoltagesB[NUM_LONG_POINTS], LongCurrentsB[NUM_LONG_POINTS];
+  uint32_t SplinedLength = 0;
+  double Step;
+  for (i = 0; i < NUM_LONG_POINTS; i++)
+  {
+    LongVoltagesA[i] = VOLTAGE_AMPL * sin(2 * M_PI * i / NUM_LONG_POINTS);
+    LongCurrentsA[i] = CURRENT_AMPL * cos(2 * M_PI * i / NUM_LONG_POINTS);
+    LongVoltagesB[i] = LongVoltagesA[i];
+    LongCurrentsB[i] = 0.8 * CURRENT_AMPL * cos(M_PI / 8 + 2 * M_PI * i / NUM_LONG_POINTS);
+  }
+  SetContextMinVarVC(CtxResample, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  CompareIVCWithContext(CtxResample, LongVoltagesA, LongCurrentsA, NUM_LONG_POINTS,
+                        LongVoltagesB, LongCurrentsB, NUM_LONG_POINTS, &ResultScore);
+  SetContextCapture(CtxResample, KeepSplinedLength, &SplinedLength);
+  if (SetContextResampling(CtxResample, -1.) != IVCMP_ERROR_INVALID_ARGUMENT ||
+      SetContextResampling(CtxResample, 0.1) != IVCMP_OK ||
+      GetContextResampling(CtxResample, &Step) != IVCMP_OK || Step != 0.1 ||
+      GetContextResampling(NULL, &Step) != IVCMP_ERROR_NULL_POINTER ||
+      CompareIVCWithContext(CtxResample, LongVoltagesA, LongCurrentsA, NUM_LONG_POINTS,
+                            LongVoltagesB, LongCurrentsB, NUM_LONG_POINTS, &ResultScore1) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  printf("Score of %u points = %.4f, score of %u points = %.4f.\n", NUM_LONG_POINTS, (float)ResultScore,
+         SplinedLength, (float)ResultScore1);
+  if (SplinedLength >= NUM_LONG_POINTS / 4 || fabs(ResultScore1 - ResultScore) > 0.005)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCContext(CtxResample);
+
+  printf("--- Test 22. Take the scores of repeated pairs from the cache.\n");
+  ivcmp_context_t *CtxScores = CreateIVCContext();
+  ivcmp_cache_stats_t CacheStats;
+  ivcmp_verdict_t VerdictResults;
+  SetContextMinVarVC(CtxScores, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  if (SetIVCCacheCapacity(2) != IVCMP_OK ||
+      CompareIVCThreshold(CtxScores, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                          IVCCapacitor.Voltages, IVCCapacitor.Currents, CurveLength, 0.01,
+                          &VerdictResults, &ResultScore2) != IVCMP_OK ||
+      CompareIVCWithContext(CtxScores, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                            IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore) != IVCMP_OK ||
+      CompareIVCWithContext(CtxScores, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                            IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore1) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* Other thresholds and curves are other keys, the least recently used pairs are evicted */
+  SetContextMinVarVC(CtxScores, VOLTAGE_AMPL / 100, CURRENT_AMPL / 100);
+  CompareIVCWithContext(CtxScores, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore2);
+  CompareIVCWithContext(CtxScores, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCCapacitor.Voltages, IVCCapacitor.Currents, CurveLength, &ResultScore2);
+  SetContextMinVarVC(CtxScores, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  CompareIVCWithContext(CtxScores, IVCResistor1.Voltages, IVCResistor1.Currents, CurveLength,
+                        IVCResistor2.Voltages, IVCResistor2.Currents, CurveLength, &ResultScore2);
+  GetIVCCacheStats(&CacheStats);
+  printf("Score = %.4f, cached Score = %.4f; %u hits, %u misses, %u evictions, %u of %u entries.\n",
+         (float)ResultScore, (float)ResultScore1, (unsigned)CacheStats.Hits, (unsigned)CacheStats.Misses,
+         (unsigned)CacheStats.Evictions, CacheStats.Entries, CacheStats.Capacity);
+  /* Lower bound of the score of the failed threshold check is not stored */
+  if (VerdictResults != IVCMP_VERDICT_FAIL || ResultScore1 != ResultScore || ResultScore2 != ResultScore ||
+      CacheStats.Hits != 1 || CacheStats.Misses != 5 || CacheStats.Evictions != 2 ||
+      CacheStats.Entries != 2 || CacheStats.Capacity != 2)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  SetIVCCacheCapacity(0);
+  GetIVCCacheStats(&CacheStats);
+  if (CacheStats.Capacity != 0 || CacheStats.Entries != 0 || GetIVCCacheStats(NULL) != IVCMP_ERROR_NULL_POINTER)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCContext(CtxScores);
+
+  printf("--- Test 23. Find the nearest nodes of long curves for both directions at once.\n");
+  ivcmp_context_t *CtxFused = CreateIVCContext();
+  ivcmp_verdict_t VerdictFused;
+  SetContextMinVarVC(CtxFused, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  SetIVCKernel(IVCMP_KERNEL_SCALAR);
+  CompareIVCWithContext(CtxFused, LongVoltagesA, LongCurrentsA, NUM_LONG_POINTS,
+                        LongVoltagesB, LongCurrentsB, NUM_LONG_POINTS, &ResultScore1);
+  for (Kernel = IVCMP_KERNEL_SCALAR; Kernel <= IVCMP_KERNEL_AVX512; Kernel++)
+  {
+    if (SetIVCKernel(Kernel) != IVCMP_OK)
+    {
+      continue;
+    }
+    /* The threshold check searches the nodes of each direction separately */
+    if (CompareIVCWithContext(CtxFused, LongVoltagesA, LongCurrentsA, NUM_LONG_POINTS,
+                              LongVoltagesB, LongCurrentsB, NUM_LONG_POINTS, &ResultScore) != IVCMP_OK ||
+        CompareIVCThreshold(CtxFused, LongVoltagesA, LongCurrentsA, NUM_LONG_POINTS,
+                            LongVoltagesB, LongCurrentsB, NUM_LONG_POINTS, 0.99, &VerdictFused,
+                            &ResultScore2) != IVCMP_OK)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+    printf("Kernel %s Score = %.4f, threshold check Score = %.4f.\n", GetIVCKernelName(Kernel), (float)ResultScore,
+           (float)ResultScore2);
+    if (ResultScore != ResultScore1 || ResultScore2 != ResultScore || VerdictFused != IVCMP_VERDICT_PASS)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  SetIVCKernel(ActiveKernel);
+  DestroyIVCContext(CtxFused);
+
+  printf("--- Test 24. Search the nearest nodes of long curves around the previous ones.\n");
+  ivcmp_context_t *CtxWindow = CreateIVCContext();
+  ivcmp_prepared_t *PreparedLongA, *PreparedLongB;
+  ivcmp_stream_t *StreamLong;
+  SetContextMinVarVC(CtxWindow, VOLTAGE_AMPL * 3 / 100, CURRENT_AMPL * 3 / 100);
+  if (PrepareIVC(CtxWindow, LongVoltagesA, LongCurrentsA, NUM_LONG_POINTS, &PreparedLongA) != IVCMP_OK ||
+      PrepareIVC(CtxWindow, LongVoltagesB, LongCurrentsB, NUM_LONG_POINTS, &PreparedLongB) != IVCMP_OK ||
+      CompareIVCPrepared(CtxWindow, PreparedLongA, PreparedLongB, &ResultScore) != IVCMP_OK ||
+      CreateIVCStream(CtxWindow, PreparedLongA, NUM_LONG_POINTS, &StreamLong) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  /* The stream finds the nearest reference node of each sample starting from the node of the previous one */
+  for (i = 0; i < NUM_LONG_POINTS; i++)
+  {
+    PushIVCStreamSample(StreamLong, LongVoltagesB[i], LongCurrentsB[i]);
+  }
+  FinishIVCStream(CtxWindow, StreamLong, &ResultScore1);
+  printf("Score = %.4f, stream Score = %.4f.\n", (float)ResultScore, (float)ResultScore1);
+  if (ResultScore1 != ResultScore)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  DestroyIVCStream(StreamLong);
+  DestroyPreparedIVC(PreparedLongA);
+  DestroyPreparedIVC(PreparedLongB);
+  DestroyIVCContext(CtxWindow);
+
+  printf("--- Test 25. Bound the scores of curves prepared with larger scaling thresholds.\n");
+  ivcmp_context_t *CtxCoarse = CreateIVCContext();
+  ivcmp_context_t *CtxFine = CreateIVCContext();
+  static double ScaleVoltages[NUM_SCALE_CURVES + 1][NUM_SCALE_POINTS];
+  static double ScaleCurrents[NUM_SCALE_CURVES + 1][NUM_SCALE_POINTS];
+  ivcmp_prepared_t *ScaleCurves[NUM_SCALE_CURVES + 1];
+  uint32_t BruteIndex = 0;
+  double BruteScore = HUGE_VAL;
+  SetContextMinVarVC(CtxCoarse, 100., 100.);
+  SetContextMinVarVC(CtxFine, 1e-3, 1e-3);
+  /* Points of the first half of curve 0 are repeats only with the thresholds of the preparation */
+  for (i = 0; i < NUM_SCALE_POINTS / 2; i++)
+  {
+    ScaleVoltages[0][i] = i * 1e-5;
+    ScaleCurrents[0][i] = 0;
+  }
+  MakeCircle(ScaleVoltages[0] + NUM_SCALE_POINTS / 2, ScaleCurrents[0] + NUM_SCALE_POINTS / 2,
+             NUM_SCALE_POINTS / 2, 1.);
+  for (i = 1; i < NUM_SCALE_CURVES; i++)
+  {
+    MakeCircle(ScaleVoltages[i], ScaleCurrents[i], NUM_SCALE_POINTS, 0.27 + 0.02 * i);
+  }
+  /* The last curve is matched against the others */
+  MakeCircle(ScaleVoltages[NUM_SCALE_CURVES], ScaleCurrents[NUM_SCALE_CURVES], NUM_SCALE_POINTS, 0.1);
+  for (i = 0; i <= NUM_SCALE_CURVES; i++)
+  {
+    if (PrepareIVC(CtxCoarse, ScaleVoltages[i], ScaleCurrents[i], NUM_SCALE_POINTS, &ScaleCurves[i]) != IVCMP_OK)
+    {
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  for (i = 0; i < NUM_SCALE_CURVES; i++)
+  {
+    CompareIVCPrepared(CtxFine, ScaleCurves[NUM_SCALE_CURVES], ScaleCurves[i], &ResultScore);
+    GetIVCScoreLowerBound(CtxFine, ScaleCurves[NUM_SCALE_CURVES], ScaleCurves[i], &Bound);
+    if (Bound > ResultScore)
+    {
+      printf("Curve %u Score = %.9f, lower bound = %.9f.\n", i, ResultScore, Bound);
+      printf("Test failed!!!\n");
+      return -1;
+    }
+    if (ResultScore < BruteScore)
+    {
+      BruteScore = ResultScore;
+      BruteIndex = i;
+    }
+  }
+  if (FindIVCBestMatch(CtxFine, ScaleCurves[NUM_SCALE_CURVES], (const ivcmp_prepared_t *const *)ScaleCurves,
+                       NUM_SCALE_CURVES, &BestIndex, &ResultScore) != IVCMP_OK)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  printf("Best match %u, Score = %.6f, brute force %u, Score = %.6f.\n", BestIndex, ResultScore, BruteIndex,
+         BruteScore);
+  if (BestIndex != BruteIndex || ResultScore != BruteScore)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+
+  printf("--- Test 26. Search the index built with larger scaling thresholds.\n");
+  static double IndexVoltages[NUM_INDEX_SCALE_CURVES][NUM_SCALE_POINTS];
+  static double IndexCurrents[NUM_INDEX_SCALE_CURVES][NUM_SCALE_POINTS];
+  double *IndexV[NUM_INDEX_SCALE_CURVES], *IndexC[NUM_INDEX_SCALE_CURVES];
+  uint32_t IndexLengths[NUM_INDEX_SCALE_CURVES];
+  /* Same curves in one node are bounded by the node only */
+  for (i = 0; i < NUM_INDEX_SCALE_CURVES; i++)
+  {
+    if (i < NUM_INDEX_SCALE_CURVES / 2)
+    {
+      memcpy(IndexVoltages[i], ScaleVoltages[0], sizeof(IndexVoltages[i]));
+      memcpy(IndexCurrents[i], ScaleCurrents[0], sizeof(IndexCurrents[i]));
+    }
+    else
+    {
+      MakeCircle(IndexVoltages[i], IndexCurrents[i], NUM_SCALE_POINTS,
+                 0.29 + 0.02 * (i - NUM_INDEX_SCALE_CURVES / 2));
+    }
+    IndexV[i] = IndexVoltages[i];
+    IndexC[i] = IndexCurrents[i];
+    IndexLengths[i] = NUM_SCALE_POINTS;
+  }
+  if (BuildIVCIndex(CtxCoarse, IndexV, IndexC, IndexLengths, NUM_INDEX_SCALE_CURVES, &Index) != IVCMP_OK ||
+      SearchIVCIndex(CtxFine, Index, ScaleCurves[NUM_SCALE_CURVES], NUM_INDEX_RESULTS, Found, FoundScores,
+                     &NumFound) != IVCMP_OK || NumFound != NUM_INDEX_RESULTS)
+  {
+    printf("Test failed!!!\n");
+    return -1;
+  }
+  for (k = 0; k < NumFound; k++)
+  {
+    printf("Match %u: curve %u, Score = %.6f.\n", k, Found[k], FoundScores[k]);
+  }
+  for (i = 0; i < NUM_INDEX_SCALE_CURVES; i++)
+  {
+    PrepareIVC(CtxCoarse, IndexV[i], IndexC[i], IndexLengths[i], &PreparedR2);
+    CompareIVCPrepared(CtxFine, ScaleCurves[NUM_SCALE_CURVES], PreparedR2, &ResultScore);
+    DestroyPreparedIVC(PreparedR2);
+    k = 0;
+    while (k < NumFound && Found[k] != i)
+    {
+      k++;
+    }
+    /* Found curves have their own scores, the others are not more similar */
+    if ((k < NumFound && FoundScores[k] != ResultScore) ||
+        (k == NumFound && ResultScore < FoundScores[NumFound - 1]))
+    {
+      printf("Curve %u Score = %.6f.\n", i, ResultScore);
+      printf("Test failed!!!\n");
+      return -1;
+    }
+  }
+  DestroyIVCIndex(Index);
+  for (i = 0; i <= NUM_SCALE_CURVES; i++)
+  {
+    DestroyPreparedIVC(ScaleCurves[i]);
+  }
+  DestroyIVCContext(CtxCoarse);
+  DestroyIVCContext(CtxFine);
+
   printf("All tests successfully passed.\n");
 
   return 0;
@@ -2,33 +2,62 @@
 This script make debug data plots and save them as .png images.
 
 To obtain plots:
-1. Uncomment DEBUG_FILE_OUTPUT macro in library source file.
-2. Rebuild the library.
-3. Compare two curves with the built library. The library will produce a set of text files with debug data.
-4. Place this script into folder with files with plot data.
-5. Run this script with python.
+1. Compare two curves with capture enabled: call pyivcmp.ivcmp.CaptureIvc(curve_a, curve_b, "capture.bin")
+   or save the buffer given to SetContextCaptureBuffer() (GetContextCaptureSize() bytes) to a file.
+2. Run this script with python: python plot_debug_data.py capture.bin
 """
 
+import struct
+import sys
 import matplotlib.pyplot as plt
 
-
-def read_curve_from_file(file_name):
-    voltages = []
-    currents = []
-    with open(file_name, "r") as f:
-        lines = f.readlines()
-
-    for line in lines:
-        v_str, i_str = line.split()
-        voltages.append(float(v_str))
-        currents.append(float(i_str))
-
-    return voltages, currents
-
-
-def plot_two_curves(plot_name, plot_title, plotfile_prefix=""):
-    a_v, a_i = read_curve_from_file(plot_name + "_a.txt")
-    b_v, b_i = read_curve_from_file(plot_name + "_b.txt")
+CAPTURE_MAGIC = b"IVCMPCAP"
+CAPTURE_HEADER = struct.Struct("=8sIIII")
+CAPTURE_RECORD = struct.Struct("=IIII")
+CAPTURE_TRUNCATED = 1
+
+CAPTURE_INPUT = 0
+CAPTURE_COPIED = 1
+CAPTURE_VARIATIONS = 2
+CAPTURE_SCALED = 3
+CAPTURE_REPEATS_REMOVED = 4
+CAPTURE_SPLINED = 5
+CAPTURE_SCORE = 6
+
+
+def read_capture(file_name):
+    """
+    Reads the capture dump written by the library.
+    Returns dictionary {(stage, curve): arrays}, arrays are (voltages, currents) for curves and (values,) for values.
+    """
+    with open(file_name, "rb") as f:
+        data = f.read()
+
+    magic, version, num_records, flags, _ = CAPTURE_HEADER.unpack_from(data, 0)
+    if magic != CAPTURE_MAGIC or version != 1:
+        raise ValueError("{} is not a capture dump".format(file_name))
+    if flags & CAPTURE_TRUNCATED:
+        print("Capture buffer was too small, some stages are lost")
+
+    records = {}
+    offset = CAPTURE_HEADER.size
+    for _ in range(num_records):
+        stage, curve, length, num_arrays = CAPTURE_RECORD.unpack_from(data, offset)
+        offset += CAPTURE_RECORD.size
+        arrays = []
+        for _ in range(num_arrays):
+            arrays.append(list(struct.unpack_from("={}d".format(length), data, offset)))
+            offset += 8 * length
+        records[(stage, curve)] = arrays
+    return records
+
+
+def plot_two_curves(records, stage, plot_name, plot_title, plotfile_prefix=""):
+    if (stage, 0) not in records or (stage, 1) not in records:
+        print("Stage {} is not captured".format(plot_name))
+        return
+    a_v, a_i = records[(stage, 0)]
+    b_v, b_i = records[(stage, 1)]
 
     plt.figure(figsize=(12, 5))
     plt.suptitle(plot_title)
@@ -60,8 +89,14 @@ def plot_two_curves(plot_name, plot_title, plotfile_prefix=""):
     # plt.show()
 
 
-plot_two_curves("input_curve", "Входные сигналы", "1")
-plot_two_curves("copied_curve", "Скопированные кривые", "2")
-plot_two_curves("scaled", "Кривые после масштабирования", "3")
-plot_two_curves("repeats_removed", "Кривые после устранения повторов", "4")
-plot_two_curves("splined", "После равномерного распределения точек", "5")
+capture = read_capture(sys.argv[1] if len(sys.argv) > 1 else "capture.bin")
+if (CAPTURE_VARIATIONS, 0) in capture:
+    print("VarV = {}\nVarC = {}".format(*capture[(CAPTURE_VARIATIONS, 0)][0]))
+if (CAPTURE_SCORE, 0) in capture:
+    print("dist_a_b = {}\ndist_b_a = {}\nscore = {}".format(*capture[(CAPTURE_SCORE, 0)][0]))
+
+plot_two_curves(capture, CAPTURE_INPUT, "input_curve", "Входные сигналы", "1")
+plot_two_curves(capture, CAPTURE_COPIED, "copied_curve", "Скопированные кривые", "2")
+plot_two_curves(capture, CAPTURE_SCALED, "scaled", "Кривые после масштабирования", "3")
+plot_two_curves(capture, CAPTURE_REPEATS_REMOVED, "repeats_removed", "Кривые после устранения повторов", "4")
+plot_two_curves(capture, CAPTURE_SPLINED, "splined", "После равномерного распределения точек", "5")